@@ -6,14 +6,19 @@
  * SCL; 2014-2015
  */
 
+#define _POSIX_C_SOURCE 200809L
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
+#include <time.h>
 
 #include "common.h"
 #include "logging.h"
 #include "automaton.h"
+#include "aut_sim.h"
 #include "ptree.h"
+#include "spc_cache.h"
 extern int yyparse( void );
 extern void yyrestart( FILE *new_file );
 
@@ -32,24 +37,259 @@ extern specification_t spc;
 #define OUTPUT_FORMAT_DOT 2
 #define OUTPUT_FORMAT_AUT 3
 #define OUTPUT_FORMAT_JSON 5
+#define OUTPUT_FORMAT_BIN 6
+#define OUTPUT_FORMAT_JSON_COMPACT 7
+#define OUTPUT_FORMAT_JSONL 8
+#define OUTPUT_FORMAT_AUT2 9
 
 /* Runtime modes */
 #define AUTMAN_SYNTAX 1
 #define AUTMAN_VARTYPES 2
 #define AUTMAN_VERMODEL 3
 #define AUTMAN_CONVERT 4
+#define AUTMAN_QUERY 5
+#define AUTMAN_SIM 6
+
+/* Default number of steps of each play in simulations (cf. "-n") */
+#define SIM_PLAY_LEN 1000
 
 /* Verification model targets */
 #define VERMODEL_TARGET_SPIN 1
 
+/* Level of gzip compression, if selected by "-z" or a file name
+   ending in ".gz" */
+#define OUTPUT_GZ_LEVEL 6
+
+
+/* State kept across queries (cf. answer_query()) */
+typedef struct {
+    aut_bin_t *bin;
+    vartype *state;
+    int *visited;  /* Number of the last "near" query reaching each node */
+    int *queue;
+    int num_near;
+} query_ctx_t;
+
+
+/* Open a view of the strategy in fp for answering queries.  Input in
+   the gr1c automaton format is converted to the binary format in a
+   temporary file, which provides the node offset table; the index of
+   states is built by aut_bin_find() when first needed. */
+static aut_bin_t *open_query_view( FILE *fp, int state_len,
+                                   unsigned char verbose )
+{
+    anode_t *head;
+    aut_bin_t *bin;
+    FILE *tmp_fp;
+    int c;
+
+    c = getc( fp );
+    if (c != EOF)
+        ungetc( c, fp );
+    if (c == *BIN_AUT_MAGIC) {
+        if (verbose > 1)
+            logprint( "Detected binary strategy format." );
+        bin = aut_bin_open( fp );
+    } else {
+        if (verbose)
+            logprint( "Converting automaton to binary format for queries;"
+                      " use -t bin to do this once." );
+        head = aut_aut_loadver( state_len, fp, NULL );
+        if (head == NULL)
+            return NULL;
+        tmp_fp = tmpfile();
+        if (tmp_fp == NULL) {
+            perror( "gr1c-autman, tmpfile" );
+            delete_aut( head );
+            return NULL;
+        }
+        if (bin_aut_dump( head, NULL, NULL, state_len, tmp_fp )) {
+            fclose( tmp_fp );
+            delete_aut( head );
+            return NULL;
+        }
+        delete_aut( head );
+        fflush( tmp_fp );
+        rewind( tmp_fp );
+        bin = aut_bin_open( tmp_fp );
+        fclose( tmp_fp );
+    }
+    if (bin != NULL && bin->state_len != state_len) {
+        fprintf( stderr,
+                 "Error: state vector length of strategy is %d,"
+                 " but %d was expected.\n", bin->state_len, state_len );
+        aut_bin_close( bin );
+        return NULL;
+    }
+    return bin;
+}
+
+
+/* Print node i as a line of the gr1c automaton format (version 1). */
+static void print_query_node( query_ctx_t *ctx, int i, FILE *fp )
+{
+    uint64_t k;
+    int j;
+
+    aut_bin_state( ctx->bin, i, ctx->state );
+    fprintf( fp, "%d", i );
+    for (j = 0; j < ctx->bin->state_len; j++)
+        fprintf( fp, " %d", *(ctx->state+j) );
+    fprintf( fp, " %d %d %d", *(ctx->bin->initial+i),
+             *(ctx->bin->modes+i), *(ctx->bin->rgrads+i) );
+    for (k = *(ctx->bin->offsets+i); k < *(ctx->bin->offsets+i+1); k++)
+        fprintf( fp, " %u", (unsigned int)*(ctx->bin->targets+k) );
+    fprintf( fp, "\n" );
+}
+
+
+/* Read a node index from the next token of query.  Return 0 on
+   success, -1 if missing or out of range. */
+static int query_node_arg( query_ctx_t *ctx, int *i )
+{
+    char *tok = strtok( NULL, " \t\r\n" ), *end;
+    long x;
+    if (tok == NULL)
+        return -1;
+    x = strtol( tok, &end, 10 );
+    if (*end != '\0' || x < 0 || x >= ctx->bin->num_nodes)
+        return -1;
+    *i = x;
+    return 0;
+}
+
+
+/* Answer a query and end the response with a blank line.  Queries
+   are "node I", "succ I", "near I K", and "find M S", as described in
+   the help message.  Return 0 on success, -1 if the query is
+   malformed, in which case the response is a line beginning with
+   "error:". */
+static int answer_query( query_ctx_t *ctx, char *query, FILE *fp )
+{
+    aut_bin_t *bin = ctx->bin;
+    char *cmd, *tok, *end;
+    int i, j, depth, head, tail, level_end;
+    uint64_t k;
+    long x;
+
+    cmd = strtok( query, " \t\r\n" );
+    if (cmd == NULL) {
+        fprintf( fp, "error: empty query\n\n" );
+        return -1;
+    }
+
+    if (!strcmp( cmd, "node" ) || !strcmp( cmd, "succ" )) {
+        if (query_node_arg( ctx, &i ) || strtok( NULL, " \t\r\n" ) != NULL) {
+            fprintf( fp, "error: expected \"%s I\" with 0 <= I < %d\n\n",
+                     cmd, bin->num_nodes );
+            return -1;
+        }
+        if (*cmd == 'n') {
+            print_query_node( ctx, i, fp );
+        } else {
+            for (k = *(bin->offsets+i); k < *(bin->offsets+i+1); k++)
+                fprintf( fp, (k == *(bin->offsets+i)) ? "%u" : " %u",
+                         (unsigned int)*(bin->targets+k) );
+            fprintf( fp, "\n" );
+        }
+
+    } else if (!strcmp( cmd, "near" )) {
+        tok = NULL;
+        if (query_node_arg( ctx, &i ) == 0)
+            tok = strtok( NULL, " \t\r\n" );
+        x = -1;
+        if (tok != NULL)
+            x = strtol( tok, &end, 10 );
+        if (tok == NULL || *end != '\0' || x < 0
+            || strtok( NULL, " \t\r\n" ) != NULL) {
+            fprintf( fp, "error: expected \"near I K\" with 0 <= I < %d"
+                     " and K >= 0\n\n", bin->num_nodes );
+            return -1;
+        }
+        if (ctx->visited == NULL) {
+            ctx->visited = calloc( bin->num_nodes, sizeof(int) );
+            ctx->queue = malloc( bin->num_nodes*sizeof(int) );
+            if (ctx->visited == NULL || ctx->queue == NULL) {
+                perror( "gr1c-autman, malloc" );
+                exit(-1);
+            }
+        }
+        ctx->num_near++;
+
+        /* Breadth-first search to depth K, printing nodes as reached */
+        *(ctx->queue) = i;
+        *(ctx->visited+i) = ctx->num_near;
+        head = 0;
+        tail = 1;
+        for (depth = 0; head < tail; depth++) {
+            level_end = tail;
+            for (; head < level_end; head++) {
+                i = *(ctx->queue+head);
+                print_query_node( ctx, i, fp );
+                if (depth == x)
+                    continue;
+                for (k = *(bin->offsets+i); k < *(bin->offsets+i+1); k++) {
+                    j = *(bin->targets+k);
+                    if (*(ctx->visited+j) != ctx->num_near) {
+                        *(ctx->visited+j) = ctx->num_near;
+                        *(ctx->queue+tail) = j;
+                        tail++;
+                    }
+                }
+            }
+        }
+
+    } else if (!strcmp( cmd, "find" )) {
+        tok = strtok( NULL, " \t\r\n" );
+        x = 0;
+        if (tok != NULL)
+            x = strtol( tok, &end, 10 );
+        for (j = 0; tok != NULL && *end == '\0' && j < bin->state_len; j++) {
+            tok = strtok( NULL, " \t\r\n" );
+            if (tok != NULL)
+                *(ctx->state+j) = strtol( tok, &end, 10 );
+        }
+        if (tok == NULL || *end != '\0' || x < -1 || x > INT_MAX
+            || strtok( NULL, " \t\r\n" ) != NULL) {
+            fprintf( fp, "error: expected \"find M S\" with mode M >= -1"
+                     " and state S of length %d\n\n", bin->state_len );
+            return -1;
+        }
+        for (i = aut_bin_find( bin, ctx->state, x, -1 ), j = 0; i >= 0;
+             i = aut_bin_find( bin, ctx->state, x, i ), j++)
+            fprintf( fp, (j == 0) ? "%d" : " %d", i );
+        fprintf( fp, "\n" );
+
+    } else {
+        fprintf( fp, "error: unrecognized query \"%s\"\n\n", cmd );
+        return -1;
+    }
+
+    fprintf( fp, "\n" );
+    return 0;
+}
+
 
 int main( int argc, char **argv )
 {
     FILE *fp;
     int i, j;
+    int c;
     int in_filename_index = -1;
     FILE *in_fp = NULL;
-    anode_t *head;
+    anode_t *head = NULL;
+    aut_bin_t *bin = NULL;
+    query_ctx_t query_ctx;
+    int query_index = -1;  /* For command-line flag "-q". */
+    aut_sim_stats_t sim_stats;
+    int num_plays = 0;  /* For command-line flag "-r". */
+    int play_len = SIM_PLAY_LEN;  /* For command-line flag "-n". */
+    int num_threads = 1;  /* For command-line flag "-j". */
+    uint64_t seed = 0;
+    bool seed_flag = False;  /* For command-line flag "-S". */
+    char *line = NULL;
+    size_t line_cap = 0;
+    int result = 0;
     int version;
     int state_len = -1;
     byte format_option = OUTPUT_FORMAT_JSON;
@@ -60,6 +300,8 @@ int main( int argc, char **argv )
     int run_option = AUTMAN_SYNTAX;
     int spc_file_index = -1;
     int output_file_index = -1;  /* For command-line flag "-o". */
+    bool compress_flag = False;  /* For command-line flag "-z". */
+    size_t len;
     FILE *spc_fp;
 
     for (i = 1; i < argc; i++) {
@@ -71,7 +313,7 @@ int main( int argc, char **argv )
             }
 
             if (argv[i][1] == 'h') {
-                printf( "Usage: %s [-hVvlsP] [-t TYPE] [-L N] [-i FILE] [-o FILE] [FILE]\n\n"
+                printf( "Usage: %s [-hVvlsPz] [-t TYPE] [-q QUERY] [-r N [-n LEN] [-j N] [-S SEED]] [-L N] [-i FILE] [-o FILE] [FILE]\n\n"
                         "If no input file is given, or if FILE is -, read from stdin.  If no action\n"
                         "is requested, then assume -s.\n\n"
                         "  -h          this help message\n"
@@ -79,17 +321,42 @@ int main( int argc, char **argv )
                         "  -v          be verbose; use -vv to be more verbose\n"
                         "  -l          enable logging\n"
                         "  -s          check syntax and get version;\n"
-                        "              print format version number, or -1 if error.\n",
+                        "              print format version number, or -1 if error.\n"
+                        "              Input in the binary format or compressed with gzip\n"
+                        "              is detected automatically.\n",
                         argv[0] );
 /*                        "  -ss         extends -s to also check the number of and values\n"
                         "              assigned to variables, given specification.\n" */
-                printf( "  -t TYPE     convert to format: txt, dot, aut, json, tulip\n"
+                printf( "  -t TYPE     convert to format: txt, dot, aut, aut2, json,\n"
+                        "              json-compact, jsonl, tulip, bin\n"
                         "              some of these require a reference specification.\n"
                         "  -P          create Spin Promela model of strategy\n"
                         "              if used with -o, then the LTL formula is printed to stdout.\n"
                         "  -L N        declare that state vector size is N\n"
                         "  -i FILE     process strategy with respect to specification FILE\n"
-                        "  -o FILE     output to FILE, rather than stdout (default)\n" );
+                        "  -o FILE     output to FILE, rather than stdout (default)\n"
+                        "  -z          compress output of -t with gzip; this is also done\n"
+                        "              for output files with names ending in \".gz\"\n" );
+                printf( "  -q QUERY    answer QUERY without loading the whole strategy, or if\n"
+                        "              QUERY is -, answer queries from stdin, one per line;\n"
+                        "              each response ends with a blank line.  Queries are\n"
+                        "                node I    print node I as in aut format version 1\n"
+                        "                succ I    print successors of node I\n"
+                        "                near I K  print nodes reachable from I in at most\n"
+                        "                          K steps, in breadth-first order\n"
+                        "                find M S  print nodes with mode M (or any, if -1)\n"
+                        "                          and state S, given as space-separated values\n"
+                        "              Input in aut format is converted to the binary format,\n"
+                        "              which serves as index, so convert it once with -t bin\n"
+                        "              for many queries.\n" );
+                printf( "  -r N        run N random plays of the strategy and print statistics\n"
+                        "              of goal visits, mode cycles, and steps per second;\n"
+                        "              the strategy is viewed as for -q.\n"
+                        "  -n LEN      play at most LEN steps in each play of -r (default %d)\n"
+                        "  -j N        run plays of -r in up to N threads\n"
+                        "  -S SEED     seed the random choices of -r; by default, the current\n"
+                        "              time is used.  Results do not depend on -j.\n",
+                        SIM_PLAY_LEN );
                 return 0;
             } else if (argv[i][1] == 'V') {
                 printf( "gr1c-autman (automaton file manipulator, distributed with"
@@ -123,10 +390,18 @@ int main( int argc, char **argv )
                     format_option = OUTPUT_FORMAT_TULIP;
                 } else if (!strncmp( argv[i+1], "dot", strlen( "dot" ) )) {
                     format_option = OUTPUT_FORMAT_DOT;
+                } else if (!strcmp( argv[i+1], "aut2" )) {
+                    format_option = OUTPUT_FORMAT_AUT2;
                 } else if (!strncmp( argv[i+1], "aut", strlen( "aut" ) )) {
                     format_option = OUTPUT_FORMAT_AUT;
+                } else if (!strcmp( argv[i+1], "json-compact" )) {
+                    format_option = OUTPUT_FORMAT_JSON_COMPACT;
+                } else if (!strcmp( argv[i+1], "jsonl" )) {
+                    format_option = OUTPUT_FORMAT_JSONL;
                 } else if (!strncmp( argv[i+1], "json", strlen( "json" ) )) {
                     format_option = OUTPUT_FORMAT_JSON;
+                } else if (!strncmp( argv[i+1], "bin", strlen( "bin" ) )) {
+                    format_option = OUTPUT_FORMAT_BIN;
                 } else {
                     fprintf( stderr,
                              "Unrecognized output format. Try \"-h\".\n" );
@@ -147,6 +422,43 @@ int main( int argc, char **argv )
                 }
                 state_len = strtol( argv[i+1], NULL, 10 );
                 i++;
+            } else if (argv[i][1] == 'q') {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                run_option = AUTMAN_QUERY;
+                query_index = i+1;
+                i++;
+            } else if (argv[i][1] == 'r' || argv[i][1] == 'n'
+                       || argv[i][1] == 'j') {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                j = strtol( argv[i+1], NULL, 10 );
+                if (j < 1) {
+                    fprintf( stderr, "Argument of -%c must be positive.\n",
+                             argv[i][1] );
+                    return 1;
+                }
+                if (argv[i][1] == 'r') {
+                    run_option = AUTMAN_SIM;
+                    num_plays = j;
+                } else if (argv[i][1] == 'n') {
+                    play_len = j;
+                } else {
+                    num_threads = j;
+                }
+                i++;
+            } else if (argv[i][1] == 'S') {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                seed = strtoull( argv[i+1], NULL, 10 );
+                seed_flag = True;
+                i++;
             } else if (argv[i][1] == 'P') {
                 run_option = AUTMAN_VERMODEL;
                 verification_model = VERMODEL_TARGET_SPIN;
@@ -157,6 +469,8 @@ int main( int argc, char **argv )
                 }
                 output_file_index = i+1;
                 i++;
+            } else if (argv[i][1] == 'z') {
+                compress_flag = True;
             } else {
                 fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
                 return 1;
@@ -176,6 +490,8 @@ int main( int argc, char **argv )
     if (run_option == AUTMAN_CONVERT && spc_file_index < 0
         && (format_option == OUTPUT_FORMAT_DOT
             || format_option == OUTPUT_FORMAT_JSON
+            || format_option == OUTPUT_FORMAT_JSON_COMPACT
+            || format_option == OUTPUT_FORMAT_JSONL
             || format_option == OUTPUT_FORMAT_TULIP)) {
         fprintf( stderr,
                  "Conversion of output to selected format requires a"
@@ -183,6 +499,25 @@ int main( int argc, char **argv )
         return 1;
     }
 
+    if (output_file_index >= 0) {
+        len = strlen( argv[output_file_index] );
+        if (len >= 3 && !strcmp( argv[output_file_index]+len-3, ".gz" ))
+            compress_flag = True;
+    }
+    if (compress_flag && run_option == AUTMAN_CONVERT) {
+        if (format_option == OUTPUT_FORMAT_BIN) {
+            fprintf( stderr,
+                     "The binary strategy format cannot be compressed.\n" );
+            return 1;
+        }
+        if (aut_dump_set_compression( OUTPUT_GZ_LEVEL )) {
+            fprintf( stderr,
+                     "Compressed output requires gr1c to be built"
+                     " with zlib.\n" );
+            return 1;
+        }
+    }
+
     if (spc_file_index < 0 && state_len < 1) {
         if (state_len < 0)
             fprintf( stderr,
@@ -194,6 +529,13 @@ int main( int argc, char **argv )
         return 1;
     }
 
+    if (run_option == AUTMAN_QUERY && !strcmp( argv[query_index], "-" )
+        && (in_filename_index < 0 || !strncmp( argv[in_filename_index], "-", 1 ))) {
+        fprintf( stderr,
+                 "Queries cannot be read from stdin when the strategy is.\n" );
+        return 1;
+    }
+
 /*    if (run_option == AUTMAN_VARTYPES && spc_file_index < 0) {
         fprintf( stderr,
                  "-ss flag requires a reference specification to be given"
@@ -218,17 +560,27 @@ int main( int argc, char **argv )
             logprint( "Using file \"%s\" for reference specification.",
                       argv[spc_file_index] );
 
-        spc_fp = fopen( argv[spc_file_index], "r" );
+        spc_fp = fopen( argv[spc_file_index], "rb" );
         if (spc_fp == NULL) {
             perror( "gr1c-autman, fopen" );
             return -1;
         }
-        yyrestart( spc_fp );
-        if (verbose)
-            logprint( "Parsing reference specification file..." );
         SPC_INIT( spc );
-        if (yyparse())
-            return 2;
+        if (spc_cache_detect( spc_fp )) {
+            /* Only variable lists are needed, so the expanded part,
+               if any, is ignored. */
+            if (verbose)
+                logprint( "Loading compiled reference specification..." );
+            if (spc_cache_load( spc_fp, SPC_CACHE_ANY, &spc, NULL,
+                                0, verbose ) < 0)
+                return 2;
+        } else {
+            yyrestart( spc_fp );
+            if (verbose)
+                logprint( "Parsing reference specification file..." );
+            if (yyparse())
+                return 2;
+        }
         if (verbose)
             logprint( "Done." );
         fclose( spc_fp );
@@ -246,32 +598,59 @@ int main( int argc, char **argv )
     } else {
         if (verbose > 1)
             logprint( "Using file \"%s\" for input.", argv[in_filename_index] );
-        in_fp = fopen( argv[in_filename_index], "r" );
+        in_fp = fopen( argv[in_filename_index], "rb" );
         if (in_fp == NULL) {
             perror( "autman, fopen" );
             return -1;
         }
     }
 
-    if (verbose > 1)
-        logprint( "Loading automaton..." );
-    head = aut_aut_loadver( state_len, in_fp, &version );
-    if (head == NULL) {
+    if (run_option == AUTMAN_QUERY || run_option == AUTMAN_SIM) {
+        if (verbose > 1)
+            logprint( "Opening view of automaton..." );
+        bin = open_query_view( in_fp, state_len, verbose );
+        if (bin == NULL) {
+            if (verbose)
+                fprintf( stderr, "Error: failed to load aut.\n" );
+            return 3;
+        }
         if (verbose)
-            fprintf( stderr, "Error: failed to load aut.\n" );
-        return 3;
-    }
-    if (verbose > 1)
-        logprint( "Done." );
-    if (verbose) {
-        logprint( "Detected format version %d.", version );
-        logprint( "Given automaton has size %d.", aut_size( head ) );
+            logprint( "Given automaton has size %d.", bin->num_nodes );
+    } else {
+        if (verbose > 1)
+            logprint( "Loading automaton..." );
+        /* Files in the binary format begin with a magic string,
+           whereas those in the gr1c automaton format begin with a
+           digit, a comment, or blank space. */
+        c = getc( in_fp );
+        if (c != EOF)
+            ungetc( c, in_fp );
+        if (c == *BIN_AUT_MAGIC) {
+            if (verbose > 1)
+                logprint( "Detected binary strategy format." );
+            head = bin_aut_loadver( state_len, in_fp, &version );
+        } else {
+            head = aut_aut_loadver( state_len, in_fp, &version );
+        }
+        if (head == NULL) {
+            if (verbose)
+                fprintf( stderr, "Error: failed to load aut.\n" );
+            return 3;
+        }
+        if (verbose > 1)
+            logprint( "Done." );
+        if (verbose) {
+            logprint( "Detected format version %d.", version );
+            logprint( "Given automaton has size %d.", aut_size( head ) );
+        }
     }
 
 
     /* Open output file if specified; else point to stdout. */
     if (output_file_index >= 0) {
-        fp = fopen( argv[output_file_index], "w" );
+        fp = fopen( argv[output_file_index],
+                    (format_option == OUTPUT_FORMAT_BIN || compress_flag)
+                    ? "wb" : "w" );
         if (fp == NULL) {
             perror( "gr1c, fopen" );
             return -1;
@@ -305,13 +684,75 @@ int main( int argc, char **argv )
                           DOT_AUT_ATTRIB, fp );
         } else if (format_option == OUTPUT_FORMAT_AUT) {
             aut_aut_dump( head, state_len, fp );
+        } else if (format_option == OUTPUT_FORMAT_AUT2) {
+            aut_aut_dumpver( head, state_len, fp, 2 );
+        } else if (format_option == OUTPUT_FORMAT_BIN) {
+            if (spc_file_index >= 0) {
+                bin_aut_dump( head, spc.evar_list, spc.svar_list,
+                              state_len, fp );
+            } else {
+                bin_aut_dump( head, NULL, NULL, state_len, fp );
+            }
         } else if (format_option == OUTPUT_FORMAT_JSON) {
             json_aut_dump( head, spc.evar_list, spc.svar_list, fp );
+        } else if (format_option == OUTPUT_FORMAT_JSON_COMPACT) {
+            json_aut_dumpopt( head, spc.evar_list, spc.svar_list,
+                              JSON_AUT_COMPACT, fp );
+        } else if (format_option == OUTPUT_FORMAT_JSONL) {
+            json_aut_dumpopt( head, spc.evar_list, spc.svar_list,
+                              JSON_AUT_LINES, fp );
         } else { /* OUTPUT_FORMAT_TULIP */
             tulip_aut_dump( head, spc.evar_list, spc.svar_list, fp );
         }
         break;
 
+    case AUTMAN_QUERY:
+        query_ctx.bin = bin;
+        query_ctx.state = malloc( (bin->state_len+1)*sizeof(vartype) );
+        if (query_ctx.state == NULL) {
+            perror( "gr1c-autman, malloc" );
+            return -1;
+        }
+        query_ctx.visited = NULL;
+        query_ctx.queue = NULL;
+        query_ctx.num_near = 0;
+        if (strcmp( argv[query_index], "-" )) {
+            if (answer_query( &query_ctx, argv[query_index], fp ))
+                result = 1;
+        } else {
+            while (getline( &line, &line_cap, stdin ) >= 0) {
+                for (j = 0; *(line+j) == ' ' || *(line+j) == '\t'; j++) ;
+                if (*(line+j) == '\0' || *(line+j) == '\n'
+                    || *(line+j) == '\r' || *(line+j) == '#')
+                    continue;
+                answer_query( &query_ctx, line, fp );
+                fflush( fp );
+            }
+            free( line );
+        }
+        free( query_ctx.state );
+        free( query_ctx.visited );
+        free( query_ctx.queue );
+        aut_bin_close( bin );
+        break;
+
+    case AUTMAN_SIM:
+        if (!seed_flag)
+            seed = time(NULL);
+        if (verbose)
+            logprint( "Running %d plays of at most %d steps in up to %d"
+                      " threads...", num_plays, play_len, num_threads );
+        if (aut_sim_run( bin, num_plays, play_len, seed, num_threads,
+                         &sim_stats )) {
+            aut_bin_close( bin );
+            return -1;
+        }
+        fprintf( fp, "seed: %llu\n", (unsigned long long)seed );
+        aut_sim_print( &sim_stats, fp );
+        aut_sim_free( &sim_stats );
+        aut_bin_close( bin );
+        break;
+
     default:
         fprintf( stderr, "Unrecognized run option.  Try \"-h\".\n" );
         return 1;
@@ -320,5 +761,5 @@ int main( int argc, char **argv )
     if (fp != stdout)
         fclose( fp );
 
-    return 0;
+    return result;
 }
@@ -10,6 +10,7 @@
  */
 
 
+#define _POSIX_C_SOURCE 200809L
 #include <math.h>
 #include <string.h>
 #include <stdio.h>
@@ -20,7 +21,6 @@
 #include "ptree.h"
 #include "solve.h"
 #include "automaton.h"
-#include "util.h"
 #include "solve_metric.h"
 #include "solve_support.h"
 #include "sim.h"
@@ -112,6 +112,7 @@ int main( int argc, char **argv )
     int i, j, var_index;
     ptree_t *tmppt;  /* General purpose temporary ptree pointer */
     int horizon = -1;
+    int num_threads = 1;  /* For command-line flag "-j". */
 
     DdNode *W, *etrans, *strans, **sgoals, **egoals;
 
@@ -187,6 +188,25 @@ int main( int argc, char **argv )
                 }
                 all_vars = NULL;
                 i++;
+            } else if (argv[i][1] == 'j') {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                num_threads = strtol( argv[i+1], NULL, 10 );
+                if (num_threads < 1) {
+                    fprintf( stderr,
+                             "Number of threads must be positive.\n" );
+                    return 1;
+                }
+                i++;
+            } else if (argv[i][1] == 's') {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                sim_set_seed( strtoull( argv[i+1], NULL, 10 ) );
+                i++;
             } else if (argv[i][1] == 'o') {
                 if (i == argc-1) {
                     fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
@@ -207,12 +227,14 @@ int main( int argc, char **argv )
 
     if (help_flag) {
         /* Split among printf() calls to conform with ISO C90 string length */
-        printf( "Usage: %s [-hVvlp] [-m ARG1,ARG2,...] [-o FILE] [FILE]\n\n"
+        printf( "Usage: %s [-hVvlp] [-j N] [-s SEED] [-m ARG1,ARG2,...] [-o FILE] [FILE]\n\n"
                 "  -h          this help message\n"
                 "  -V          print version and exit\n"
                 "  -v          be verbose; use -vv to be more verbose\n"
                 "  -l          enable logging\n"
                 "  -p          dump parse trees to DOT files, and echo formulas to screen\n"
+                "  -j N        compute distances for the horizon in up to N threads\n"
+                "  -s SEED     seed the choice of environment moves in simulation\n"
                 "  -o FILE     output results to FILE, rather than stdout (default)\n", argv[0] );
         printf( "  -m ARG1,... run simulation using comma-separated list of arguments:\n"
                 "                ARG1 is the max simulation duration; -1 to only compute horizon;\n"
@@ -427,7 +449,7 @@ int main( int argc, char **argv )
                             &spc.env_trans_array, &spc.et_array_len,
                             &spc.sys_trans_array, &spc.st_array_len,
                             &spc.env_goals, spc.num_egoals, &spc.sys_goals, spc.num_sgoals,
-                            verbose ) < 0)
+                            ALL_ENV_EXIST_SYS_INIT, verbose ) < 0)
         return -1;
     spc.nonbool_var_list = expand_nonbool_variables( &spc.evar_list, &spc.svar_list,
                                                      verbose );
@@ -469,7 +491,7 @@ int main( int argc, char **argv )
     Cudd_SetMaxCacheHard( manager, (unsigned int)-1 );
     Cudd_AutodynEnable( manager, CUDD_REORDER_SAME );
 
-    T = check_realizable( manager, EXIST_SYS_INIT, verbose );
+    T = check_realizable( manager, ALL_ENV_EXIST_SYS_INIT, verbose );
     if (verbose) {
         if (T != NULL) {
             logprint( "Realizable." );
@@ -483,6 +505,7 @@ int main( int argc, char **argv )
             if (verbose)
                 logprint( "Computing horizon with metric variables: %s",
                           metric_vars );
+            metric_set_threads( num_threads );
             horizon = compute_horizon( manager, &W, &etrans, &strans, &sgoals,
                                        metric_vars, verbose );
             logprint( "horizon: %d", horizon );
@@ -9,6 +9,12 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include "common.h"
 #include "logging.h"
@@ -18,6 +24,7 @@
 #include "automaton.h"
 #include "solve_metric.h"
 #include "gr1c_util.h"
+#include "spc_cache.h"
 extern int yyparse( void );
 extern void yyrestart( FILE *new_file );
 
@@ -47,13 +54,392 @@ extern ptree_t *gen_tree_ptr;
     printf( "gr1c-patch (part of gr1c v" GR1C_VERSION ")\n\n" GR1C_COPYRIGHT "\n" )
 
 
+/* Maximum length of lines read in serve mode */
+#define SERVE_LINE_LEN 1024
+
+/* Nodes of the strategy have IDs that persist across patches in serve
+   mode, so that replies need only describe what changed. */
+typedef struct {
+    int *ids;  /* In the order of the node list */
+    int num_nodes;
+    int next_id;
+
+    /* Snapshot taken before patching */
+    aut_numbering_t *numbering;
+    uint32_t *keys;
+    int *succ_offsets;
+    int *succs;  /* IDs of successors */
+} serve_ids_t;
+
+static uint32_t serve_node_key( anode_t *node, int state_len )
+{
+    uint32_t key = 2166136261u;
+    int i;
+    for (i = 0; i < state_len; i++)
+        key = (key ^ (uint32_t)*(node->state+i)) * 16777619u;
+    key = (key ^ (uint32_t)node->mode) * 16777619u;
+    return (key ^ (uint32_t)node->initial) * 16777619u;
+}
+
+static void *serve_malloc( size_t size )
+{
+    void *ptr = malloc( size > 0 ? size : 1 );
+    if (ptr == NULL) {
+        perror( "gr1c-patch, malloc" );
+        exit(-1);
+    }
+    return ptr;
+}
+
+/* Number nodes consecutively from 0, as in the gr1c automaton format. */
+static void serve_reset_ids( serve_ids_t *sid, anode_t *head )
+{
+    int i;
+    sid->num_nodes = aut_size( head );
+    free( sid->ids );
+    sid->ids = serve_malloc( sid->num_nodes*sizeof(int) );
+    for (i = 0; i < sid->num_nodes; i++)
+        *(sid->ids+i) = i;
+    sid->next_id = sid->num_nodes;
+}
+
+static void serve_snapshot( serve_ids_t *sid, anode_t *head, int state_len )
+{
+    anode_t *node;
+    int i, j, num_edges = 0;
+
+    sid->numbering = aut_number_nodes( head );
+    sid->keys = serve_malloc( sid->num_nodes*sizeof(uint32_t) );
+    sid->succ_offsets = serve_malloc( (sid->num_nodes+1)*sizeof(int) );
+    for (node = head; node != NULL; node = node->next)
+        num_edges += node->trans_len;
+    sid->succs = serve_malloc( num_edges*sizeof(int) );
+
+    *(sid->succ_offsets) = 0;
+    for (node = head, i = 0; node != NULL; node = node->next, i++) {
+        *(sid->keys+i) = serve_node_key( node, state_len );
+        for (j = 0; j < node->trans_len; j++)
+            *(sid->succs + *(sid->succ_offsets+i)+j)
+                = *(sid->ids + aut_numbering_index( sid->numbering,
+                                                    *(node->trans+j) ));
+        *(sid->succ_offsets+i+1) = *(sid->succ_offsets+i) + node->trans_len;
+    }
+}
+
+static void serve_free_snapshot( serve_ids_t *sid )
+{
+    delete_aut_numbering( sid->numbering );
+    sid->numbering = NULL;
+    free( sid->keys );
+    free( sid->succ_offsets );
+    free( sid->succs );
+    sid->keys = NULL;
+    sid->succ_offsets = sid->succs = NULL;
+}
+
+/* Print node as in the gr1c automaton format (version 1), with
+   nonboolean variables compacted using offw and encodings enc. */
+static void serve_print_node( FILE *out, int id, anode_t *node,
+                              int *succ_ids, int state_len,
+                              int *offw, int num_nonbool, int *enc )
+{
+    int i, j;
+    fprintf( out, "%d", id );
+    for (i = 0, j = 0; i < state_len; ) {
+        if (j < num_nonbool && i == *(offw+2*j)) {
+            fprintf( out, " %d", nonbool_to_int( node->state+i, *(offw+2*j+1),
+                                                 *(enc+j) ) );
+            i += *(offw+2*j+1);
+            j++;
+        } else {
+            fprintf( out, " %d", *(node->state+i) );
+            i++;
+        }
+    }
+    fprintf( out, " %d %d %d", node->initial, node->mode, node->rgrad );
+    for (i = 0; i < node->trans_len; i++)
+        fprintf( out, " %d", *(succ_ids+i) );
+    fprintf( out, "\n" );
+}
+
+/* Match nodes of head with those of the snapshot, update the IDs, and
+   reply with the nodes that were deleted, added, or have changed
+   transitions.  The snapshot is freed. */
+static void serve_reply_delta( FILE *out, serve_ids_t *sid, anode_t *head,
+                               struct timespec *start, int state_len,
+                               int *offw, int num_nonbool, int *enc )
+{
+    aut_numbering_t *numbering;
+    anode_t *node;
+    struct timespec end;
+    bool *matched;
+    int *ids, *succ_ids, *old_index;
+    int num_nodes, num_changed = 0, succ_cap = 0;
+    int i, j, k;
+
+    num_nodes = aut_size( head );
+    numbering = aut_number_nodes( head );
+    ids = serve_malloc( num_nodes*sizeof(int) );
+    old_index = serve_malloc( num_nodes*sizeof(int) );
+    matched = serve_malloc( sid->num_nodes*sizeof(bool) );
+    for (k = 0; k < sid->num_nodes; k++)
+        *(matched+k) = False;
+
+    /* Deleted nodes may be freed and their addresses reused, hence
+       the comparison of keys. */
+    for (node = head, i = 0; node != NULL; node = node->next, i++) {
+        k = aut_numbering_index( sid->numbering, node );
+        if (k >= 0 && !*(matched+k)
+            && *(sid->keys+k) == serve_node_key( node, state_len )) {
+            *(matched+k) = True;
+            *(ids+i) = *(sid->ids+k);
+            *(old_index+i) = k;
+        } else {
+            *(ids+i) = sid->next_id++;
+            *(old_index+i) = -1;
+        }
+    }
+
+    succ_ids = NULL;
+    for (node = head, i = 0; node != NULL; node = node->next, i++) {
+        if (node->trans_len > succ_cap) {
+            succ_cap = node->trans_len;
+            free( succ_ids );
+            succ_ids = serve_malloc( succ_cap*sizeof(int) );
+        }
+        for (j = 0; j < node->trans_len; j++)
+            *(succ_ids+j) = *(ids + aut_numbering_index( numbering,
+                                                         *(node->trans+j) ));
+        k = *(old_index+i);
+        if (k >= 0
+            && *(sid->succ_offsets+k+1) - *(sid->succ_offsets+k)
+               == node->trans_len
+            && (node->trans_len == 0
+                || !memcmp( succ_ids, sid->succs + *(sid->succ_offsets+k),
+                            node->trans_len*sizeof(int) )))
+            continue;
+        /* Mark as changed, to be printed below. */
+        *(old_index+i) = -1;
+        num_changed++;
+    }
+    for (k = 0; k < sid->num_nodes; k++) {
+        if (!*(matched+k))
+            num_changed++;
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &end );
+    fprintf( out, "ok %.3f %d %d\n",
+             (end.tv_sec - start->tv_sec)*1e3
+             + (end.tv_nsec - start->tv_nsec)/1e6,
+             num_nodes, num_changed );
+    for (k = 0; k < sid->num_nodes; k++) {
+        if (!*(matched+k))
+            fprintf( out, "- %d\n", *(sid->ids+k) );
+    }
+    for (node = head, i = 0; node != NULL; node = node->next, i++) {
+        if (*(old_index+i) >= 0)
+            continue;
+        for (j = 0; j < node->trans_len; j++)
+            *(succ_ids+j) = *(ids + aut_numbering_index( numbering,
+                                                         *(node->trans+j) ));
+        serve_print_node( out, *(ids+i), node, succ_ids, state_len,
+                          offw, num_nonbool, enc );
+    }
+    fprintf( out, ".\n" );
+    fflush( out );
+
+    free( succ_ids );
+    free( matched );
+    free( old_index );
+    delete_aut_numbering( numbering );
+    serve_free_snapshot( sid );
+    free( sid->ids );
+    sid->ids = ids;
+    sid->num_nodes = num_nodes;
+}
+
+/* Reply with the whole strategy, renumbering nodes from 0. */
+static void serve_reply_dump( FILE *out, serve_ids_t *sid, anode_t *head,
+                              int state_len,
+                              int *offw, int num_nonbool, int *enc )
+{
+    aut_numbering_t *numbering;
+    anode_t *node;
+    int *succ_ids = NULL, succ_cap = 0;
+    int i, j;
+
+    serve_reset_ids( sid, head );
+    numbering = aut_number_nodes( head );
+    fprintf( out, "ok 0 %d %d\n", sid->num_nodes, sid->num_nodes );
+    for (node = head, i = 0; node != NULL; node = node->next, i++) {
+        if (node->trans_len > succ_cap) {
+            succ_cap = node->trans_len;
+            free( succ_ids );
+            succ_ids = serve_malloc( succ_cap*sizeof(int) );
+        }
+        for (j = 0; j < node->trans_len; j++)
+            *(succ_ids+j) = aut_numbering_index( numbering, *(node->trans+j) );
+        serve_print_node( out, i, node, succ_ids, state_len,
+                          offw, num_nonbool, enc );
+    }
+    fprintf( out, ".\n" );
+    fflush( out );
+    free( succ_ids );
+    delete_aut_numbering( numbering );
+}
+
+/* Read batches of edge set changes from in, each ended by a line
+   ".", and reply to out with the changes of the strategy.  A batch
+   that is rejected before the strategy is changed (e.g., because it
+   is malformed) gets the reply "error", and serving continues.
+   Return 0 at end of input or if out cannot be written (e.g., the
+   peer closed the connection), 1 if "quit" is read, or -1 if
+   patching fails after the strategy was changed. */
+static int serve_patches( DdManager *manager, patch_session_t *session,
+                          serve_ids_t *sid, FILE *in, FILE *out,
+                          int state_len, int *offw, int num_nonbool,
+                          int *enc, unsigned char verbose )
+{
+    char line[SERVE_LINE_LEN];
+    char *batch = NULL;
+    size_t batch_len = 0, batch_cap = 0, line_len;
+    struct timespec start;
+    FILE *batch_fp;
+    int status = 0;
+
+    while (fgets( line, SERVE_LINE_LEN, in ) != NULL) {
+        line_len = strlen( line );
+        if (batch_len == 0 && !strcmp( line, "quit\n" )) {
+            status = 1;
+            break;
+        } else if (batch_len == 0 && !strcmp( line, "dump\n" )) {
+            serve_reply_dump( out, sid, session->strategy, state_len,
+                              offw, num_nonbool, enc );
+            if (ferror( out ))
+                break;
+            continue;
+        } else if (strcmp( line, ".\n" )) {
+            if (batch_len+line_len+1 > batch_cap) {
+                batch_cap = 2*(batch_len+line_len+1);
+                batch = realloc( batch, batch_cap );
+                if (batch == NULL) {
+                    perror( "gr1c-patch, realloc" );
+                    exit(-1);
+                }
+            }
+            memcpy( batch+batch_len, line, line_len+1 );
+            batch_len += line_len;
+            continue;
+        }
+
+        clock_gettime( CLOCK_MONOTONIC, &start );
+        serve_snapshot( sid, session->strategy, state_len );
+        if (batch_len > 0) {
+            batch_fp = fmemopen( batch, batch_len, "r" );
+            if (batch_fp == NULL) {
+                perror( "gr1c-patch, fmemopen" );
+                exit(-1);
+            }
+            if (verbose)
+                logprint( "Patching given strategy..." );
+            if (patch_session_apply( manager, session, batch_fp, verbose )) {
+                fclose( batch_fp );
+                serve_free_snapshot( sid );
+                fprintf( out, "error\n.\n" );
+                fflush( out );
+                batch_len = 0;
+                if (session->strategy == NULL) {
+                    status = -1;
+                    break;
+                }
+                if (ferror( out ))
+                    break;
+                continue;
+            }
+            fclose( batch_fp );
+            if (verbose)
+                logprint( "Done." );
+        }
+        serve_reply_delta( out, sid, session->strategy, &start, state_len,
+                           offw, num_nonbool, enc );
+        batch_len = 0;
+        if (ferror( out ))
+            break;
+    }
+
+    free( batch );
+    return status;
+}
+
+/* Serve connections to a Unix domain socket at path, one at a time,
+   until "quit" is read or patching fails.  Return 0 on success. */
+static int serve_socket( char *path, DdManager *manager,
+                         patch_session_t *session, serve_ids_t *sid,
+                         int state_len, int *offw, int num_nonbool,
+                         int *enc, unsigned char verbose )
+{
+    struct sockaddr_un addr;
+    FILE *in, *out;
+    int sock, conn, status = 0;
+
+    if (strlen( path ) >= sizeof(addr.sun_path)) {
+        fprintf( stderr, "Socket path is too long: %s\n", path );
+        return -1;
+    }
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    strcpy( addr.sun_path, path );
+    sock = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if (sock == -1) {
+        perror( "gr1c-patch, socket" );
+        return -1;
+    }
+    if (bind( sock, (struct sockaddr *)&addr, sizeof(addr) )
+        || listen( sock, 1 )) {
+        perror( "gr1c-patch, bind" );
+        close( sock );
+        return -1;
+    }
+    if (verbose)
+        logprint( "Listening at %s", path );
+
+    while (status == 0) {
+        conn = accept( sock, NULL, NULL );
+        if (conn == -1) {
+            perror( "gr1c-patch, accept" );
+            status = -1;
+            break;
+        }
+        in = fdopen( conn, "r" );
+        out = fdopen( dup( conn ), "w" );
+        if (in == NULL || out == NULL) {
+            perror( "gr1c-patch, fdopen" );
+            exit(-1);
+        }
+        status = serve_patches( manager, session, sid, in, out,
+                                state_len, offw, num_nonbool, enc, verbose );
+        fclose( in );
+        fclose( out );
+    }
+
+    close( sock );
+    unlink( path );
+    return (status < 0) ? -1 : 0;
+}
+
+
 int main( int argc, char **argv )
 {
     FILE *fp;
+    specification_t compiled;  /* Expanded part of compiled specification */
+    int cache_status = 0;
     byte run_option = GR1C_MODE_UNSET;
     bool help_flag = False;
     bool ptdump_flag = False;
     bool logging_flag = False;
+    bool serve_flag = False;  /* For command-line flag "-s". */
+    int socket_index = -1;  /* For command-line flag "--socket". */
+    int num_threads = 1;  /* For command-line flag "-j". */
     byte format_option = OUTPUT_FORMAT_JSON;
     unsigned char verbose = 0;
     bool reading_options = True;  /* For disabling option parsing using "--" */
@@ -86,6 +472,11 @@ int main( int argc, char **argv )
     char *metric_vars = NULL;
     int *offw = NULL, num_metric_vars;
 
+    patch_session_t *session;
+    serve_ids_t sid;
+    int *enc;
+    int serve_status;
+
     /* Look for flags in command-line arguments. */
     for (i = 1; i < argc; i++) {
         if (reading_options && argv[i][0] == '-' && argv[i][1] != '-') {
@@ -113,6 +504,21 @@ int main( int argc, char **argv )
                 logging_flag = True;
             } else if (argv[i][1] == 'p') {
                 ptdump_flag = True;
+            } else if (argv[i][1] == 'j') {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                num_threads = strtol( argv[i+1], NULL, 10 );
+                if (num_threads < 1) {
+                    fprintf( stderr,
+                             "Number of threads must be positive.\n" );
+                    return 1;
+                }
+                i++;
+            } else if (argv[i][1] == 's') {
+                run_option = GR1C_MODE_PATCH;
+                serve_flag = True;
             } else if (argv[i][1] == 'm') {
                 if (i == argc-1) {
                     fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
@@ -196,6 +602,15 @@ int main( int argc, char **argv )
             } else if (!strncmp( argv[i]+2, "version", strlen( "version" ) )) {
                 PRINT_VERSION();
                 return 0;
+            } else if (!strncmp( argv[i]+2, "socket", strlen( "socket" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                run_option = GR1C_MODE_PATCH;
+                serve_flag = True;
+                socket_index = i+1;
+                i++;
             } else {
                 fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
                 return 1;
@@ -220,11 +635,25 @@ int main( int argc, char **argv )
     } else if (remove_goal_mode >= 0 && aut_input_index < 0) {
         fprintf( stderr, "\"-r\" flag can only be used with \"-a\"\n" );
         return 1;
+    } else if (serve_flag && (edges_input_index >= 0 || clformula_index >= 0
+                              || remove_goal_mode >= 0)) {
+        fprintf( stderr,
+                 "\"-s\" flag cannot be used with \"-e\", \"-f\", or \"-r\".\n" );
+        return 1;
+    } else if (serve_flag && aut_input_index < 0) {
+        fprintf( stderr, "\"-s\" flag can only be used with \"-a\"\n" );
+        return 1;
+    } else if (serve_flag && socket_index < 0
+               && (input_index < 0 || !strncmp( argv[aut_input_index], "-", 1 ))) {
+        fprintf( stderr,
+                 "Serving on stdin requires the specification and automaton"
+                 " to be read from files.\n" );
+        return 1;
     }
 
     if (help_flag) {
         /* Split among printf() calls to conform with ISO C90 string length */
-        printf( "Usage: %s [-hVvlp] [-m VARS] [-t TYPE] [-aeo FILE] [-f FORM] [-r N] [[--] FILE]\n\n"
+        printf( "Usage: %s [-hVvlps] [--socket PATH] [-j N] [-m VARS] [-t TYPE] [-aeo FILE] [-f FORM] [-r N] [[--] FILE]\n\n"
                 "  -h          this help message\n"
                 "  -V          print version and exit\n"
                 "  -v          be verbose; use -vv to be more verbose\n"
@@ -236,11 +665,17 @@ int main( int argc, char **argv )
                 "  -a FILE     automaton input file, in gr1c \"aut\" format;\n"
                 "              if FILE is -, then read from stdin\n"
                 "  -e FILE     patch, given game edge set change file; requires -a flag\n"
+                "  -j N        when patching with -e or -s, solve games of up to N\n"
+                "              goal modes at a time, in separate threads\n"
                 "  -o FILE     output strategy to FILE, rather than stdout (default)\n" );
         printf( "  -f FORM     FORM is a Boolean (state) formula, currently only\n"
                 "              used for appending a system goal; requires -a flag.\n"
                 "  -r N        remove system goal N (in order, according to given file);\n"
                 "              requires -a flag.\n" );
+        printf( "  -s          serve batches of edge set changes from stdin, replying\n"
+                "              with changes of the strategy on stdout; requires -a flag\n"
+                "  --socket PATH  as -s, but serve connections to a Unix domain\n"
+                "              socket created at PATH\n" );
         return 0;
     }
 
@@ -263,7 +698,8 @@ int main( int argc, char **argv )
         if (verbose == 0)
             verbose = 1;
     } else {
-        setlogstream( stdout );
+        /* Replies of serve mode on stdout are not mixed with logging. */
+        setlogstream( (serve_flag && socket_index < 0) ? stderr : stdout );
         setlogopt( LOGOPT_NOTIME );
     }
     if (verbose > 0)
@@ -313,25 +749,35 @@ int main( int argc, char **argv )
     /* If filename for specification given at command-line, then use
        it.  Else, read from stdin. */
     if (input_index > 0) {
-        fp = fopen( argv[input_index], "r" );
+        fp = fopen( argv[input_index], "rb" );
         if (fp == NULL) {
             perror( "gr1c-patch, fopen" );
             return -1;
         }
-        yyrestart( fp );
     } else {
-        yyrestart( stdin );
+        fp = stdin;
     }
 
-    /* Parse the specification. */
+    /* Parse the specification, or load it if compiled. */
     spc.evar_list = NULL;
     spc.svar_list = NULL;
     gen_tree_ptr = NULL;
-    if (verbose)
-        logprint( "Parsing input..." );
     SPC_INIT( spc );
-    if (yyparse())
-        return 2;
+    if (spc_cache_detect( fp )) {
+        if (verbose)
+            logprint( "Loading compiled specification..." );
+        SPC_INIT( compiled );
+        cache_status = spc_cache_load( fp, SPC_CACHE_GR1, &spc, &compiled,
+                                       ALL_ENV_EXIST_SYS_INIT, verbose );
+        if (cache_status < 0)
+            return 2;
+    } else {
+        yyrestart( fp );
+        if (verbose)
+            logprint( "Parsing input..." );
+        if (yyparse())
+            return 2;
+    }
     if (verbose)
         logprint( "Done." );
 
@@ -491,14 +937,22 @@ int main( int argc, char **argv )
                         spc.env_goals, spc.num_egoals, spc.sys_goals, spc.num_sgoals, stdout );
     }
 
-    if (expand_nonbool_GR1( spc.evar_list, spc.svar_list, &spc.env_init, &spc.sys_init,
-                            &spc.env_trans_array, &spc.et_array_len,
-                            &spc.sys_trans_array, &spc.st_array_len,
-                            &spc.env_goals, spc.num_egoals, &spc.sys_goals, spc.num_sgoals,
-                            ALL_ENV_EXIST_SYS_INIT, verbose ) < 0)
-        return -1;
-    spc.nonbool_var_list = expand_nonbool_variables( &spc.evar_list, &spc.svar_list,
-                                                     verbose );
+    if (cache_status == 1) {
+        spc_free( &spc );
+        spc = compiled;
+    } else {
+        if (expand_nonbool_GR1( spc.evar_list, spc.svar_list,
+                                &spc.env_init, &spc.sys_init,
+                                &spc.env_trans_array, &spc.et_array_len,
+                                &spc.sys_trans_array, &spc.st_array_len,
+                                &spc.env_goals, spc.num_egoals,
+                                &spc.sys_goals, spc.num_sgoals,
+                                ALL_ENV_EXIST_SYS_INIT, verbose ) < 0)
+            return -1;
+        spc.nonbool_var_list = expand_nonbool_variables( &spc.evar_list,
+                                                         &spc.svar_list,
+                                                         verbose );
+    }
 
     tmppt = spc.nonbool_var_list;
     while (tmppt) {
@@ -506,7 +960,8 @@ int main( int argc, char **argv )
             if (verbose > 1)
                 logprint( "Expanding nonbool variable %s in command-line"
                           " formula...", tmppt->name );
-            clformula = expand_to_bool( clformula, tmppt->name, tmppt->value );
+            clformula = expand_to_bool( clformula, tmppt->name, tmppt->value,
+                                        get_nonbool_encoding( tmppt->name ) );
             if (verbose > 1)
                 logprint( "Done." );
         }
@@ -543,7 +998,51 @@ int main( int argc, char **argv )
         }
     }
 
-    if (edges_input_index >= 0) {  /* patch_localfixpoint() */
+    patch_set_threads( num_threads );
+
+    if (serve_flag) {  /* patch_session_apply() */
+
+        if (offw != NULL)
+            free( offw );
+        offw = get_offsets_list( spc.evar_list, spc.svar_list, spc.nonbool_var_list );
+        enc = get_encodings_list( spc.nonbool_var_list );
+
+        session = patch_session_open( manager, strategy_fp,
+                                      original_num_env, original_num_sys,
+                                      offw, verbose );
+        if (session == NULL) {
+            fprintf( stderr, "Failed to load strategy.\n" );
+            return -1;
+        }
+        sid.ids = NULL;
+        sid.numbering = NULL;
+        serve_reset_ids( &sid, session->strategy );
+        /* A peer that disconnects early is found by failed writes. */
+        signal( SIGPIPE, SIG_IGN );
+        if (socket_index >= 0) {
+            serve_status = serve_socket( argv[socket_index], manager, session,
+                                         &sid, num_env+num_sys, offw,
+                                         tree_size( spc.nonbool_var_list ),
+                                         enc, verbose );
+        } else {
+            serve_status = serve_patches( manager, session, &sid, stdin, stdout,
+                                          num_env+num_sys, offw,
+                                          tree_size( spc.nonbool_var_list ),
+                                          enc, verbose );
+        }
+        free( sid.ids );
+        if (enc != NULL)
+            free( enc );
+
+        strategy = session->strategy;
+        session->strategy = NULL;
+        patch_session_close( manager, session );
+        if (serve_status < 0 && strategy != NULL) {
+            delete_aut( strategy );
+            strategy = NULL;
+        }
+
+    } else if (edges_input_index >= 0) {  /* patch_localfixpoint() */
 
         if (offw != NULL)
             free( offw );
@@ -660,7 +1159,8 @@ int main( int argc, char **argv )
         num_sys = tree_size( spc.svar_list );
     }
 
-    if (strategy != NULL) {
+    /* In serve mode, stdout is only for replies. */
+    if (strategy != NULL && !(serve_flag && output_file_index < 0)) {
         /* Open output file if specified; else point to stdout. */
         if (output_file_index >= 0) {
             fp = fopen( argv[output_file_index], "w" );
@@ -721,6 +1221,7 @@ int main( int argc, char **argv )
         Cudd_RecursiveDeref( manager, T );
     if (strategy)
         delete_aut( strategy );
+    patch_cache_clear();
     if (verbose > 1)
         logprint( "Cudd_CheckZeroRef -> %d", Cudd_CheckZeroRef( manager ) );
     Cudd_Quit(manager);
@@ -0,0 +1,72 @@
+/** \file aut_sim.h
+ * \brief Monte Carlo simulation of strategies.
+ *
+ * Random plays are run on a read-only view of a strategy in the gr1c
+ * binary format (cf. aut_bin_open() in automaton.h), so the strategy
+ * is neither copied nor modified, and plays can run in several
+ * threads.  At each step, the next node is drawn uniformly at random
+ * from the successors of the current node.  In strategies synthesized
+ * by gr1c, each environment move from a node leads to exactly one
+ * successor, so this is a uniform choice of environment move.
+ *
+ * Progress is measured by the goal mode of nodes: a visit of goal
+ * mode m is counted when a play moves from a node with mode m to a
+ * node with another mode, and a mode cycle is the sequence of steps
+ * between consecutive entries into mode 0 by a play, where beginning
+ * at a node with mode 0 counts as an entry.  Strategies for a single
+ * system goal have only one mode, so for them a visit is counted when
+ * a play arrives at a node with reach annotation value (rgrad) 0, and
+ * a cycle is the sequence of steps between consecutive such arrivals,
+ * where beginning at such a node counts as an arrival.
+ */
+
+
+#ifndef AUT_SIM_H
+#define AUT_SIM_H
+
+#include <stdint.h>
+
+#include "automaton.h"
+
+
+/** \brief Statistics of random plays, as found by aut_sim_run(). */
+typedef struct {
+    int num_plays;
+    uint64_t num_steps;
+    int num_blocked;  /**<\brief Plays that reached a node without
+                         successors before their full length. */
+
+    int num_goals;  /**<\brief Number of goal modes, i.e., one more
+                       than the greatest mode of a node. */
+    uint64_t *goal_visits;  /**<\brief Visits of each goal mode. */
+
+    /** \brief Number of mode cycles and their lengths, in steps.  If
+        there are no cycles, then the lengths are 0. */
+    uint64_t num_cycles;
+    int cycle_min, cycle_max;
+    uint64_t cycle_sum;
+
+    double secs;  /**<\brief Wall-clock time of all plays. */
+} aut_sim_stats_t;
+
+
+/** Run num_plays random plays of at most play_len steps each, in up
+   to num_threads threads, and place statistics in stats, which should
+   be freed by aut_sim_free().  Plays begin at a node drawn uniformly
+   from the initial nodes, or from all nodes if none is initial.
+
+   Each play has its own generator, seeded from seed by rng_next() (cf.
+   gr1c_util.h), so the results only depend on seed and not on the
+   number of threads.  Return 0 on success, or -1 if the strategy is
+   empty. */
+int aut_sim_run( aut_bin_t *bin, int num_plays, int play_len,
+                 uint64_t seed, int num_threads, aut_sim_stats_t *stats );
+
+/** Print statistics in stats to fp, including throughput in steps
+   per second. */
+void aut_sim_print( aut_sim_stats_t *stats, FILE *fp );
+
+void aut_sim_free( aut_sim_stats_t *stats );
+
+
+#endif
@@ -14,6 +14,7 @@
 #define AUTOMATON_H
 
 #include <stdio.h>
+#include <stdint.h>
 
 #include "common.h"
 #include "ptree.h"
@@ -98,6 +99,29 @@ int find_anode_index( anode_t *head, int mode, vartype *state, int state_len );
    0-based indexing. */
 int anode_index( anode_t *head, anode_t *node );
 
+/** \brief Table from nodes to their positions in the node list.
+
+   Lookup with aut_numbering_index() takes constant expected time,
+   whereas anode_index() walks the list; writers of entire automata
+   should therefore build a numbering once, with aut_number_nodes(),
+   so that their running time is linear in the size of the output. */
+typedef struct aut_numbering_t
+{
+    anode_t **nodes;  /* Open-addressing table; NULL if slot is empty. */
+    int *indices;
+    int size;  /* Power of 2 */
+} aut_numbering_t;
+
+/** Number the nodes of the given automaton, from 0 at head.  The
+   numbering is invalid once nodes are inserted or deleted.  Free it
+   with delete_aut_numbering(). */
+aut_numbering_t *aut_number_nodes( anode_t *head );
+
+/** Return the position of the given node, or -1 if not found. */
+int aut_numbering_index( aut_numbering_t *numbering, anode_t *node );
+
+void delete_aut_numbering( aut_numbering_t *numbering );
+
 /** Delete target node from strategy automaton.
 
    Note that any references to \p target in transition arrays of other nodes are
@@ -175,16 +199,21 @@ void list_aut_dump( anode_t *head, int state_len, FILE *fp );
 void aut_aut_dump( anode_t *head, int state_len, FILE *fp );
 
 /** Dump strategy using the specified version of the "gr1c automaton"
-   file format.  This function is wrapped by aut_aut_dump().  Return 0
-   on success.  If the given version number is not supported, then
-   return -1. */
+   file format.  This function is wrapped by aut_aut_dump().  Version 2
+   gives each state vector as a change of that of the previous node or
+   as a reference to an earlier one, and so is much smaller for large
+   strategies.  Return 0 on success.  If the given version number is
+   not supported, then return -1. */
 int aut_aut_dumpver( anode_t *head, int state_len, FILE *fp, int version );
 
 /** Load strategy given in "gr1c automaton" format from file fp.  Read
    [external_notes](md_formats.html) for details.  If fp = NULL, then
    read from stdin.  Return resulting head pointer, or NULL if error.
    If version is not NULL, then the detected format version number is
-   placed in *version.
+   placed in *version.  Lines may be of any length, and fp is read
+   sequentially, so it can be a pipe.  Input that is gzip-compressed
+   is detected and decompressed (requires that gr1c is built with
+   zlib, i.e., USE_ZLIB is defined).
 
    Note that attempting to load a gr1c automaton file for a version
    that includes fields not present in this build of gr1c results in a
@@ -198,11 +227,153 @@ anode_t *aut_aut_loadver( int state_len, FILE *fp, int *version );
    aut_aut_loadver() with version == NULL */
 anode_t *aut_aut_load( int state_len, FILE *fp );
 
+/**
+ * \defgroup JSONDumpFlags format flags for json_aut_dumpopt
+ *
+ * @{
+ */
+#define JSON_AUT_PRETTY 0  /**<\brief Indented, one node field per line. */
+#define JSON_AUT_COMPACT 1  /**<\brief No blank space between tokens. */
+#define JSON_AUT_LINES 2  /**<\brief JSON lines: a header object with
+                             all entries except "nodes" on the first
+                             line, and then one object per node, with
+                             its integer ID in the field "id". */
+/**@}*/
+
 /** Dump strategy using the current version of the gr1c-JSON file
-   format.  Consult [external_notes](md_formats.html) for details. */
+   format.  Consult [external_notes](md_formats.html) for details.
+   Nodes are named by their positions in the node list, so the output
+   does not depend on memory addresses.  Equivalent to calling
+   json_aut_dumpopt() with JSON_AUT_PRETTY. */
 int json_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
                    FILE *fp );
 
+/** Dump strategy in gr1c-JSON, with layout selected by format_flags
+   from \ref JSONDumpFlags.  If the environment variable
+   SOURCE_DATE_EPOCH is set, then it is used as the timestamp instead
+   of the current time.  Return 0 on success, nonzero on error. */
+int json_aut_dumpopt( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
+                      unsigned char format_flags, FILE *fp );
+
+/** Return the number of bytes written by the most recent call of
+   aut_aut_dumpver(), dot_aut_dump(), tulip_aut_dump(),
+   list_aut_dump(), json_aut_dumpopt(), or bin_aut_dump(), e.g., to
+   report throughput.  When built with GCC or compatible compilers,
+   the count is kept per thread. */
+size_t aut_last_dump_bytes(void);
+
+/** Select gzip compression of the output of aut_aut_dumpver(),
+   dot_aut_dump(), tulip_aut_dump(), list_aut_dump(), and
+   json_aut_dumpopt() at the given level, from 1 (fastest) to 9
+   (smallest), or disable it if level is 0 (the default).  Output is
+   compressed as it is written, through a buffer of fixed size.  The
+   binary format (bin_aut_dump()) is never compressed, so that it can
+   be mapped into memory.  When built with GCC or compatible
+   compilers, the selection applies only to the calling thread.  Then
+   aut_last_dump_bytes() gives the size after compression.
+
+   Return 0 on success, -1 if level is not in the range 0 to 9 or if
+   gr1c was built without zlib (USE_ZLIB not defined). */
+int aut_dump_set_compression( int level );
+
+/** Magic string (including the terminating NUL) that begins every
+   file in the gr1c binary strategy format. */
+#define BIN_AUT_MAGIC "GR1CBIN"
+#define BIN_AUT_MAGIC_LEN 8
+
+/** Current version of the gr1c binary strategy format. */
+#define BIN_AUT_VERSION 1
+
+/** \brief Read-only view of a strategy in the gr1c binary format.
+
+   All arrays point directly into the file contents, which are mapped
+   into memory when possible, so opening a view does not copy or
+   parse the nodes.  Node indices are positions in the node list of
+   the dumped automaton.  Read [external_notes](md_formats.html) for
+   the layout. */
+typedef struct aut_bin_t
+{
+    int version;
+    int state_len;
+    int num_env;  /**<\brief Number of environment variables, or -1 if
+                     variable names were not recorded. */
+    int num_nodes;
+    uint64_t num_edges;
+
+    /** \brief Variable names in state vector order (environment
+        first), or NULL if not recorded. */
+    char **names;
+    const unsigned char *widths;  /**<\brief Bits per variable. */
+
+    int row_words;  /**<\brief 64-bit words per packed state. */
+    const uint64_t *states;
+    const int32_t *modes;
+    const int32_t *rgrads;
+    const unsigned char *initial;
+
+    /** \brief Transitions in compressed sparse row form: the
+        successors of node i are targets[offsets[i]] through
+        targets[offsets[i+1]-1]. */
+    const uint64_t *offsets;
+    const uint32_t *targets;
+
+    /* Hash table of states, built by aut_bin_find() when first
+       needed.  Each slot holds the smallest index of the nodes having
+       some state, or BIN_AUT_NONE; index_next links each node to the
+       next node having the same state.  index_row holds the packed
+       state being sought. */
+    uint32_t *index;
+    uint32_t *index_next;
+    size_t index_size;
+    uint64_t *index_row;
+
+    void *base;  /* Start of file contents */
+    size_t len;
+    bool mapped;  /* True if base must be unmapped rather than freed */
+} aut_bin_t;
+
+/** Dump strategy in the gr1c binary format.  If evar_list and
+   svar_list are not both NULL, then the variable names are recorded;
+   in that case, state_len must be the total length of the lists.  If
+   fp = NULL, then write to stdout.  Return 0 on success, nonzero on
+   error. */
+int bin_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
+                  int state_len, FILE *fp );
+
+/** Open a view of a gr1c binary strategy file, starting at the
+   current position of fp.  If fp is a regular file at position 0,
+   then its contents are mapped into memory; otherwise, the remainder
+   of fp is read into a buffer.  The view remains valid after fp is
+   closed.  Return NULL on error, including if the file is truncated,
+   inconsistent, or was written on a machine of different byte order.
+   Close the view with aut_bin_close(). */
+aut_bin_t *aut_bin_open( FILE *fp );
+
+/** Unpack the state of node i of the given view into state, which
+   must have room for bin->state_len elements. */
+void aut_bin_state( aut_bin_t *bin, int i, vartype *state );
+
+void aut_bin_close( aut_bin_t *bin );
+
+/** Marks empty slots in the state index of aut_bin_t. */
+#define BIN_AUT_NONE 0xffffffffu
+
+/** Find the first node of the given view that comes after node
+   after, has the given state, and, unless mode is -1, has the given
+   goal mode.  Use after = -1 to start from the first node.  The state
+   index is built on the first call, which takes time linear in the
+   number of nodes; later calls take constant expected time plus the
+   number of nodes having the state.  Return the index of the node, or
+   -1 if there is none. */
+int aut_bin_find( aut_bin_t *bin, vartype *state, int mode, int after );
+
+/** Load strategy given in the gr1c binary format from file fp, as
+   for aut_bin_open().  If fp = NULL, then read from stdin.  If
+   state_len is positive and does not match the file, then fail.
+   Return resulting head pointer, or NULL if error.  If version is not
+   NULL, then the format version number is placed in *version. */
+anode_t *bin_aut_loadver( int state_len, FILE *fp, int *version );
+
 /** Get number of nodes in given automaton. */
 int aut_size( anode_t *head );
 
@@ -225,7 +396,9 @@ int forward_modereach( anode_t *node, int mode, vartype **N, int N_len,
 /** Convert binary-expanded form of a variable back into nonboolean.
    The domain of the variable is [0,maxval], and to indicate this the
    value field is set to maxval in the resulting (merged) variable
-   entry (in evar_list or svar_list).
+   entry (in evar_list or svar_list).  The bits are decoded in the
+   encoding selected for name (cf. get_nonbool_encoding() in
+   gr1c_util.h).
    Returns the new state vector length, or -1 on error. */
 int aut_compact_nonbool( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
                          char *name, int maxval );
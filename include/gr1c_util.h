@@ -9,6 +9,8 @@
 #ifndef GR1C_UTIL_H
 #define GR1C_UTIL_H
 
+#include <stdint.h>
+
 #include "common.h"
 #include "ptree.h"
 
@@ -38,11 +40,61 @@ int bitvec_to_int( vartype *vec, int vec_len );
 vartype *int_to_bitvec( int x, int vec_len );
 
 
+/** Convert bitvector into integer according to the given encoding
+   (cf. \ref NonboolEncodings in ptree.h).  For the binary encoding,
+   this is the same as bitvec_to_int().  Return -1 if the bitvector
+   does not represent a value, i.e., in the one-hot encoding if it
+   does not have exactly one bit set. */
+int nonbool_to_int( vartype *vec, int vec_len, int encoding );
+
+/** Convert integer to bitvector according to the given encoding.  The
+   caller is assumed to free the allocated array.  If vec_len < 1, then
+   return value is NULL. */
+vartype *int_to_nonbool( int x, int vec_len, int encoding );
+
+/** Return the next number of a pseudorandom sequence, given the state
+   of the generator, which is updated.  Any value of the state is a
+   valid seed, and the sequence only depends on the seed, so results
+   are reproducible, unlike those of rand() after srand( time(NULL) ).
+   Different states can be used in different threads. */
+uint64_t rng_next( uint64_t *state );
+
+/** Return a pseudorandom number uniformly distributed in [0, 1),
+   using rng_next(). */
+double rng_uniform( uint64_t *state );
+
+/** Select the encoding used when expanding the nonboolean variable
+   with the given name, e.g., in expand_nonbool_variables() and
+   expand_nonbool_GR1().  If name is NULL, then set the default for
+   variables that are not selected individually; initially, this is
+   NONBOOL_ENC_BINARY.  Return 0 on success, -1 if the encoding is not
+   recognized. */
+int set_nonbool_encoding( char *name, int encoding );
+
+/** Return the encoding of the nonboolean variable with given name. */
+int get_nonbool_encoding( char *name );
+
+/** Select encodings from a comma-separated list of items that are
+   each of the form ENC or NAME=ENC, where ENC is one of "binary",
+   "gray", or "onehot".  ENC alone sets the default.  E.g., "gray,x=onehot".
+   Return 0 on success, -1 on error. */
+int parse_nonbool_encodings( char *spec );
+
+/** Forget encodings of all variables and restore the default. */
+void clear_nonbool_encodings(void);
+
+/** Return an array of the encodings of the variables in
+   nonbool_var_list, in order, or NULL if the list is empty.  The
+   caller is assumed to free it. */
+int *get_encodings_list( ptree_t *nonbool_var_list );
+
+
 /** Expand any variables with integral domains.
 
    Expand any variables with integral domains in given lists of variables, where
-   the expansion is as performed by var_to_bool() (cf. ptree.h). Variables that
-   have type boolean are ignored.
+   the expansion is as performed by var_to_bool() (cf. ptree.h) in the encoding
+   selected by set_nonbool_encoding(). Variables that have type boolean are
+   ignored.
 
    \param evar_list linked list of environment variables.
 
@@ -58,9 +110,11 @@ ptree_t *expand_nonbool_variables( ptree_t **evar_list, ptree_t **svar_list,
 
 /** Return an array of length mapped_len where the nonboolean
    variables in given state array have been expanded according to
-   their offsets and widths in offw.  Return NULL if error. */
-vartype *expand_nonbool_state( vartype *state, int *offw, int num_nonbool,
-                               int mapped_len );
+   their offsets and widths in offw, and their encodings in enc (as
+   from get_encodings_list()).  If enc is NULL, then the binary
+   encoding is used for all variables.  Return NULL if error. */
+vartype *expand_nonbool_state( vartype *state, int *offw, int *enc,
+                               int num_nonbool, int mapped_len );
 
 /** Similar to get_offsets() except that evar_list and svar_list are
    arguments (rather than global) and the variables with nonboolean
@@ -76,6 +130,9 @@ int *get_offsets_list( ptree_t *evar_list, ptree_t *svar_list,
    unreachable values that result from nonbool expansion should be
    incorporated into initial conditions.  The _init trees are assumed
    to be well-formed given init_flags, as verified by check_gr1c_form().
+   Each variable is expanded in the encoding selected for it by
+   set_nonbool_encoding(); for the one-hot encoding, the restriction
+   is that exactly one bit is set.
 
    \param verbose level of detail in logging; larger implies more detail. 0
    (zero) to be quiet. */
@@ -119,4 +176,45 @@ int check_gr1c_form( ptree_t *evar_list, ptree_t *svar_list,
 void print_support( DdManager *manager, int state_len, DdNode *X, FILE *outf );
 
 
+/** Compute a static variable order from the structure of the GR(1)
+   specification, using the FORCE heuristic: each top-level conjunct
+   of the initial conditions, each transition rule, and each goal is
+   regarded as a hyperedge over the variables it mentions, and
+   variables are repeatedly moved to the mean center of gravity of
+   their hyperedges, so as to reduce the total span of hyperedges.
+   Each variable is kept adjacent to its primed copy.
+
+   The arguments are as for check_gr1c_form(), with nonboolean
+   variables already expanded.  Variable indices are as for
+   ptree_BDD() with evar_list followed by svar_list, i.e., primed
+   variables are offset by num_env+num_sys.
+
+   Return array of length 2*(num_env+num_sys) that is suitable to
+   give to Cudd_ShuffleHeap(), i.e., the i-th entry is the index of
+   the variable at level i.  The caller is assumed to free it.  Return
+   NULL if there are no variables. */
+int *force_var_order( ptree_t *evar_list, ptree_t *svar_list,
+                      ptree_t *env_init, ptree_t *sys_init,
+                      ptree_t **env_trans_array, int et_array_len,
+                      ptree_t **sys_trans_array, int st_array_len,
+                      ptree_t **env_goals, int num_env_goals,
+                      ptree_t **sys_goals, int num_sys_goals,
+                      unsigned char verbose );
+
+/** Write the current variable order of the manager to fp, one
+   variable name per line from the top level, where primed variables
+   have ' appended.  Variable indices are as for force_var_order().
+   Return 0 on success, -1 on error. */
+int dump_var_order( DdManager *manager,
+                    ptree_t *evar_list, ptree_t *svar_list, FILE *fp );
+
+/** Read a variable order as written by dump_var_order().  Blank lines
+   and lines beginning with # are ignored, as are (with a warning)
+   names that are unknown or repeated.  Variables that do not appear
+   in the file are placed at the bottom, in the default order.  The
+   result is as returned by force_var_order().  Return NULL on
+   error. */
+int *load_var_order( FILE *fp, ptree_t *evar_list, ptree_t *svar_list );
+
+
 #endif
@@ -36,6 +36,64 @@ anode_t *patch_localfixpoint( DdManager *manager,
                               ptree_t *nonbool_var_list, int *offw,
                               unsigned char verbose );
 
+/** \brief Strategy and changes of the game kept between patches.
+
+   Changes of the game read by patch_session_apply() accumulate, so
+   that each patch is made in the game as changed by all earlier
+   ones. */
+typedef struct {
+    /** \brief Current strategy, with nonboolean variables expanded;
+        NULL if a patch failed while modifying it. */
+    anode_t *strategy;
+
+    int original_num_env;
+    int original_num_sys;
+    int *offw;  /* As given to patch_session_open() */
+
+    /** \brief Changes of the environment (resp. system) transition
+        rule T, which becomes (T & emod[0]) | emod[1] (resp. smod). */
+    DdNode *emod[2];
+    DdNode *smod[2];
+} patch_session_t;
+
+/** Read strategy from strategy_fp (or stdin if NULL) as for
+   patch_localfixpoint(), and keep it in a new session for patching
+   repeatedly with patch_session_apply().  offw is not copied and
+   should remain valid until patch_session_close().  Return NULL on
+   error. */
+patch_session_t *patch_session_open( DdManager *manager, FILE *strategy_fp,
+                                     int original_num_env,
+                                     int original_num_sys,
+                                     int *offw, unsigned char verbose );
+
+/** Patch the strategy of the session using the edge set changes read
+   from change_fp, in the same format as for patch_localfixpoint().
+   Return 0 on success, or nonzero on error.  If the error was found
+   before the strategy was changed, e.g., because change_fp is
+   malformed or an affected state is not listed in it, then the
+   strategy and the game are as before the call.  Otherwise, because
+   the strategy may have been partially modified, it is deleted
+   (session->strategy is NULL), and later calls fail. */
+int patch_session_apply( DdManager *manager, patch_session_t *session,
+                         FILE *change_fp, unsigned char verbose );
+
+/** Delete the session, including its strategy. */
+void patch_session_close( DdManager *manager, patch_session_t *session );
+
+/** Solve the reachability games of different goal modes in up to n
+   threads when patching with patch_localfixpoint() or
+   patch_session_apply().  Each thread uses a CUDD manager of its own,
+   to which the transition rules are copied, so this only pays if the
+   games are large compared to the rules.  The local strategies are
+   connected to the original in order of goal mode, as without
+   threads.  The default is 1, i.e., no additional threads. */
+void patch_set_threads( int n );
+
+/** Release the BDDs of transition conjuncts that patch_localfixpoint()
+   keeps between calls.  Call this before the specification or manager
+   used with patch_localfixpoint() is freed, e.g., before Cudd_Quit(). */
+void patch_cache_clear(void);
+
 /** Solve a reachability game symbolically, by blocking an environment
    goal or reaching Exit from Entry.  States are restricted to the set
    N (given as a characteristic function named N_BDD). */
@@ -0,0 +1,61 @@
+/** \file perfstat.h
+ * \brief Hardware performance counters of solver phases.
+ *
+ * If gr1c is built with USE_PERFSTAT defined (e.g., "make PERFSTAT=1"),
+ * then CPU cycles, instructions, cache misses, and page faults are
+ * counted using perf_event_open(2), which is specific to Linux.
+ * Phases are delimited by calls of perfstat_begin() and
+ * perfstat_end(), which may be nested, in which case counts of the
+ * outer phase include those of the inner phases.  Counts are
+ * accumulated per pair of phase name and level, e.g., the level of a
+ * fixpoint iteration, and include threads created during the phase.
+ *
+ * Counting begins only after perfstat_enable() succeeds, so the other
+ * functions can be called unconditionally at phase boundaries.  If
+ * USE_PERFSTAT is not defined, then perfstat_enable() fails and the
+ * other functions do nothing.  Phases should be delimited from only
+ * one thread.
+ */
+
+
+#ifndef PERFSTAT_H
+#define PERFSTAT_H
+
+#include <stdio.h>
+
+
+/** Number of counters of each phase: cycles, instructions, cache
+   misses, and page faults, in that order. */
+#define PERFSTAT_NUM_COUNTERS 4
+
+/** Maximum nesting of phases; deeper phases are not counted. */
+#define PERFSTAT_MAX_DEPTH 16
+
+
+/** Open the counters and begin recording phases.  Return 0 on
+   success, or -1 if no counter is available (e.g., if gr1c is built
+   without USE_PERFSTAT, or if access is denied by the setting of
+   /proc/sys/kernel/perf_event_paranoid).  Counters that cannot be
+   opened are reported as unavailable. */
+int perfstat_enable(void);
+
+/** Begin phase with the given name and level.  Use level -1 if the
+   phase is not part of a sequence.  The name is not copied, so it
+   should be a string constant. */
+void perfstat_begin( char *phase, int level );
+
+/** End the most recently begun phase. */
+void perfstat_end(void);
+
+/** Print counts of each phase using logprint(). */
+void perfstat_log(void);
+
+/** Write counts of each phase to fp in JSON.  Unavailable counters
+   are null.  Return 0 on success, nonzero on error. */
+int perfstat_dump_json( FILE *fp );
+
+/** Close the counters and delete the records of phases. */
+void perfstat_disable(void);
+
+
+#endif
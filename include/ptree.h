@@ -124,7 +124,11 @@ void print_formula( ptree_t *head, FILE *fp, unsigned char format_flags );
    pointer to the new tree root, or NULL on error.  N.B., the given
    trees are *pointed to* by the new tree, i.e, their roots become
    nodes in the new tree, and therefore you generally should *not* try
-   to free the originals (but can discard the old heads pointers). */
+   to free the originals (but can discard the old heads pointers).
+
+   For PT_AND and PT_OR, the new tree is balanced, i.e., it has depth
+   logarithmic in len.  For PT_IMPLIES, it is the left-deep chain
+   (((heads[0] -> heads[1]) -> heads[2]) -> ...). */
 ptree_t *merge_ptrees( ptree_t **heads, int len, int type );
 
 /** Generate BDD corresponding to given parse tree.  var_list is the
@@ -138,6 +142,79 @@ ptree_t *merge_ptrees( ptree_t **heads, int len, int type );
    number of variables (length of list var_list). */
 DdNode *ptree_BDD( ptree_t *head, ptree_t *var_list, DdManager *manager );
 
+/** \brief Hash-consed formula DAG for building BDDs.
+
+   Parse trees given to pdag_BDD() are interned so that structurally
+   equal subformulas (up to the order of operands of commutative
+   operators) share one entry, whence the corresponding BDD is
+   constructed only once per call.  The BDD of an entry is released as
+   soon as the last entry that uses it has been built, so memory is
+   not held by intermediate results of large formulas.  The entries
+   (but not their BDDs) persist across calls, so subformulas shared by
+   several parse trees, e.g., transition rules and goals, are interned
+   once but built again for each tree.  All fields are
+   internal except for cluster_size; use init_pdag(), pdag_BDD(), and
+   delete_pdag().
+
+   Conjunctions of three or more operands, e.g., from merge_ptrees(),
+   are flattened and their operands gathered into clusters by overlap
+   of variable support, with each cluster kept to at most cluster_size
+   BDD nodes (unless a single operand is larger).  The clusters are
+   then conjoined pairwise in a balanced manner, so the size of the
+   final conjunction is not bounded by cluster_size.  This avoids
+   building large intermediate BDDs merely because of the order in
+   which transition rules were written. */
+typedef struct pdag_t
+{
+    DdManager *manager;
+    int num_vars;  /**<\brief Length of the variable list. */
+
+    /** \brief Maximum size (number of BDD nodes) of a conjunct cluster;
+        -1 indicates no limit.  Default is PDAG_CLUSTER_SIZE. */
+    int cluster_size;
+
+    /* Open-addressing table from variable names to list indices */
+    char **var_names;
+    int *var_indices;
+    int var_tab_size;
+
+    /* Unique table of interned subformulas.  Entry k has key
+       (type, a, b) stored at keys[3k], keys[3k+1], keys[3k+2], and
+       (referenced) BDD at bdds[k], which is NULL unless the entry is
+       being built.  During a build, uses[k] is the number of pending
+       entries that have entry k as an operand. */
+    int *keys;
+    DdNode **bdds;
+    int *uses;
+    char *flags;
+    int len;
+    int cap;
+    int *tab;  /* Open-addressing table of entry indices; -1 if empty. */
+    int tab_size;
+
+    /* Entries to be built by the current call of pdag_BDD() */
+    int *work;
+    int work_len;
+    int work_cap;
+} pdag_t;
+
+#define PDAG_CLUSTER_SIZE 5000
+
+/** Create an empty formula DAG for building BDDs in \p manager, with
+   variable indices determined by \p var_list as for ptree_BDD().  The
+   list is read only during this call.  Return NULL on error. */
+pdag_t *init_pdag( ptree_t *var_list, DdManager *manager );
+
+/** Generate BDD corresponding to given parse tree, building each
+   distinct subformula once.  The traversal is iterative,
+   so the depth of \p head is not limited by the call stack.  The
+   caller owns a reference to the returned BDD.  Return NULL on
+   error. */
+DdNode *pdag_BDD( pdag_t *dag, ptree_t *head );
+
+/** Release all memoized BDDs and free the DAG. */
+void delete_pdag( pdag_t *dag );
+
 /** Generate Graphviz DOT file depicting the parse tree.  Return 0 on
    success, -1 on error. */
 int tree_dot_dump( ptree_t *head, char *filename );
@@ -182,23 +259,49 @@ int rmax_tree_value( ptree_t *head, char *name );
    violating variable, which the caller is expected to free. */
 char *check_vars( ptree_t *head, ptree_t *var_list, ptree_t *nextvar_list );
 
+/**
+ * \defgroup NonboolEncodings encodings of variables with integral domains
+ *
+ * @{
+ */
+/** Unsigned binary, least significant bit first. */
+#define NONBOOL_ENC_BINARY 0
+/** Reflected binary Gray code, least significant bit first, so that
+   consecutive values differ in exactly one bit. */
+#define NONBOOL_ENC_GRAY 1
+/** One bit per value, exactly one of which is set. */
+#define NONBOOL_ENC_ONEHOT 2
+/**@}*/
+
+/** Return the number of bits used to represent a variable with domain
+   {0,...,maxval} in the given encoding (cf. \ref NonboolEncodings),
+   or -1 if the encoding is not recognized. */
+int nonbool_num_bits( int maxval, int encoding );
+
 /** name is a variable with domain {0,...,maxval}, where we assume
    that maxval is at least 2.  Return a list of variables in order of
    increasing bit index, e.g., invoking with a variable named "foo"
-   and maxval=2 causes a list to be returned of the form foo0,foo1.
+   and maxval=2 in the binary encoding causes a list to be returned of
+   the form foo0,foo1.  The length of the list is given by
+   nonbool_num_bits().
 
    The maximum length of the resulting variable names, i.e., names after
    appending bit indices, is 1024. (This is fixed as an internal constant.)
 
    Return NULL on error. */
-ptree_t *var_to_bool( char *name, int maxval );
+ptree_t *var_to_bool( char *name, int maxval, int encoding );
 
 /** Expand all occurrences of name (a variable) in formula described
    by the tree head, replacing by Boolean variables as would be found
    by var_to_bool().  Changes are made in-place.
 
+   In the one-hot encoding, the expansion of name = k is only the bit
+   of index k, which is correct provided that the constraint from
+   onehot_domain_bool() is imposed on name.
+
    Return the (possibly new) head pointer, or NULL if error. */
-ptree_t *expand_to_bool( ptree_t *head, char *name, int maxval );
+ptree_t *expand_to_bool( ptree_t *head, char *name, int maxval,
+                         int encoding );
 
 /** Create tree describing unreachable values of a
    nonboolean-expanded-to-boolean variable.  E.g., this can be used to
@@ -209,6 +312,12 @@ ptree_t *expand_to_bool( ptree_t *head, char *name, int maxval );
    PT_VARIABLE or PT_NEXT_VARIABLE. */
 ptree_t *unreach_expanded_bool( char *name, int lower, int upper, int type );
 
+/** Create tree describing that exactly one of the bits of a variable
+   with domain {0,...,maxval} in the one-hot encoding is set.  The
+   bits are named as by var_to_bool().  type should be one of
+   PT_VARIABLE or PT_NEXT_VARIABLE.  Return NULL on error. */
+ptree_t *onehot_domain_bool( char *name, int maxval, int type );
+
 /** Push variable or constant into top of tree.
 
    (Behavior is like reverse Polish notation.) If \p name is not NULL and if
@@ -0,0 +1,115 @@
+/** \file reduce.h
+ * \brief Elimination of defined and irrelevant variables before solving.
+ *
+ * The routines here act on the global specification spc after
+ * nonboolean variables have been expanded (cf. expand_nonbool_GR1()
+ * and expand_nonbool_variables() in gr1c_util.h) and before the
+ * transition rules are merged.  The game is reduced by removing
+ *
+ * - variables v that are defined by a pair of conjuncts v <-> f in
+ *   the initial conditions and v' <-> f' in the transition rules of
+ *   the player who controls v, where f does not mention v and f' is
+ *   f with all variables primed.  Every other occurrence of v (resp.
+ *   v') is replaced by f (resp. f').
+ *
+ * - connected components of the variable dependency graph that do not
+ *   touch any goal (this includes unused variables), provided that
+ *   the component cannot affect realizability: the environment part
+ *   of its transition rules is always satisfiable, the system can
+ *   always respond to any environment move that satisfies it, and its
+ *   initial conditions are satisfiable.
+ *
+ * A strategy synthesized for the reduced game is converted into one
+ * for the original game by reduce_restore_aut().
+ */
+
+
+#ifndef REDUCE_H
+#define REDUCE_H
+
+#include "common.h"
+#include "ptree.h"
+#include "automaton.h"
+
+
+/** Default bound on the number of variables in a component that may
+   be eliminated when a strategy is to be restored afterward.  Each
+   strategy node is expanded over the reachable valuations of the
+   component, which are found by enumeration. */
+#define REDUCE_MAX_COMPONENT 10
+
+/**
+ * \defgroup ReduceStepTypes types of reduction steps
+ *
+ * @{
+ */
+#define REDUCE_DEFINED 0  /**<\brief One variable replaced by its definition. */
+#define REDUCE_COMPONENT 1  /**<\brief Independent component removed. */
+/**@}*/
+
+/** \brief One elimination step, as needed to undo it. */
+typedef struct reduce_step_t
+{
+    int type;  /**<\brief Consult table of \ref ReduceStepTypes. */
+
+    /** \brief List of the removed variables, environment variables
+        first, in order of appearance in the variable list. */
+    ptree_t *vars;
+    int num_env;  /**<\brief Number of environment variables in vars. */
+
+    /** \brief For each removed variable, its index in the variable list
+        (evar_list followed by svar_list) just before this step. */
+    int *positions;
+
+    /** \brief Definition f (over unprimed variables) of the removed
+        variable, if type is REDUCE_DEFINED. */
+    ptree_t *def;
+
+    /* Conjunction of removed conjuncts, if type is REDUCE_COMPONENT */
+    ptree_t *env_init;
+    ptree_t *sys_init;
+    ptree_t *env_trans;
+    ptree_t *sys_trans;
+} reduce_step_t;
+
+/** \brief Record of a reduction of the global specification. */
+typedef struct reduction_t
+{
+    unsigned char init_flags;
+    bool one_side_sys;  /**<\brief True if init_flags is ONE_SIDE_INIT
+                           and only SYSINIT is nonempty. */
+    reduce_step_t *steps;  /**<\brief In order of application. */
+    int num_steps;
+} reduction_t;
+
+
+/** Reduce the global specification spc in-place, as described above.
+
+   Removed variables are deleted from spc.evar_list and spc.svar_list,
+   and conjuncts that were used up are replaced by True.  At least one
+   system variable is always kept.
+
+   \param init_flags as given to check_realizable() (cf. solve.h).
+
+   \param max_component largest component (number of variables) that
+   may be eliminated, or -1 to not limit it, which is only appropriate
+   if the result will not be given to reduce_restore_aut().
+
+   \param verbose level of detail in logging; larger implies more
+   detail. 0 (zero) to be quiet.
+
+   \return record of eliminations, to be freed with delete_reduction(),
+   or NULL on error. */
+reduction_t *reduce_GR1( unsigned char init_flags, int max_component,
+                         unsigned char verbose );
+
+/** Convert strategy synthesized for the reduced game into one for the
+   original game, and restore the removed variables into spc.evar_list
+   and spc.svar_list.  The given automaton is consumed (it may be
+   freed).  Return head of the resulting automaton, or NULL on error. */
+anode_t *reduce_restore_aut( reduction_t *red, anode_t *head );
+
+void delete_reduction( reduction_t *red );
+
+
+#endif
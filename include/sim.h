@@ -9,6 +9,8 @@
 #ifndef SIM_H
 #define SIM_H
 
+#include <stdint.h>
+
 #include "common.h"
 #include "automaton.h"
 
@@ -19,11 +21,19 @@
    Some core functions for working with strategy automata have changed
    recently, and sim_rhc() has not yet been carefully checked
    following those changes.  As such, sim_rhc() should be considered
-   as possibly temporarily defunct. */
+   as possibly temporarily defunct.
+
+   Environment moves are drawn uniformly at random by
+   sample_env_move(), using a generator seeded by sim_set_seed(), or by
+   the current time if it was not called. */
 anode_t *sim_rhc( DdManager *manager, DdNode *W,
                   DdNode *etrans, DdNode *strans, DdNode **sgoals,
                   char *metric_vars, int horizon, vartype *init_state,
                   int num_it, unsigned char verbose );
 
+/** Seed the generator of environment moves in sim_rhc(), so that
+   simulations can be repeated. */
+void sim_set_seed( uint64_t seed );
+
 
 #endif
@@ -109,6 +109,40 @@ DdNode *compute_winning_set_BDD( DdManager *manager,
                                  DdNode **egoals, DdNode **sgoals,
                                  unsigned char verbose );
 
+/** Fixpoints kept by compute_winning_set_incr() from one call to the
+   next.  Initialize with WINNING_INCR_INIT(), and release with
+   winning_incr_clear(). */
+typedef struct {
+    DdNode *etrans, *strans;  /* Transition rules of the last call */
+    DdNode **Z;  /* Fixpoint for each system goal; Z[0] is the winning set */
+    DdNode **Y;  /* Least fixpoint for each system goal, from the last
+                    iteration of Z */
+    int num_sgoals;
+} winning_incr_t;
+
+#define WINNING_INCR_INIT(X) \
+    (X).etrans = (X).strans = NULL; \
+    (X).Z = (X).Y = NULL; \
+    (X).num_sgoals = 0;
+
+/** Compute the same winning set as compute_winning_set_BDD(), but
+   reuse fixpoints from the previous call with incr, if any.  If
+   etrans has only gained and strans only lost edges since then (e.g.,
+   by "restrict" of controlled edges), then the greatest fixpoint
+   continues down from the previous winning set.  In the opposite
+   case (e.g., by "relax"), the least fixpoints begin from their
+   previous values.  Otherwise, the winning set is computed from
+   scratch.  The goals must be the same in each call.  The fixpoints
+   are saved in incr for the next call, and the returned BDD is
+   referenced for the caller.  Return NULL if error. */
+DdNode *compute_winning_set_incr( DdManager *manager, winning_incr_t *incr,
+                                  DdNode *etrans, DdNode *strans,
+                                  DdNode **egoals, DdNode **sgoals,
+                                  unsigned char verbose );
+
+/** Dereference the fixpoints saved in incr, and reinitialize it. */
+void winning_incr_clear( DdManager *manager, winning_incr_t *incr );
+
 /** W is assumed to be (the characteristic function of) the set of
    winning states, e.g., as returned by compute_winning_set().
    num_sublevels is an int array of length equal to the number of
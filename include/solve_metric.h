@@ -22,17 +22,42 @@
    linked.  get_offsets_list() is a more general version. */
 int *get_offsets( char *metric_vars, int *num_vars );
 
-/** G is the goal set against which to measure distance.
-   Result is written into given variables Min and Max;
+/** G is the goal set against which to measure distance.  Min and Max
+   are the least and greatest distance to G among states in T.  They
+   are computed symbolically, by finding the extrema of an ADD of the
+   distance over the metric variables, so the cost depends on BDD sizes
+   rather than on the number of states in T and G.  Result is written
+   into given variables Min and Max, which are -1 if T or G is empty;
    return 0 on success, -1 error. */
 int bounds_DDset( DdManager *manager, DdNode *T, DdNode *G,
                   int *offw, int num_metric_vars,
                   double *Min, double *Max, unsigned char verbose );
 
+/** Same as bounds_DDset() but for distance to the state ref_state. */
 int bounds_state( DdManager *manager, DdNode *T, vartype *ref_state,
                   int *offw, int num_metric_vars,
                   double *Min, double *Max, unsigned char verbose );
 
+/** Compute the winning set W and its sublevel sets, as in
+   compute_horizon().  (*Min)[i][j] and (*Max)[i][j] are the least and
+   greatest distance to system goal i among states that are in
+   sublevel j+1 but not in sublevel j of that goal, for j from 1 to
+   (*num_sublevels)[i]-2, and 0 for j = 0.  The caller is expected to
+   free *num_sublevels, *Min, and *Max, and the arrays in them.  Return
+   0 on success, -1 on error. */
+int compute_minmax( DdManager *manager, DdNode **W,
+                    DdNode **etrans, DdNode **strans, DdNode ***sgoals,
+                    int **num_sublevels, double ***Min, double ***Max,
+                    int *offw, int num_metric_vars,
+                    unsigned char verbose );
+
+/** Compute distance bounds of sublevel sets in compute_horizon() in up
+   to n threads.  Each pair of system goal and sublevel is independent
+   of the others; pairs are split among threads, each using a CUDD
+   manager of its own, to which the sets are copied.  Results do not
+   depend on n.  The default is 1, i.e., no additional threads. */
+void metric_set_threads( int n );
+
 int compute_horizon( DdManager *manager, DdNode **W,
                      DdNode **etrans, DdNode **strans, DdNode ***sgoals,
                      char *metric_vars, unsigned char verbose );
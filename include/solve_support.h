@@ -9,6 +9,9 @@
 #ifndef SOLVE_SUPPORT_H
 #define SOLVE_SUPPORT_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "common.h"
 
 
@@ -66,6 +69,27 @@ vartype **get_env_moves( DdManager *manager, int *cube,
                          vartype *state, DdNode *etrans,
                          int num_env, int num_sys, int *emoves_len );
 
+/** Draw a satisfying assignment of f uniformly at random, and store it
+   in assignment, where assignment[i] is the value of the variable with
+   index vars[i].  f must not depend on other variables.  Assignments
+   are not enumerated; instead, each variable in turn is set with
+   probability given by counts of satisfying assignments of the
+   cofactors (cf. Cudd_CountMinterm()), so the cost is linear in
+   num_vars times the size of f.  rng is the state of the generator
+   (cf. rng_next() in gr1c_util.h).  Return 0 on success, or -1 if f is
+   unsatisfiable. */
+int sample_minterm( DdManager *manager, DdNode *f, int *vars, int num_vars,
+                    vartype *assignment, uint64_t *rng );
+
+/** Draw one of the environment moves that get_env_moves() would list,
+   uniformly at random using sample_minterm(), and store it in
+   env_move, which has length num_env.  Return 0 on success, or -1 if
+   there is no environment move or on error. */
+int sample_env_move( DdManager *manager, int *cube,
+                     vartype *state, DdNode *etrans,
+                     int num_env, int num_sys, vartype *env_move,
+                     uint64_t *rng );
+
 /** Compute exists modal operator applied to set C, i.e., the set of
    states such that for each environment move, there exists a system
    move into C. */
@@ -73,5 +97,20 @@ DdNode *compute_existsmodal( DdManager *manager, DdNode *C,
                              DdNode *etrans, DdNode *strans,
                              int num_env, int num_sys, int *cube );
 
+/** Create a manager with num_vars variables for use by a worker
+   thread, with the cache limit and dynamic reordering of manager.
+   Managers cannot be shared among threads, so the BDDs that a worker
+   needs are copied into its manager using Cudd_bddTransfer(), which
+   reads the original manager and thus must be done before any worker
+   starts.  Exit on failure. */
+DdManager *worker_manager( DdManager *manager, int num_vars );
+
+/** Call worker() on each of the num_workers consecutive objects of
+   the given size at args, each in its own thread, and return when all
+   calls are done.  If a thread cannot be created, then its call is
+   made in the calling thread, as is the only call if num_workers is 1. */
+void run_workers( void *(*worker)( void * ), void *args, size_t size,
+                  int num_workers );
+
 
 #endif
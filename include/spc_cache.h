@@ -0,0 +1,83 @@
+/** \file spc_cache.h
+ * \brief Precompiled specifications.
+ *
+ * A compiled specification holds the parse trees of a specification
+ * as given (the "source" part), so that it can be used without
+ * running the parser, and optionally the result of expanding
+ * nonboolean variables into bits (cf. expand_nonbool_GR1() and
+ * expand_nonbool_variables() in gr1c_util.h), so that this step can
+ * also be skipped.  Files begin with SPC_CACHE_MAGIC, which cannot
+ * begin a specification in the text format, so front ends accept
+ * compiled specifications in place of the usual input.
+ *
+ * Integers are written in the byte order of the machine that created
+ * the file, which is checked when loading.
+ */
+
+
+#ifndef SPC_CACHE_H
+#define SPC_CACHE_H
+
+#include <stdio.h>
+
+#include "common.h"
+#include "ptree.h"
+
+
+#define SPC_CACHE_MAGIC "\211GR1CSPC"
+#define SPC_CACHE_MAGIC_LEN 8
+#define SPC_CACHE_VERSION 1
+
+/**
+ * \defgroup SpcCacheKinds kinds of games in compiled specifications
+ *
+ * The grammars accepted by gr1c and gr1c-rg differ in the meaning of
+ * system goals, so a compiled specification records which was used.
+ *
+ * @{
+ */
+#define SPC_CACHE_GR1 0  /**<\brief GR(1) game, as parsed by gr1c. */
+#define SPC_CACHE_RG 1  /**<\brief Reachability game, as parsed by gr1c-rg. */
+#define SPC_CACHE_ANY -1  /**<\brief Accept either kind when loading. */
+/**@}*/
+
+
+/** Return True if the next byte of fp is the first byte of
+   SPC_CACHE_MAGIC, without consuming it. */
+bool spc_cache_detect( FILE *fp );
+
+/** Begin writing a compiled specification to fp with the source part
+   given by spec, which should not yet be expanded.  kind is one of
+   \ref SpcCacheKinds other than SPC_CACHE_ANY.  Return 0 on success,
+   nonzero on error. */
+int spc_cache_dump_source( specification_t *spec, int kind, FILE *fp );
+
+/** Append the given specification, as it is after expand_nonbool_GR1()
+   with init_flags and expand_nonbool_variables(), to a compiled
+   specification begun with spc_cache_dump_source().  The encoding
+   of each nonboolean variable (cf. get_nonbool_encoding()) is
+   recorded.  Return 0 on success, nonzero on error. */
+int spc_cache_dump_expanded( specification_t *spec, unsigned char init_flags,
+                             FILE *fp );
+
+/** Load compiled specification from fp.  The source part is placed in
+   *source, which should be initialized with SPC_INIT.  If expanded is
+   not NULL, the file includes an expanded part, and that part was
+   created with the given init_flags and with the encodings currently
+   selected for its nonboolean variables, then it is placed in
+   *expanded.
+
+   Return -1 on error (including if the kind of game differs from
+   kind, unless kind is SPC_CACHE_ANY), 0 if only the source part was
+   loaded, and 1 if the expanded part was also loaded. */
+int spc_cache_load( FILE *fp, int kind,
+                    specification_t *source, specification_t *expanded,
+                    unsigned char init_flags, unsigned char verbose );
+
+/** Delete the variable lists, initial conditions, transition rule
+   arrays, and goals of spec, and reinitialize it with SPC_INIT.
+   Merged transition rules (env_trans and sys_trans) are not deleted. */
+void spc_free( specification_t *spec );
+
+
+#endif
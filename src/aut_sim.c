@@ -0,0 +1,241 @@
+/* aut_sim.c -- Monte Carlo simulation of strategies.
+ */
+
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "common.h"
+#include "automaton.h"
+#include "gr1c_util.h"
+#include "solve_support.h"
+#include "aut_sim.h"
+
+
+/* Plays first, ..., last-1, which are run by one thread */
+typedef struct {
+    aut_bin_t *bin;
+    int *init_nodes;
+    int num_init;
+    uint64_t *seeds;  /* Seed of each play */
+    int first, last;
+    int play_len;
+    aut_sim_stats_t stats;
+} aut_sim_worker_t;
+
+
+static void init_stats( aut_sim_stats_t *stats, int num_goals )
+{
+    stats->num_plays = 0;
+    stats->num_steps = 0;
+    stats->num_blocked = 0;
+    stats->num_goals = num_goals;
+    stats->goal_visits = calloc( num_goals, sizeof(uint64_t) );
+    if (stats->goal_visits == NULL) {
+        perror( __FILE__ ",  calloc" );
+        exit(-1);
+    }
+    stats->num_cycles = 0;
+    stats->cycle_min = stats->cycle_max = 0;
+    stats->cycle_sum = 0;
+    stats->secs = 0;
+}
+
+static void add_cycle( aut_sim_stats_t *stats, int len )
+{
+    if (stats->num_cycles == 0 || len < stats->cycle_min)
+        stats->cycle_min = len;
+    if (stats->num_cycles == 0 || len > stats->cycle_max)
+        stats->cycle_max = len;
+    stats->num_cycles++;
+    stats->cycle_sum += len;
+}
+
+/* Add the statistics in src to those in dest. */
+static void merge_stats( aut_sim_stats_t *dest, aut_sim_stats_t *src )
+{
+    int i;
+    dest->num_plays += src->num_plays;
+    dest->num_steps += src->num_steps;
+    dest->num_blocked += src->num_blocked;
+    for (i = 0; i < dest->num_goals; i++)
+        *(dest->goal_visits+i) += *(src->goal_visits+i);
+    if (src->num_cycles > 0) {
+        if (dest->num_cycles == 0 || src->cycle_min < dest->cycle_min)
+            dest->cycle_min = src->cycle_min;
+        if (dest->num_cycles == 0 || src->cycle_max > dest->cycle_max)
+            dest->cycle_max = src->cycle_max;
+        dest->num_cycles += src->num_cycles;
+        dest->cycle_sum += src->cycle_sum;
+    }
+}
+
+
+static void *aut_sim_worker( void *arg )
+{
+    aut_sim_worker_t *w = arg;
+    aut_bin_t *bin = w->bin;
+    aut_sim_stats_t *stats = &w->stats;
+    uint64_t rng, first_edge, num_succ;
+    int node, mode, next_mode;
+    int last_entry;  /* Step of the last entry into mode 0 (or arrival
+                        at the goal if single), or -1 */
+    int p, s;
+
+    /* With one goal mode, the mode never changes, so arrivals at the
+       goal, i.e., at nodes with reach annotation 0, are counted. */
+    bool single = (stats->num_goals == 1);
+
+    for (p = w->first; p < w->last; p++) {
+        rng = *(w->seeds+p);
+        node = *(w->init_nodes + rng_next( &rng ) % w->num_init);
+        mode = *(bin->modes+node);
+        if (single)
+            last_entry = (*(bin->rgrads+node) == 0) ? 0 : -1;
+        else
+            last_entry = (mode == 0) ? 0 : -1;
+        for (s = 1; s <= w->play_len; s++) {
+            first_edge = *(bin->offsets+node);
+            num_succ = *(bin->offsets+node+1) - first_edge;
+            if (num_succ == 0) {
+                stats->num_blocked++;
+                break;
+            }
+            node = *(bin->targets + first_edge + rng_next( &rng ) % num_succ);
+            next_mode = *(bin->modes+node);
+            if (single) {
+                if (*(bin->rgrads+node) == 0) {
+                    (*stats->goal_visits)++;
+                    if (last_entry >= 0)
+                        add_cycle( stats, s - last_entry );
+                    last_entry = s;
+                }
+            } else if (next_mode != mode) {
+                if (mode >= 0)
+                    (*(stats->goal_visits+mode))++;
+                if (next_mode == 0) {
+                    if (last_entry >= 0)
+                        add_cycle( stats, s - last_entry );
+                    last_entry = s;
+                }
+                mode = next_mode;
+            }
+        }
+        stats->num_steps += s-1;
+        stats->num_plays++;
+    }
+    return NULL;
+}
+
+
+int aut_sim_run( aut_bin_t *bin, int num_plays, int play_len,
+                 uint64_t seed, int num_threads, aut_sim_stats_t *stats )
+{
+    aut_sim_worker_t *workers;
+    int num_workers;
+    int *init_nodes, num_init;
+    uint64_t *seeds;
+    struct timespec start, end;
+    int num_goals = 1;
+    int i;
+
+    if (bin->num_nodes == 0) {
+        fprintf( stderr, "Error aut_sim_run: strategy is empty.\n" );
+        return -1;
+    }
+    if (num_plays < 0)
+        num_plays = 0;
+
+    for (i = 0; i < bin->num_nodes; i++) {
+        if (*(bin->modes+i) >= num_goals)
+            num_goals = *(bin->modes+i)+1;
+    }
+    init_stats( stats, num_goals );
+
+    init_nodes = malloc( bin->num_nodes*sizeof(int) );
+    seeds = malloc( (num_plays+1)*sizeof(uint64_t) );
+    if (init_nodes == NULL || seeds == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    num_init = 0;
+    for (i = 0; i < bin->num_nodes; i++) {
+        if (*(bin->initial+i))
+            *(init_nodes+(num_init++)) = i;
+    }
+    if (num_init == 0) {
+        for (i = 0; i < bin->num_nodes; i++)
+            *(init_nodes+i) = i;
+        num_init = bin->num_nodes;
+    }
+    for (i = 0; i < num_plays; i++)
+        *(seeds+i) = rng_next( &seed );
+
+    num_workers = (num_threads < num_plays) ? num_threads : num_plays;
+    if (num_workers < 1)
+        num_workers = 1;
+    workers = malloc( num_workers*sizeof(aut_sim_worker_t) );
+    if (workers == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < num_workers; i++) {
+        (workers+i)->bin = bin;
+        (workers+i)->init_nodes = init_nodes;
+        (workers+i)->num_init = num_init;
+        (workers+i)->seeds = seeds;
+        (workers+i)->first = (int)((long long)num_plays*i/num_workers);
+        (workers+i)->last = (int)((long long)num_plays*(i+1)/num_workers);
+        (workers+i)->play_len = play_len;
+        init_stats( &(workers+i)->stats, num_goals );
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    run_workers( aut_sim_worker, workers, sizeof(aut_sim_worker_t),
+                 num_workers );
+    clock_gettime( CLOCK_MONOTONIC, &end );
+    stats->secs = (end.tv_sec - start.tv_sec)
+        + (end.tv_nsec - start.tv_nsec)/1e9;
+
+    for (i = 0; i < num_workers; i++) {
+        merge_stats( stats, &(workers+i)->stats );
+        aut_sim_free( &(workers+i)->stats );
+    }
+    free( workers );
+    free( init_nodes );
+    free( seeds );
+    return 0;
+}
+
+
+void aut_sim_print( aut_sim_stats_t *stats, FILE *fp )
+{
+    int i;
+
+    fprintf( fp, "plays: %d\n", stats->num_plays );
+    fprintf( fp, "blocked plays: %d\n", stats->num_blocked );
+    fprintf( fp, "steps: %llu\n", (unsigned long long)stats->num_steps );
+    fprintf( fp, "seconds: %.6f\n", stats->secs );
+    if (stats->secs > 0)
+        fprintf( fp, "steps per second: %.0f\n",
+                 stats->num_steps/stats->secs );
+    for (i = 0; i < stats->num_goals; i++)
+        fprintf( fp, "visits of goal mode %d: %llu\n",
+                 i, (unsigned long long)*(stats->goal_visits+i) );
+    fprintf( fp, "mode cycles: %llu\n",
+             (unsigned long long)stats->num_cycles );
+    if (stats->num_cycles > 0)
+        fprintf( fp, "mode cycle length: min %d, mean %.2f, max %d\n",
+                 stats->cycle_min,
+                 (double)stats->cycle_sum/stats->num_cycles,
+                 stats->cycle_max );
+}
+
+
+void aut_sim_free( aut_sim_stats_t *stats )
+{
+    free( stats->goal_visits );
+    stats->goal_visits = NULL;
+}
@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 
 #include "ptree.h"
 #include "gr1c_util.h"
@@ -147,6 +148,65 @@ int anode_index( anode_t *head, anode_t *node )
 }
 
 
+#define AUT_NUMBERING_HASH(node, size) \
+    ((int)((((uintptr_t)(node) >> 4)*2654435761u) & ((size)-1)))
+aut_numbering_t *aut_number_nodes( anode_t *head )
+{
+    aut_numbering_t *numbering;
+    int counter, k;
+
+    numbering = malloc( sizeof(aut_numbering_t) );
+    if (numbering == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    numbering->size = 16;
+    while (numbering->size < 2*aut_size( head ))
+        numbering->size *= 2;
+    numbering->nodes = calloc( numbering->size, sizeof(anode_t *) );
+    numbering->indices = malloc( numbering->size*sizeof(int) );
+    if (numbering->nodes == NULL || numbering->indices == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+
+    counter = 0;
+    while (head) {
+        k = AUT_NUMBERING_HASH( head, numbering->size );
+        while (*(numbering->nodes+k) != NULL)
+            k = (k+1) & (numbering->size-1);
+        *(numbering->nodes+k) = head;
+        *(numbering->indices+k) = counter;
+        head = head->next;
+        counter++;
+    }
+
+    return numbering;
+}
+
+
+int aut_numbering_index( aut_numbering_t *numbering, anode_t *node )
+{
+    int k = AUT_NUMBERING_HASH( node, numbering->size );
+    while (*(numbering->nodes+k) != NULL) {
+        if (*(numbering->nodes+k) == node)
+            return *(numbering->indices+k);
+        k = (k+1) & (numbering->size-1);
+    }
+    return -1;
+}
+
+
+void delete_aut_numbering( aut_numbering_t *numbering )
+{
+    if (numbering == NULL)
+        return;
+    free( numbering->nodes );
+    free( numbering->indices );
+    free( numbering );
+}
+
+
 anode_t *delete_anode( anode_t *head, anode_t *target )
 {
     anode_t *node, *next;
@@ -308,6 +368,7 @@ int aut_compact_nonbool( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
     int num_env, num_sys;
     ptree_t *var = evar_list, *var_tail, *var_next;
     int start_index, stop_index, i;
+    int encoding = get_nonbool_encoding( name );
     vartype *new_state;
 
     num_env = tree_size( evar_list );
@@ -364,8 +425,9 @@ int aut_compact_nonbool( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
 
         for (i = 0; i < start_index; i++)
             *(new_state+i) = *(head->state+i);
-        *(new_state+start_index) = bitvec_to_int( head->state+start_index,
-                                                  stop_index-start_index+1 );
+        *(new_state+start_index) = nonbool_to_int( head->state+start_index,
+                                                   stop_index-start_index+1,
+                                                   encoding );
         for (i = start_index+1;
              i < num_env+num_sys - (stop_index-start_index); i++)
             *(new_state+i) = *(head->state+i+stop_index-start_index);
@@ -387,7 +449,7 @@ int aut_expand_bool( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
 {
     int mapped_len, num_nonbool;
     vartype *new_state;
-    int *offw;
+    int *offw, *enc;
 
     if (head == NULL)  /* Empty automaton */
         return -1;
@@ -401,14 +463,17 @@ int aut_expand_bool( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
     offw = get_offsets_list( evar_list, svar_list, nonbool_var_list );
     if (offw == NULL && num_nonbool > 0)
         return -1;
+    enc = get_encodings_list( nonbool_var_list );
 
     while (head) {
-        new_state = expand_nonbool_state( head->state, offw, num_nonbool,
-                                          mapped_len );
+        new_state = expand_nonbool_state( head->state, offw, enc,
+                                          num_nonbool, mapped_len );
         if (new_state == NULL) {
             fprintf( stderr,
                      "Error aut_expand_bool: failed to expand nonbool values"
                      " in automaton.\n" );
+            free( offw );
+            free( enc );
             return -1;
         }
 
@@ -420,6 +485,7 @@ int aut_expand_bool( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
 
     if (offw != NULL)
         free( offw );
+    free( enc );
     return 0;
 }
 
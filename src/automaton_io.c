@@ -8,861 +8,1974 @@
 #define _POSIX_C_SOURCE 200809L
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
+#include <limits.h>
 #include <time.h>
+#if defined(__unix__) || defined(__APPLE__)
+#define BIN_AUT_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
 
 #include "ptree.h"
 #include "automaton.h"
 
 
-#define INPUT_STRING_LEN 4096
+/* Input of the line-oriented text format is read in large blocks by
+   fread(), and lines are returned in place from the buffer, which is
+   grown if a line does not fit.  Thus, line length is not limited.
+   Input that is gzip-compressed is detected by its first bytes and
+   decompressed through a buffer of fixed size. */
+#define AUT_READ_BUFLEN (1 << 20)
+typedef struct {
+    FILE *fp;
+    char *buf;
+    size_t cap;
+    size_t pos;  /* Start of unread data */
+    size_t end;  /* End of data in buf */
+    bool eof;
+    bool probed;  /* Whether compression has been checked for */
+    bool gz;  /* Whether input is gzip-compressed */
+    bool failed;
+#ifdef USE_ZLIB
+    z_stream zs;
+    unsigned char *zbuf;  /* Compressed input */
+    bool member_end;  /* Whether at end of a gzip member */
+#endif
+} inbuf_t;
+
+
+static void inbuf_init( inbuf_t *in, FILE *fp )
+{
+    in->fp = fp;
+    in->cap = AUT_READ_BUFLEN;
+    in->buf = malloc( in->cap );
+    if (in->buf == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    in->pos = in->end = 0;
+    in->eof = False;
+    in->probed = in->gz = in->failed = False;
+#ifdef USE_ZLIB
+    in->zbuf = NULL;
+#endif
+}
+
+
+static void inbuf_free( inbuf_t *in )
+{
+    free( in->buf );
+#ifdef USE_ZLIB
+    if (in->gz) {
+        inflateEnd( &(in->zs) );
+        free( in->zbuf );
+    }
+#endif
+}
+
+
+/* Read up to n bytes of input, after decompression if needed, into
+   dst.  Return the number of bytes read, which is 0 at end of input
+   or on error, in which case in->failed is set. */
+static size_t inbuf_read( inbuf_t *in, char *dst, size_t n )
+{
+    size_t got;
+#ifdef USE_ZLIB
+    int ret;
+#endif
+
+    if (!in->gz) {
+        got = fread( dst, 1, n, in->fp );
+        if (in->probed)
+            return got;
+        in->probed = True;
+        if (got < 2 || (unsigned char)*dst != 0x1f
+            || (unsigned char)*(dst+1) != 0x8b)
+            return got;
+#ifdef USE_ZLIB
+        /* The bytes read so far are the start of compressed input. */
+        in->zbuf = malloc( AUT_READ_BUFLEN );
+        if (in->zbuf == NULL) {
+            perror( __FILE__ ",  malloc" );
+            exit(-1);
+        }
+        memcpy( in->zbuf, dst, got );
+        memset( &(in->zs), 0, sizeof(z_stream) );
+        if (inflateInit2( &(in->zs), 15+16 ) != Z_OK) {
+            fprintf( stderr, "Error initializing decompression.\n" );
+            free( in->zbuf );
+            in->failed = True;
+            return 0;
+        }
+        in->zs.next_in = in->zbuf;
+        in->zs.avail_in = got;
+        in->member_end = False;
+        in->gz = True;
+#else
+        fprintf( stderr,
+                 "Error: input is gzip-compressed, but gr1c was built"
+                 " without zlib.\n" );
+        in->failed = True;
+        return 0;
+#endif
+    }
+
+#ifdef USE_ZLIB
+    in->zs.next_out = (unsigned char *)dst;
+    in->zs.avail_out = n;
+    while (in->zs.avail_out == n) {
+        if (in->zs.avail_in == 0) {
+            got = fread( in->zbuf, 1, AUT_READ_BUFLEN, in->fp );
+            if (got == 0) {
+                if (!in->member_end) {
+                    fprintf( stderr, "Error: compressed input is truncated.\n" );
+                    in->failed = True;
+                }
+                break;
+            }
+            in->zs.next_in = in->zbuf;
+            in->zs.avail_in = got;
+        }
+        if (in->member_end) {  /* Concatenated gzip members */
+            inflateReset( &(in->zs) );
+            in->member_end = False;
+        }
+        ret = inflate( &(in->zs), Z_NO_FLUSH );
+        if (ret == Z_STREAM_END) {
+            in->member_end = True;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            fprintf( stderr, "Error decompressing input.\n" );
+            in->failed = True;
+            break;
+        }
+    }
+    return n - in->zs.avail_out;
+#else
+    return 0;
+#endif
+}
+
+
+/* Return the next line, with its newline character (if any) replaced
+   by '\0', or NULL if there are no more lines.  The returned string
+   is valid until the next call. */
+static char *inbuf_getline( inbuf_t *in )
+{
+    char *line, *nl;
+    char *tmp;
+    size_t scanned = 0;  /* Bytes after pos known to not contain '\n' */
+    size_t n;
+
+    while (True) {
+        nl = memchr( in->buf+in->pos+scanned, '\n',
+                     in->end - in->pos - scanned );
+        if (nl != NULL) {
+            *nl = '\0';
+            line = in->buf+in->pos;
+            in->pos = nl - in->buf + 1;
+            return line;
+        }
+        scanned = in->end - in->pos;
+
+        if (in->eof) {
+            if (in->pos == in->end)
+                return NULL;
+            *(in->buf+in->end) = '\0';
+            line = in->buf+in->pos;
+            in->pos = in->end;
+            return line;
+        }
+
+        if (in->pos > 0) {
+            memmove( in->buf, in->buf+in->pos, in->end - in->pos );
+            in->end -= in->pos;
+            in->pos = 0;
+        }
+        /* Always leave room to terminate the last line. */
+        if (in->end == in->cap-1) {
+            tmp = realloc( in->buf, 2*in->cap );
+            if (tmp == NULL) {
+                perror( __FILE__ ",  realloc" );
+                exit(-1);
+            }
+            in->buf = tmp;
+            in->cap *= 2;
+        }
+        n = inbuf_read( in, in->buf+in->end, in->cap-1 - in->end );
+        if (n == 0)
+            in->eof = True;
+        in->end += n;
+    }
+}
+
+
+/* Parse a decimal integer at *s, after skipping blank space, and
+   advance *s past it.  Return nonzero if one was found. */
+static int parse_int( char **s, int *x )
+{
+    char *p = *s;
+    bool negative = False;
+    long v = 0;
+
+    while (*p == ' ' || *p == '\t' || *p == '\r'
+           || *p == '\v' || *p == '\f')
+        p++;
+    if (*p == '-' || *p == '+') {
+        negative = (*p == '-');
+        p++;
+    }
+    if (*p < '0' || *p > '9')
+        return 0;
+    while (*p >= '0' && *p <= '9') {
+        if (v <= INT_MAX)
+            v = 10*v + (*p - '0');
+        p++;
+    }
+    if (v > INT_MAX)
+        v = INT_MAX;
+    *x = negative ? -v : v;
+    *s = p;
+    return 1;
+}
+
+
+/* Parse the state field of a line in gr1c automaton format version 2
+   at *s into state, and advance *s past it.  prev is the state of the
+   previous node, or NULL if there is none, and dict is the dictionary
+   of dict_len states given so far.  Return 1 if the state was given
+   as a change of prev (and thus is a new dictionary entry), 0 if it
+   was given by reference to the dictionary, or -1 if error. */
+static int parse_state_v2( char **s, vartype *state, int state_len,
+                           vartype *prev, vartype **dict, int dict_len )
+{
+    char *p = *s;
+    int pos, x;
+    int i;
+
+    while (*p == ' ' || *p == '\t')
+        p++;
+    if (*p == '@') {
+        p++;
+        if (!parse_int( &p, &x ) || x < 0 || x >= dict_len)
+            return -1;
+        memcpy( state, *(dict+x), state_len*sizeof(vartype) );
+        *s = p;
+        return 0;
+    }
+
+    if (prev == NULL) {
+        for (i = 0; i < state_len; i++)
+            *(state+i) = 0;
+    } else {
+        memcpy( state, prev, state_len*sizeof(vartype) );
+    }
+    if (*p == '.') {
+        p++;
+    } else {
+        while (True) {
+            if (!parse_int( &p, &pos ) || pos < 0 || pos >= state_len
+                || *p != ':')
+                return -1;
+            p++;
+            if (!parse_int( &p, state+pos ))
+                return -1;
+            if (*p != ',')
+                break;
+            p++;
+        }
+    }
+    if (*p != ' ' && *p != '\t' && *p != '\r' && *p != '\0')
+        return -1;
+    *s = p;
+    return 1;
+}
+
 
-/* Future work: sorting of nodes could be made faster. */
 anode_t *aut_aut_loadver( int state_len, FILE *fp, int *version )
 {
+    inbuf_t in;
     anode_t *head = NULL, *node;
-    vartype *state;
-    int this_trans;
-    int i, j, k;  /* Generic counters */
-    int ia_len;  /* length of ID_array, trans_array, and node_array */
-    int *ID_array;
-    int **trans_array;
-    anode_t **node_array;
-    char line[INPUT_STRING_LEN];
-    char *start, *end;
-    int line_num;
+    anode_t **nodes = NULL;  /* In order of appearance in the file */
+    int *IDs = NULL;
+    int *positions = NULL;  /* Index in nodes of each ID */
+    vartype **dict = NULL;  /* Distinct states given in version 2 */
+    int dict_len = 0;
+    long target;
+    size_t *trans_start = NULL;  /* Offset of each node's entries in trans */
+    int *trans = NULL;  /* Target IDs of transitions of all nodes */
+    int num_nodes = 0, nodes_cap = 0;
+    size_t num_trans = 0, trans_cap = 0;
+    char *line, *s;
+    int line_num = 0;
     int detected_version = -1;
-    int *tmp_intp;
-    int **tmp_intpp;
-    anode_t **tmp_anode_tpp;
+    int x;
+    int i, j;
+    size_t k;
+    void *tmp;
 
     if (fp == NULL)
         fp = stdin;
 
     if (state_len < 1)
         return NULL;
-    state = malloc( sizeof(vartype)*state_len );
-    if (state == NULL) {
-        perror( __FILE__ ",  malloc" );
-        exit(-1);
-    }
 
-    ia_len = 1;
-    ID_array = malloc( sizeof(int)*ia_len );
-    trans_array = malloc( sizeof(int *)*ia_len );
-    *(trans_array+ia_len-1) = NULL;
-    node_array = malloc( sizeof(anode_t *)*ia_len );
-    *(node_array+ia_len-1) = NULL;
-    if (ID_array == NULL || trans_array == NULL || node_array == NULL) {
-        free( state );
-        perror( __FILE__ ",  malloc" );
-        exit(-1);
-    }
-
-    line_num = 0;
-    while (fgets( line, INPUT_STRING_LEN, fp )) {
+    inbuf_init( &in, fp );
+    while ((line = inbuf_getline( &in )) != NULL) {
         line_num++;
-        if (strlen( line ) < 1 || *line == '#' || *line == '\n' || *line == '\r')
+        if (*line == '\0' || *line == '#' || *line == '\r')
             continue;
 
-        *(ID_array+ia_len-1) = strtol( line, &end, 10 );
-        if (line == end) {
+        s = line;
+        if (detected_version == 2) {
+            x = num_nodes;  /* Node IDs are implicit. */
+        } else if (!parse_int( &s, &x )) {
             fprintf( stderr,
                      "Error parsing gr1c automaton line %d.\n", line_num );
-            head = NULL;
             goto gc;
-        } else if (detected_version < 0) {
-            if (*end == '\0' || *end == '\n' || *end == '\r') {
-                detected_version = *(ID_array+ia_len-1);
-                if (detected_version < 0) {
+        }
+
+        if (detected_version < 0) {
+            while (*s == ' ' || *s == '\t' || *s == '\r')
+                s++;
+            if (*s == '\0') {
+                detected_version = x;
+                if (detected_version < 0 || detected_version > 2) {
                     fprintf( stderr,
-                             "Invalid version number \"%d\" found while"
-                             " parsing gr1c automaton line %d.\n",
-                             detected_version,
-                             line_num );
-                    head = NULL;
+                             "Only gr1c automaton format versions 0, 1,"
+                             " and 2 are supported; found \"%d\" on"
+                             " line %d.\n",
+                             detected_version, line_num );
                     goto gc;
                 }
                 continue;
-            } else {
-                /* If no explicit version number, then assume 0, and
-                   continue parsing this line accordingly. */
-                detected_version = 0;
             }
+            /* If no explicit version number, then assume 0, and
+               continue parsing this line accordingly. */
+            detected_version = 0;
+        }
 
-            if (detected_version != 0 && detected_version != 1) {
-                fprintf( stderr,
-                         "Only gr1c automaton format versions 0 and 1 are supported." );
-                head = NULL;
-                goto gc;
+        if (num_nodes == nodes_cap) {
+            nodes_cap = (nodes_cap == 0) ? 1024 : 2*nodes_cap;
+            tmp = realloc( nodes, nodes_cap*sizeof(anode_t *) );
+            if (tmp == NULL) {
+                perror( __FILE__ ",  realloc" );
+                exit(-1);
+            }
+            nodes = tmp;
+            tmp = realloc( IDs, nodes_cap*sizeof(int) );
+            if (tmp == NULL) {
+                perror( __FILE__ ",  realloc" );
+                exit(-1);
+            }
+            IDs = tmp;
+            tmp = realloc( trans_start, nodes_cap*sizeof(size_t) );
+            if (tmp == NULL) {
+                perror( __FILE__ ",  realloc" );
+                exit(-1);
+            }
+            trans_start = tmp;
+            tmp = realloc( dict, nodes_cap*sizeof(vartype *) );
+            if (tmp == NULL) {
+                perror( __FILE__ ",  realloc" );
+                exit(-1);
             }
+            dict = tmp;
         }
 
-        start = end;
-        for (i = 0; i < state_len && *end != '\0'; i++) {
-            *(state+i) = strtol( start, &end, 10 );
-            if (start == end)
-                break;
-            start = end;
-        }
-        if (i != state_len) {
-            fprintf( stderr,
-                     "Error parsing gr1c automaton line %d.\n", line_num );
-            head = NULL;
-            goto gc;
+        node = malloc( sizeof(anode_t) );
+        if (node == NULL) {
+            perror( __FILE__ ",  malloc" );
+            exit(-1);
         }
-
-        *(node_array+ia_len-1) = malloc( sizeof(anode_t) );
-        if (*(node_array+ia_len-1) == NULL) {
+        node->state = malloc( sizeof(vartype)*state_len );
+        if (node->state == NULL) {
             perror( __FILE__ ",  malloc" );
             exit(-1);
         }
+        node->initial = False;
+        node->trans = NULL;
+        node->trans_len = 0;
+        node->next = NULL;
+        *(nodes+num_nodes) = node;
+        *(IDs+num_nodes) = x;
+        *(trans_start+num_nodes) = num_trans;
+        num_nodes++;
+
+        if (detected_version == 2) {
+            i = parse_state_v2( &s, node->state, state_len,
+                                (num_nodes > 1)
+                                ? (*(nodes+num_nodes-2))->state : NULL,
+                                dict, dict_len );
+            if (i < 0) {
+                fprintf( stderr,
+                         "Error parsing state on gr1c automaton line %d.\n",
+                         line_num );
+                goto gc;
+            }
+            if (i == 1)
+                *(dict+(dict_len++)) = node->state;
+        } else {
+            for (i = 0; i < state_len; i++) {
+                if (!parse_int( &s, node->state+i ))
+                    break;
+            }
+            if (i != state_len) {
+                fprintf( stderr,
+                         "Error parsing gr1c automaton line %d.\n",
+                         line_num );
+                goto gc;
+            }
+        }
 
-        if (detected_version == 1) {
-            (*(node_array+ia_len-1))->initial = strtol( start, &end, 10 );
-            if (start == end || *end == '\0') {
+        if (detected_version >= 1) {
+            if (!parse_int( &s, &x )) {
                 fprintf( stderr,
                          "Error parsing gr1c automaton line %d.\n", line_num );
-                head = NULL;
                 goto gc;
             }
-            if ((*(node_array+ia_len-1))->initial != 0
-                && (*(node_array+ia_len-1))->initial != 1) {
+            if (x != 0 && x != 1) {
                 fprintf( stderr,
                          "Invalid value for node field \"initial\" on line %d.\n", line_num );
-                head = NULL;
                 goto gc;
             }
-            start = end;
-        }
-
-        (*(node_array+ia_len-1))->mode = strtol( start, &end, 10 );
-        if (start == end || *end == '\0') {
-            fprintf( stderr,
-                     "Error parsing gr1c automaton line %d.\n", line_num );
-            head = NULL;
-            goto gc;
+            node->initial = x;
         }
-        start = end;
 
-        (*(node_array+ia_len-1))->rgrad = strtol( start, &end, 10 );
-        if (start == end) {
+        if (!parse_int( &s, &(node->mode) ) || !parse_int( &s, &(node->rgrad) )) {
             fprintf( stderr,
                      "Error parsing gr1c automaton line %d.\n", line_num );
-            head = NULL;
             goto gc;
         }
-        start = end;
 
-        if (detected_version == 0)
-            (*(node_array+ia_len-1))->initial = False;
-
-        (*(node_array+ia_len-1))->state = state;
-        (*(node_array+ia_len-1))->trans_len = 0;
-        (*(node_array+ia_len-1))->next = NULL;
-        *(trans_array+ia_len-1) = NULL;
-
-        this_trans = strtol( start, &end, 10 );
-        while (start != end) {
-            ((*(node_array+ia_len-1))->trans_len)++;
-            *(trans_array+ia_len-1)
-                = realloc( *(trans_array+ia_len-1),
-                           sizeof(int)*((*(node_array+ia_len-1))->trans_len) );
-            if (*(trans_array+ia_len-1) == NULL) {
-                perror( __FILE__ ",  realloc" );
-                exit(-1);
+        target = num_nodes-1;
+        while (parse_int( &s, &x )) {
+            if (detected_version == 2) {
+                /* Each target is given relative to the previous one,
+                   and the first relative to this node. */
+                target += x;
+                x = (target < 0 || target > INT_MAX) ? -1 : target;
             }
-            *(*(trans_array+ia_len-1)
-              + (*(node_array+ia_len-1))->trans_len - 1) = this_trans;
-
-            start = end;
-            this_trans = strtol( start, &end, 10 );
-        }
-
-        state = malloc( sizeof(vartype)*state_len );
-        if (state == NULL) {
-            perror( __FILE__ ",  malloc" );
-            exit(-1);
-        }
-        ia_len++;
-
-        tmp_intp = realloc( ID_array, sizeof(int)*ia_len );
-        if (tmp_intp == NULL) {
-            free( ID_array );
-            ID_array = NULL;
-        } else {
-            ID_array = tmp_intp;
-        }
-        tmp_intpp = realloc( trans_array, sizeof(int *)*ia_len );
-        if (tmp_intpp == NULL) {
-            free( trans_array );
-            trans_array = NULL;
-        } else {
-            trans_array = tmp_intpp;
-        }
-        tmp_anode_tpp = realloc( node_array, sizeof(anode_t *)*ia_len );
-        if (tmp_anode_tpp == NULL) {
-            free( node_array );
-            node_array = NULL;
-        } else {
-            node_array = tmp_anode_tpp;
-        }
-        if (ID_array == NULL || trans_array == NULL || node_array == NULL) {
-            perror( __FILE__ ",  realloc" );
-            exit(-1);
+            if (num_trans == trans_cap) {
+                trans_cap = (trans_cap == 0) ? 4096 : 2*trans_cap;
+                tmp = realloc( trans, trans_cap*sizeof(int) );
+                if (tmp == NULL) {
+                    perror( __FILE__ ",  realloc" );
+                    exit(-1);
+                }
+                trans = tmp;
+            }
+            *(trans+num_trans) = x;
+            num_trans++;
+            (node->trans_len)++;
         }
-        *(trans_array+ia_len-1) = NULL;
-        *(node_array+ia_len-1) = NULL;
     }
-    free( state );
-    state = NULL;
-    ia_len--;
-    if (ia_len == 0) {
-        head = NULL;
+    if (in.failed || num_nodes == 0)
         goto gc;
-    }
 
-    tmp_intp = realloc( ID_array, sizeof(int)*ia_len );
-    if (tmp_intp == NULL) {
-        free( ID_array );
-        ID_array = NULL;
-    } else {
-        ID_array = tmp_intp;
-    }
-    tmp_intpp = realloc( trans_array, sizeof(int *)*ia_len );
-    if (tmp_intpp == NULL) {
-        free( trans_array );
-        trans_array = NULL;
-    } else {
-        trans_array = tmp_intpp;
-    }
-    tmp_anode_tpp = realloc( node_array, sizeof(anode_t *)*ia_len );
-    if (tmp_anode_tpp == NULL) {
-        free( node_array );
-        node_array = NULL;
-    } else {
-        node_array = tmp_anode_tpp;
-    }
-    if (ID_array == NULL || trans_array == NULL || node_array == NULL) {
-        perror( __FILE__ ",  realloc" );
+    /* The IDs must be 0 through num_nodes-1, in any order. */
+    positions = malloc( num_nodes*sizeof(int) );
+    if (positions == NULL) {
+        perror( __FILE__ ",  malloc" );
         exit(-1);
     }
-
-    for (i = 0; i < ia_len; i++) {
-        for (j = 0; j < ia_len && *(ID_array+j) != i; j++) ;
-        if (j == ia_len) {
+    for (i = 0; i < num_nodes; i++)
+        *(positions+i) = -1;
+    for (i = 0; i < num_nodes; i++) {
+        if (*(IDs+i) < 0 || *(IDs+i) >= num_nodes
+            || *(positions + *(IDs+i)) >= 0) {
             fprintf( stderr,
                      "Error parsing gr1c automaton data; missing indices.\n" );
-            head = NULL;
             goto gc;
         }
-
-        if (i == 0) {
-            head = *(node_array+j);
-            node = head;
-        } else {
-            node->next = *(node_array+j);
-            node = node->next;
+        *(positions + *(IDs+i)) = i;
+    }
+    for (k = 0; k < num_trans; k++) {
+        if (*(trans+k) < 0 || *(trans+k) >= num_nodes) {
+            fprintf( stderr,
+                     "Error parsing gr1c automaton data; missing"
+                     " indices.\n" );
+            goto gc;
         }
+    }
 
+    /* Order the node list by ID, and resolve the transitions. */
+    head = *(nodes + *positions);
+    for (i = 0; i < num_nodes; i++) {
+        node = *(nodes + *(positions+i));
+        if (i < num_nodes-1)
+            node->next = *(nodes + *(positions+i+1));
         if (node->trans_len > 0) {
             node->trans = malloc( sizeof(anode_t *)*(node->trans_len) );
             if (node->trans == NULL) {
                 perror( __FILE__ ",  malloc" );
                 exit(-1);
             }
-            for (j = 0; j < node->trans_len; j++) {
-                for (k = 0;
-                     k < ia_len && *(ID_array+k) != *(*(trans_array+i)+j);
-                     k++) ;
-                if (k == ia_len) {
-                    fprintf( stderr,
-                             "Error parsing gr1c automaton data; missing"
-                             " indices.\n" );
-                    head = NULL;
-                    goto gc;
-                }
-                *(node->trans+j) = *(node_array+k);
-            }
+            k = *(trans_start + *(positions+i));
+            for (j = 0; j < node->trans_len; j++)
+                *(node->trans+j) = *(nodes + *(positions + *(trans+k+j)));
         }
     }
 
     /* The "gc" label abbreviates "garbage collection". */
   gc:
-    free( state );
-    free( ID_array );
     if (head == NULL) {
-        for (i = 0; i < ia_len; i++)
-            delete_aut( *(node_array+i) );
+        for (i = 0; i < num_nodes; i++)
+            delete_aut( *(nodes+i) );
     }
-    free( node_array );
-    for (i = 0; i < ia_len; i++)
-        free( *(trans_array+i) );
-    free( trans_array );
+    inbuf_free( &in );
+    free( nodes );
+    free( IDs );
+    free( positions );
+    free( trans_start );
+    free( trans );
+    free( dict );
 
     if (version != NULL && head != NULL)
         *version = detected_version;
     return head;
 }
 
+
 anode_t *aut_aut_load( int state_len, FILE *fp )
 {
     return aut_aut_loadver( state_len, fp, NULL );
 }
 
 
-int aut_aut_dumpver( anode_t *head, int state_len, FILE *fp, int version )
+/* The writers below accumulate output in a large buffer that is
+   passed to fwrite() when full, and integers are formatted directly,
+   which is much faster than calling fprintf() for each field.  If
+   compression is selected, then the buffer is instead passed through
+   deflate() into a smaller buffer of fixed size. */
+#define AUT_WRITE_BUFLEN (1 << 20)
+#define AUT_GZ_BUFLEN (1 << 16)
+typedef struct {
+    FILE *fp;
+    char *buf;
+    size_t len;
+    bool failed;
+#ifdef USE_ZLIB
+    z_stream *zs;  /* NULL if not compressing */
+    unsigned char *zbuf;
+#endif
+} outbuf_t;
+
+/* Kept per thread where supported, so that strategies can be written
+   concurrently (e.g., several output formats from gr1c). */
+#if defined(__GNUC__)
+static __thread size_t last_dump_bytes = 0;
+#else
+static size_t last_dump_bytes = 0;
+#endif
+
+size_t aut_last_dump_bytes(void)
 {
-    anode_t *node = head;
-    int node_counter = 0;
-    int i;
-
-    if (fp == NULL)
-        fp = stdout;
+    return last_dump_bytes;
+}
 
-    fprintf( fp, "%d\n", version );
-    switch (version) {
-    case 0:
-        while (node) {
-            fprintf( fp, "%d", node_counter );
-            for (i = 0; i < state_len; i++)
-                fprintf( fp, " %d", *(node->state+i) );
-            fprintf( fp, " %d %d", node->mode, node->rgrad );
-            for (i = 0; i < node->trans_len; i++)
-                fprintf( fp, " %d", anode_index( head, *(node->trans+i) ) );
-            fprintf( fp, "\n" );
-            node = node->next;
-            node_counter++;
-        }
-        break;
-
-    case 1:
-        while (node) {
-            fprintf( fp, "%d", node_counter );
-            for (i = 0; i < state_len; i++)
-                fprintf( fp, " %d", *(node->state+i) );
-            fprintf( fp, " %d %d %d", node->initial, node->mode, node->rgrad );
-            for (i = 0; i < node->trans_len; i++)
-                fprintf( fp, " %d", anode_index( head, *(node->trans+i) ) );
-            fprintf( fp, "\n" );
-            node = node->next;
-            node_counter++;
-        }
-        break;
-
-    default:
-        return -1;  /* Unrecognized gr1c automaton format version */
-    }
+/* Compression level selected by aut_dump_set_compression() */
+#if defined(__GNUC__)
+static __thread int dump_compression = 0;
+#else
+static int dump_compression = 0;
+#endif
 
+int aut_dump_set_compression( int level )
+{
+    if (level < 0 || level > 9)
+        return -1;
+#ifndef USE_ZLIB
+    if (level > 0)
+        return -1;
+#endif
+    dump_compression = level;
     return 0;
 }
 
 
-void aut_aut_dump( anode_t *head, int state_len, FILE *fp )
+/* If level is positive, then output is gzip-compressed at that
+   level. */
+static void outbuf_init( outbuf_t *out, FILE *fp, int level )
 {
-    aut_aut_dumpver( head, state_len, fp, 1 );
+    out->fp = (fp == NULL) ? stdout : fp;
+    out->buf = malloc( AUT_WRITE_BUFLEN );
+    if (out->buf == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    out->len = 0;
+    out->failed = False;
+    last_dump_bytes = 0;
+
+#ifdef USE_ZLIB
+    out->zs = NULL;
+    out->zbuf = NULL;
+    if (level > 0) {
+        out->zs = malloc( sizeof(z_stream) );
+        out->zbuf = malloc( AUT_GZ_BUFLEN );
+        if (out->zs == NULL || out->zbuf == NULL) {
+            perror( __FILE__ ",  malloc" );
+            exit(-1);
+        }
+        memset( out->zs, 0, sizeof(z_stream) );
+        /* 15+16 selects the gzip wrapper with the largest window. */
+        if (deflateInit2( out->zs, level, Z_DEFLATED, 15+16, 8,
+                          Z_DEFAULT_STRATEGY ) != Z_OK) {
+            fprintf( stderr, "Error initializing compression.\n" );
+            free( out->zs );
+            out->zs = NULL;
+            out->failed = True;
+        }
+    }
+#endif
 }
 
 
-int dot_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
-                  unsigned char format_flags, FILE *fp )
+#ifdef USE_ZLIB
+static void outbuf_deflate( outbuf_t *out, const char *data, size_t len,
+                            int flush )
 {
-    int i, j, last_nonzero_env, last_nonzero_sys;
-    anode_t *node;
-    int node_counter = 0;
-    ptree_t *var;
-    int num_env, num_sys;
-    char this_node_str[INPUT_STRING_LEN];
-    int nb = 0;
+    size_t n;
+
+    out->zs->next_in = (unsigned char *)data;
+    out->zs->avail_in = len;
+    do {
+        out->zs->next_out = out->zbuf;
+        out->zs->avail_out = AUT_GZ_BUFLEN;
+        if (deflate( out->zs, flush ) == Z_STREAM_ERROR) {
+            out->failed = True;
+            return;
+        }
+        n = AUT_GZ_BUFLEN - out->zs->avail_out;
+        if (n > 0 && fwrite( out->zbuf, 1, n, out->fp ) != n)
+            out->failed = True;
+        last_dump_bytes += n;
+    } while (out->zs->avail_out == 0);
+}
+#endif
 
-    if (fp == NULL)
-        fp = stdout;
 
-    num_env = tree_size( evar_list );
-    num_sys = tree_size( svar_list );
+/* Pass data to the file, compressing it if selected. */
+static void outbuf_emit( outbuf_t *out, const char *data, size_t len )
+{
+#ifdef USE_ZLIB
+    if (out->zs != NULL) {
+        outbuf_deflate( out, data, len, Z_NO_FLUSH );
+        return;
+    }
+#endif
+    if (len > 0 && fwrite( data, 1, len, out->fp ) != len)
+        out->failed = True;
+    last_dump_bytes += len;
+}
 
-    fprintf( fp,
-             "/* created using gr1c, version "
-             GR1C_VERSION " */\n" );
-    fprintf( fp, "digraph A {\n    \"\" [shape=none]\n" );
-    node = head;
-    while (node) {
-        /* Buffer node string */
-        nb = snprintf( this_node_str, INPUT_STRING_LEN,
-                       "\"%d;\\n", node_counter );
-        if (nb >= INPUT_STRING_LEN)
-            return -1;
-        if (format_flags & DOT_AUT_ATTRIB) {
-            nb += snprintf( this_node_str+nb, INPUT_STRING_LEN-nb,
-                            "(%d, %d)\\n", node->mode, node->rgrad );
-            if (nb >= INPUT_STRING_LEN)
-                return -1;
-        }
-        if ((format_flags & 0x1) == DOT_AUT_ALL) {
-            last_nonzero_env = num_env-1;
-            last_nonzero_sys = num_sys-1;
-        } else {
-            for (last_nonzero_env = num_env-1; last_nonzero_env >= 0
-                     && *(node->state+last_nonzero_env) == 0;
-                 last_nonzero_env--) ;
-            for (last_nonzero_sys = num_sys-1; last_nonzero_sys >= 0
-                     && *(node->state+num_env+last_nonzero_sys) == 0;
-                 last_nonzero_sys--) ;
-        }
-        if (last_nonzero_env < 0 && last_nonzero_sys < 0) {
-            nb += snprintf( this_node_str+nb, INPUT_STRING_LEN-nb,
-                            "{}" );
-            if (nb >= INPUT_STRING_LEN)
-                return -1;
-        } else {
-            if (!(format_flags & DOT_AUT_EDGEINPUT)) {
-                for (j = 0; j < num_env; j++) {
-                    if ((format_flags & DOT_AUT_BINARY)
-                        && *(node->state+j) == 0)
-                        continue;
-                    var = get_list_item( evar_list, j );
-                    if (j == last_nonzero_env) {
-                        if (format_flags & DOT_AUT_BINARY) {
-                            nb += snprintf( this_node_str+nb,
-                                            INPUT_STRING_LEN-nb,
-                                            "%s", var->name );
-                            if (nb >= INPUT_STRING_LEN)
-                                return -1;
-                        } else {
-                            nb += snprintf( this_node_str+nb,
-                                            INPUT_STRING_LEN-nb,
-                                            "%s=%d",
-                                            var->name, *(node->state+j) );
-                            if (nb >= INPUT_STRING_LEN)
-                                return -1;
-                        }
-                        if ((last_nonzero_sys >= 0
-                             || (format_flags & DOT_AUT_ALL))
-                            && !(format_flags & DOT_AUT_EDGEINPUT)) {
-                            nb += snprintf( this_node_str+nb,
-                                            INPUT_STRING_LEN-nb,
-                                            ", " );
-                            if (nb >= INPUT_STRING_LEN)
-                                return -1;
-                        }
-                    } else {
-                        if (format_flags & DOT_AUT_BINARY) {
-                            nb += snprintf( this_node_str+nb,
-                                            INPUT_STRING_LEN-nb,
-                                            "%s, ", var->name );
-                            if (nb >= INPUT_STRING_LEN)
-                                return -1;
-                        } else {
-                            nb += snprintf( this_node_str+nb,
-                                            INPUT_STRING_LEN-nb,
-                                            "%s=%d, ",
-                                            var->name, *(node->state+j) );
-                            if (nb >= INPUT_STRING_LEN)
-                                return -1;
-                        }
-                    }
-                }
-            }
-            if (last_nonzero_sys < 0 && (format_flags & DOT_AUT_EDGEINPUT)) {
-                nb += snprintf( this_node_str+nb,
-                                INPUT_STRING_LEN-nb,
-                                "{}" );
-                if (nb >= INPUT_STRING_LEN)
-                    return -1;
-            } else {
-                for (j = 0; j < num_sys; j++) {
-                    if ((format_flags & DOT_AUT_BINARY)
-                        && *(node->state+num_env+j) == 0)
-                        continue;
-                    var = get_list_item( svar_list, j );
-                    if (j == last_nonzero_sys) {
-                        if (format_flags & DOT_AUT_BINARY) {
-                            nb += snprintf( this_node_str+nb,
-                                            INPUT_STRING_LEN-nb,
-                                            "%s", var->name );
-                            if (nb >= INPUT_STRING_LEN)
-                                return -1;
-                        } else {
-                            nb += snprintf( this_node_str+nb,
-                                            INPUT_STRING_LEN-nb,
-                                            "%s=%d",
-                                            var->name,
-                                            *(node->state+num_env+j) );
-                            if (nb >= INPUT_STRING_LEN)
-                                return -1;
-                        }
-                    } else {
-                        if (format_flags & DOT_AUT_BINARY) {
-                            nb += snprintf( this_node_str+nb,
-                                            INPUT_STRING_LEN-nb,
-                                            "%s, ", var->name );
-                            if (nb >= INPUT_STRING_LEN)
-                                return -1;
-                        } else {
-                            nb += snprintf( this_node_str+nb,
-                                            INPUT_STRING_LEN-nb,
-                                            "%s=%d, ",
-                                            var->name,
-                                            *(node->state+num_env+j) );
-                            if (nb >= INPUT_STRING_LEN)
-                                return -1;
-                        }
-                    }
-                }
-            }
-        }
-        nb += snprintf( this_node_str+nb, INPUT_STRING_LEN-nb, "\"" );
-        if (nb >= INPUT_STRING_LEN)
-            return -1;
 
-        fprintf( fp, "    %s\n", this_node_str );
+static void outbuf_flush( outbuf_t *out )
+{
+    outbuf_emit( out, out->buf, out->len );
+    out->len = 0;
+}
 
-        /* Next print all outgoing edges from the current node, and a
-           special incoming edge if this node is initial. */
-        if (node->initial)
-            fprintf( fp, "    \"\" -> %s\n", this_node_str );
-        for (i = 0; i < node->trans_len; i++) {
-            fprintf( fp, "    %s -> ", this_node_str );
-            fprintf( fp, "\"%d;\\n", anode_index( head, *(node->trans+i) ) );
-            if (format_flags & DOT_AUT_ATTRIB) {
-                fprintf( fp,
-                         "(%d, %d)\\n",
-                         (*(node->trans+i))->mode, (*(node->trans+i))->rgrad);
-            }
-            if ((format_flags & 0x1) == DOT_AUT_ALL) {
-                last_nonzero_env = num_env-1;
-                last_nonzero_sys = num_sys-1;
-            } else {
-                for (last_nonzero_env = num_env-1; last_nonzero_env >= 0
-                         && *((*(node->trans+i))->state+last_nonzero_env) == 0;
-                     last_nonzero_env--) ;
-                for (last_nonzero_sys = num_sys-1; last_nonzero_sys >= 0
-                         && *((*(node->trans+i))->state
-                              +num_env+last_nonzero_sys) == 0;
-                     last_nonzero_sys--) ;
-            }
-            if (last_nonzero_env < 0 && last_nonzero_sys < 0) {
-                fprintf( fp, "{}" );
-            } else {
-                if (!(format_flags & DOT_AUT_EDGEINPUT)) {
-                    for (j = 0; j < num_env; j++) {
-                        if ((format_flags & DOT_AUT_BINARY)
-                            && *((*(node->trans+i))->state+j) == 0)
-                            continue;
-                        var = get_list_item( evar_list, j );
-                        if (j == last_nonzero_env) {
-                            if (format_flags & DOT_AUT_BINARY) {
-                                fprintf( fp, "%s", var->name );
-                            } else {
-                                fprintf( fp,
-                                         "%s=%d",
-                                         var->name,
-                                         *((*(node->trans+i))->state+j) );
-                            }
-                            if ((last_nonzero_sys >= 0
-                                 || (format_flags & DOT_AUT_ALL))
-                                && !(format_flags & DOT_AUT_EDGEINPUT))
-                                fprintf( fp, ", " );
-                        } else {
-                            if (format_flags & DOT_AUT_BINARY) {
-                                fprintf( fp, "%s, ", var->name );
-                            } else {
-                                fprintf( fp,
-                                         "%s=%d, ",
-                                         var->name,
-                                         *((*(node->trans+i))->state+j) );
-                            }
-                        }
-                    }
-                }
-                if (last_nonzero_sys < 0
-                    && (format_flags & DOT_AUT_EDGEINPUT)) {
-                    fprintf( fp, "{}" );
-                } else {
-                    for (j = 0; j < num_sys; j++) {
-                        if ((format_flags & DOT_AUT_BINARY)
-                            && *((*(node->trans+i))->state+num_env+j) == 0)
-                            continue;
-                        var = get_list_item( svar_list, j );
-                        if (j == last_nonzero_sys) {
-                            if (format_flags & DOT_AUT_BINARY) {
-                                fprintf( fp, "%s", var->name );
-                            } else {
-                                fprintf( fp,
-                                         "%s=%d",
-                                         var->name,
-                                         *((*(node->trans+i))->state
-                                           +num_env+j) );
-                            }
-                        } else {
-                            if (format_flags & DOT_AUT_BINARY) {
-                                fprintf( fp, "%s, ", var->name );
-                            } else {
-                                fprintf( fp,
-                                         "%s=%d, ",
-                                         var->name,
-                                         *((*(node->trans+i))->state
-                                           +num_env+j) );
-                            }
-                        }
-                    }
-                }
-            }
-            fprintf( fp, "\"" );
-            if (format_flags & DOT_AUT_EDGEINPUT) {
-                fprintf( fp, "[label=\"" );
-                if (last_nonzero_env < 0) {
-                    fprintf( fp, "{}" );
-                } else {
-                    for (j = 0; j < num_env; j++) {
-                        if ((format_flags & DOT_AUT_BINARY)
-                            && *((*(node->trans+i))->state+j) == 0)
-                            continue;
-                        var = get_list_item( evar_list, j );
-                        if (j == last_nonzero_env) {
-                            if (format_flags & DOT_AUT_BINARY) {
-                                fprintf( fp, "%s", var->name );
-                            } else {
-                                fprintf( fp,
-                                         "%s=%d",
-                                         var->name,
-                                         *((*(node->trans+i))->state+j) );
-                            }
-                        } else {
-                            if (format_flags & DOT_AUT_BINARY) {
-                                fprintf( fp, "%s, ", var->name );
-                            } else {
-                                fprintf( fp,
-                                         "%s=%d, ",
-                                         var->name,
-                                         *((*(node->trans+i))->state+j) );
-                            }
-                        }
-                    }
-                }
-                fprintf( fp, "\"]" );
-            }
-            fprintf( fp, "\n" );
+
+/* Flush and release the buffer.  Return 0 on success, -1 if any write
+   failed. */
+static int outbuf_close( outbuf_t *out )
+{
+    outbuf_flush( out );
+#ifdef USE_ZLIB
+    if (out->zs != NULL) {
+        outbuf_deflate( out, NULL, 0, Z_FINISH );
+        deflateEnd( out->zs );
+        free( out->zs );
+        out->zs = NULL;
+    }
+    free( out->zbuf );
+    out->zbuf = NULL;
+#endif
+    free( out->buf );
+    out->buf = NULL;
+    return out->failed ? -1 : 0;
+}
+
+
+static void outbuf_write( outbuf_t *out, const char *s, size_t len )
+{
+    if (out->len+len > AUT_WRITE_BUFLEN) {
+        outbuf_flush( out );
+        if (len > AUT_WRITE_BUFLEN) {
+            outbuf_emit( out, s, len );
+            return;
         }
-        node_counter++;
-        node = node->next;
     }
-    fprintf( fp, "}\n" );
+    memcpy( out->buf+out->len, s, len );
+    out->len += len;
+}
 
-    return 0;
+
+static void outbuf_puts( outbuf_t *out, const char *s )
+{
+    outbuf_write( out, s, strlen( s ) );
 }
 
 
-int tulip_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
-                    FILE *fp )
+/* Write decimal representation of x, padded on the left with spaces
+   to at least width characters, as by fprintf() with "%*d". */
+static void outbuf_putint( outbuf_t *out, int x, int width )
 {
-    int i;
-    anode_t *node;
-    int node_counter = 0;
-    ptree_t *var;
+    char digits[16];
+    unsigned int ux;
+    int n = 0, i;
+
+    ux = (x < 0) ? -(unsigned int)x : (unsigned int)x;
+    do {
+        digits[n++] = '0' + ux % 10;
+        ux /= 10;
+    } while (ux > 0);
+    if (x < 0)
+        digits[n++] = '-';
+
+    if (out->len+n+width > AUT_WRITE_BUFLEN)
+        outbuf_flush( out );
+    for (i = n; i < width; i++)
+        *(out->buf+(out->len++)) = ' ';
+    while (n > 0)
+        *(out->buf+(out->len++)) = digits[--n];
+}
+
+
+static void outbuf_printf( outbuf_t *out, const char *fmt, ... )
+{
+    va_list ap;
+    char *tmp;
+    int n;
+
+    va_start( ap, fmt );
+    n = vsnprintf( out->buf+out->len, AUT_WRITE_BUFLEN-out->len, fmt, ap );
+    va_end( ap );
+    if (n < 0) {
+        out->failed = True;
+        return;
+    }
+    if (n < AUT_WRITE_BUFLEN-out->len) {
+        out->len += n;
+        return;
+    }
+
+    outbuf_flush( out );
+    tmp = malloc( n+1 );
+    if (tmp == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    va_start( ap, fmt );
+    vsnprintf( tmp, n+1, fmt, ap );
+    va_end( ap );
+    outbuf_write( out, tmp, n );
+    free( tmp );
+}
+
+
+/* Array of variable names in the order of the state vector. */
+static char **var_names( ptree_t *evar_list, ptree_t *svar_list )
+{
+    char **names;
+    int i = 0;
+    names = malloc( (tree_size( evar_list )+tree_size( svar_list )+1)
+                    *sizeof(char *) );
+    if (names == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (; evar_list; evar_list = evar_list->left)
+        *(names+(i++)) = evar_list->name;
+    for (; svar_list; svar_list = svar_list->left)
+        *(names+(i++)) = svar_list->name;
+    return names;
+}
+
+
+/* FNV-1a over the values of a state vector */
+static size_t state_hash( vartype *state, int state_len )
+{
+    uint64_t h = 14695981039346656037ULL;
+    int i;
+    for (i = 0; i < state_len; i++) {
+        h ^= (uint32_t)*(state+i);
+        h *= 1099511628211ULL;
+    }
+    return (size_t)(h ^ (h >> 32));
+}
+
+/* Dictionary of distinct states for gr1c automaton format version 2,
+   as an open-addressing hash table of the nodes at which each state
+   first occurs. */
+typedef struct {
+    anode_t **nodes;
+    int *entries;  /* Dictionary entry of the state of each slot */
+    size_t size;  /* Number of slots, a power of 2 */
+    int len;  /* Number of entries */
+} state_dict_t;
+
+static void state_dict_init( state_dict_t *dict, int num_nodes )
+{
+    size_t k;
+    dict->size = 16;
+    while (dict->size < 2*(size_t)num_nodes)
+        dict->size *= 2;
+    dict->nodes = malloc( dict->size*sizeof(anode_t *) );
+    dict->entries = malloc( dict->size*sizeof(int) );
+    if (dict->nodes == NULL || dict->entries == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (k = 0; k < dict->size; k++)
+        *(dict->nodes+k) = NULL;
+    dict->len = 0;
+}
+
+/* Return the dictionary entry of the state of node, or -1 if it is
+   not present, in which case it is added. */
+static int state_dict_lookup( state_dict_t *dict, anode_t *node,
+                              int state_len )
+{
+    size_t k = state_hash( node->state, state_len ) & (dict->size-1);
+    while (*(dict->nodes+k) != NULL) {
+        if (!memcmp( (*(dict->nodes+k))->state, node->state,
+                     state_len*sizeof(vartype) ))
+            return *(dict->entries+k);
+        k = (k+1) & (dict->size-1);
+    }
+    *(dict->nodes+k) = node;
+    *(dict->entries+k) = dict->len++;
+    return -1;
+}
+
+/* Write the state field of node in gr1c automaton format version 2,
+   given the previous node (or NULL if none). */
+static void aut_dump_state_v2( outbuf_t *out, state_dict_t *dict,
+                               anode_t *node, anode_t *prev, int state_len )
+{
+    int entry, i;
+    bool first = True;
+
+    entry = state_dict_lookup( dict, node, state_len );
+    if (entry >= 0) {
+        outbuf_write( out, "@", 1 );
+        outbuf_putint( out, entry, 0 );
+        return;
+    }
+    for (i = 0; i < state_len; i++) {
+        if (*(node->state+i) == ((prev == NULL) ? 0 : *(prev->state+i)))
+            continue;
+        if (!first)
+            outbuf_write( out, ",", 1 );
+        outbuf_putint( out, i, 0 );
+        outbuf_write( out, ":", 1 );
+        outbuf_putint( out, *(node->state+i), 0 );
+        first = False;
+    }
+    if (first)
+        outbuf_write( out, ".", 1 );
+}
+
+
+int aut_aut_dumpver( anode_t *head, int state_len, FILE *fp, int version )
+{
+    anode_t *node = head, *prev = NULL;
+    aut_numbering_t *numbering;
+    state_dict_t dict;
+    outbuf_t out;
+    int node_counter = 0;
+    int target, x;
+    int i;
+
+    if (version < 0 || version > 2)
+        return -1;  /* Unrecognized gr1c automaton format version */
+
+    numbering = aut_number_nodes( head );
+    if (version == 2)
+        state_dict_init( &dict, aut_size( head ) );
+    outbuf_init( &out, fp, dump_compression );
+    outbuf_putint( &out, version, 0 );
+    outbuf_write( &out, "\n", 1 );
+    while (node) {
+        if (version == 2) {
+            aut_dump_state_v2( &out, &dict, node, prev, state_len );
+        } else {
+            outbuf_putint( &out, node_counter, 0 );
+            for (i = 0; i < state_len; i++) {
+                outbuf_write( &out, " ", 1 );
+                outbuf_putint( &out, *(node->state+i), 0 );
+            }
+        }
+        if (version >= 1) {
+            outbuf_write( &out, " ", 1 );
+            outbuf_putint( &out, node->initial, 0 );
+        }
+        outbuf_write( &out, " ", 1 );
+        outbuf_putint( &out, node->mode, 0 );
+        outbuf_write( &out, " ", 1 );
+        outbuf_putint( &out, node->rgrad, 0 );
+        target = node_counter;
+        for (i = 0; i < node->trans_len; i++) {
+            outbuf_write( &out, " ", 1 );
+            if (version == 2) {
+                /* Relative to the previous target */
+                x = aut_numbering_index( numbering, *(node->trans+i) );
+                outbuf_putint( &out, x - target, 0 );
+                target = x;
+            } else {
+                outbuf_putint( &out,
+                               aut_numbering_index( numbering,
+                                                    *(node->trans+i) ),
+                               0 );
+            }
+        }
+        outbuf_write( &out, "\n", 1 );
+        prev = node;
+        node = node->next;
+        node_counter++;
+    }
+    delete_aut_numbering( numbering );
+    if (version == 2) {
+        free( dict.nodes );
+        free( dict.entries );
+    }
+
+    return outbuf_close( &out );
+}
+
+
+void aut_aut_dump( anode_t *head, int state_len, FILE *fp )
+{
+    aut_aut_dumpver( head, state_len, fp, 1 );
+}
+
+
+/* Write the assignments to variables start,...,start+len-1 in state
+   that are shown under format_flags, separated by commas.  Also put a
+   separator after the variable at last_nonzero if sep_after. */
+static void dot_state_vars( outbuf_t *out, vartype *state, char **names,
+                            int start, int len, int last_nonzero,
+                            bool sep_after, unsigned char format_flags )
+{
+    int j;
+    for (j = 0; j < len; j++) {
+        if ((format_flags & DOT_AUT_BINARY) && *(state+start+j) == 0)
+            continue;
+        if (format_flags & DOT_AUT_BINARY) {
+            outbuf_puts( out, *(names+start+j) );
+        } else {
+            outbuf_printf( out, "%s=%d",
+                           *(names+start+j), *(state+start+j) );
+        }
+        if (j != last_nonzero || sep_after)
+            outbuf_write( out, ", ", 2 );
+    }
+}
+
+
+/* Write the name of node, which includes its number and state, as
+   used in DOT output, without the closing quotation mark. */
+static void dot_node_str( outbuf_t *out, anode_t *node, int index,
+                          char **names, int num_env, int num_sys,
+                          unsigned char format_flags )
+{
+    int last_nonzero_env, last_nonzero_sys;
+
+    outbuf_write( out, "\"", 1 );
+    outbuf_putint( out, index, 0 );
+    outbuf_write( out, ";\\n", 3 );
+    if (format_flags & DOT_AUT_ATTRIB)
+        outbuf_printf( out, "(%d, %d)\\n", node->mode, node->rgrad );
+    if ((format_flags & 0x1) == DOT_AUT_ALL) {
+        last_nonzero_env = num_env-1;
+        last_nonzero_sys = num_sys-1;
+    } else {
+        for (last_nonzero_env = num_env-1; last_nonzero_env >= 0
+                 && *(node->state+last_nonzero_env) == 0;
+             last_nonzero_env--) ;
+        for (last_nonzero_sys = num_sys-1; last_nonzero_sys >= 0
+                 && *(node->state+num_env+last_nonzero_sys) == 0;
+             last_nonzero_sys--) ;
+    }
+    if (last_nonzero_env < 0 && last_nonzero_sys < 0) {
+        outbuf_write( out, "{}", 2 );
+        return;
+    }
+    if (!(format_flags & DOT_AUT_EDGEINPUT))
+        dot_state_vars( out, node->state, names, 0, num_env,
+                        last_nonzero_env,
+                        last_nonzero_sys >= 0 || (format_flags & DOT_AUT_ALL),
+                        format_flags );
+    if (last_nonzero_sys < 0 && (format_flags & DOT_AUT_EDGEINPUT)) {
+        outbuf_write( out, "{}", 2 );
+    } else {
+        dot_state_vars( out, node->state, names, num_env, num_sys,
+                        last_nonzero_sys, False, format_flags );
+    }
+}
+
+
+int dot_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
+                  unsigned char format_flags, FILE *fp )
+{
+    int i, last_nonzero_env;
+    anode_t *node;
+    aut_numbering_t *numbering;
+    outbuf_t out;
+    char **names;
+    int node_counter = 0;
     int num_env, num_sys;
 
-    if (fp == NULL)
-        fp = stdout;
+    num_env = tree_size( evar_list );
+    num_sys = tree_size( svar_list );
+    names = var_names( evar_list, svar_list );
+    numbering = aut_number_nodes( head );
+
+    outbuf_init( &out, fp, dump_compression );
+    outbuf_puts( &out,
+                 "/* created using gr1c, version "
+                 GR1C_VERSION " */\n" );
+    outbuf_puts( &out, "digraph A {\n    \"\" [shape=none]\n" );
+    node = head;
+    while (node) {
+        outbuf_puts( &out, "    " );
+        dot_node_str( &out, node, node_counter, names, num_env, num_sys,
+                      format_flags );
+        outbuf_puts( &out, "\"\n" );
+
+        /* Next print all outgoing edges from the current node, and a
+           special incoming edge if this node is initial. */
+        if (node->initial) {
+            outbuf_puts( &out, "    \"\" -> " );
+            dot_node_str( &out, node, node_counter, names, num_env, num_sys,
+                          format_flags );
+            outbuf_puts( &out, "\"\n" );
+        }
+        for (i = 0; i < node->trans_len; i++) {
+            outbuf_puts( &out, "    " );
+            dot_node_str( &out, node, node_counter, names, num_env, num_sys,
+                          format_flags );
+            outbuf_puts( &out, "\" -> " );
+            dot_node_str( &out, *(node->trans+i),
+                          aut_numbering_index( numbering,
+                                               *(node->trans+i) ),
+                          names, num_env, num_sys, format_flags );
+            outbuf_write( &out, "\"", 1 );
+            if (format_flags & DOT_AUT_EDGEINPUT) {
+                outbuf_puts( &out, "[label=\"" );
+                if ((format_flags & 0x1) == DOT_AUT_ALL) {
+                    last_nonzero_env = num_env-1;
+                } else {
+                    for (last_nonzero_env = num_env-1; last_nonzero_env >= 0
+                             && *((*(node->trans+i))->state
+                                  +last_nonzero_env) == 0;
+                         last_nonzero_env--) ;
+                }
+                if (last_nonzero_env < 0) {
+                    outbuf_write( &out, "{}", 2 );
+                } else {
+                    dot_state_vars( &out, (*(node->trans+i))->state, names,
+                                    0, num_env, last_nonzero_env, False,
+                                    format_flags );
+                }
+                outbuf_write( &out, "\"]", 2 );
+            }
+            outbuf_write( &out, "\n", 1 );
+        }
+        node_counter++;
+        node = node->next;
+    }
+    outbuf_puts( &out, "}\n" );
+
+    free( names );
+    delete_aut_numbering( numbering );
+    return outbuf_close( &out );
+}
+
+
+int tulip_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
+                    FILE *fp )
+{
+    int i;
+    anode_t *node;
+    aut_numbering_t *numbering;
+    outbuf_t out;
+    char **names;
+    int node_counter = 0;
+    ptree_t *var;
+    int num_env, num_sys;
 
     num_env = tree_size( evar_list );
     num_sys = tree_size( svar_list );
 
-    fprintf( fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" );
-    fprintf( fp,
-             "<tulipcon xmlns=\"http://tulip-control.sourceforge.net/ns/1\""
-             " version=\"1\">\n" );
-    fprintf( fp, "  <env_vars>\n" );
-    for (i = 0; i < num_env; i++) {
-        var = get_list_item( evar_list, i );
+    outbuf_init( &out, fp, dump_compression );
+    outbuf_puts( &out, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" );
+    outbuf_puts( &out,
+                 "<tulipcon xmlns=\"http://tulip-control.sourceforge.net/ns/1\""
+                 " version=\"1\">\n" );
+    outbuf_puts( &out, "  <env_vars>\n" );
+    for (var = evar_list; var; var = var->left) {
         if (var->value >= 0) {
-            fprintf( fp,
-                     "    <item key=\"%s\" value=\"[0,%d]\" />\n",
-                     var->name, var->value );
+            outbuf_printf( &out,
+                           "    <item key=\"%s\" value=\"[0,%d]\" />\n",
+                           var->name, var->value );
         } else {
-            fprintf( fp,
-                     "    <item key=\"%s\" value=\"boolean\" />\n",
-                     var->name );
+            outbuf_printf( &out,
+                           "    <item key=\"%s\" value=\"boolean\" />\n",
+                           var->name );
         }
     }
-    fprintf( fp, "  </env_vars>\n" );
-    fprintf( fp, "  <sys_vars>\n" );
-    for (i = 0; i < num_sys; i++) {
-        var = get_list_item( svar_list, i );
+    outbuf_puts( &out, "  </env_vars>\n" );
+    outbuf_puts( &out, "  <sys_vars>\n" );
+    for (var = svar_list; var; var = var->left) {
         if (var->value >= 0) {
-            fprintf( fp,
-                     "    <item key=\"%s\" value=\"[0,%d]\" />\n",
-                     var->name, var->value );
+            outbuf_printf( &out,
+                           "    <item key=\"%s\" value=\"[0,%d]\" />\n",
+                           var->name, var->value );
         } else {
-            fprintf( fp,
-                     "    <item key=\"%s\" value=\"boolean\" />\n",
-                     var->name );
+            outbuf_printf( &out,
+                           "    <item key=\"%s\" value=\"boolean\" />\n",
+                           var->name );
         }
     }
-    fprintf( fp, "  </sys_vars>\n" );
-    fprintf( fp,
-             "  <spec>\n    "
-             "<env_init></env_init><env_safety></env_safety>"
-             "<env_prog></env_prog>"
-             "<sys_init></sys_init><sys_safety></sys_safety>"
-             "<sys_prog></sys_prog>\n"
-             "  </spec>\n" );
-
-    fprintf( fp, "  <aut type=\"basic\">\n" );
+    outbuf_puts( &out, "  </sys_vars>\n" );
+    outbuf_puts( &out,
+                 "  <spec>\n    "
+                 "<env_init></env_init><env_safety></env_safety>"
+                 "<env_prog></env_prog>"
+                 "<sys_init></sys_init><sys_safety></sys_safety>"
+                 "<sys_prog></sys_prog>\n"
+                 "  </spec>\n" );
+
+    names = var_names( evar_list, svar_list );
+    numbering = aut_number_nodes( head );
+    outbuf_puts( &out, "  <aut type=\"basic\">\n" );
     node = head;
     while (node) {
-        fprintf( fp, "    <node>\n      <id>%d</id><anno>", node_counter );
-        if (node->mode != -1 && node->rgrad != -1)
-            fprintf( fp, "%d %d", node->mode, node->rgrad );
-        fprintf( fp, "</anno>\n      <child_list>" );
-        for (i = 0; i < node->trans_len; i++)
-            fprintf( fp, " %d", anode_index( head, *(node->trans+i) ) );
-        fprintf( fp, "</child_list>\n      <state>\n" );
-        for (i = 0; i < num_env; i++) {
-            var = get_list_item( evar_list, i );
-            fprintf( fp, "        <item key=\"%s\" value=\"%d\" />\n",
-                     var->name, *(node->state+i) );
-        }
-        for (i = 0; i < num_sys; i++) {
-            var = get_list_item( svar_list, i );
-            fprintf( fp, "        <item key=\"%s\" value=\"%d\" />\n",
-                     var->name, *(node->state+num_env+i) );
-        }
-        fprintf( fp, "      </state>\n    </node>\n" );
+        outbuf_puts( &out, "    <node>\n      <id>" );
+        outbuf_putint( &out, node_counter, 0 );
+        outbuf_puts( &out, "</id><anno>" );
+        if (node->mode != -1 && node->rgrad != -1) {
+            outbuf_putint( &out, node->mode, 0 );
+            outbuf_write( &out, " ", 1 );
+            outbuf_putint( &out, node->rgrad, 0 );
+        }
+        outbuf_puts( &out, "</anno>\n      <child_list>" );
+        for (i = 0; i < node->trans_len; i++) {
+            outbuf_write( &out, " ", 1 );
+            outbuf_putint( &out,
+                           aut_numbering_index( numbering, *(node->trans+i) ),
+                           0 );
+        }
+        outbuf_puts( &out, "</child_list>\n      <state>\n" );
+        for (i = 0; i < num_env+num_sys; i++) {
+            outbuf_puts( &out, "        <item key=\"" );
+            outbuf_puts( &out, *(names+i) );
+            outbuf_puts( &out, "\" value=\"" );
+            outbuf_putint( &out, *(node->state+i), 0 );
+            outbuf_puts( &out, "\" />\n" );
+        }
+        outbuf_puts( &out, "      </state>\n    </node>\n" );
         node_counter++;
         node = node->next;
     }
+    delete_aut_numbering( numbering );
+    free( names );
 
-    fprintf( fp, "  </aut>\n" );
-    fprintf( fp,
-             "  <extra>created using gr1c, version "
-             GR1C_VERSION "</extra>\n</tulipcon>\n" );
+    outbuf_puts( &out, "  </aut>\n" );
+    outbuf_puts( &out,
+                 "  <extra>created using gr1c, version "
+                 GR1C_VERSION "</extra>\n</tulipcon>\n" );
 
-    return 0;
+    return outbuf_close( &out );
 }
 
 
 void list_aut_dump( anode_t *head, int state_len, FILE *fp )
 {
     anode_t *node = head;
+    aut_numbering_t *numbering;
+    outbuf_t out;
     int node_counter = 0;
     int i;
-    if (fp == NULL)
-        fp = stdout;
+
+    numbering = aut_number_nodes( head );
+    outbuf_init( &out, fp, dump_compression );
     while (node) {
-        fprintf( fp, "%4d ", node_counter );
+        outbuf_putint( &out, node_counter, 4 );
+        outbuf_write( &out, " ", 1 );
         if (node->initial)
-            fprintf( fp, "(init) " );
-        fprintf( fp, ": " );
+            outbuf_puts( &out, "(init) " );
+        outbuf_puts( &out, ": " );
         if (state_len > 0) {
             for (i = 0; i < state_len-1; i++) {
-                fprintf( fp, "%d,", *(node->state+i) );
+                outbuf_putint( &out, *(node->state+i), 0 );
+                outbuf_write( &out, ",", 1 );
             }
-            fprintf( fp, "%d", *(node->state+state_len-1) );
+            outbuf_putint( &out, *(node->state+state_len-1), 0 );
         } else {
-            fprintf( fp, "(nil)" );
+            outbuf_puts( &out, "(nil)" );
+        }
+        outbuf_puts( &out, " - " );
+        outbuf_putint( &out, node->mode, 2 );
+        outbuf_puts( &out, " - " );
+        outbuf_putint( &out, node->rgrad, 2 );
+        outbuf_puts( &out, " - [" );
+        for (i = 0; i < node->trans_len; i++) {
+            outbuf_write( &out, " ", 1 );
+            outbuf_putint( &out,
+                           aut_numbering_index( numbering, *(node->trans+i) ),
+                           0 );
         }
-        fprintf( fp, " - %2d - %2d - [", node->mode, node->rgrad );
-        for (i = 0; i < node->trans_len; i++)
-            fprintf( fp, " %d", anode_index( head, *(node->trans+i) ) );
-        fprintf( fp, "]\n" );
+        outbuf_puts( &out, "]\n" );
         node = node->next;
         node_counter++;
     }
+    delete_aut_numbering( numbering );
+    outbuf_close( &out );
 }
 
 
 #define TIMESTAMP_LEN 32
+/* Write a list of variables with domains, as in the "ENV" and "SYS"
+   entries.  range_sep follows the comma in ranges "[0,n]". */
+static void json_var_list( outbuf_t *out, ptree_t *var_list,
+                           bool compact, const char *range_sep )
+{
+    ptree_t *var;
+
+    outbuf_write( out, "[", 1 );
+    for (var = var_list; var; var = var->left) {
+        outbuf_write( out, "{\"", 2 );
+        outbuf_puts( out, var->name );
+        outbuf_puts( out, compact ? "\":" : "\": " );
+        if (var->value >= 0) {
+            outbuf_puts( out, "[0," );
+            outbuf_puts( out, range_sep );
+            outbuf_putint( out, var->value, 0 );
+            outbuf_puts( out, "]}" );
+        } else {
+            outbuf_puts( out, "\"boolean\"}" );
+        }
+        if (var->left != NULL)
+            outbuf_puts( out, compact ? "," : ", " );
+    }
+    outbuf_write( out, "]", 1 );
+}
+
+
+static void json_node( outbuf_t *out, anode_t *node, int node_ID,
+                       aut_numbering_t *numbering, int state_len,
+                       unsigned char format_flags )
+{
+    bool compact = (format_flags & (JSON_AUT_COMPACT | JSON_AUT_LINES)) != 0;
+    bool lines = (format_flags & JSON_AUT_LINES) != 0;
+    int i;
+
+    if (lines) {
+        outbuf_puts( out, "{\"id\":" );
+        outbuf_putint( out, node_ID, 0 );
+        outbuf_puts( out, ",\"state\":[" );
+    } else {
+        outbuf_write( out, "\"", 1 );
+        outbuf_putint( out, node_ID, 0 );
+        outbuf_puts( out, compact ? "\":{\"state\":[" : "\": {\n    \"state\": [" );
+    }
+    for (i = 0; i < state_len; i++) {
+        outbuf_putint( out, *(node->state+i), 0 );
+        if (i < state_len-1)
+            outbuf_puts( out, compact ? "," : ", " );
+    }
+
+    outbuf_puts( out, compact ? "],\"mode\":" : "],\n    \"mode\": " );
+    outbuf_putint( out, node->mode, 0 );
+    outbuf_puts( out, compact ? ",\"rgrad\":" : ",\n    \"rgrad\": " );
+    outbuf_putint( out, node->rgrad, 0 );
+    outbuf_puts( out, compact ? ",\"initial\":" : ",\n    \"initial\": " );
+    outbuf_puts( out, node->initial ? "true" : "false" );
+
+    /* Node names are strings in the "nodes" object, so transitions
+       refer to them by strings, whereas in JSON lines they are
+       integers, as in the "id" field. */
+    outbuf_puts( out, compact ? ",\"trans\":[" : ",\n    \"trans\": [" );
+    for (i = 0; i < node->trans_len; i++) {
+        if (!lines)
+            outbuf_write( out, "\"", 1 );
+        outbuf_putint( out,
+                       aut_numbering_index( numbering, *(node->trans+i) ), 0 );
+        if (!lines)
+            outbuf_write( out, "\"", 1 );
+        if (i < node->trans_len-1)
+            outbuf_puts( out, compact ? "," : ", " );
+    }
+    outbuf_puts( out, compact ? "]}" : "] }" );
+}
+
+
 int json_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
                    FILE *fp )
 {
-    int num_env, num_sys;
+    return json_aut_dumpopt( head, evar_list, svar_list, JSON_AUT_PRETTY, fp );
+}
+
 
-    struct tm *timeptr;
+int json_aut_dumpopt( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
+                      unsigned char format_flags, FILE *fp )
+{
+    int state_len;
+    bool compact = (format_flags & (JSON_AUT_COMPACT | JSON_AUT_LINES)) != 0;
+    bool lines = (format_flags & JSON_AUT_LINES) != 0;
+    struct tm tm;
     time_t clock;
+    char *epoch, *end;
     char timestamp[TIMESTAMP_LEN];
-    int i;
-    ptree_t *var;
+    aut_numbering_t *numbering;
+    anode_t *node;
+    int node_ID;
+    outbuf_t out;
 
-    if (fp == NULL)
-        fp = stdout;
-
-    num_env = tree_size( evar_list );
-    num_sys = tree_size( svar_list );
+    state_len = tree_size( evar_list ) + tree_size( svar_list );
 
+    /* Following the convention for reproducible builds, a fixed time
+       can be given in the environment variable SOURCE_DATE_EPOCH, so
+       that output is identical between runs. */
     clock = time( NULL );
-    timeptr = gmtime( &clock );  /* UTC */
-    if (strftime( timestamp, TIMESTAMP_LEN,
-                  "%Y-%m-%d %H:%M:%S", timeptr ) == 0) {
+    epoch = getenv( "SOURCE_DATE_EPOCH" );
+    if (epoch != NULL && *epoch != '\0') {
+        clock = strtol( epoch, &end, 10 );
+        if (*end != '\0') {
+            fprintf( stderr,
+                     "ERROR: SOURCE_DATE_EPOCH is not an integer." );
+            return -1;
+        }
+    }
+    /* UTC; gmtime() would share its result among threads. */
+    if (gmtime_r( &clock, &tm ) == NULL
+        || strftime( timestamp, TIMESTAMP_LEN,
+                     "%Y-%m-%d %H:%M:%S", &tm ) == 0) {
         fprintf( stderr, "ERROR: strftime() failed to create timestamp." );
         return -1;
     }
 
-    fprintf( fp, "{\"version\": 1,\n" );  /* gr1c JSON format version */
-    fprintf( fp, " \"gr1c\": \"" GR1C_VERSION "\",\n" );
-    fprintf( fp, " \"date\": \"%s\",\n", timestamp );
-    fprintf( fp, " \"extra\": \"\",\n\n" );
-
-    fprintf( fp, " \"ENV\": [" );
-    for (i = 0; i < num_env; i++) {
-        var = get_list_item( evar_list, i );
-        fprintf( fp, "{\"%s\": ", var->name );
-        if (var->value >= 0) {
-            fprintf( fp, "[0,%d]}", var->value );
+    numbering = aut_number_nodes( head );
+    outbuf_init( &out, fp, dump_compression );
+    /* gr1c JSON format version */
+    outbuf_puts( &out, compact ? "{\"version\":1," : "{\"version\": 1,\n" );
+    outbuf_puts( &out, compact ? "\"gr1c\":\"" GR1C_VERSION "\","
+                 : " \"gr1c\": \"" GR1C_VERSION "\",\n" );
+    outbuf_puts( &out, compact ? "\"date\":\"" : " \"date\": \"" );
+    outbuf_puts( &out, timestamp );
+    outbuf_puts( &out, compact ? "\",\"extra\":\"\",\"ENV\":"
+                 : "\",\n \"extra\": \"\",\n\n \"ENV\": " );
+    json_var_list( &out, evar_list, compact, "" );
+    outbuf_puts( &out, compact ? ",\"SYS\":" : ",\n \"SYS\": " );
+    json_var_list( &out, svar_list, compact, compact ? "" : " " );
+
+    if (lines) {
+        outbuf_puts( &out, "}\n" );
+    } else {
+        outbuf_puts( &out, compact ? ",\"nodes\":{" : ",\n\n \"nodes\": {\n" );
+    }
+    for (node = head, node_ID = 0; node; node = node->next, node_ID++) {
+        json_node( &out, node, node_ID, numbering, state_len, format_flags );
+        if (lines) {
+            outbuf_write( &out, "\n", 1 );
         } else {
-            fprintf( fp, "\"boolean\"}" );
+            if (node->next != NULL)
+                outbuf_write( &out, ",", 1 );
+            if (!compact)
+                outbuf_write( &out, "\n", 1 );
         }
-        if (i < num_env-1)
-            fprintf( fp, ", " );
     }
-    fprintf( fp, "],\n \"SYS\": [" );
-    for (i = 0; i < num_sys; i++) {
-        var = get_list_item( svar_list, i );
-        fprintf( fp, "{\"%s\": ", var->name );
-        if (var->value >= 0) {
-            fprintf( fp, "[0, %d]}", var->value );
-        } else {
-            fprintf( fp, "\"boolean\"}" );
+    if (!lines)
+        outbuf_puts( &out, "}}\n" );
+
+    delete_aut_numbering( numbering );
+    return outbuf_close( &out );
+}
+
+
+/* Fixed-size header of the gr1c binary strategy format.  Every
+   section that follows it is padded to a multiple of 8 bytes, so that
+   the arrays are aligned when the file is mapped into memory. */
+typedef struct {
+    char magic[BIN_AUT_MAGIC_LEN];
+    uint32_t version;
+    uint32_t byte_order;  /* BIN_AUT_BYTE_ORDER as written */
+    uint32_t state_len;
+    int32_t num_env;
+    uint32_t num_nodes;
+    uint32_t row_words;
+    uint64_t num_edges;
+    uint64_t names_len;
+} bin_header_t;
+
+#define BIN_AUT_BYTE_ORDER 0x01020304
+#define BIN_PAD8(n) (((n)+7) & ~(uint64_t)7)
+
+
+/* Write zeros following a section of len bytes to align the next. */
+static void outbuf_pad8( outbuf_t *out, uint64_t len )
+{
+    static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    outbuf_write( out, zeros, BIN_PAD8( len ) - len );
+}
+
+
+/* Pack state into row, which must be zeroed beforehand.  Values are
+   stored consecutively from the least significant bit of the first
+   word and may straddle words. */
+static void bin_pack_state( uint64_t *row, vartype *state,
+                            const unsigned char *widths, int state_len )
+{
+    uint64_t v;
+    int i, bit = 0;
+
+    for (i = 0; i < state_len; i++) {
+        v = (uint32_t)(*(state+i)) & ((((uint64_t)1) << *(widths+i)) - 1);
+        *(row + bit/64) |= v << (bit%64);
+        if (bit%64 + *(widths+i) > 64)
+            *(row + bit/64 + 1) |= v >> (64 - bit%64);
+        bit += *(widths+i);
+    }
+}
+
+
+int bin_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
+                  int state_len, FILE *fp )
+{
+    bin_header_t header;
+    aut_numbering_t *numbering;
+    outbuf_t out;
+    anode_t *node;
+    ptree_t *var;
+    unsigned char *widths;
+    uint64_t *row;
+    uint64_t num_edges, names_len, offset;
+    uint32_t u, target;
+    int32_t x;
+    int num_nodes, row_bits;
+    int i;
+
+    if (state_len < 1)
+        return -1;
+    if ((evar_list != NULL || svar_list != NULL)
+        && tree_size( evar_list ) + tree_size( svar_list ) != state_len)
+        return -1;
+
+    widths = malloc( state_len );
+    if (widths == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < state_len; i++)
+        *(widths+i) = 1;
+
+    /* Find the number of bits needed for each variable, and check
+       that all transitions are to nodes in the list. */
+    numbering = aut_number_nodes( head );
+    num_nodes = 0;
+    num_edges = 0;
+    for (node = head; node != NULL; node = node->next) {
+        for (i = 0; i < state_len; i++) {
+            u = (uint32_t)(*(node->state+i));
+            while (*(widths+i) < 32 && (u >> *(widths+i)) != 0)
+                (*(widths+i))++;
+        }
+        for (i = 0; i < node->trans_len; i++) {
+            if (aut_numbering_index( numbering, *(node->trans+i) ) < 0) {
+                fprintf( stderr,
+                         "Error: transition to node not in automaton.\n" );
+                delete_aut_numbering( numbering );
+                free( widths );
+                return -1;
+            }
         }
-        if (i < num_sys-1)
-            fprintf( fp, ", " );
+        num_nodes++;
+        num_edges += node->trans_len;
     }
-    fprintf( fp, "],\n\n" );
 
-    fprintf( fp, " \"nodes\": {\n" );
-    while (head) {
-        fprintf( fp, "\"%p\": {\n", (void *)head );
-        fprintf( fp, "    \"state\": [" );
-        for (i = 0; i < num_env+num_sys; i++) {
-            fprintf( fp, "%d", *(head->state+i) );
-            if (i < num_env+num_sys-1)
-                fprintf( fp, ", " );
+    row_bits = 0;
+    for (i = 0; i < state_len; i++)
+        row_bits += *(widths+i);
+
+    names_len = 0;
+    if (evar_list != NULL || svar_list != NULL) {
+        for (var = evar_list; var != NULL; var = var->left)
+            names_len += strlen( var->name )+1;
+        for (var = svar_list; var != NULL; var = var->left)
+            names_len += strlen( var->name )+1;
+    }
+
+    memset( &header, 0, sizeof(header) );
+    memcpy( header.magic, BIN_AUT_MAGIC, BIN_AUT_MAGIC_LEN );
+    header.version = BIN_AUT_VERSION;
+    header.byte_order = BIN_AUT_BYTE_ORDER;
+    header.state_len = state_len;
+    if (evar_list != NULL || svar_list != NULL) {
+        header.num_env = tree_size( evar_list );
+    } else {
+        header.num_env = -1;
+    }
+    header.num_nodes = num_nodes;
+    header.row_words = (row_bits+63)/64;
+    header.num_edges = num_edges;
+    header.names_len = BIN_PAD8( names_len );
+
+    row = malloc( header.row_words*sizeof(uint64_t) );
+    if (row == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+
+    /* Not compressed, so that the file can be mapped. */
+    outbuf_init( &out, fp, 0 );
+    outbuf_write( &out, (char *)&header, sizeof(header) );
+    outbuf_write( &out, (char *)widths, state_len );
+    outbuf_pad8( &out, state_len );
+    if (names_len > 0) {
+        for (var = evar_list; var != NULL; var = var->left)
+            outbuf_write( &out, var->name, strlen( var->name )+1 );
+        for (var = svar_list; var != NULL; var = var->left)
+            outbuf_write( &out, var->name, strlen( var->name )+1 );
+        outbuf_pad8( &out, names_len );
+    }
+
+    for (node = head; node != NULL; node = node->next) {
+        memset( row, 0, header.row_words*sizeof(uint64_t) );
+        bin_pack_state( row, node->state, widths, state_len );
+        outbuf_write( &out, (char *)row, header.row_words*sizeof(uint64_t) );
+    }
+
+    for (node = head; node != NULL; node = node->next) {
+        x = node->mode;
+        outbuf_write( &out, (char *)&x, sizeof(x) );
+    }
+    outbuf_pad8( &out, num_nodes*sizeof(int32_t) );
+    for (node = head; node != NULL; node = node->next) {
+        x = node->rgrad;
+        outbuf_write( &out, (char *)&x, sizeof(x) );
+    }
+    outbuf_pad8( &out, num_nodes*sizeof(int32_t) );
+    for (node = head; node != NULL; node = node->next)
+        outbuf_write( &out, node->initial ? "\1" : "\0", 1 );
+    outbuf_pad8( &out, num_nodes );
+
+    offset = 0;
+    outbuf_write( &out, (char *)&offset, sizeof(offset) );
+    for (node = head; node != NULL; node = node->next) {
+        offset += node->trans_len;
+        outbuf_write( &out, (char *)&offset, sizeof(offset) );
+    }
+    for (node = head; node != NULL; node = node->next) {
+        for (i = 0; i < node->trans_len; i++) {
+            target = aut_numbering_index( numbering, *(node->trans+i) );
+            outbuf_write( &out, (char *)&target, sizeof(target) );
         }
+    }
+    outbuf_pad8( &out, num_edges*sizeof(uint32_t) );
 
-        fprintf( fp,
-                 "],\n    \"mode\": %d,\n    \"rgrad\": %d,\n",
-                 head->mode, head->rgrad );
-        if (head->initial) {
-            fprintf( fp, "    \"initial\": true,\n" );
+    delete_aut_numbering( numbering );
+    free( row );
+    free( widths );
+    return outbuf_close( &out );
+}
+
+
+/* Point *section at count elements of given size at *pos in the file
+   contents, and advance *pos past the section and its padding.
+   Return nonzero if the file is too short. */
+static int bin_section( aut_bin_t *bin, uint64_t *pos,
+                        uint64_t count, uint64_t size, const void **section )
+{
+    if (*pos > bin->len || count > (bin->len - *pos)/size)
+        return -1;
+    *section = (char *)bin->base + *pos;
+    *pos += BIN_PAD8( count*size );
+    if (*pos > bin->len)
+        return -1;
+    return 0;
+}
+
+
+/* Interpret and check the file contents at bin->base.  Return
+   nonzero if they are not a valid binary strategy. */
+static int bin_parse( aut_bin_t *bin )
+{
+    bin_header_t header;
+    uint64_t pos;
+    const char *names, *end;
+    int row_bits;
+    int i;
+
+    if (bin->len < sizeof(header))
+        return -1;
+    memcpy( &header, bin->base, sizeof(header) );
+    if (memcmp( header.magic, BIN_AUT_MAGIC, BIN_AUT_MAGIC_LEN ))
+        return -1;
+    if (header.byte_order != BIN_AUT_BYTE_ORDER) {
+        fprintf( stderr,
+                 "Error: binary strategy was written with different"
+                 " byte order.\n" );
+        return -1;
+    }
+    if (header.version != BIN_AUT_VERSION) {
+        fprintf( stderr,
+                 "Error: unsupported binary strategy format version %d.\n",
+                 (int)header.version );
+        return -1;
+    }
+    if (header.state_len < 1 || header.state_len > INT_MAX
+        || header.num_nodes > INT_MAX
+        || (header.num_env >= 0 && (uint32_t)header.num_env > header.state_len))
+        return -1;
+    bin->version = header.version;
+    bin->state_len = header.state_len;
+    bin->num_env = header.num_env;
+    bin->num_nodes = header.num_nodes;
+    bin->num_edges = header.num_edges;
+    bin->row_words = header.row_words;
+
+    pos = sizeof(header);
+    if (bin_section( bin, &pos, bin->state_len, 1,
+                     (const void **)&bin->widths ))
+        return -1;
+    row_bits = 0;
+    for (i = 0; i < bin->state_len; i++) {
+        if (*(bin->widths+i) < 1 || *(bin->widths+i) > 32)
+            return -1;
+        row_bits += *(bin->widths+i);
+    }
+    if (header.row_words != (uint32_t)(row_bits+63)/64)
+        return -1;
+
+    if (bin_section( bin, &pos, header.names_len, 1, (const void **)&names ))
+        return -1;
+    if (bin->num_env >= 0) {
+        bin->names = malloc( bin->state_len*sizeof(char *) );
+        if (bin->names == NULL) {
+            perror( __FILE__ ",  malloc" );
+            exit(-1);
+        }
+        end = names + header.names_len;
+        for (i = 0; i < bin->state_len; i++) {
+            if (names >= end)
+                return -1;
+            *(bin->names+i) = (char *)names;
+            names = memchr( names, '\0', end - names );
+            if (names == NULL)
+                return -1;
+            names++;
+        }
+    }
+
+    if (bin_section( bin, &pos, (uint64_t)bin->num_nodes,
+                     bin->row_words*sizeof(uint64_t),
+                     (const void **)&bin->states )
+        || bin_section( bin, &pos, bin->num_nodes, sizeof(int32_t),
+                        (const void **)&bin->modes )
+        || bin_section( bin, &pos, bin->num_nodes, sizeof(int32_t),
+                        (const void **)&bin->rgrads )
+        || bin_section( bin, &pos, bin->num_nodes, 1,
+                        (const void **)&bin->initial )
+        || bin_section( bin, &pos, (uint64_t)bin->num_nodes+1,
+                        sizeof(uint64_t), (const void **)&bin->offsets )
+        || bin_section( bin, &pos, bin->num_edges, sizeof(uint32_t),
+                        (const void **)&bin->targets ))
+        return -1;
+
+    if (*(bin->offsets) != 0 || *(bin->offsets+bin->num_nodes) != bin->num_edges)
+        return -1;
+    for (i = 0; i < bin->num_nodes; i++) {
+        if (*(bin->offsets+i+1) < *(bin->offsets+i)
+            || *(bin->offsets+i+1) - *(bin->offsets+i) > INT_MAX)
+            return -1;
+    }
+    for (pos = 0; pos < bin->num_edges; pos++) {
+        if (*(bin->targets+pos) >= (uint32_t)bin->num_nodes)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+aut_bin_t *aut_bin_open( FILE *fp )
+{
+    aut_bin_t *bin;
+    size_t cap, n;
+    char *tmp;
+#ifdef BIN_AUT_MMAP
+    struct stat sb;
+    void *base;
+#endif
+
+    if (fp == NULL)
+        fp = stdin;
+
+    bin = malloc( sizeof(aut_bin_t) );
+    if (bin == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    bin->names = NULL;
+    bin->index = NULL;
+    bin->index_next = NULL;
+    bin->index_size = 0;
+    bin->index_row = NULL;
+    bin->base = NULL;
+    bin->len = 0;
+    bin->mapped = False;
+
+#ifdef BIN_AUT_MMAP
+    if (fstat( fileno( fp ), &sb ) == 0 && S_ISREG( sb.st_mode )
+        && sb.st_size > 0 && ftell( fp ) == 0) {
+        base = mmap( NULL, sb.st_size, PROT_READ, MAP_PRIVATE,
+                     fileno( fp ), 0 );
+        if (base != MAP_FAILED) {
+            bin->base = base;
+            bin->len = sb.st_size;
+            bin->mapped = True;
+        }
+    }
+#endif
+
+    if (!bin->mapped) {
+        cap = AUT_WRITE_BUFLEN;
+        bin->base = malloc( cap );
+        if (bin->base == NULL) {
+            perror( __FILE__ ",  malloc" );
+            exit(-1);
+        }
+        while ((n = fread( (char *)bin->base + bin->len, 1,
+                           cap - bin->len, fp )) > 0) {
+            bin->len += n;
+            if (bin->len == cap) {
+                cap *= 2;
+                tmp = realloc( bin->base, cap );
+                if (tmp == NULL) {
+                    perror( __FILE__ ",  realloc" );
+                    exit(-1);
+                }
+                bin->base = tmp;
+            }
+        }
+    }
+
+    if (bin_parse( bin )) {
+        aut_bin_close( bin );
+        return NULL;
+    }
+    return bin;
+}
+
+
+void aut_bin_state( aut_bin_t *bin, int i, vartype *state )
+{
+    const uint64_t *row = bin->states + (size_t)i*bin->row_words;
+    uint64_t v;
+    int j, w, bit = 0;
+
+    for (j = 0; j < bin->state_len; j++) {
+        w = *(bin->widths+j);
+        v = *(row + bit/64) >> (bit%64);
+        if (bit%64 + w > 64)
+            v |= *(row + bit/64 + 1) << (64 - bit%64);
+        v &= (((uint64_t)1) << w) - 1;
+        if (w == 32) {
+            *(state+j) = (int32_t)(uint32_t)v;
         } else {
-            fprintf( fp, "    \"initial\": false,\n" );
+            *(state+j) = v;
         }
+        bit += w;
+    }
+}
 
-        fprintf( fp, "    \"trans\": [" );
-        for (i = 0; i < head->trans_len; i++) {
-            fprintf( fp, "\"%p\"", (void *)*(head->trans+i) );
-            if (i < head->trans_len-1)
-                fprintf( fp, ", " );
+
+/* FNV-1a over the words of a packed state */
+static size_t bin_row_hash( const uint64_t *row, int row_words )
+{
+    uint64_t h = 14695981039346656037ULL;
+    int i;
+    for (i = 0; i < row_words; i++) {
+        h ^= *(row+i);
+        h *= 1099511628211ULL;
+    }
+    return (size_t)(h ^ (h >> 32));
+}
+
+static void bin_build_index( aut_bin_t *bin )
+{
+    const uint64_t *row;
+    size_t k;
+    uint32_t *last;  /* Last node found so far with the state of each slot */
+    int i;
+
+    bin->index_size = 16;
+    while (bin->index_size < 2*(size_t)bin->num_nodes)
+        bin->index_size *= 2;
+    bin->index = malloc( bin->index_size*sizeof(uint32_t) );
+    last = malloc( bin->index_size*sizeof(uint32_t) );
+    bin->index_next = malloc( (bin->num_nodes+1)*sizeof(uint32_t) );
+    bin->index_row = malloc( (bin->row_words+1)*sizeof(uint64_t) );
+    if (bin->index == NULL || last == NULL || bin->index_next == NULL
+        || bin->index_row == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (k = 0; k < bin->index_size; k++)
+        *(bin->index+k) = BIN_AUT_NONE;
+
+    for (i = 0; i < bin->num_nodes; i++) {
+        row = bin->states + (size_t)i*bin->row_words;
+        *(bin->index_next+i) = BIN_AUT_NONE;
+        k = bin_row_hash( row, bin->row_words ) & (bin->index_size-1);
+        while (*(bin->index+k) != BIN_AUT_NONE
+               && memcmp( bin->states + (size_t)(*(bin->index+k))*bin->row_words,
+                          row, bin->row_words*sizeof(uint64_t) ))
+            k = (k+1) & (bin->index_size-1);
+        if (*(bin->index+k) == BIN_AUT_NONE) {
+            *(bin->index+k) = i;
+        } else {
+            *(bin->index_next + *(last+k)) = i;
         }
-        fprintf( fp, "] }" );
+        *(last+k) = i;
+    }
+
+    free( last );
+}
+
+int aut_bin_find( aut_bin_t *bin, vartype *state, int mode, int after )
+{
+    uint64_t *row;
+    size_t k;
+    uint32_t node;
+    int i;
 
-        head = head->next;
-        if (head != NULL)
-            fprintf( fp, "," );
-        fprintf( fp, "\n" );
+    /* States having values that do not fit in the recorded widths
+       cannot occur. */
+    for (i = 0; i < bin->state_len; i++) {
+        if (*(bin->widths+i) < 32
+            && (*(state+i) < 0 || *(state+i) >> *(bin->widths+i) != 0))
+            return -1;
     }
-    fprintf( fp, "}}\n" );
-    return 0;
+
+    if (bin->index == NULL)
+        bin_build_index( bin );
+
+    row = bin->index_row;
+    memset( row, 0, bin->row_words*sizeof(uint64_t) );
+    bin_pack_state( row, state, bin->widths, bin->state_len );
+    if (after >= 0 && after < bin->num_nodes
+        && !memcmp( bin->states + (size_t)after*bin->row_words,
+                    row, bin->row_words*sizeof(uint64_t) )) {
+        /* Continue along the nodes having this state, so that
+           enumerating all of them takes linear time. */
+        node = *(bin->index_next+after);
+    } else {
+        k = bin_row_hash( row, bin->row_words ) & (bin->index_size-1);
+        while (*(bin->index+k) != BIN_AUT_NONE
+               && memcmp( bin->states + (size_t)(*(bin->index+k))*bin->row_words,
+                          row, bin->row_words*sizeof(uint64_t) ))
+            k = (k+1) & (bin->index_size-1);
+        node = *(bin->index+k);
+    }
+
+    for (; node != BIN_AUT_NONE; node = *(bin->index_next+node)) {
+        if ((int)node > after && (mode == -1 || *(bin->modes+node) == mode))
+            return node;
+    }
+    return -1;
+}
+
+void aut_bin_close( aut_bin_t *bin )
+{
+    if (bin == NULL)
+        return;
+    free( bin->names );
+    free( bin->index );
+    free( bin->index_next );
+    free( bin->index_row );
+#ifdef BIN_AUT_MMAP
+    if (bin->mapped) {
+        munmap( bin->base, bin->len );
+    } else {
+        free( bin->base );
+    }
+#else
+    free( bin->base );
+#endif
+    free( bin );
+}
+
+
+anode_t *bin_aut_loadver( int state_len, FILE *fp, int *version )
+{
+    aut_bin_t *bin;
+    anode_t *head = NULL;
+    anode_t **nodes;
+    vartype *state;
+    uint64_t k;
+    int i, j;
+
+    bin = aut_bin_open( fp );
+    if (bin == NULL)
+        return NULL;
+    if (state_len > 0 && state_len != bin->state_len) {
+        fprintf( stderr,
+                 "Error: binary strategy has state vector length %d,"
+                 " but %d was expected.\n", bin->state_len, state_len );
+        aut_bin_close( bin );
+        return NULL;
+    }
+    if (bin->num_nodes == 0) {
+        aut_bin_close( bin );
+        return NULL;
+    }
+
+    nodes = malloc( bin->num_nodes*sizeof(anode_t *) );
+    state = malloc( bin->state_len*sizeof(vartype) );
+    if (nodes == NULL || state == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+
+    /* insert_anode() prepends, so build the list from its tail. */
+    for (i = bin->num_nodes-1; i >= 0; i--) {
+        aut_bin_state( bin, i, state );
+        head = insert_anode( head, *(bin->modes+i), *(bin->rgrads+i),
+                             *(bin->initial+i) ? True : False,
+                             state, bin->state_len );
+        *(nodes+i) = head;
+    }
+    for (i = 0; i < bin->num_nodes; i++) {
+        (*(nodes+i))->trans_len = *(bin->offsets+i+1) - *(bin->offsets+i);
+        if ((*(nodes+i))->trans_len == 0)
+            continue;
+        (*(nodes+i))->trans = malloc( (*(nodes+i))->trans_len
+                                      *sizeof(anode_t *) );
+        if ((*(nodes+i))->trans == NULL) {
+            perror( __FILE__ ",  malloc" );
+            exit(-1);
+        }
+        k = *(bin->offsets+i);
+        for (j = 0; j < (*(nodes+i))->trans_len; j++)
+            *((*(nodes+i))->trans+j) = *(nodes + *(bin->targets+k+j));
+    }
+
+    if (version != NULL)
+        *version = bin->version;
+    free( state );
+    free( nodes );
+    aut_bin_close( bin );
+    return head;
 }
 
 
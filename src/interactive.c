@@ -412,6 +412,7 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
 
     ptree_t *var_separator;
     DdNode *W;
+    winning_incr_t W_incr;  /* Fixpoints kept for recomputing W */
     DdNode *strans_into_W;
 
     DdNode *etrans, *strans, **egoals, **sgoals;
@@ -522,8 +523,9 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
     strans_patched = strans;
     Cudd_Ref( strans_patched );
 
-    W = compute_winning_set_BDD( manager,
-                                 etrans, strans, egoals, sgoals, verbose );
+    WINNING_INCR_INIT( W_incr );
+    W = compute_winning_set_incr( manager, &W_incr,
+                                  etrans, strans, egoals, sgoals, verbose );
     if (W == NULL) {
         fprintf( stderr,
                  "Error levelset_interactive: failed to construct winning"
@@ -539,9 +541,9 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
         case INTCOM_REWIN:
             if (W != NULL)
                 Cudd_RecursiveDeref( manager, W );
-            W = compute_winning_set_BDD( manager,
-                                         etrans_patched, strans_patched,
-                                         egoals, sgoals, verbose );
+            W = compute_winning_set_incr( manager, &W_incr,
+                                          etrans_patched, strans_patched,
+                                          egoals, sgoals, verbose );
             if (W == NULL) {
                 fprintf( stderr,
                          "Error levelset_interactive: failed to construct"
@@ -553,9 +555,9 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
         case INTCOM_RELEVELS:
             if (W != NULL)
                 Cudd_RecursiveDeref( manager, W );
-            W = compute_winning_set_BDD( manager,
-                                         etrans_patched, strans_patched,
-                                         egoals, sgoals, verbose );
+            W = compute_winning_set_incr( manager, &W_incr,
+                                          etrans_patched, strans_patched,
+                                          egoals, sgoals, verbose );
             if (W == NULL) {
                 fprintf( stderr,
                          "Error levelset_interactive: failed to construct"
@@ -961,6 +963,7 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
     Cudd_RecursiveDeref( manager, etrans_patched );
     Cudd_RecursiveDeref( manager, strans_patched );
     Cudd_RecursiveDeref( manager, W );
+    winning_incr_clear( manager, &W_incr );
     Cudd_RecursiveDeref( manager, etrans );
     Cudd_RecursiveDeref( manager, strans );
     for (i = 0; i < spc.num_egoals; i++)
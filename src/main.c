@@ -11,6 +11,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <time.h>
+#include <pthread.h>
 #if defined(_WIN32) || defined(_WIN64)
 #include <process.h>
 #endif
@@ -21,6 +23,9 @@
 #include "solve.h"
 #include "automaton.h"
 #include "gr1c_util.h"
+#include "reduce.h"
+#include "spc_cache.h"
+#include "perfstat.h"
 extern int yyparse( void );
 extern void yyrestart( FILE *new_file );
 
@@ -39,6 +44,14 @@ extern specification_t spc;
 #define OUTPUT_FORMAT_DOT 2
 #define OUTPUT_FORMAT_AUT 3
 #define OUTPUT_FORMAT_JSON 5
+#define OUTPUT_FORMAT_BIN 6
+#define OUTPUT_FORMAT_JSON_COMPACT 7
+#define OUTPUT_FORMAT_JSONL 8
+#define OUTPUT_FORMAT_AUT2 9
+
+/* Level of gzip compression, if selected by "-z" or a file name
+   ending in ".gz" */
+#define OUTPUT_GZ_LEVEL 6
 
 /* Verification model targets */
 #define VERMODEL_TARGET_SPIN 1
@@ -50,6 +63,125 @@ extern specification_t spc;
 #define GR1C_MODE_INTERACTIVE 3
 
 
+/* Destination of the strategy, as given by "-t TYPE" and "-o FILE", or
+   by "-t TYPE:FILE", which can be repeated. */
+typedef struct {
+    byte format;
+    char *filename;  /* NULL indicates stdout */
+    FILE *fp;
+    anode_t *strategy;
+    ptree_t *evar_list;
+    ptree_t *svar_list;
+    bool nonbool;  /* True if there are nonboolean variables */
+    int compression;  /* Level of gzip compression, or 0 if none */
+    int result;
+    size_t bytes;
+    double secs;
+} strategy_output_t;
+
+
+/* Return one of the OUTPUT_FORMAT_ values for the given name, or -1 if
+   it is not recognized. */
+static int parse_output_format( char *name )
+{
+    if (!strncmp( name, "txt", strlen( "txt" ) )) {
+        return OUTPUT_FORMAT_TEXT;
+    } else if (!strncmp( name, "tulip", strlen( "tulip" ) )) {
+        return OUTPUT_FORMAT_TULIP;
+    } else if (!strncmp( name, "dot", strlen( "dot" ) )) {
+        return OUTPUT_FORMAT_DOT;
+    } else if (!strcmp( name, "aut2" )) {
+        return OUTPUT_FORMAT_AUT2;
+    } else if (!strncmp( name, "aut", strlen( "aut" ) )) {
+        return OUTPUT_FORMAT_AUT;
+    } else if (!strcmp( name, "json-compact" )) {
+        return OUTPUT_FORMAT_JSON_COMPACT;
+    } else if (!strcmp( name, "jsonl" )) {
+        return OUTPUT_FORMAT_JSONL;
+    } else if (!strncmp( name, "json", strlen( "json" ) )) {
+        return OUTPUT_FORMAT_JSON;
+    } else if (!strncmp( name, "bin", strlen( "bin" ) )) {
+        return OUTPUT_FORMAT_BIN;
+    }
+    return -1;
+}
+
+
+/* Return True if filename ends with ".gz". */
+static bool gz_filename( char *filename )
+{
+    size_t len;
+    if (filename == NULL)
+        return False;
+    len = strlen( filename );
+    return len >= 3 && !strcmp( filename+len-3, ".gz" );
+}
+
+
+/* Write the strategy to an output, which should already be open.  The
+   strategy is only read, so this can run for several outputs at once
+   in separate threads. */
+static void *dump_strategy( void *arg )
+{
+    strategy_output_t *out = (strategy_output_t *)arg;
+    struct timespec start, end;
+    int state_len;
+
+    state_len = tree_size( out->evar_list ) + tree_size( out->svar_list );
+    clock_gettime( CLOCK_MONOTONIC, &start );
+
+    out->result = 0;
+    /* Compression is selected per thread. */
+    if (aut_dump_set_compression( out->compression )) {
+        out->result = -1;
+        out->bytes = 0;
+        out->secs = 0;
+        return NULL;
+    }
+    if (out->format == OUTPUT_FORMAT_TEXT) {
+        list_aut_dump( out->strategy, state_len, out->fp );
+    } else if (out->format == OUTPUT_FORMAT_DOT) {
+        if (out->nonbool) {
+            out->result = dot_aut_dump( out->strategy,
+                                        out->evar_list, out->svar_list,
+                                        DOT_AUT_ATTRIB, out->fp );
+        } else {
+            out->result = dot_aut_dump( out->strategy,
+                                        out->evar_list, out->svar_list,
+                                        DOT_AUT_BINARY | DOT_AUT_ATTRIB,
+                                        out->fp );
+        }
+    } else if (out->format == OUTPUT_FORMAT_AUT) {
+        aut_aut_dump( out->strategy, state_len, out->fp );
+    } else if (out->format == OUTPUT_FORMAT_AUT2) {
+        out->result = aut_aut_dumpver( out->strategy, state_len, out->fp, 2 );
+    } else if (out->format == OUTPUT_FORMAT_JSON) {
+        out->result = json_aut_dump( out->strategy,
+                                     out->evar_list, out->svar_list, out->fp );
+    } else if (out->format == OUTPUT_FORMAT_JSON_COMPACT) {
+        out->result = json_aut_dumpopt( out->strategy,
+                                        out->evar_list, out->svar_list,
+                                        JSON_AUT_COMPACT, out->fp );
+    } else if (out->format == OUTPUT_FORMAT_JSONL) {
+        out->result = json_aut_dumpopt( out->strategy,
+                                        out->evar_list, out->svar_list,
+                                        JSON_AUT_LINES, out->fp );
+    } else if (out->format == OUTPUT_FORMAT_BIN) {
+        out->result = bin_aut_dump( out->strategy,
+                                    out->evar_list, out->svar_list,
+                                    state_len, out->fp );
+    } else { /* OUTPUT_FORMAT_TULIP */
+        out->result = tulip_aut_dump( out->strategy,
+                                      out->evar_list, out->svar_list, out->fp );
+    }
+    out->bytes = aut_last_dump_bytes();
+
+    clock_gettime( CLOCK_MONOTONIC, &end );
+    out->secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)*1e-9;
+    return NULL;
+}
+
+
 #define PRINT_VERSION() \
     printf( "gr1c " GR1C_VERSION "\n\n" GR1C_COPYRIGHT "\n" )
 
@@ -57,16 +189,34 @@ extern specification_t spc;
 int main( int argc, char **argv )
 {
     FILE *fp;
+    strategy_output_t *outputs = NULL;  /* For command-line flag "-t TYPE:FILE" */
+    int num_outputs = 0;
+    bool primary_output_flag = False;  /* "-t TYPE" or "-o FILE" given */
+    bool compress_flag = False;  /* For command-line flag "-z". */
+    pthread_t *dump_threads = NULL;
+    bool *dump_started = NULL;
+    int first_output;
+    char *separator;
+    int format;
     byte run_option = GR1C_MODE_SYNTHESIS;
     bool help_flag = False;
     bool ptdump_flag = False;
     bool logging_flag = False;
+    bool reduce_flag = False;
+    bool static_order_flag = False;
     unsigned char init_flags = ALL_ENV_EXIST_SYS_INIT;
     byte format_option = OUTPUT_FORMAT_JSON;
     unsigned char verbose = 0;
     bool reading_options = True;  /* For disabling option parsing using "--" */
     int input_index = -1;
     int output_file_index = -1;  /* For command-line flag "-o". */
+    int order_file_index = -1;  /* For command-line flag "--order". */
+    int compile_file_index = -1;  /* For command-line flag "--compile". */
+    int perfstat_file_index = -1;  /* For command-line flag "--perfstat". */
+    FILE *compile_fp = NULL;
+    specification_t compiled;  /* Expanded part of compiled specification */
+    int cache_status = 0;
+    int *var_order = NULL;
     char dumpfilename[64];
     char **command_argv = NULL;
 
@@ -85,6 +235,8 @@ int main( int argc, char **argv )
     int i, j, var_index;
     ptree_t *tmppt;  /* General purpose temporary ptree pointer */
 
+    reduction_t *reduction = NULL;
+
     DdManager *manager;
     DdNode *T = NULL;
     anode_t *strategy = NULL;
@@ -185,6 +337,10 @@ int main( int argc, char **argv )
                 ptdump_flag = True;
             } else if (argv[i][1] == 'r') {
                 run_option = GR1C_MODE_REALIZABLE;
+            } else if (argv[i][1] == 'e') {
+                reduce_flag = True;
+            } else if (argv[i][1] == 'O') {
+                static_order_flag = True;
             } else if (argv[i][1] == 'i') {
                 run_option = GR1C_MODE_INTERACTIVE;
             } else if (argv[i][1] == 't') {
@@ -192,21 +348,37 @@ int main( int argc, char **argv )
                     fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
                     return 1;
                 }
-                if (!strncmp( argv[i+1], "txt", strlen( "txt" ) )) {
-                    format_option = OUTPUT_FORMAT_TEXT;
-                } else if (!strncmp( argv[i+1], "tulip", strlen( "tulip" ) )) {
-                    format_option = OUTPUT_FORMAT_TULIP;
-                } else if (!strncmp( argv[i+1], "dot", strlen( "dot" ) )) {
-                    format_option = OUTPUT_FORMAT_DOT;
-                } else if (!strncmp( argv[i+1], "aut", strlen( "aut" ) )) {
-                    format_option = OUTPUT_FORMAT_AUT;
-                } else if (!strncmp( argv[i+1], "json", strlen( "json" ) )) {
-                    format_option = OUTPUT_FORMAT_JSON;
-                } else {
+                separator = strchr( argv[i+1], ':' );
+                if (separator != NULL)
+                    *separator = '\0';
+                format = parse_output_format( argv[i+1] );
+                if (format < 0) {
                     fprintf( stderr,
                              "Unrecognized output format. Try \"-h\".\n" );
                     return 1;
                 }
+                if (separator == NULL) {
+                    format_option = format;
+                    primary_output_flag = True;
+                } else {
+                    if (*(separator+1) == '\0') {
+                        fprintf( stderr,
+                                 "Missing file name in output \"%s:\"."
+                                 " Try \"-h\".\n", argv[i+1] );
+                        return 1;
+                    }
+                    outputs = realloc( outputs, (num_outputs+2)
+                                       *sizeof(strategy_output_t) );
+                    if (outputs == NULL) {
+                        perror( __FILE__ ",  realloc" );
+                        return -1;
+                    }
+                    /* The first slot is reserved for the output given
+                       by "-t TYPE" and "-o FILE". */
+                    (outputs+num_outputs+1)->format = format;
+                    (outputs+num_outputs+1)->filename = separator+1;
+                    num_outputs++;
+                }
                 i++;
             } else if (argv[i][1] == 'n') {
                 if (i == argc-1) {
@@ -236,9 +408,12 @@ int main( int argc, char **argv )
                     return 1;
                 }
                 output_file_index = i+1;
+                primary_output_flag = True;
                 i++;
             } else if (argv[i][1] == 'P') {
                 verification_model = VERMODEL_TARGET_SPIN;
+            } else if (argv[i][1] == 'z') {
+                compress_flag = True;
             } else {
                 fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
                 return 1;
@@ -251,6 +426,37 @@ int main( int argc, char **argv )
             } else if (!strncmp( argv[i]+2, "version", strlen( "version" ) )) {
                 PRINT_VERSION();
                 return 0;
+            } else if (!strncmp( argv[i]+2, "order", strlen( "order" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                order_file_index = i+1;
+                i++;
+            } else if (!strncmp( argv[i]+2, "compile", strlen( "compile" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                compile_file_index = i+1;
+                i++;
+            } else if (!strncmp( argv[i]+2, "perfstat", strlen( "perfstat" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                perfstat_file_index = i+1;
+                i++;
+            } else if (!strncmp( argv[i]+2, "encoding", strlen( "encoding" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                if (parse_nonbool_encodings( argv[i+1] )) {
+                    fprintf( stderr, "Invalid encoding given. Try \"-h\".\n" );
+                    return 1;
+                }
+                i++;
             } else {
                 fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
                 return 1;
@@ -269,13 +475,19 @@ int main( int argc, char **argv )
 
     if (help_flag) {
         /* Split among printf() calls to conform with ISO C90 string length */
-        printf( "Usage: %s [-hVvlspriP] [-n INIT] [-t TYPE] [-o FILE] [[--] FILE]\n\n"
+        printf( "Usage: %s [-hVvlspreOiPz] [-n INIT] [-t TYPE[:FILE]] [-o FILE]\n"
+                "          [--order FILE] [--encoding ENC] [--compile FILE]\n"
+                "          [--perfstat FILE] [[--] FILE]\n\n"
                 "  -h          this help message\n"
                 "  -V          print version and exit\n"
                 "  -v          be verbose; use -vv to be more verbose\n"
                 "  -l          enable logging\n"
                 "  -t TYPE     strategy output format; default is \"json\";\n"
-                "              supported formats: txt, dot, aut, json, tulip\n", argv[0] );
+                "              supported formats: txt, dot, aut, aut2, json,\n"
+                "              json-compact, jsonl, tulip, bin\n"
+                "  -t TYPE:FILE  also output strategy to FILE in format TYPE;\n"
+                "              can be repeated, and if only such outputs are given,\n"
+                "              then nothing is written to stdout\n", argv[0] );
         printf( "  -n INIT     initial condition interpretation; (not case sensitive)\n"
                 "              one of\n"
                 "                  ALL_ENV_EXIST_SYS_INIT (default)\n"
@@ -285,10 +497,28 @@ int main( int argc, char **argv )
         printf( "  -p          dump parse trees to DOT files, and echo formulas to screen\n"
                 "  -r          only check realizability; do not synthesize strategy\n"
                 "              (return 0 if realizable, 3 if not)\n"
+                "  -e          eliminate variables that are defined by others or\n"
+                "              irrelevant to the goals before solving; ignored with -i\n"
+                "  -O          initial BDD variable order from structure of specification\n"
+                "  --order FILE  read initial BDD variable order from FILE, if it exists\n"
+                "              (takes precedence over -O), and write final order to FILE\n"
+                "  --encoding ENC  encoding of variables with integral domains;\n"
+                "              comma-separated list of items of the form E or VAR=E,\n"
+                "              where E is one of binary (default), gray, onehot,\n"
+                "              and E alone applies to variables not given by name\n"
+                "  --compile FILE  write compiled specification to FILE and exit;\n"
+                "              it can be given in place of the specification to skip\n"
+                "              parsing and expansion of nonboolean variables\n"
+                "  --perfstat FILE  write hardware performance counters of each phase\n"
+                "              of solving to FILE in JSON, and log them if verbose;\n"
+                "              requires gr1c built with \"make PERFSTAT=1\" on Linux\n"
                 "  -i          interactive mode\n"
                 "  -o FILE     output strategy to FILE, rather than stdout (default)\n"
+                "  -z          compress strategy output with gzip; this is also done\n"
+                "              for output files with names ending in \".gz\"\n"
                 "  -P          create Spin Promela model of strategy;\n"
-                "              output to stdout, so requires -o flag to also be used\n" );
+                "              output to stdout, so requires -o flag or only\n"
+                "              -t TYPE:FILE outputs to also be used\n" );
         printf( "\nFor other commands, use: %s COMMAND [...]\n\n"
                 "  rg          solve reachability game\n"
                 "  autman      manipulate finite-memory strategies\n"
@@ -304,9 +534,11 @@ int main( int argc, char **argv )
                 " implemented.\n" );
         return 1;
     }
-    if (verification_model > 0 && output_file_index < 0) {
-        printf( "-P flag can only be used with -o flag because the"
-                " verification model is\noutput to stdout.\n" );
+    if (verification_model > 0 && output_file_index < 0
+        && (num_outputs == 0 || primary_output_flag)) {
+        printf( "-P flag can only be used with -o flag, or with only -t TYPE:FILE"
+                " outputs,\nbecause the verification model is output to"
+                " stdout.\n" );
         return 1;
     }
 
@@ -322,25 +554,50 @@ int main( int argc, char **argv )
     if (verbose > 0)
         logprint( "Running with verbosity level %d.", verbose );
 
+    if (perfstat_file_index >= 0 && perfstat_enable()) {
+        fprintf( stderr,
+                 "Performance counters are not available.  gr1c must be built"
+                 " with\n\"make PERFSTAT=1\" on Linux, and"
+                 " /proc/sys/kernel/perf_event_paranoid\nmust allow"
+                 " counting.\n" );
+        return 1;
+    }
+
     /* If filename for specification given at command-line, then use
        it.  Else, read from stdin. */
     if (input_index > 0) {
-        fp = fopen( argv[input_index], "r" );
+        fp = fopen( argv[input_index], "rb" );
         if (fp == NULL) {
             perror( __FILE__ ",  fopen" );
             return -1;
         }
-        yyrestart( fp );
     } else {
-        yyrestart( stdin );
+        fp = stdin;
     }
 
-    /* Parse the specification. */
-    if (verbose)
-        logprint( "Parsing input..." );
+    /* Parse the specification, or load it if compiled. */
+    perfstat_begin( "parse", -1 );
     SPC_INIT( spc );
-    if (yyparse())
-        return 2;
+    if (spc_cache_detect( fp )) {
+        if (verbose)
+            logprint( "Loading compiled specification..." );
+        SPC_INIT( compiled );
+        cache_status = spc_cache_load( fp, SPC_CACHE_GR1, &spc, &compiled,
+                                       init_flags, verbose );
+        if (cache_status < 0) {
+            perfstat_end();
+            return 2;
+        }
+    } else {
+        yyrestart( fp );
+        if (verbose)
+            logprint( "Parsing input..." );
+        if (yyparse()) {
+            perfstat_end();
+            return 2;
+        }
+    }
+    perfstat_end();
     if (verbose)
         logprint( "Done." );
 
@@ -387,6 +644,17 @@ int main( int argc, char **argv )
         *spc.sys_goals = init_ptree( PT_CONSTANT, NULL, 1 );
     }
 
+    if (compile_file_index >= 0) {
+        compile_fp = fopen( argv[compile_file_index], "wb" );
+        if (compile_fp == NULL) {
+            perror( __FILE__ ",  fopen" );
+            return -1;
+        }
+        if (spc_cache_dump_source( &spc, SPC_CACHE_GR1, compile_fp )) {
+            fprintf( stderr, "Error while writing compiled specification.\n" );
+            return -1;
+        }
+    }
 
     if (ptdump_flag) {
         tree_dot_dump( spc.env_init, "env_init_ptree.dot" );
@@ -507,11 +775,18 @@ int main( int argc, char **argv )
             *(original_sys_trans_array+i) = copy_ptree( *(spc.sys_trans_array+i) );
     }
 
-    if (expand_nonbool_GR1( spc.evar_list, spc.svar_list, &spc.env_init, &spc.sys_init,
-                            &spc.env_trans_array, &spc.et_array_len,
-                            &spc.sys_trans_array, &spc.st_array_len,
-                            &spc.env_goals, spc.num_egoals, &spc.sys_goals, spc.num_sgoals,
-                            init_flags, verbose ) < 0) {
+    perfstat_begin( "bitblast", -1 );
+    if (cache_status == 1) {
+        if (verbose)
+            logprint( "Using expansion of nonboolean variables from compiled"
+                      " specification." );
+        spc_free( &spc );
+        spc = compiled;
+    } else if (expand_nonbool_GR1( spc.evar_list, spc.svar_list, &spc.env_init, &spc.sys_init,
+                                   &spc.env_trans_array, &spc.et_array_len,
+                                   &spc.sys_trans_array, &spc.st_array_len,
+                                   &spc.env_goals, spc.num_egoals, &spc.sys_goals, spc.num_sgoals,
+                                   init_flags, verbose ) < 0) {
         if (verification_model > 0) {
             for (j = 0; j < original_num_egoals; j++)
                 free( *(original_env_goals+j) );
@@ -526,10 +801,36 @@ int main( int argc, char **argv )
                 free( *(original_sys_trans_array+j) );
             free( original_sys_trans_array );
         }
+        perfstat_end();
         return -1;
+    } else {
+        spc.nonbool_var_list = expand_nonbool_variables( &spc.evar_list,
+                                                         &spc.svar_list,
+                                                         verbose );
+    }
+    perfstat_end();
+
+    if (compile_fp != NULL) {
+        if (spc_cache_dump_expanded( &spc, init_flags, compile_fp )
+            || fclose( compile_fp )) {
+            fprintf( stderr, "Error while writing compiled specification.\n" );
+            return -1;
+        }
+        if (verbose)
+            logprint( "Wrote compiled specification to \"%s\".",
+                      argv[compile_file_index] );
+        return 0;
+    }
+
+    if (reduce_flag && run_option != GR1C_MODE_INTERACTIVE) {
+        /* Components need not be enumerated if no strategy is built. */
+        reduction = reduce_GR1( init_flags,
+                                (run_option == GR1C_MODE_REALIZABLE)
+                                ? -1 : REDUCE_MAX_COMPONENT,
+                                verbose );
+        if (reduction == NULL)
+            return -1;
     }
-    spc.nonbool_var_list = expand_nonbool_variables( &spc.evar_list, &spc.svar_list,
-                                                     verbose );
 
     /* Merge component safety (transition) formulas */
     if (spc.et_array_len > 1) {
@@ -564,9 +865,33 @@ int main( int argc, char **argv )
     num_env = tree_size( spc.evar_list );
     num_sys = tree_size( spc.svar_list );
 
+    if (order_file_index >= 0) {
+        fp = fopen( argv[order_file_index], "r" );
+        if (fp != NULL) {
+            var_order = load_var_order( fp, spc.evar_list, spc.svar_list );
+            fclose( fp );
+            if (var_order == NULL)
+                return -1;
+        }
+    }
+    if (var_order == NULL && static_order_flag)
+        var_order = force_var_order( spc.evar_list, spc.svar_list,
+                                     spc.env_init, spc.sys_init,
+                                     spc.env_trans_array, spc.et_array_len,
+                                     spc.sys_trans_array, spc.st_array_len,
+                                     spc.env_goals, spc.num_egoals,
+                                     spc.sys_goals, spc.num_sgoals, verbose );
+
     manager = Cudd_Init( 2*(num_env+num_sys),
                          0, CUDD_UNIQUE_SLOTS, CUDD_CACHE_SLOTS, 0 );
     Cudd_SetMaxCacheHard( manager, (unsigned int)-1 );
+    if (var_order != NULL) {
+        if (!Cudd_ShuffleHeap( manager, var_order )) {
+            fprintf( stderr, "Error while applying initial variable order.\n" );
+            return -1;
+        }
+        free( var_order );
+    }
     Cudd_AutodynEnable( manager, CUDD_REORDER_SAME );
 
     if (run_option == GR1C_MODE_INTERACTIVE) {
@@ -591,7 +916,9 @@ int main( int argc, char **argv )
         T = NULL;  /* To avoid seg faults by the generic clean-up code. */
     } else {
 
+        perfstat_begin( "realizability", -1 );
         T = check_realizable( manager, init_flags, verbose );
+        perfstat_end();
         if (run_option == GR1C_MODE_REALIZABLE) {
             if ((verbose == 0) || (getlogstream() != stdout)) {
                 if (T != NULL) {
@@ -614,7 +941,9 @@ int main( int argc, char **argv )
 
             if (verbose)
                 logprint( "Synthesizing a strategy..." );
+            perfstat_begin( "synthesis", -1 );
             strategy = synthesize( manager, init_flags, verbose );
+            perfstat_end();
             if (verbose)
                 logprint( "Done." );
             if (strategy == NULL) {
@@ -625,6 +954,28 @@ int main( int argc, char **argv )
         }
     }
 
+    if (order_file_index >= 0) {
+        fp = fopen( argv[order_file_index], "w" );
+        if (fp == NULL) {
+            perror( __FILE__ ",  fopen" );
+            return -1;
+        }
+        if (dump_var_order( manager, spc.evar_list, spc.svar_list, fp ) < 0) {
+            fprintf( stderr, "Error while saving variable order.\n" );
+            return -1;
+        }
+        fclose( fp );
+    }
+
+    if (strategy != NULL && reduction != NULL) {
+        strategy = reduce_restore_aut( reduction, strategy );
+        if (strategy == NULL) {
+            fprintf( stderr,
+                     "Error while restoring eliminated variables in strategy.\n" );
+            return -1;
+        }
+    }
+
     if (strategy != NULL) {  /* De-expand nonboolean variables */
         tmppt = spc.nonbool_var_list;
         while (tmppt) {
@@ -638,40 +989,122 @@ int main( int argc, char **argv )
     }
 
     if (strategy != NULL) {
-        /* Open output file if specified; else point to stdout. */
-        if (output_file_index >= 0) {
-            fp = fopen( argv[output_file_index], "w" );
-            if (fp == NULL) {
-                perror( __FILE__ ",  fopen" );
-                return -1;
+        /* The first slot is for the output given by "-t TYPE" and
+           "-o FILE" (or stdout), which is skipped if only outputs of
+           the form "-t TYPE:FILE" were requested. */
+        if (num_outputs == 0 || primary_output_flag) {
+            first_output = 0;
+            if (outputs == NULL) {
+                outputs = malloc( sizeof(strategy_output_t) );
+                if (outputs == NULL) {
+                    perror( __FILE__ ",  malloc" );
+                    return -1;
+                }
             }
+            outputs->format = format_option;
+            outputs->filename = (output_file_index >= 0)
+                ? argv[output_file_index] : NULL;
         } else {
-            fp = stdout;
+            first_output = 1;
         }
 
-        if (verbose)
-            logprint( "Dumping automaton of size %d...", aut_size( strategy ) );
-
-        if (format_option == OUTPUT_FORMAT_TEXT) {
-            list_aut_dump( strategy, num_env+num_sys, fp );
-        } else if (format_option == OUTPUT_FORMAT_DOT) {
-            if (spc.nonbool_var_list != NULL) {
-                dot_aut_dump( strategy, spc.evar_list, spc.svar_list,
-                              DOT_AUT_ATTRIB, fp );
+        /* Open all output files before writing any, to report errors
+           early. */
+        for (i = first_output; i <= num_outputs; i++) {
+            (outputs+i)->compression = 0;
+            if (compress_flag || gz_filename( (outputs+i)->filename )) {
+                if ((outputs+i)->format == OUTPUT_FORMAT_BIN) {
+                    fprintf( stderr,
+                             "The binary strategy format cannot be"
+                             " compressed.\n" );
+                    return 1;
+                }
+                if (aut_dump_set_compression( OUTPUT_GZ_LEVEL )) {
+                    fprintf( stderr,
+                             "Compressed output requires gr1c to be built"
+                             " with zlib.\n" );
+                    return 1;
+                }
+                aut_dump_set_compression( 0 );
+                (outputs+i)->compression = OUTPUT_GZ_LEVEL;
+            }
+            if ((outputs+i)->filename != NULL) {
+                (outputs+i)->fp = fopen( (outputs+i)->filename,
+                                         ((outputs+i)->format == OUTPUT_FORMAT_BIN
+                                          || (outputs+i)->compression > 0)
+                                         ? "wb" : "w" );
+                if ((outputs+i)->fp == NULL) {
+                    perror( __FILE__ ",  fopen" );
+                    return -1;
+                }
             } else {
-                dot_aut_dump( strategy, spc.evar_list, spc.svar_list,
-                              DOT_AUT_BINARY | DOT_AUT_ATTRIB, fp );
+                (outputs+i)->fp = stdout;
             }
-        } else if (format_option == OUTPUT_FORMAT_AUT) {
-            aut_aut_dump( strategy, num_env+num_sys, fp );
-        } else if (format_option == OUTPUT_FORMAT_JSON) {
-            json_aut_dump( strategy, spc.evar_list, spc.svar_list, fp );
-        } else { /* OUTPUT_FORMAT_TULIP */
-            tulip_aut_dump( strategy, spc.evar_list, spc.svar_list, fp );
+            (outputs+i)->strategy = strategy;
+            (outputs+i)->evar_list = spc.evar_list;
+            (outputs+i)->svar_list = spc.svar_list;
+            (outputs+i)->nonbool = (spc.nonbool_var_list != NULL);
         }
 
-        if (fp != stdout)
-            fclose( fp );
+        if (verbose) {
+            if (num_outputs+1-first_output > 1) {
+                logprint( "Dumping automaton of size %d to %d outputs...",
+                          aut_size( strategy ), num_outputs+1-first_output );
+            } else {
+                logprint( "Dumping automaton of size %d...", aut_size( strategy ) );
+            }
+        }
+
+        perfstat_begin( "output", -1 );
+
+        /* The strategy is not modified while writing it, so all
+           outputs after the first are written in separate threads.
+           If a thread cannot be created, then that output is written
+           after the first. */
+        if (num_outputs > first_output) {
+            dump_threads = malloc( (num_outputs+1)*sizeof(pthread_t) );
+            dump_started = malloc( (num_outputs+1)*sizeof(bool) );
+            if (dump_threads == NULL || dump_started == NULL) {
+                perror( __FILE__ ",  malloc" );
+                return -1;
+            }
+            for (i = first_output+1; i <= num_outputs; i++)
+                *(dump_started+i) = !pthread_create( dump_threads+i, NULL,
+                                                     dump_strategy, outputs+i );
+        }
+        dump_strategy( outputs+first_output );
+        for (i = first_output+1; i <= num_outputs; i++) {
+            if (*(dump_started+i)) {
+                pthread_join( *(dump_threads+i), NULL );
+            } else {
+                dump_strategy( outputs+i );
+            }
+        }
+        free( dump_threads );
+        free( dump_started );
+        perfstat_end();
+
+        for (i = first_output; i <= num_outputs; i++) {
+            if ((outputs+i)->fp != stdout) {
+                if (fclose( (outputs+i)->fp ))
+                    (outputs+i)->result = -1;
+            } else {
+                fflush( (outputs+i)->fp );
+            }
+            if ((outputs+i)->result) {
+                fprintf( stderr, "Error while writing strategy to %s.\n",
+                         ((outputs+i)->filename != NULL)
+                         ? (outputs+i)->filename : "stdout" );
+            }
+            if (verbose) {
+                logprint( "Wrote %f MB in %f s (%f MB/s) to %s.",
+                          (outputs+i)->bytes/1e6, (outputs+i)->secs,
+                          ((outputs+i)->secs > 0)
+                          ? (outputs+i)->bytes/1e6/(outputs+i)->secs : 0.0,
+                          ((outputs+i)->filename != NULL)
+                          ? (outputs+i)->filename : "stdout" );
+            }
+        }
 
         if (verification_model > 0) {
             /* Currently, only target supported is Spin Promela */
@@ -723,6 +1156,19 @@ int main( int argc, char **argv )
         Cudd_RecursiveDeref( manager, T );
     if (strategy)
         delete_aut( strategy );
+    free( outputs );
+    delete_reduction( reduction );
+    clear_nonbool_encodings();
+    if (perfstat_file_index >= 0) {
+        if (verbose)
+            perfstat_log();
+        fp = fopen( argv[perfstat_file_index], "w" );
+        if (fp == NULL || perfstat_dump_json( fp ) || fclose( fp ))
+            fprintf( stderr,
+                     "Error while writing performance counters to \"%s\".\n",
+                     argv[perfstat_file_index] );
+        perfstat_disable();
+    }
     if (verbose > 1)
         logprint( "Cudd_CheckZeroRef -> %d", Cudd_CheckZeroRef( manager ) );
     Cudd_Quit(manager);
@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 
 #include "common.h"
 #include "logging.h"
@@ -65,110 +66,500 @@ void pprint_state( vartype *state, int num_env, int num_sys, FILE *fp )
 }
 
 
-/* Returns strategy with patched goal mode, or NULL if error. */
-anode_t *localfixpoint_goalmode( DdManager *manager, int num_env, int num_sys,
-                                 anode_t *strategy, int goal_mode,
-                                 anode_t ***affected, int *affected_len,
-                                 DdNode *etrans, DdNode *strans,
-                                 DdNode **egoals,
-                                 DdNode *N_BDD, vartype **N, int N_len,
-                                 unsigned char verbose )
+/* BDDs of the transition conjuncts of spc, kept across calls of
+   patch_localfixpoint() so that ptree_BDD() is not repeated for each
+   patch.  The cache is rebuilt if the manager or array of conjuncts
+   differs from that of the previous call. */
+typedef struct {
+    DdManager *manager;
+    ptree_t **trans_array;
+    int len;
+    DdNode **parts;
+} trans_cache_t;
+
+static trans_cache_t etrans_cache = {NULL, NULL, 0, NULL};
+static trans_cache_t strans_cache = {NULL, NULL, 0, NULL};
+
+/* Maximum number of threads for solving reachability games */
+static int num_threads = 1;
+
+static void trans_cache_clear( trans_cache_t *cache )
 {
-    int i, j, k;  /* Generic counters */
-    anode_t **Exit;
-    anode_t **Entry;
-    int Exit_len, Entry_len;
-    anode_t *local_strategy;
-    anode_t *head, *node;
-    int min_rgrad;  /* Minimum reach annotation value of affected nodes. */
-    int Exit_rgrad;  /* Maximum value among reached Exit nodes. */
-    int local_max_rgrad;
-    int local_min_rgrad;
+    int i;
+    for (i = 0; i < cache->len; i++)
+        Cudd_RecursiveDeref( cache->manager, *(cache->parts+i) );
+    free( cache->parts );
+    cache->manager = NULL;
+    cache->trans_array = NULL;
+    cache->len = 0;
+    cache->parts = NULL;
+}
 
-    /* Pre-allocate space for Entry and Exit sets; the number of
-       elements actually used is tracked by Entry_len and Exit_len,
-       respectively. */
-    Exit = malloc( sizeof(anode_t *)*N_len );
-    if (Exit == NULL) {
+/* var_list should be the chained lists of environment and system
+   variables, as required by ptree_BDD(). */
+static void trans_cache_fill( trans_cache_t *cache, DdManager *manager,
+                              ptree_t **trans_array, int len,
+                              ptree_t *var_list )
+{
+    int i;
+    if (cache->manager == manager && cache->trans_array == trans_array
+        && cache->len == len)
+        return;
+    trans_cache_clear( cache );
+    if (len == 0)
+        return;
+    cache->parts = malloc( len*sizeof(DdNode *) );
+    if (cache->parts == NULL) {
         perror( __FILE__ ",  malloc" );
         exit(-1);
     }
-    Entry = malloc( sizeof(anode_t *)*N_len );
-    if (Entry == NULL) {
+    for (i = 0; i < len; i++)
+        *(cache->parts+i) = ptree_BDD( *(trans_array+i), var_list, manager );
+    cache->manager = manager;
+    cache->trans_array = trans_array;
+    cache->len = len;
+}
+
+void patch_set_threads( int n )
+{
+    num_threads = (n < 1) ? 1 : n;
+}
+
+
+void patch_cache_clear(void)
+{
+    trans_cache_clear( &etrans_cache );
+    trans_cache_clear( &strans_cache );
+}
+
+/* Conjunction of the cached transition conjuncts that are relevant
+   given restriction to the set N.  A conjunct is irrelevant if it is
+   True from every state in N, whatever the next state; because N_BDD
+   does not depend on primed variables, that is the case iff N_BDD
+   implies the conjunct. */
+static DdNode *local_trans( DdManager *manager, trans_cache_t *cache,
+                            DdNode *N_BDD, unsigned char verbose )
+{
+    DdNode *trans, *tmp;
+    int i;
+
+    trans = Cudd_ReadOne( manager );
+    Cudd_Ref( trans );
+    for (i = 0; i < cache->len; i++) {
+        if (Cudd_bddLeq( manager, N_BDD, *(cache->parts+i) ))
+            continue;
+        if (verbose) {
+            logprint_raw( "\n" );
+            print_formula( *(cache->trans_array+i), getlogstream(),
+                           FORMULA_SYNTAX_GR1C );
+        }
+        tmp = Cudd_bddAnd( manager, trans, *(cache->parts+i) );
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, trans );
+        trans = tmp;
+    }
+    return trans;
+}
+
+
+/* FNV-1a over the values of a state vector */
+static size_t patch_state_hash( vartype *state, int state_len )
+{
+    uint64_t h = 14695981039346656037ULL;
+    int i;
+    for (i = 0; i < state_len; i++) {
+        h ^= (uint32_t)*(state+i);
+        h *= 1099511628211ULL;
+    }
+    return (size_t)(h ^ (h >> 32));
+}
+
+/* Set of states, as an open-addressing hash table.  States are not
+   copied, so they must outlive the set. */
+typedef struct {
+    vartype **slots;  /* NULL if slot is empty */
+    size_t size;  /* Power of 2 */
+    int state_len;
+} state_set_t;
+
+/* Initialize set for at most capacity states. */
+static void state_set_init( state_set_t *set, int capacity, int state_len )
+{
+    size_t k;
+    set->size = 16;
+    while (set->size < 2*(size_t)capacity)
+        set->size *= 2;
+    set->slots = malloc( set->size*sizeof(vartype *) );
+    if (set->slots == NULL) {
         perror( __FILE__ ",  malloc" );
         exit(-1);
     }
+    for (k = 0; k < set->size; k++)
+        *(set->slots+k) = NULL;
+    set->state_len = state_len;
+}
 
-    /* Ignore goal modes that are unaffected by the change. */
-    if (*(affected_len + goal_mode) == 0) {
-        free( Exit );
-        free( Entry );
-        return strategy;
+static size_t state_set_slot( state_set_t *set, vartype *state )
+{
+    size_t k = patch_state_hash( state, set->state_len ) & (set->size-1);
+    while (*(set->slots+k) != NULL
+           && !statecmp( *(set->slots+k), state, set->state_len ))
+        k = (k+1) & (set->size-1);
+    return k;
+}
+
+/* Return True if state was added, False if it was already present. */
+static bool state_set_add( state_set_t *set, vartype *state )
+{
+    size_t k = state_set_slot( set, state );
+    if (*(set->slots+k) != NULL)
+        return False;
+    *(set->slots+k) = state;
+    return True;
+}
+
+static bool state_set_member( state_set_t *set, vartype *state )
+{
+    return *(set->slots + state_set_slot( set, state )) != NULL;
+}
+
+static void state_set_free( state_set_t *set )
+{
+    free( set->slots );
+    set->slots = NULL;
+}
+
+
+/* Index of the nodes of a strategy by state and goal mode, together
+   with the predecessors of each node.  Nodes are identified by their
+   position in the list when the index was built.  Modes are those at
+   that time, and keys are compared by mode first, so nodes of some
+   goal mode can be deleted (and their entries in nodes set to NULL)
+   once no more lookups are made for that mode. */
+typedef struct {
+    anode_t **nodes;
+    int *modes;
+    int *next;  /* Next position with the same state and mode, or -1 */
+    int *slots;  /* First position having some key, or -1 if empty */
+    size_t size;  /* Power of 2 */
+
+    /* Predecessors of node i are at preds[pred_offsets[i]] through
+       preds[pred_offsets[i+1]-1], once for each transition. */
+    int *pred_offsets;
+    int *preds;
+
+    int num_nodes;
+    int state_len;
+} patch_index_t;
+
+static size_t patch_index_slot( patch_index_t *index,
+                                int mode, vartype *state )
+{
+    size_t k = (patch_state_hash( state, index->state_len )
+                ^ (size_t)mode*2654435761u) & (index->size-1);
+    int p;
+    while ((p = *(index->slots+k)) >= 0) {
+        if (*(index->modes+p) == mode
+            && statecmp( (*(index->nodes+p))->state, state,
+                         index->state_len ))
+            break;
+        k = (k+1) & (index->size-1);
     }
+    return k;
+}
+
+static void patch_index_build( patch_index_t *index, anode_t *head,
+                               int state_len )
+{
+    aut_numbering_t *numbering;
+    anode_t *node;
+    int *fill;
+    size_t k;
+    int i, j, p;
+
+    index->num_nodes = aut_size( head );
+    index->state_len = state_len;
+    index->nodes = malloc( index->num_nodes*sizeof(anode_t *) );
+    index->modes = malloc( index->num_nodes*sizeof(int) );
+    index->next = malloc( index->num_nodes*sizeof(int) );
+    index->pred_offsets = malloc( (index->num_nodes+1)*sizeof(int) );
+    index->size = 16;
+    while (index->size < 2*(size_t)index->num_nodes)
+        index->size *= 2;
+    index->slots = malloc( index->size*sizeof(int) );
+    if (index->nodes == NULL || index->modes == NULL || index->next == NULL
+        || index->pred_offsets == NULL || index->slots == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (k = 0; k < index->size; k++)
+        *(index->slots+k) = -1;
+
+    for (node = head, i = 0; node; node = node->next, i++) {
+        *(index->nodes+i) = node;
+        *(index->modes+i) = node->mode;
+    }
+    /* Insert in reverse, so that each chain is in list order. */
+    for (i = index->num_nodes-1; i >= 0; i--) {
+        k = patch_index_slot( index, *(index->modes+i),
+                              (*(index->nodes+i))->state );
+        *(index->next+i) = *(index->slots+k);
+        *(index->slots+k) = i;
+    }
+
+    numbering = aut_number_nodes( head );
+    for (i = 0; i <= index->num_nodes; i++)
+        *(index->pred_offsets+i) = 0;
+    for (i = 0; i < index->num_nodes; i++) {
+        node = *(index->nodes+i);
+        for (j = 0; j < node->trans_len; j++) {
+            p = aut_numbering_index( numbering, *(node->trans+j) );
+            if (p >= 0)
+                (*(index->pred_offsets+p+1))++;
+        }
+    }
+    for (i = 0; i < index->num_nodes; i++)
+        *(index->pred_offsets+i+1) += *(index->pred_offsets+i);
+    index->preds = malloc( (*(index->pred_offsets+index->num_nodes)+1)
+                           *sizeof(int) );
+    fill = malloc( index->num_nodes*sizeof(int) );
+    if (index->preds == NULL || (fill == NULL && index->num_nodes > 0)) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < index->num_nodes; i++)
+        *(fill+i) = *(index->pred_offsets+i);
+    for (i = 0; i < index->num_nodes; i++) {
+        node = *(index->nodes+i);
+        for (j = 0; j < node->trans_len; j++) {
+            p = aut_numbering_index( numbering, *(node->trans+j) );
+            if (p >= 0)
+                *(index->preds + (*(fill+p))++) = i;
+        }
+    }
+    free( fill );
+    delete_aut_numbering( numbering );
+}
+
+/* Return the position of the first node with given state and mode, or
+   -1 if there is none.  Others follow through index->next. */
+static int patch_index_find( patch_index_t *index, int mode, vartype *state )
+{
+    return *(index->slots + patch_index_slot( index, mode, state ));
+}
+
+static void patch_index_free( patch_index_t *index )
+{
+    free( index->nodes );
+    free( index->modes );
+    free( index->next );
+    free( index->slots );
+    free( index->pred_offsets );
+    free( index->preds );
+}
+
+
+/* Replace transitions of node into old with new, or delete them if
+   new is NULL.  Unlike replace_anode_trans(), only node is visited. */
+static void replace_node_trans( anode_t *node, anode_t *old, anode_t *new )
+{
+    int i, j;
+    for (i = j = 0; i < node->trans_len; i++) {
+        if (*(node->trans+i) != old) {
+            *(node->trans+(j++)) = *(node->trans+i);
+        } else if (new != NULL) {
+            *(node->trans+(j++)) = new;
+        }
+    }
+    node->trans_len = j;
+    if (j == 0 && node->trans != NULL) {
+        free( node->trans );
+        node->trans = NULL;
+    }
+}
+
+/* Delete nodes having mode -2, in one pass.  Transitions into them
+   should already have been removed.  Return the (possibly new) head. */
+static anode_t *delete_marked_anodes( anode_t *head )
+{
+    anode_t *node, *prev = NULL;
+    node = head;
+    while (node) {
+        if (node->mode == -2) {
+            node = delete_anode( node, node );
+            if (prev == NULL) {
+                head = node;
+            } else {
+                prev->next = node;
+            }
+        } else {
+            prev = node;
+            node = node->next;
+        }
+    }
+    return head;
+}
+
+/* Append node to the array of affected nodes of its goal mode.
+   Arrays are grown geometrically, with capacity implied by length. */
+static void append_affected( anode_t ***affected, int *affected_len,
+                             anode_t *node )
+{
+    int len = *(affected_len + node->mode);
+    if ((len & (len-1)) == 0) {  /* len is 0 or a power of 2 */
+        *(affected + node->mode)
+            = realloc( *(affected + node->mode),
+                       sizeof(anode_t *)*(len == 0 ? 1 : 2*len) );
+        if (*(affected + node->mode) == NULL) {
+            perror( __FILE__ ",  realloc" );
+            exit(-1);
+        }
+    }
+    *(*(affected + node->mode) + len) = node;
+    (*(affected_len + node->mode))++;
+}
+
+/* Same as forward_modereach(), but with membership in N tested by
+   lookup in a set of states. */
+static void forward_modereach_set( anode_t *node, int mode, state_set_t *N_set,
+                                   int magic_mode )
+{
+    int i;
+    for (i = 0; i < node->trans_len; i++) {
+        if ((*(node->trans+i))->mode == mode
+            && state_set_member( N_set, (*(node->trans+i))->state )) {
+            (*(node->trans+i))->mode = magic_mode;
+            forward_modereach_set( *(node->trans+i), mode, N_set, magic_mode );
+        }
+    }
+}
+
+
+/* Entry and Exit sets of a goal mode to be patched, and the local
+   strategy from Entry to Exit */
+typedef struct {
+    int goal_mode;
+    anode_t **Entry;
+    int *Entry_pos;  /* Positions of Entry nodes in index */
+    int Entry_len;
+    anode_t **Exit;
+    int Exit_len;
+    int N_i_len;  /* Number of nodes of this goal mode with state in N */
+    /* Node with minimum reach annotation value among Entry and
+       affected nodes.  Its value is read when splicing because that
+       of earlier goal modes scales all values. */
+    anode_t *min_rgrad_node;
+    bool solved;  /* Whether local_strategy has been computed */
+    anode_t *local_strategy;
+} goalmode_patch_t;
+
+static void goalmode_patch_free( goalmode_patch_t *gp )
+{
+    free( gp->Entry );
+    free( gp->Entry_pos );
+    free( gp->Exit );
+    delete_aut( gp->local_strategy );
+    gp->Entry = gp->Exit = NULL;
+    gp->Entry_pos = NULL;
+    gp->local_strategy = NULL;
+}
+
+
+/* Build Entry and Exit sets for gp->goal_mode.  Return False if the
+   goal mode is unaffected by the change, and thus is not patched. */
+static bool localfixpoint_prepare( goalmode_patch_t *gp,
+                                   int num_env, int num_sys,
+                                   anode_t ***affected, int *affected_len,
+                                   vartype **N, int N_len,
+                                   state_set_t *N_set, patch_index_t *index,
+                                   unsigned char verbose )
+{
+    int i, j, p;  /* Generic counters */
+    int goal_mode = gp->goal_mode;
+    anode_t **Exit, **Entry;
+    int Exit_len, Entry_len;
+    int *Entry_pos;
+    anode_t *min_rgrad_node;
+    anode_t *node, *pred;
+    bool entry_found;
+
+    gp->Entry = gp->Exit = NULL;
+    gp->Entry_pos = NULL;
+    gp->local_strategy = NULL;
+    gp->solved = False;
+
+    /* Ignore goal modes that are unaffected by the change. */
+    if (*(affected_len + goal_mode) == 0)
+        return False;
 
     if (verbose)
         logprint( "Processing for goal mode %d...", goal_mode );
 
-    /* Build Entry set and initial Exit set */
+    /* Pre-allocate space for Entry and Exit sets, which are contained
+       in the nodes of this goal mode with state in N; the number of
+       elements actually used is tracked by Entry_len and Exit_len,
+       respectively. */
+    gp->N_i_len = 0;
+    for (i = 0; i < N_len; i++) {
+        for (p = patch_index_find( index, goal_mode, *(N+i) ); p >= 0;
+             p = *(index->next+p))
+            gp->N_i_len++;
+    }
+    Exit = malloc( sizeof(anode_t *)*(gp->N_i_len+1) );
+    Entry = malloc( sizeof(anode_t *)*(N_len+1) );
+    Entry_pos = malloc( sizeof(int)*(N_len+1) );
+    if (Exit == NULL || Entry == NULL || Entry_pos == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+
+    /* Build Entry set and initial Exit set.  Exit is every node of this
+       goal mode with state in N.  For each state in N, Entry includes
+       the first such node that has a predecessor of this goal mode
+       outside of N. */
     Exit_len = Entry_len = 0;
-    head = strategy;
-    while (head) {
-        /* Though we use linear search in N, if we could sort N
-           earlier, or somehow ensure the input (from the game
-           edge change file) is already ordered, then this could
-           be made into a binary search. */
-        if (head->mode == goal_mode) {
-            for (i = 0; i < N_len; i++)
-                if (statecmp( head->state, *(N+i), num_env+num_sys ))
+    for (i = 0; i < N_len; i++) {
+        entry_found = False;
+        for (p = patch_index_find( index, goal_mode, *(N+i) ); p >= 0;
+             p = *(index->next+p)) {
+            node = *(index->nodes+p);
+            *(Exit+(Exit_len++)) = node;
+            if (entry_found)
+                continue;
+            for (j = *(index->pred_offsets+p);
+                 j < *(index->pred_offsets+p+1); j++) {
+                pred = *(index->nodes + *(index->preds+j));
+                if (pred != NULL && pred->mode == goal_mode
+                    && !state_set_member( N_set, pred->state )) {
+                    *(Entry_pos+Entry_len) = p;
+                    *(Entry+(Entry_len++)) = node;
+                    entry_found = True;
                     break;
-
-            if (i < N_len) {  /* Was a match found? */
-                Exit_len++;
-                *(Exit+Exit_len-1) = head;
-            } else {
-                /* Test for nominal membership in Entry set; i.e.,
-                   current node is not in N, check if it leads into N. */
-                for (j = 0; j < head->trans_len; j++) {
-                    for (k = 0; k < N_len; k++)
-                        if ((*(head->trans+j))->mode == goal_mode
-                            && statecmp( (*(head->trans+j))->state, *(N+k),
-                                         num_env+num_sys ))
-                            break;
-                    if (k < N_len) {
-                        for (k = 0; k < Entry_len; k++)
-                            if (statecmp((*(Entry+k))->state,
-                                         (*(head->trans+j))->state,
-                                         num_env+num_sys ))
-                                break;
-                        if (k == Entry_len) {
-                            Entry_len++;
-                            *(Entry+Entry_len-1) = *(head->trans+j);
-                        }
-                    }
                 }
             }
         }
-        head = head->next;
     }
 
     /* Find minimum reach annotation value among nodes in the
        Entry and U_i sets, and remove any initial Exit nodes greater
        than or equal to it. */
-    min_rgrad = -1;
+    min_rgrad_node = NULL;
     for (i = 0; i < Entry_len; i++) {
-        if ((*(Entry+i))->rgrad < min_rgrad || min_rgrad == -1)
-            min_rgrad = (*(Entry+i))->rgrad;
+        if (min_rgrad_node == NULL
+            || (*(Entry+i))->rgrad < min_rgrad_node->rgrad)
+            min_rgrad_node = *(Entry+i);
     }
     for (i = 0; i < *(affected_len+goal_mode); i++) {
-        if ((*(*(affected+goal_mode)+i))->rgrad < min_rgrad || min_rgrad == -1)
-            min_rgrad = (*(*(affected+goal_mode)+i))->rgrad;
+        if (min_rgrad_node == NULL
+            || (*(*(affected+goal_mode)+i))->rgrad < min_rgrad_node->rgrad)
+            min_rgrad_node = *(*(affected+goal_mode)+i);
     }
     if (verbose)
         logprint( "Minimum reach annotation value in Entry or U_i: %d",
-                  min_rgrad );
+                  min_rgrad_node->rgrad );
     i = 0;
     while (i < Exit_len) {
-        if ((*(Exit+i))->rgrad >= min_rgrad) {
+        if ((*(Exit+i))->rgrad >= min_rgrad_node->rgrad) {
             if (Exit_len > 1) {
                 *(Exit+i) = *(Exit+Exit_len-1);
                 Exit_len--;
@@ -198,15 +589,183 @@ anode_t *localfixpoint_goalmode( DdManager *manager, int num_env, int num_sys,
         }
     }
 
-    local_strategy = synthesize_reachgame( manager, num_env, num_sys,
-                                           Entry, Entry_len, Exit, Exit_len,
-                                           etrans, strans, egoals, N_BDD,
-                                           verbose );
-    if (local_strategy == NULL) {
-        free( Exit );
-        free( Entry );
-        return NULL;
+    gp->Entry = Entry;
+    gp->Entry_pos = Entry_pos;
+    gp->Entry_len = Entry_len;
+    gp->Exit = Exit;
+    gp->Exit_len = Exit_len;
+    gp->min_rgrad_node = min_rgrad_node;
+    return True;
+}
+
+
+/* Reachability games of goal modes that are solved in one thread,
+   using a manager of its own */
+typedef struct {
+    DdManager *manager;
+    int num_env, num_sys;
+    DdNode *etrans, *strans, **egoals, *N_BDD;
+    goalmode_patch_t **gps;
+    int gps_len;
+} reach_worker_t;
+
+static void *reach_worker( void *arg )
+{
+    reach_worker_t *worker = (reach_worker_t *)arg;
+    goalmode_patch_t *gp;
+    int i;
+    for (i = 0; i < worker->gps_len; i++) {
+        gp = *(worker->gps+i);
+        gp->local_strategy = synthesize_reachgame( worker->manager,
+                                                   worker->num_env,
+                                                   worker->num_sys,
+                                                   gp->Entry, gp->Entry_len,
+                                                   gp->Exit, gp->Exit_len,
+                                                   worker->etrans,
+                                                   worker->strans,
+                                                   worker->egoals,
+                                                   worker->N_BDD, 0 );
+        gp->solved = True;
+        if (gp->local_strategy == NULL)
+            break;
+    }
+    return NULL;
+}
+
+/* Solve the reachability games of the goal modes in gps that are to
+   be patched, in up to num_threads threads.  The games only depend on
+   states of Entry and Exit nodes, so they can be solved before any of
+   the local strategies are connected to the original.  Goal modes are
+   left unsolved if only one thread would be used. */
+static void solve_reachgames( DdManager *manager, int num_env, int num_sys,
+                              goalmode_patch_t *gps, int num_gps,
+                              DdNode *etrans, DdNode *strans,
+                              DdNode **egoals, DdNode *N_BDD,
+                              unsigned char verbose )
+{
+    reach_worker_t *workers;
+    DdNode **vars, **pvars;
+    int num_workers, num_patched;
+    int i, j;
+
+    num_patched = 0;
+    for (i = 0; i < num_gps; i++) {
+        if ((gps+i)->Entry != NULL)
+            num_patched++;
+    }
+    num_workers = (num_threads < num_patched) ? num_threads : num_patched;
+    if (num_workers <= 1)
+        return;
+    if (verbose)
+        logprint( "Solving reachability games of %d goal modes in %d threads...",
+                  num_patched, num_workers );
+
+    workers = malloc( num_workers*sizeof(reach_worker_t) );
+    vars = malloc( (num_env+num_sys)*sizeof(DdNode *) );
+    pvars = malloc( (num_env+num_sys)*sizeof(DdNode *) );
+    if (workers == NULL || vars == NULL || pvars == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+
+    /* Each worker gets a copy of the transition rules and goals. */
+    for (i = 0; i < num_workers; i++) {
+        (workers+i)->manager = worker_manager( manager,
+                                               2*(num_env+num_sys) );
+        for (j = 0; j < num_env+num_sys; j++) {
+            *(vars+j) = Cudd_bddIthVar( (workers+i)->manager, j );
+            *(pvars+j) = Cudd_bddIthVar( (workers+i)->manager,
+                                         j+num_env+num_sys );
+        }
+        if (!Cudd_SetVarMap( (workers+i)->manager, vars, pvars,
+                             num_env+num_sys )) {
+            fprintf( stderr,
+                     "Error: failed to define variable map in CUDD"
+                     " manager.\n" );
+            exit(-1);
+        }
+
+        (workers+i)->num_env = num_env;
+        (workers+i)->num_sys = num_sys;
+        (workers+i)->etrans = Cudd_bddTransfer( manager, (workers+i)->manager,
+                                                etrans );
+        Cudd_Ref( (workers+i)->etrans );
+        (workers+i)->strans = Cudd_bddTransfer( manager, (workers+i)->manager,
+                                                strans );
+        Cudd_Ref( (workers+i)->strans );
+        (workers+i)->N_BDD = Cudd_bddTransfer( manager, (workers+i)->manager,
+                                               N_BDD );
+        Cudd_Ref( (workers+i)->N_BDD );
+        (workers+i)->egoals = malloc( (spc.num_egoals+1)*sizeof(DdNode *) );
+        (workers+i)->gps = malloc( num_patched*sizeof(goalmode_patch_t *) );
+        if ((workers+i)->egoals == NULL || (workers+i)->gps == NULL) {
+            perror( __FILE__ ",  malloc" );
+            exit(-1);
+        }
+        for (j = 0; j < spc.num_egoals; j++) {
+            *((workers+i)->egoals+j) = Cudd_bddTransfer( manager,
+                                                         (workers+i)->manager,
+                                                         *(egoals+j) );
+            Cudd_Ref( *((workers+i)->egoals+j) );
+        }
+        (workers+i)->gps_len = 0;
+    }
+    free( vars );
+    free( pvars );
+
+    /* Goal modes are dealt to workers in turn. */
+    j = 0;
+    for (i = 0; i < num_gps; i++) {
+        if ((gps+i)->Entry == NULL)
+            continue;
+        *((workers+j)->gps + (workers+j)->gps_len++) = gps+i;
+        j = (j+1) % num_workers;
+    }
+
+    run_workers( reach_worker, workers, sizeof(reach_worker_t), num_workers );
+
+    for (i = 0; i < num_workers; i++) {
+        Cudd_RecursiveDeref( (workers+i)->manager, (workers+i)->etrans );
+        Cudd_RecursiveDeref( (workers+i)->manager, (workers+i)->strans );
+        Cudd_RecursiveDeref( (workers+i)->manager, (workers+i)->N_BDD );
+        for (j = 0; j < spc.num_egoals; j++)
+            Cudd_RecursiveDeref( (workers+i)->manager,
+                                 *((workers+i)->egoals+j) );
+        free( (workers+i)->egoals );
+        free( (workers+i)->gps );
+        Cudd_Quit( (workers+i)->manager );
     }
+    free( workers );
+}
+
+
+/* Connect the local strategy of gp to the original strategy, and
+   delete the nodes of gp->goal_mode that it replaces.  Return the
+   patched strategy, or NULL if error. */
+static anode_t *localfixpoint_splice( anode_t *strategy, goalmode_patch_t *gp,
+                                      int num_env, int num_sys,
+                                      vartype **N, int N_len,
+                                      state_set_t *N_set,
+                                      patch_index_t *index,
+                                      unsigned char verbose )
+{
+    int i, j, p;  /* Generic counters */
+    int goal_mode = gp->goal_mode;
+    anode_t **Exit = gp->Exit;
+    anode_t **Entry = gp->Entry;
+    int Exit_len = gp->Exit_len, Entry_len = gp->Entry_len;
+    int min_rgrad;
+    int *dead, dead_len;  /* Positions of deleted nodes in index */
+    anode_t *local_strategy;
+    anode_t *head, *node, *pred;
+    int Exit_rgrad;  /* Maximum value among reached Exit nodes. */
+    int local_max_rgrad;
+    int local_min_rgrad;
+
+    local_strategy = gp->local_strategy;
+    if (local_strategy == NULL)
+        return NULL;
+    min_rgrad = gp->min_rgrad_node->rgrad;
 
     if (verbose > 1) {
         logprint( "Local strategy for goal mode %d:", goal_mode );
@@ -240,7 +799,15 @@ anode_t *localfixpoint_goalmode( DdManager *manager, int num_env, int num_sys,
             return NULL;
         }
 
-        replace_anode_trans( strategy, *(Entry+i), node );
+        /* Only predecessors in the original strategy can lead into
+           an Entry node, so those listed in the index suffice. */
+        p = *(gp->Entry_pos+i);
+        for (j = *(index->pred_offsets+p);
+             j < *(index->pred_offsets+p+1); j++) {
+            pred = *(index->nodes + *(index->preds+j));
+            if (pred != NULL)
+                replace_node_trans( pred, *(Entry+i), node );
+        }
     }
 
     Exit_rgrad = -1;
@@ -264,15 +831,7 @@ anode_t *localfixpoint_goalmode( DdManager *manager, int num_env, int num_sys,
             if ((*(Exit+i))->rgrad > Exit_rgrad)
                 Exit_rgrad = (*(Exit+i))->rgrad;
 
-            if (forward_modereach( *(Exit+i), goal_mode, N, N_len,
-                                   -1, num_env+num_sys )) {
-                fprintf( stderr,
-                         "Error localfixpoint_goalmode: forward graph"
-                         " reachability computation failed\nfrom Exit node"
-                         " in goal mode %d\n",
-                         goal_mode );
-                return NULL;
-            }
+            forward_modereach_set( *(Exit+i), goal_mode, N_set, -1 );
 
             (*(Exit+i))->mode = -1;
             node->mode = -2;  /* Mark as to-be-deleted */
@@ -283,41 +842,39 @@ anode_t *localfixpoint_goalmode( DdManager *manager, int num_env, int num_sys,
     }
 
     /* Delete useless nodes from N_i (whose function is now replaced
-       by the local strategy). */
-    node = strategy;
-    while (node) {
-        if (node->mode != goal_mode) {
-            if (node->mode == -1)
-                node->mode = goal_mode;
-            node = node->next;
-            continue;
-        }
-        for (i = 0; i < N_len; i++)
-            if (statecmp( node->state, *(N+i), num_env+num_sys ))
-                break;
-        if (i < N_len)
-            node->mode = -2;
-        node = node->next;
-    }
-    node = strategy;
-    while (node) {
-        if (node->mode == -2) {
-            replace_anode_trans( strategy, node, NULL );
-            strategy = delete_anode( strategy, node );
-            node = strategy;
-        } else {
-            node = node->next;
-        }
+       by the local strategy).  Nodes marked -1 by reachability from
+       Exit nodes are kept; all of them have state in N.  Entries in
+       the index are cleared only after the last lookup for this goal
+       mode, because lookups compare states of nodes in the index. */
+    dead = malloc( sizeof(int)*(gp->N_i_len+1) );
+    if (dead == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
     }
-    node = local_strategy;
-    while (node) {
-        if (node->mode == -2) {
-            local_strategy = delete_anode( local_strategy, node );
-            node = local_strategy;
-        } else {
-            node = node->next;
+    dead_len = 0;
+    for (i = 0; i < N_len; i++) {
+        for (p = patch_index_find( index, goal_mode, *(N+i) ); p >= 0;
+             p = *(index->next+p)) {
+            node = *(index->nodes+p);
+            if (node->mode == -1) {
+                node->mode = goal_mode;
+            } else if (node->mode == goal_mode) {
+                node->mode = -2;
+                *(dead+(dead_len++)) = p;
+                for (j = *(index->pred_offsets+p);
+                     j < *(index->pred_offsets+p+1); j++) {
+                    pred = *(index->nodes + *(index->preds+j));
+                    if (pred != NULL)
+                        replace_node_trans( pred, node, NULL );
+                }
+            }
         }
     }
+    for (i = 0; i < dead_len; i++)
+        *(index->nodes + *(dead+i)) = NULL;
+    free( dead );
+    strategy = delete_marked_anodes( strategy );
+    local_strategy = delete_marked_anodes( local_strategy );
 
     /* Scale reach annotation values to make room for patch. */
     i = 1;
@@ -340,24 +897,133 @@ anode_t *localfixpoint_goalmode( DdManager *manager, int num_env, int num_sys,
     while (head->next)
         head = head->next;
     head->next = local_strategy;
+    gp->local_strategy = NULL;
+
+    return strategy;
+}
+
 
-    free( Entry );
-    free( Exit );
+/* Read strategy and expand nonboolean variables, as required by
+   patch_batch().  Return NULL on error. */
+static anode_t *load_expanded_strategy( FILE *strategy_fp,
+                                        int original_num_env,
+                                        int original_num_sys,
+                                        unsigned char verbose )
+{
+    anode_t *strategy;
+
+    if (strategy_fp == NULL)
+        strategy_fp = stdin;
+
+    strategy = aut_aut_load( original_num_env+original_num_sys, strategy_fp );
+    if (strategy == NULL) {
+        return NULL;
+    }
+    if (verbose)
+        logprint( "Read in strategy of size %d", aut_size( strategy ) );
+
+    if (spc.nonbool_var_list != NULL) {
+        if (verbose > 1)
+            logprint( "Expanding nonbool variables in the given strategy"
+                      " automaton..." );
+        if (aut_expand_bool( strategy,
+                             spc.evar_list, spc.svar_list, spc.nonbool_var_list )) {
+            fprintf( stderr,
+                     "Error patch_localfixpoint: Failed to expand"
+                     " nonboolean variables in given automaton." );
+            delete_aut( strategy );
+            return NULL;
+        }
+        if (verbose > 1) {
+            logprint( "Given strategy after variable expansion:" );
+            logprint_startline();
+            dot_aut_dump( strategy, spc.evar_list, spc.svar_list, DOT_AUT_ATTRIB,
+                          getlogstream() );
+            logprint_endline();
+        }
+    }
 
     return strategy;
 }
 
 
+/* Restrict (conjoin with C) or relax (disjoin with C) the transition
+   rule *trans.  If mod is not NULL, then also update the accumulated
+   changes, where mod[0] and mod[1] represent the rule (T & mod[0]) |
+   mod[1] obtained from the original rule T. */
+static void change_trans( DdManager *manager, DdNode **trans, DdNode **mod,
+                          DdNode *C, bool relax )
+{
+    DdNode *tmp;
+    int i;
+
+    if (relax) {
+        tmp = Cudd_bddOr( manager, *trans, C );
+    } else {
+        tmp = Cudd_bddAnd( manager, *trans, C );
+    }
+    Cudd_Ref( tmp );
+    Cudd_RecursiveDeref( manager, *trans );
+    *trans = tmp;
+
+    if (mod == NULL)
+        return;
+    for (i = (relax ? 1 : 0); i < 2; i++) {
+        if (relax) {
+            tmp = Cudd_bddOr( manager, *(mod+i), C );
+        } else {
+            tmp = Cudd_bddAnd( manager, *(mod+i), C );
+        }
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, *(mod+i) );
+        *(mod+i) = tmp;
+    }
+}
+
+
+/* Record the change of edges C of a transition rule, where *removed
+   and *added represent the rule (T & !*removed) | *added obtained from
+   the original rule T.  Edges C are removed if relax is False, else
+   they are added.  Thus the edits of a change file compose into one
+   change of the rule, which is made by change_trans() after all edits
+   are read. */
+static void edit_edges( DdManager *manager, DdNode **removed, DdNode **added,
+                        DdNode *C, bool relax )
+{
+    DdNode *tmp;
+
+    if (!relax) {
+        tmp = Cudd_bddOr( manager, *removed, C );
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, *removed );
+        *removed = tmp;
+        tmp = Cudd_bddAnd( manager, *added, Cudd_Not( C ) );
+    } else {
+        tmp = Cudd_bddOr( manager, *added, C );
+    }
+    Cudd_Ref( tmp );
+    Cudd_RecursiveDeref( manager, *added );
+    *added = tmp;
+}
+
+
+/* Apply the game changes read from change_fp to the strategy
+   *strategy, which has nonboolean variables expanded.  If emod and
+   smod are not NULL, then the local environment and system
+   transition rules are first changed as they describe (cf.
+   change_trans()), and on success, they are updated to include the
+   changes from change_fp.  Return 0 on success, -1 on error before
+   the strategy is changed (e.g., if change_fp is malformed), or -2 if
+   patching fails after *strategy may have been partially modified. */
 #define INPUT_STRING_LEN 1024
-anode_t *patch_localfixpoint( DdManager *manager,
-                              FILE *strategy_fp, FILE *change_fp,
-                              int original_num_env, int original_num_sys,
-                              ptree_t *nonbool_var_list, int *offw,
-                              unsigned char verbose )
+static int patch_batch( DdManager *manager, anode_t **strategy_p,
+                        FILE *change_fp,
+                        int original_num_env, int original_num_sys,
+                        int *offw, DdNode **emod, DdNode **smod,
+                        unsigned char verbose )
 {
     ptree_t *var_separator;
-    DdNode *etrans, *strans, **egoals;
-    DdNode *etrans_part, *strans_part;
+    DdNode *etrans = NULL, *strans = NULL, **egoals = NULL;
     int num_env, num_sys;
     int num_nonbool;
     int num_enonbool;  /* Number of env variables with nonboolean domain */
@@ -372,13 +1038,22 @@ anode_t *patch_localfixpoint( DdManager *manager,
     bool env_nogoal_flag = False;  /* Indicate environment has no goals */
 
     int i, j, k;  /* Generic counters */
-    DdNode *tmp, *tmp2;
+    DdNode *tmp;
     int num_read;
     anode_t *strategy, *result_strategy;
-    anode_t *node, *head;
+    int status = -1;
+
+    /* Changes of transition rules, including those read from change_fp */
+    DdNode *emod_buf[2], *smod_buf[2];
+    DdNode **emod_next = NULL, **smod_next = NULL;
+    anode_t *node;
     vartype **N = NULL;  /* "neighborhood" of states */
     int N_len = 0;
+    state_set_t N_set;
+    patch_index_t index;
+    bool indexed = False;  /* Whether index has been built */
     int goal_mode;
+    goalmode_patch_t *gps;
     DdNode *N_BDD = NULL;  /* Characteristic function for set of states N. */
     bool break_flag;
 
@@ -388,46 +1063,27 @@ anode_t *patch_localfixpoint( DdManager *manager,
                                     manuscript. */
     int *affected_len = NULL;  /* Lengths of arrays in affected */
 
+    /* Edges removed from and added to the local transition rules by
+       change_fp (cf. edit_edges()) */
+    DdNode *eremoved = NULL, *eadded = NULL;
+    DdNode *sremoved = NULL, *sadded = NULL;
+    char *is_affected = NULL;  /* Whether node at each position of index
+                                  is in affected */
+    vartype **blocked = NULL;  /* System parts of states named by
+                                  blocksys commands */
+    int blocked_len = 0;
+    state_set_t blocked_set;
+
     DdNode **vars, **pvars;
-    int *cube;
     DdNode *ddval;
 
-    if (change_fp == NULL)
-        return NULL;  /* Require game changes to be listed in an open stream. */
-
-    if (strategy_fp == NULL)
-        strategy_fp = stdin;
-
+    strategy = *strategy_p;
+    N_set.slots = NULL;
     num_env = tree_size( spc.evar_list );
     num_sys = tree_size( spc.svar_list );
 
-    strategy = aut_aut_load( original_num_env+original_num_sys, strategy_fp );
-    if (strategy == NULL) {
-        return NULL;
-    }
-    if (verbose)
-        logprint( "Read in strategy of size %d", aut_size( strategy ) );
-
     num_nonbool = tree_size( spc.nonbool_var_list );
     if (num_nonbool > 0) {
-        if (verbose > 1)
-            logprint( "Expanding nonbool variables in the given strategy"
-                      " automaton..." );
-        if (aut_expand_bool( strategy,
-                             spc.evar_list, spc.svar_list, spc.nonbool_var_list )) {
-            fprintf( stderr,
-                     "Error patch_localfixpoint: Failed to expand"
-                     " nonboolean variables in given automaton." );
-            return NULL;
-        }
-        if (verbose > 1) {
-            logprint( "Given strategy after variable expansion:" );
-            logprint_startline();
-            dot_aut_dump( strategy, spc.evar_list, spc.svar_list, DOT_AUT_ATTRIB,
-                          getlogstream() );
-            logprint_endline();
-        }
-
         num_enonbool = 0;
         while (*(offw+2*num_enonbool) < num_env)
             num_enonbool++;
@@ -456,12 +1112,6 @@ anode_t *patch_localfixpoint( DdManager *manager,
         *(affected_len+i) = 0;
     }
 
-    cube = (int *)malloc( sizeof(int)*2*(num_env+num_sys) );
-    if (cube == NULL) {
-        perror( __FILE__ ",  malloc" );
-        exit(-1);
-    }
-
     /* Set environment goal to True (i.e., any state) if none was
        given. This simplifies the implementation below. */
     if (spc.num_egoals == 0) {
@@ -486,34 +1136,32 @@ anode_t *patch_localfixpoint( DdManager *manager,
             break_flag = True;
             break;
         } else if (num_read < original_num_env+original_num_sys) {
+            free( state );
             fprintf( stderr,
                      "Error patch_localfixpoint: malformed game change"
                      " file.\n" );
-            free( doffw );
-            free( affected );
-            free( affected_len );
-            free( cube );
-            return NULL;
+            goto gc;
         }
 
         N_len++;
-        N = realloc( N, sizeof(vartype *)*N_len );
-        if (N == NULL) {
-            perror( __FILE__ ",  realloc" );
-            exit(-1);
+        if ((N_len & (N_len-1)) == 0) {  /* N_len is a power of 2 */
+            N = realloc( N, sizeof(vartype *)*2*N_len );
+            if (N == NULL) {
+                perror( __FILE__ ",  realloc" );
+                exit(-1);
+            }
         }
         if (num_nonbool > 0) {
-            *(N+N_len-1) = expand_nonbool_state( state, offw, num_nonbool,
+            /* Only the binary encoding is supported when patching. */
+            *(N+N_len-1) = expand_nonbool_state( state, offw, NULL,
+                                                 num_nonbool,
                                                  num_env+num_sys );
             if (*(N+N_len-1) == NULL) {
+                free( state );
                 fprintf( stderr,
                          "Error patch_localfixpoint: failed to expand"
                          " nonbool values in edge change file\n" );
-                free( doffw );
-                free( affected );
-                free( affected_len );
-                free( cube );
-                return NULL;
+                goto gc;
             }
             free( state );
         } else {
@@ -521,6 +1169,29 @@ anode_t *patch_localfixpoint( DdManager *manager,
         }
     }
 
+    /* Drop repeated states of N, and index the strategy so that nodes
+       with state in N, and their predecessors, are found without
+       searching the whole strategy. */
+    state_set_init( &N_set, N_len, num_env+num_sys );
+    j = 0;
+    for (i = 0; i < N_len; i++) {
+        if (state_set_add( &N_set, *(N+i) )) {
+            *(N+(j++)) = *(N+i);
+        } else {
+            free( *(N+i) );
+        }
+    }
+    N_len = j;
+    patch_index_build( &index, strategy, num_env+num_sys );
+    indexed = True;
+    is_affected = malloc( (index.num_nodes+1)*sizeof(char) );
+    if (is_affected == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < index.num_nodes; i++)
+        *(is_affected+i) = 0;
+
     if (verbose) {
         logprint( "States in N (%d total):", N_len );
         for (i = 0; i < N_len; i++) {
@@ -555,138 +1226,58 @@ anode_t *patch_localfixpoint( DdManager *manager,
             fprintf( stderr,
                      "Error: get_list_item failed on environment variables"
                      " list.\n" );
-            free( doffw );
-            free( affected );
-            free( affected_len );
-            free( cube );
-            return NULL;
+            goto gc;
         }
         var_separator->left = spc.svar_list;
     }
 
     /* Generate BDDs for parse trees from the problem spec transition
        rules that are relevant given restriction to N. */
-    if (verbose)
-        logprint( "Building local environment transition BDD..." );
-    etrans = Cudd_ReadOne( manager );
-    Cudd_Ref( etrans );
+    trans_cache_fill( &etrans_cache, manager,
+                      spc.env_trans_array, spc.et_array_len, spc.evar_list );
+    trans_cache_fill( &strans_cache, manager,
+                      spc.sys_trans_array, spc.st_array_len, spc.evar_list );
     if (verbose) {
+        logprint( "Building local environment transition BDD..." );
         logprint_startline();
         logprint_raw( "Relevant env trans (one per line):" );
     }
-    for (i = 0; i < spc.et_array_len; i++) {
-        etrans_part = ptree_BDD( *(spc.env_trans_array+i), spc.evar_list, manager );
-        for (j = 0; j < N_len; j++) {
-            for (k = 0; k < num_env+num_sys; k++) {
-                *(cube+k) = *(*(N+j)+k);
-                *(cube+num_env+num_sys+k) = 2;
-            }
-            ddval = Cudd_CubeArrayToBdd( manager, cube );
-            if (ddval == NULL) {
-                fprintf( stderr,
-                         "Error patch_localfixpoint: building characteristic"
-                         " function of N." );
-                return NULL;
-            }
-            Cudd_Ref( ddval );
-
-            tmp2 = Cudd_Cofactor( manager, etrans_part, ddval );
-            if (tmp2 == NULL) {
-                fprintf( stderr,
-                         "Error patch_localfixpoint: computing cofactor." );
-                return NULL;
-            }
-            Cudd_Ref( tmp2 );
-
-            if (!Cudd_bddLeq( manager, tmp2, Cudd_ReadOne( manager ) )
-                || !Cudd_bddLeq( manager, Cudd_ReadOne( manager ), tmp2 )) {
-                Cudd_RecursiveDeref( manager, tmp2 );
-                Cudd_RecursiveDeref( manager, ddval );
-                break;
-            }
-
-            Cudd_RecursiveDeref( manager, tmp2 );
-            Cudd_RecursiveDeref( manager, ddval );
-        }
-        if (j < N_len) {
-            if (verbose) {
-                logprint_raw( "\n" );
-                print_formula( *(spc.env_trans_array+i), getlogstream(),
-                               FORMULA_SYNTAX_GR1C );
-            }
-            tmp = Cudd_bddAnd( manager, etrans, etrans_part );
-            Cudd_Ref( tmp );
-            Cudd_RecursiveDeref( manager, etrans );
-            etrans = tmp;
-        }
-        Cudd_RecursiveDeref( manager, etrans_part );
-
-    }
+    etrans = local_trans( manager, &etrans_cache, N_BDD, verbose );
     if (verbose) {
         logprint_endline();
         logprint( "Done." );
         logprint( "Building local system transition BDD..." );
-    }
-
-    strans = Cudd_ReadOne( manager );
-    Cudd_Ref( strans );
-    if (verbose) {
         logprint_startline();
         logprint_raw( "Relevant sys trans (one per line):" );
     }
-    for (i = 0; i < spc.st_array_len; i++) {
-        strans_part = ptree_BDD( *(spc.sys_trans_array+i), spc.evar_list, manager );
-        for (j = 0; j < N_len; j++) {
-            for (k = 0; k < num_env+num_sys; k++) {
-                *(cube+k) = *(*(N+j)+k);
-                *(cube+num_env+num_sys+k) = 2;
-            }
-            ddval = Cudd_CubeArrayToBdd( manager, cube );
-            if (ddval == NULL) {
-                fprintf( stderr,
-                         "Error patch_localfixpoint: building characteristic"
-                         " function of N." );
-                return NULL;
-            }
-            Cudd_Ref( ddval );
-
-            tmp2 = Cudd_Cofactor( manager, strans_part, ddval );
-            if (tmp2 == NULL) {
-                fprintf( stderr,
-                         "Error patch_localfixpoint: computing cofactor." );
-                return NULL;
-            }
-            Cudd_Ref( tmp2 );
-
-            if (!Cudd_bddLeq( manager, tmp2, Cudd_ReadOne( manager ) )
-                || !Cudd_bddLeq( manager, Cudd_ReadOne( manager ), tmp2 )) {
-                Cudd_RecursiveDeref( manager, tmp2 );
-                Cudd_RecursiveDeref( manager, ddval );
-                break;
-            }
-
-            Cudd_RecursiveDeref( manager, tmp2 );
-            Cudd_RecursiveDeref( manager, ddval );
-        }
-        if (j < N_len) {
-            if (verbose) {
-                logprint_raw( "\n" );
-                print_formula( *(spc.sys_trans_array+i), getlogstream(),
-                               FORMULA_SYNTAX_GR1C );
-            }
-            tmp = Cudd_bddAnd( manager, strans, strans_part );
-            Cudd_Ref( tmp );
-            Cudd_RecursiveDeref( manager, strans );
-            strans = tmp;
-        }
-        Cudd_RecursiveDeref( manager, strans_part );
-
-    }
+    strans = local_trans( manager, &strans_cache, N_BDD, verbose );
     if (verbose) {
         logprint_endline();
         logprint( "Done." );
     }
 
+    /* Changes from earlier patches */
+    if (emod != NULL && smod != NULL) {
+        emod_next = emod_buf;
+        smod_next = smod_buf;
+        for (i = 0; i < 2; i++) {
+            *(emod_next+i) = *(emod+i);
+            Cudd_Ref( *(emod_next+i) );
+            *(smod_next+i) = *(smod+i);
+            Cudd_Ref( *(smod_next+i) );
+        }
+        tmp = Cudd_bddAnd( manager, etrans, *emod );
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, etrans );
+        etrans = tmp;
+        change_trans( manager, &etrans, NULL, *(emod+1), True );
+        tmp = Cudd_bddAnd( manager, strans, *smod );
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, strans );
+        strans = tmp;
+        change_trans( manager, &strans, NULL, *(smod+1), True );
+    }
+
     /* Build goal BDDs, if present. */
     if (spc.num_egoals > 0) {
         egoals = malloc( spc.num_egoals*sizeof(DdNode *) );
@@ -702,7 +1293,18 @@ anode_t *patch_localfixpoint( DdManager *manager,
         var_separator->left = NULL;
     }
 
-    /* Was the earlier file loop broken because a command was discovered? */
+    /* Was the earlier file loop broken because a command was discovered?
+       All commands are read before the transition rules are changed,
+       and nodes affected by blocksys commands are found in one pass
+       over the strategy after reading. */
+    eremoved = Cudd_Not( Cudd_ReadOne( manager ) );
+    Cudd_Ref( eremoved );
+    eadded = Cudd_Not( Cudd_ReadOne( manager ) );
+    Cudd_Ref( eadded );
+    sremoved = Cudd_Not( Cudd_ReadOne( manager ) );
+    Cudd_Ref( sremoved );
+    sadded = Cudd_Not( Cudd_ReadOne( manager ) );
+    Cudd_Ref( sadded );
     if (break_flag) {
         do {
             /* Blank or comment line? */
@@ -731,32 +1333,34 @@ anode_t *patch_localfixpoint( DdManager *manager,
                     fprintf( stderr,
                              "Error: invalid arguments to restrict or relax"
                              " command.\n" );
-                    return NULL;
+                    goto gc;
                 }
 
                 if (num_nonbool > 0) {
                     if (num_read == 2*(original_num_env+original_num_sys)) {
-                        state = expand_nonbool_state( state_frag, doffw,
+                        state = expand_nonbool_state( state_frag, doffw, NULL,
                                                       2*num_nonbool,
                                                       2*(num_env+num_sys) );
                         if (state == NULL) {
+                            free( state_frag );
                             fprintf( stderr,
                                      "Error patch_localfixpoint: failed to"
                                      " expand nonbool values in edge change"
                                      " file\n" );
-                            return NULL;
+                            goto gc;
                         }
                         free( state_frag );
                     } else { /* num_read==2*original_num_env+original_num_sys */
-                        state = expand_nonbool_state( state_frag, doffw,
+                        state = expand_nonbool_state( state_frag, doffw, NULL,
                                                       num_nonbool+num_enonbool,
                                                       2*num_env+num_sys );
                         if (state == NULL) {
+                            free( state_frag );
                             fprintf( stderr,
                                      "Error patch_localfixpoint: failed to"
                                      " expand nonbool values in edge change"
                                      " file\n" );
-                            return NULL;
+                            goto gc;
                         }
                         free( state_frag );
                     }
@@ -789,45 +1393,20 @@ anode_t *patch_localfixpoint( DdManager *manager,
 
                 /* Find nodes in strategy that are affected by this change */
                 for (j = 0; j < spc.num_sgoals; j++) {
-                    node = find_anode( strategy, j, state, num_env+num_sys );
-                    while (node != NULL) {
+                    for (k = patch_index_find( &index, j, state ); k >= 0;
+                         k = *(index.next+k)) {
+                        node = *(index.nodes+k);
                         if (!strncmp( line, "restrict ", strlen( "restrict " ) )
                             && (num_read
                                 == 2*(original_num_env+original_num_sys))) {
                             for (i = 0; i < node->trans_len; i++) {
                                 if (statecmp( (*(node->trans+i))->state,
                                               state+num_env+num_sys,
-                                              num_env+num_sys )) {
-                                    (*(affected_len + node->mode))++;
-                                    *(affected + node->mode)
-                                        = realloc( *(affected + node->mode),
-                                                   sizeof(anode_t *)
-                                                   *(*(affected_len
-                                                       + node->mode)) );
-                                    if (*(affected + node->mode) == NULL) {
-                                        perror( __FILE__ ", "
-                                                " realloc" );
-                                        exit(-1);
-                                    }
-                                    /* If affected state is not in N,
-                                       then fail. */
-                                    for (i = 0; i < N_len; i++) {
-                                        if (statecmp( state, *(N+i),
-                                                      num_env+num_sys ))
-                                            break;
-                                    }
-                                    if (i == N_len) {
-                                        fprintf( stderr,
-                                                 "Error patch_localfixpoint:"
-                                                 " affected state not"
-                                                 " contained in N.\n" );
-                                        return NULL;
-                                    }
-                                    *(*(affected + node->mode)
-                                      + *(affected_len + node->mode)-1) = node;
+                                              num_env+num_sys ))
                                     break;
-                                }
                             }
+                            if (i == node->trans_len)
+                                continue;
                         } else if (!strncmp( line, "relax ", strlen("relax ") )
                                    && (num_read
                                        == 2*original_num_env+original_num_sys)
@@ -837,36 +1416,24 @@ anode_t *patch_localfixpoint( DdManager *manager,
                                               state+num_env+num_sys, num_env ))
                                     break;
                             }
-                            if (i == node->trans_len) {
-                                (*(affected_len + node->mode))++;
-                                *(affected + node->mode)
-                                    = realloc( *(affected + node->mode),
-                                               sizeof(anode_t *)
-                                               *(*(affected_len
-                                                   + node->mode)) );
-                                if (*(affected + node->mode) == NULL) {
-                                    perror( __FILE__ ",  realloc" );
-                                    exit(-1);
-                                }
-                                /* If affected state is not in N, then fail. */
-                                for (i = 0; i < N_len; i++) {
-                                    if (statecmp( state, *(N+i),
-                                                  num_env+num_sys ))
-                                        break;
-                                }
-                                if (i == N_len) {
-                                    fprintf( stderr,
-                                             "Error patch_localfixpoint:"
-                                             " affected state not contained"
-                                             " in N.\n" );
-                                    return NULL;
-                                }
-                                *(*(affected + node->mode)
-                                  + *(affected_len + node->mode)-1) = node;
-                            }
+                            if (i < node->trans_len)
+                                continue;
+                        } else {
+                            continue;
                         }
 
-                        node = find_anode( node->next, j, state, num_env+num_sys );
+                        /* If affected state is not in N, then fail. */
+                        if (!state_set_member( &N_set, state )) {
+                            free( state );
+                            fprintf( stderr,
+                                     "Error patch_localfixpoint: affected"
+                                     " state not contained in N.\n" );
+                            goto gc;
+                        }
+                        if (!*(is_affected+k)) {
+                            *(is_affected+k) = 1;
+                            append_affected( affected, affected_len, node );
+                        }
                     }
                 }
 
@@ -874,36 +1441,16 @@ anode_t *patch_localfixpoint( DdManager *manager,
                 vertex2 = state_to_BDD( manager, state+num_env+num_sys,
                                      num_env+num_sys,
                                      num_read-(num_env+num_sys) );
-                if (!strncmp( line, "restrict ", strlen( "restrict " ) )) {
-                    tmp = Cudd_Not( vertex2 );
-                    Cudd_Ref( tmp );
-                    Cudd_RecursiveDeref( manager, vertex2 );
-                    vertex2 = tmp;
-                    tmp = Cudd_bddOr( manager, Cudd_Not( vertex1 ), vertex2 );
-                } else { /* "relax " */
-                    tmp = Cudd_bddAnd( manager, vertex1, vertex2 );
-                }
+                tmp = Cudd_bddAnd( manager, vertex1, vertex2 );
                 Cudd_Ref( tmp );
                 Cudd_RecursiveDeref( manager, vertex1 );
                 Cudd_RecursiveDeref( manager, vertex2 );
                 if (num_read == 2*original_num_env+original_num_sys) {
-                    if (!strncmp( line, "restrict ", strlen( "restrict " ) )) {
-                        tmp2 = Cudd_bddAnd( manager, tmp, etrans );
-                    } else { /* "relax " */
-                        tmp2 = Cudd_bddOr( manager, tmp, etrans );
-                    }
-                    Cudd_Ref( tmp2 );
-                    Cudd_RecursiveDeref( manager, etrans );
-                    etrans = tmp2;
+                    edit_edges( manager, &eremoved, &eadded, tmp,
+                                !strncmp( line, "relax ", strlen( "relax " ) ) );
                 } else { /* num_read == 2*(original_num_env+original_num_sys) */
-                    if (!strncmp( line, "restrict ", strlen( "restrict " ) )) {
-                        tmp2 = Cudd_bddAnd( manager, tmp, strans );
-                    } else { /* "relax " */
-                        tmp2 = Cudd_bddOr( manager, tmp, strans );
-                    }
-                    Cudd_Ref( tmp2 );
-                    Cudd_RecursiveDeref( manager, strans );
-                    strans = tmp2;
+                    edit_edges( manager, &sremoved, &sadded, tmp,
+                                !strncmp( line, "relax ", strlen( "relax " ) ) );
                 }
                 Cudd_RecursiveDeref( manager, tmp );
                 free( state );
@@ -913,26 +1460,27 @@ anode_t *patch_localfixpoint( DdManager *manager,
                                            &state_frag, original_num_sys );
                 if (num_read != original_num_sys) {
                     if (num_read > 0)
-                        free( state );
+                        free( state_frag );
                     fprintf( stderr,
                              "Error: invalid arguments to blocksys"
                              " command.\n%d\n%s\n", num_read, line );
-                    return NULL;
+                    goto gc;
                 }
                 if (num_nonbool > 0) {
                     for (i = 0; i < num_nonbool-num_enonbool; i++)
                         *(offw+2*num_enonbool+2*i) -= num_env;
                     state = expand_nonbool_state( state_frag,
-                                                  offw+2*num_enonbool,
+                                                  offw+2*num_enonbool, NULL,
                                                   num_nonbool-num_enonbool,
                                                   num_sys );
                     for (i = 0; i < num_nonbool-num_enonbool; i++)
                         *(offw+2*num_enonbool+2*i) += num_env;
                     if (state == NULL) {
+                        free( state_frag );
                         fprintf( stderr,
                                  "Error patch_localfixpoint: failed to expand"
                                  " nonbool values in edge change file\n" );
-                        return NULL;
+                        goto gc;
                     }
                     free( state_frag );
                 } else {
@@ -945,65 +1493,70 @@ anode_t *patch_localfixpoint( DdManager *manager,
                     logprint_endline();
                 }
 
-                /* Find nodes in strategy that are affected by this change */
-                head = strategy;
-                while (head) {
-                    for (i = 0; i < head->trans_len; i++) {
-                        if (statecmp( state, (*(head->trans+i))->state+num_env,
-                                      num_sys )) {
-                            (*(affected_len + head->mode))++;
-                            *(affected + head->mode)
-                                = realloc( *(affected + head->mode),
-                                           sizeof(anode_t *)
-                                           *(*(affected_len + head->mode)) );
-                            if (*(affected + head->mode) == NULL) {
-                                perror( __FILE__ ",  realloc" );
-                                exit(-1);
-                            }
-                            /* If affected state is not in N, then fail. */
-                            for (i = 0; i < N_len; i++) {
-                                if (statecmp( head->state, *(N+i),
-                                              num_env+num_sys ))
-                                    break;
-                            }
-                            if (i == N_len) {
-                                fprintf( stderr,
-                                         "Error patch_localfixpoint: affected"
-                                         " state not contained in N.\n" );
-                                return NULL;
-                            }
-                            *(*(affected + head->mode)
-                              + *(affected_len + head->mode)-1) = head;
-                            break;
-                        }
-                    }
-                    head = head->next;
-                }
-
                 vertex2 = state_to_BDD( manager, state,
                                      2*num_env+num_sys, num_sys );
-                tmp = Cudd_Not( vertex2 );
-                Cudd_Ref( tmp );
+                edit_edges( manager, &sremoved, &sadded, vertex2, False );
                 Cudd_RecursiveDeref( manager, vertex2 );
-                vertex2 = tmp;
-
-                tmp = Cudd_bddAnd( manager, strans, vertex2 );
-                Cudd_Ref( tmp );
-                Cudd_RecursiveDeref( manager, strans );
-                strans = tmp;
 
-                Cudd_RecursiveDeref( manager, vertex2 );
-                free( state );
+                /* Nodes affected by this change are found after all
+                   commands are read. */
+                blocked_len++;
+                if ((blocked_len & (blocked_len-1)) == 0) {
+                    blocked = realloc( blocked,
+                                       sizeof(vartype *)*2*blocked_len );
+                    if (blocked == NULL) {
+                        perror( __FILE__ ",  realloc" );
+                        exit(-1);
+                    }
+                }
+                *(blocked+blocked_len-1) = state;
 
             } else {
                 fprintf( stderr,
                          "Error patch_localfixpoint: unrecognized line in"
                          " given edge change file.\n" );
-                return NULL;
+                goto gc;
             }
         } while (fgets( line, INPUT_STRING_LEN, change_fp ));
     }
 
+    /* Find nodes in strategy that are affected by blocksys commands */
+    if (blocked_len > 0) {
+        state_set_init( &blocked_set, blocked_len, num_sys );
+        for (i = 0; i < blocked_len; i++)
+            state_set_add( &blocked_set, *(blocked+i) );
+        for (k = 0; k < index.num_nodes; k++) {
+            node = *(index.nodes+k);
+            if (*(is_affected+k))
+                continue;
+            for (i = 0; i < node->trans_len; i++) {
+                if (state_set_member( &blocked_set,
+                                      (*(node->trans+i))->state+num_env ))
+                    break;
+            }
+            if (i == node->trans_len)
+                continue;
+
+            /* If affected state is not in N, then fail. */
+            if (!state_set_member( &N_set, node->state )) {
+                fprintf( stderr,
+                         "Error patch_localfixpoint: affected"
+                         " state not contained in N.\n" );
+                state_set_free( &blocked_set );
+                goto gc;
+            }
+            *(is_affected+k) = 1;
+            append_affected( affected, affected_len, node );
+        }
+        state_set_free( &blocked_set );
+    }
+
+    /* Change the local transition rules once for the whole batch. */
+    change_trans( manager, &etrans, emod_next, Cudd_Not( eremoved ), False );
+    change_trans( manager, &etrans, emod_next, eadded, True );
+    change_trans( manager, &strans, smod_next, Cudd_Not( sremoved ), False );
+    change_trans( manager, &strans, smod_next, sadded, True );
+
     /* Define a map in the manager to easily swap variables with their
        primed selves. */
     vars = malloc( (num_env+num_sys)*sizeof(DdNode *) );
@@ -1015,55 +1568,205 @@ anode_t *patch_localfixpoint( DdManager *manager,
     if (!Cudd_SetVarMap( manager, vars, pvars, num_env+num_sys )) {
         fprintf( stderr,
                  "Error: failed to define variable map in CUDD manager.\n" );
-        return NULL;
+        free( vars );
+        free( pvars );
+        goto gc;
     }
     free( vars );
     free( pvars );
 
+    gps = malloc( spc.num_sgoals*sizeof(goalmode_patch_t) );
+    if (gps == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
     for (goal_mode = 0; goal_mode < spc.num_sgoals; goal_mode++) {
+        (gps+goal_mode)->goal_mode = goal_mode;
+        localfixpoint_prepare( gps+goal_mode, num_env, num_sys,
+                               affected, affected_len, N, N_len,
+                               &N_set, &index, verbose );
+    }
+    solve_reachgames( manager, num_env, num_sys, gps, spc.num_sgoals,
+                      etrans, strans, egoals, N_BDD, verbose );
 
-        result_strategy = localfixpoint_goalmode( manager, num_env, num_sys,
-                                                  strategy, goal_mode,
-                                                  affected, affected_len,
-                                                  etrans, strans, egoals,
-                                                  N_BDD, N, N_len,
-                                                  verbose );
+    for (goal_mode = 0; goal_mode < spc.num_sgoals; goal_mode++) {
+        if ((gps+goal_mode)->Entry == NULL)
+            continue;
+        if (!(gps+goal_mode)->solved) {
+            (gps+goal_mode)->local_strategy
+                = synthesize_reachgame( manager, num_env, num_sys,
+                                        (gps+goal_mode)->Entry,
+                                        (gps+goal_mode)->Entry_len,
+                                        (gps+goal_mode)->Exit,
+                                        (gps+goal_mode)->Exit_len,
+                                        etrans, strans, egoals, N_BDD,
+                                        verbose );
+            (gps+goal_mode)->solved = True;
+        }
+        result_strategy = localfixpoint_splice( strategy, gps+goal_mode,
+                                                num_env, num_sys, N, N_len,
+                                                &N_set, &index, verbose );
         if (result_strategy == NULL)
             break;
         strategy = result_strategy;
     }
+    for (i = 0; i < spc.num_sgoals; i++)
+        goalmode_patch_free( gps+i );
+    free( gps );
 
-    if (goal_mode != spc.num_sgoals) {  /* Did a local patching attempt fail? */
-        delete_aut( strategy );
-        strategy = NULL;
-    } else {
+    status = -2;
+    if (goal_mode == spc.num_sgoals) {  /* Did all local patching succeed? */
         strategy = aut_prune_deadends( strategy );
+        if (strategy != NULL)
+            status = 0;
     }
-
-
-    /* Pre-exit clean-up */
-    free( cube );
-    Cudd_RecursiveDeref( manager, etrans );
-    Cudd_RecursiveDeref( manager, strans );
-    for (i = 0; i < spc.num_egoals; i++)
-        Cudd_RecursiveDeref( manager, *(egoals+i) );
-    if (spc.num_egoals > 0)
+    /* The "gc" label abbreviates "garbage collection". */
+  gc:
+    if (emod_next != NULL) {
+        for (i = 0; i < 2; i++) {
+            if (status == 0) {
+                Cudd_RecursiveDeref( manager, *(emod+i) );
+                *(emod+i) = *(emod_next+i);
+                Cudd_RecursiveDeref( manager, *(smod+i) );
+                *(smod+i) = *(smod_next+i);
+            } else {
+                Cudd_RecursiveDeref( manager, *(emod_next+i) );
+                Cudd_RecursiveDeref( manager, *(smod_next+i) );
+            }
+        }
+    }
+    if (etrans != NULL)
+        Cudd_RecursiveDeref( manager, etrans );
+    if (strans != NULL)
+        Cudd_RecursiveDeref( manager, strans );
+    if (egoals != NULL) {
+        for (i = 0; i < spc.num_egoals; i++)
+            Cudd_RecursiveDeref( manager, *(egoals+i) );
         free( egoals );
+    }
     if (env_nogoal_flag) {
         spc.num_egoals = 0;
         delete_tree( *spc.env_goals );
         free( spc.env_goals );
+        spc.env_goals = NULL;
     }
-    Cudd_RecursiveDeref( manager, N_BDD );
+    if (N_BDD != NULL)
+        Cudd_RecursiveDeref( manager, N_BDD );
+    if (eremoved != NULL) {
+        Cudd_RecursiveDeref( manager, eremoved );
+        Cudd_RecursiveDeref( manager, eadded );
+        Cudd_RecursiveDeref( manager, sremoved );
+        Cudd_RecursiveDeref( manager, sadded );
+    }
+    if (indexed)
+        patch_index_free( &index );
+    free( is_affected );
+    state_set_free( &N_set );
     for (i = 0; i < N_len; i++)
         free( *(N+i) );
     free( N );
+    for (i = 0; i < blocked_len; i++)
+        free( *(blocked+i) );
+    free( blocked );
     for (i = 0; i < spc.num_sgoals; i++)
         free( *(affected+i) );
     free( affected );
     free( affected_len );
-    if (num_nonbool > 0)
-        free( doffw );
+    free( doffw );
+
+    *strategy_p = strategy;
+    return status;
+}
 
+
+anode_t *patch_localfixpoint( DdManager *manager,
+                              FILE *strategy_fp, FILE *change_fp,
+                              int original_num_env, int original_num_sys,
+                              ptree_t *nonbool_var_list, int *offw,
+                              unsigned char verbose )
+{
+    anode_t *strategy;
+
+    if (change_fp == NULL)
+        return NULL;  /* Require game changes to be listed in an open stream. */
+
+    strategy = load_expanded_strategy( strategy_fp, original_num_env,
+                                       original_num_sys, verbose );
+    if (strategy == NULL)
+        return NULL;
+    if (patch_batch( manager, &strategy, change_fp,
+                     original_num_env, original_num_sys, offw,
+                     NULL, NULL, verbose )) {
+        delete_aut( strategy );
+        return NULL;
+    }
     return strategy;
 }
+
+
+patch_session_t *patch_session_open( DdManager *manager, FILE *strategy_fp,
+                                     int original_num_env,
+                                     int original_num_sys,
+                                     int *offw, unsigned char verbose )
+{
+    patch_session_t *session;
+    int i;
+
+    session = malloc( sizeof(patch_session_t) );
+    if (session == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    session->strategy = load_expanded_strategy( strategy_fp,
+                                                original_num_env,
+                                                original_num_sys, verbose );
+    if (session->strategy == NULL) {
+        free( session );
+        return NULL;
+    }
+    session->original_num_env = original_num_env;
+    session->original_num_sys = original_num_sys;
+    session->offw = offw;
+    for (i = 0; i < 2; i++) {
+        /* No change: (T & True) | False */
+        *(session->emod+i) = *(session->smod+i)
+            = (i == 0) ? Cudd_ReadOne( manager )
+            : Cudd_Not( Cudd_ReadOne( manager ) );
+        Cudd_Ref( *(session->emod+i) );
+        Cudd_Ref( *(session->smod+i) );
+    }
+    return session;
+}
+
+
+int patch_session_apply( DdManager *manager, patch_session_t *session,
+                         FILE *change_fp, unsigned char verbose )
+{
+    int status;
+    if (session->strategy == NULL || change_fp == NULL)
+        return -1;
+    status = patch_batch( manager, &session->strategy, change_fp,
+                          session->original_num_env,
+                          session->original_num_sys,
+                          session->offw, session->emod, session->smod,
+                          verbose );
+    if (status == -2) {
+        delete_aut( session->strategy );
+        session->strategy = NULL;
+    }
+    return (status == 0) ? 0 : -1;
+}
+
+
+void patch_session_close( DdManager *manager, patch_session_t *session )
+{
+    int i;
+    if (session == NULL)
+        return;
+    delete_aut( session->strategy );
+    for (i = 0; i < 2; i++) {
+        Cudd_RecursiveDeref( manager, *(session->emod+i) );
+        Cudd_RecursiveDeref( manager, *(session->smod+i) );
+    }
+    free( session );
+}
@@ -0,0 +1,257 @@
+/* perfstat.c -- Hardware performance counters of solver phases.
+ */
+
+
+#ifdef USE_PERFSTAT
+#define _GNU_SOURCE  /* For syscall() */
+#else
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#ifdef USE_PERFSTAT
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "common.h"
+#include "logging.h"
+#include "perfstat.h"
+
+
+/* Counts of phases having the same name and level */
+typedef struct {
+    char *phase;
+    int level;
+    int depth;  /* Nesting when the phase was first begun */
+    int calls;
+    double secs;
+    long long counts[PERFSTAT_NUM_COUNTERS];  /* -1 if unavailable */
+} perfstat_record_t;
+
+/* Phase that has begun but not yet ended */
+typedef struct {
+    int record;  /* Index in records */
+    struct timespec start;
+    long long counts[PERFSTAT_NUM_COUNTERS];
+} perfstat_frame_t;
+
+static char *counter_names[PERFSTAT_NUM_COUNTERS] = {
+    "cycles", "instructions", "cache_misses", "page_faults"
+};
+
+static bool enabled = False;
+#ifdef USE_PERFSTAT
+static int fds[PERFSTAT_NUM_COUNTERS];
+#endif
+static perfstat_record_t *records = NULL;
+static int num_records = 0, records_cap = 0;
+static perfstat_frame_t stack[PERFSTAT_MAX_DEPTH];
+static int depth = 0;  /* May exceed PERFSTAT_MAX_DEPTH */
+
+
+#ifdef USE_PERFSTAT
+static int open_counter( __u32 type, __u64 config )
+{
+    struct perf_event_attr attr;
+    memset( &attr, 0, sizeof(attr) );
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.inherit = 1;  /* Include threads created while counting */
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 );
+}
+#endif
+
+static void read_counters( long long *counts )
+{
+#ifdef USE_PERFSTAT
+    uint64_t value;
+#endif
+    int i;
+    for (i = 0; i < PERFSTAT_NUM_COUNTERS; i++) {
+        counts[i] = -1;
+#ifdef USE_PERFSTAT
+        if (fds[i] >= 0 && read( fds[i], &value, sizeof(value) ) == sizeof(value))
+            counts[i] = value;
+#endif
+    }
+}
+
+
+int perfstat_enable(void)
+{
+#ifdef USE_PERFSTAT
+    int i, num_open = 0;
+
+    if (enabled)
+        return 0;
+    fds[0] = open_counter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES );
+    fds[1] = open_counter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS );
+    fds[2] = open_counter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES );
+    fds[3] = open_counter( PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS );
+    for (i = 0; i < PERFSTAT_NUM_COUNTERS; i++) {
+        if (fds[i] >= 0)
+            num_open++;
+    }
+    if (num_open == 0)
+        return -1;
+    enabled = True;
+    depth = 0;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+
+void perfstat_begin( char *phase, int level )
+{
+    perfstat_frame_t *frame;
+    void *tmp;
+    int i;
+
+    if (!enabled)
+        return;
+    if (depth++ >= PERFSTAT_MAX_DEPTH)
+        return;
+    frame = stack+depth-1;
+
+    /* Recent phases are the most likely to recur. */
+    for (i = num_records-1; i >= 0; i--) {
+        if ((records+i)->level == level && !strcmp( (records+i)->phase, phase ))
+            break;
+    }
+    if (i < 0) {
+        if (num_records == records_cap) {
+            records_cap = (records_cap == 0) ? 64 : 2*records_cap;
+            tmp = realloc( records, records_cap*sizeof(perfstat_record_t) );
+            if (tmp == NULL) {
+                perror( __FILE__ ",  realloc" );
+                exit(-1);
+            }
+            records = tmp;
+        }
+        i = num_records++;
+        (records+i)->phase = phase;
+        (records+i)->level = level;
+        (records+i)->depth = depth-1;
+        (records+i)->calls = 0;
+        (records+i)->secs = 0;
+        memset( (records+i)->counts, 0, sizeof((records+i)->counts) );
+    }
+    frame->record = i;
+
+    clock_gettime( CLOCK_MONOTONIC, &frame->start );
+    read_counters( frame->counts );
+}
+
+
+void perfstat_end(void)
+{
+    perfstat_frame_t *frame;
+    perfstat_record_t *record;
+    struct timespec end;
+    long long counts[PERFSTAT_NUM_COUNTERS];
+    int i;
+
+    if (!enabled || depth == 0)
+        return;
+    if (depth-- > PERFSTAT_MAX_DEPTH)
+        return;
+    read_counters( counts );
+    clock_gettime( CLOCK_MONOTONIC, &end );
+
+    frame = stack+depth;
+    record = records+frame->record;
+    record->calls++;
+    record->secs += (end.tv_sec - frame->start.tv_sec)
+        + (end.tv_nsec - frame->start.tv_nsec)/1e9;
+    for (i = 0; i < PERFSTAT_NUM_COUNTERS; i++) {
+        if (counts[i] < 0 || frame->counts[i] < 0 || record->counts[i] < 0) {
+            record->counts[i] = -1;
+        } else {
+            record->counts[i] += counts[i] - frame->counts[i];
+        }
+    }
+}
+
+
+void perfstat_log(void)
+{
+    char line[256];
+    char *s;
+    int i, j;
+
+    for (i = 0; i < num_records; i++) {
+        s = line;
+        s += sprintf( s, "%*s%s", 2*(records+i)->depth, "",
+                      (records+i)->phase );
+        if ((records+i)->level >= 0)
+            s += sprintf( s, " %d", (records+i)->level );
+        s += sprintf( s, ": %d calls, %.6f s", (records+i)->calls,
+                      (records+i)->secs );
+        for (j = 0; j < PERFSTAT_NUM_COUNTERS; j++) {
+            if ((records+i)->counts[j] < 0) {
+                s += sprintf( s, ", %s n/a", counter_names[j] );
+            } else {
+                s += sprintf( s, ", %s %lld", counter_names[j],
+                              (records+i)->counts[j] );
+            }
+        }
+        logprint( "%s", line );
+    }
+}
+
+
+int perfstat_dump_json( FILE *fp )
+{
+    int i, j;
+
+    fprintf( fp, "{\"counters\": [" );
+    for (j = 0; j < PERFSTAT_NUM_COUNTERS; j++)
+        fprintf( fp, "%s\"%s\"", (j > 0) ? ", " : "", counter_names[j] );
+    fprintf( fp, "],\n \"phases\": [" );
+    for (i = 0; i < num_records; i++) {
+        fprintf( fp, "%s\n  {\"phase\": \"%s\", \"level\": %d, \"depth\": %d,"
+                 " \"calls\": %d, \"seconds\": %.6f",
+                 (i > 0) ? "," : "", (records+i)->phase, (records+i)->level,
+                 (records+i)->depth, (records+i)->calls, (records+i)->secs );
+        for (j = 0; j < PERFSTAT_NUM_COUNTERS; j++) {
+            if ((records+i)->counts[j] < 0) {
+                fprintf( fp, ", \"%s\": null", counter_names[j] );
+            } else {
+                fprintf( fp, ", \"%s\": %lld", counter_names[j],
+                         (records+i)->counts[j] );
+            }
+        }
+        fprintf( fp, "}" );
+    }
+    fprintf( fp, "\n]}\n" );
+    return ferror( fp );
+}
+
+
+void perfstat_disable(void)
+{
+#ifdef USE_PERFSTAT
+    int i;
+    if (enabled) {
+        for (i = 0; i < PERFSTAT_NUM_COUNTERS; i++) {
+            if (fds[i] >= 0)
+                close( fds[i] );
+        }
+    }
+#endif
+    enabled = False;
+    depth = 0;
+    free( records );
+    records = NULL;
+    num_records = records_cap = 0;
+}
@@ -282,21 +282,42 @@ char *check_vars( ptree_t *head, ptree_t *var_list, ptree_t *nextvar_list )
 }
 
 
+int nonbool_num_bits( int maxval, int encoding )
+{
+    switch (encoding) {
+    case NONBOOL_ENC_BINARY:
+    case NONBOOL_ENC_GRAY:
+        if (maxval > 0)
+            return (int)(ceil(log2( maxval+1 )));
+        return 1;
+
+    case NONBOOL_ENC_ONEHOT:
+        return maxval+1;
+
+    default:
+        return -1;
+    }
+}
+
+
 #define VARNAME_STRING_LEN 1024
-ptree_t *var_to_bool( char *name, int maxval )
+ptree_t *var_to_bool( char *name, int maxval, int encoding )
 {
     ptree_t *head;
     char varname[VARNAME_STRING_LEN];
+    int num_bits;
     int i;
 
     if (name == NULL || maxval < 0)
         return NULL;
 
-    maxval = (int)(ceil(log2( maxval+1 )));
+    num_bits = nonbool_num_bits( maxval, encoding );
+    if (num_bits < 1)
+        return NULL;
 
     snprintf( varname, VARNAME_STRING_LEN, "%s0", name );
     head = init_ptree( PT_VARIABLE, varname, 0 );
-    for (i = 1; i < maxval; i++) {
+    for (i = 1; i < num_bits; i++) {
         snprintf( varname, VARNAME_STRING_LEN, "%s%d", name, i );
         append_list_item( head, PT_VARIABLE, varname, 0 );
     }
@@ -399,10 +420,11 @@ ptree_t *expand_nonbool_varnum( ptree_t *head, char *name, int maxval )
 }
 
 
-ptree_t *expand_to_bool( ptree_t *head, char *name, int maxval )
+ptree_t *expand_to_bool( ptree_t *head, char *name, int maxval,
+                         int encoding )
 {
     ptree_t **heads;
-    int this_val, i;
+    int this_val, code, i;
     bool is_next;
     int num_bits;
     ptree_t *expanded_varlist;
@@ -410,11 +432,9 @@ ptree_t *expand_to_bool( ptree_t *head, char *name, int maxval )
     if (head == NULL)
         return NULL;
 
-    if (maxval > 0) {
-        num_bits = (int)(ceil(log2( maxval+1 )));
-    } else {
-        num_bits = 1;
-    }
+    num_bits = nonbool_num_bits( maxval, encoding );
+    if (num_bits < 1)
+        return NULL;
 
     if (head->type == PT_LT || head->type == PT_GT
         || head->type == PT_LE || head->type == PT_GE
@@ -427,7 +447,7 @@ ptree_t *expand_to_bool( ptree_t *head, char *name, int maxval )
             || (head->right->type != PT_CONSTANT
                 && !strcmp( head->right->name, name )))) {
 
-        expanded_varlist = var_to_bool( name, maxval );
+        expanded_varlist = var_to_bool( name, maxval, encoding );
         if (expanded_varlist == NULL)
             return NULL;
 
@@ -450,6 +470,25 @@ ptree_t *expand_to_bool( ptree_t *head, char *name, int maxval )
         }
 
         delete_tree( head );
+
+        if (encoding == NONBOOL_ENC_ONEHOT) {
+            if (this_val > maxval || this_val < 0) {
+                delete_tree( expanded_varlist );
+                return init_ptree( PT_CONSTANT, NULL, 0 );
+            }
+            head = get_list_item( expanded_varlist, this_val );
+            if (this_val > 0)
+                get_list_item( expanded_varlist, this_val-1 )->left = NULL;
+            else
+                expanded_varlist = NULL;
+            delete_tree( head->left );
+            head->left = NULL;
+            delete_tree( expanded_varlist );
+            if (is_next)
+                head->type = PT_NEXT_VARIABLE;
+            return head;
+        }
+
         heads = malloc( num_bits*sizeof(ptree_t *) );
         if (heads == NULL) {
             perror( __FILE__ ",  malloc" );
@@ -459,11 +498,17 @@ ptree_t *expand_to_bool( ptree_t *head, char *name, int maxval )
         /* Enforce inability to reach values outside the expanded domain */
         if (this_val > (int)(pow( 2, num_bits ) )-1 || this_val < 0) {
             free( heads );
+            delete_tree( expanded_varlist );
             return init_ptree( PT_CONSTANT, NULL, 0 );
         }
 
+        if (encoding == NONBOOL_ENC_GRAY) {
+            code = this_val ^ (this_val >> 1);
+        } else {
+            code = this_val;
+        }
         for (i = num_bits-1; i >= 0; i--) {
-            if ((this_val >> i)&1) {
+            if ((code >> i)&1) {
                 *(heads+i) = get_list_item( expanded_varlist, i );
                 (*(heads+i))->left = (*(heads+i))->right = NULL;
                 if (is_next)
@@ -480,8 +525,8 @@ ptree_t *expand_to_bool( ptree_t *head, char *name, int maxval )
 
         free( heads );
     } else {
-        head->left = expand_to_bool( head->left, name, maxval );
-        head->right = expand_to_bool( head->right, name, maxval );
+        head->left = expand_to_bool( head->left, name, maxval, encoding );
+        head->right = expand_to_bool( head->right, name, maxval, encoding );
     }
 
     return head;
@@ -519,6 +564,51 @@ ptree_t *unreach_expanded_bool( char *name, int lower, int upper, int type )
 }
 
 
+ptree_t *onehot_domain_bool( char *name, int maxval, int type )
+{
+    ptree_t **heads;
+    ptree_t *head, *node;
+    char varname[VARNAME_STRING_LEN];
+    int num_terms, i, j;
+    if (name == NULL || maxval < 0)
+        return NULL;
+    if (!(type == PT_VARIABLE || type == PT_NEXT_VARIABLE)) {
+        fprintf( stderr,
+                 "onehot_domain_bool: Invoked with unsupported type, %d\n",
+                 type );
+        return NULL;
+    }
+
+    /* At least one bit is set, and no two bits are set together. */
+    heads = malloc( (1+maxval*(maxval+1)/2)*sizeof(ptree_t *) );
+    if (heads == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; i <= maxval; i++) {
+        snprintf( varname, VARNAME_STRING_LEN, "%s%d", name, i );
+        *(heads+i) = init_ptree( type, varname, 0 );
+    }
+    *heads = merge_ptrees( heads, maxval+1, PT_OR );
+    num_terms = 1;
+    for (i = 0; i < maxval; i++) {
+        for (j = i+1; j <= maxval; j++) {
+            node = init_ptree( PT_AND, NULL, 0 );
+            snprintf( varname, VARNAME_STRING_LEN, "%s%d", name, i );
+            node->left = init_ptree( type, varname, 0 );
+            snprintf( varname, VARNAME_STRING_LEN, "%s%d", name, j );
+            node->right = init_ptree( type, varname, 0 );
+            *(heads+num_terms) = init_ptree( PT_NEG, NULL, 0 );
+            (*(heads+num_terms))->right = node;
+            num_terms++;
+        }
+    }
+    head = merge_ptrees( heads, num_terms, PT_AND );
+    free( heads );
+
+    return head;
+}
+
 int tree_size( ptree_t *head )
 {
     if (head == NULL)
@@ -612,6 +702,30 @@ void inorder_trav( ptree_t *head,
 }
 
 
+/* Join heads[0..len-1] by the associative operator type, splitting
+   in halves so that the depth of the result is logarithmic in len. */
+static ptree_t *merge_ptrees_balanced( ptree_t **heads, int len, int type )
+{
+    ptree_t *head;
+
+    if (len == 1)
+        return *heads;
+
+    head = init_ptree( type, NULL, -1 );
+    if (head == NULL)
+        return NULL;
+    head->left = merge_ptrees_balanced( heads, (len+1)/2, type );
+    head->right = merge_ptrees_balanced( heads+(len+1)/2, len/2, type );
+    if (head->left == NULL || head->right == NULL) {
+        fprintf( stderr,
+                 "Error: merge_ptrees failed to create enough new"
+                 " nodes.\n" );
+        return NULL;
+    }
+
+    return head;
+}
+
 ptree_t *merge_ptrees( ptree_t **heads, int len, int type )
 {
     ptree_t *head, *node;
@@ -627,12 +741,14 @@ ptree_t *merge_ptrees( ptree_t **heads, int len, int type )
     switch (type) {
     case PT_AND:
     case PT_OR:
+        return merge_ptrees_balanced( heads, len, type );
     case PT_IMPLIES:
         break;
     default:
         return NULL;
     }
 
+    /* Implication is not associative, so build a left-deep chain. */
     head = init_ptree( type, NULL, -1 );
     if (head == NULL)
         return NULL;
@@ -963,126 +1079,806 @@ void print_formula( ptree_t *head, FILE *fp, unsigned char format_flags )
 
 DdNode *ptree_BDD( ptree_t *head, ptree_t *var_list, DdManager *manager )
 {
-    DdNode *lsub, *rsub,*fn2, *tmp;
-    int index;
+    pdag_t *dag;
+    DdNode *fn;
 
-    /* Initialize with NULL to ensure meaningful return value in case default
-       branches taken. */
-    DdNode *fn = NULL;
+    dag = init_pdag( var_list, manager );
+    if (dag == NULL)
+        return NULL;
+    fn = pdag_BDD( dag, head );
+    delete_pdag( dag );
+    return fn;
+}
 
-    switch (head->type) {
+
+/* Internal entry types of pdag_t, besides those of ptree_t.  The
+   operands of an n-ary conjunction (n > 2) are listed by a chain of
+   PDAG_CONJ_LINK entries, which have no BDD. */
+#define PDAG_CONJ -1
+#define PDAG_CONJ_LINK -2
+
+/* Flags of pdag_t entries */
+#define PDAG_PENDING 1
+
+/* djb2 string hash */
+static unsigned int pdag_strhash( char *s )
+{
+    unsigned int h = 5381;
+    while (*s != '\0')
+        h = h*33 + (unsigned char)(*s++);
+    return h;
+}
+
+static unsigned int pdag_keyhash( int type, int a, int b )
+{
+    unsigned int h = (unsigned int)type;
+    h = h*0x9E3779B1u + (unsigned int)a;
+    h = h*0x9E3779B1u + (unsigned int)b;
+    return h ^ (h >> 15);
+}
+
+/* Return index of variable with given name, or -1 if not found. */
+static int pdag_var_index( pdag_t *dag, char *name )
+{
+    unsigned int k = pdag_strhash( name ) & (dag->var_tab_size-1);
+    while (*(dag->var_names+k) != NULL) {
+        if (!strcmp( *(dag->var_names+k), name ))
+            return *(dag->var_indices+k);
+        k = (k+1) & (dag->var_tab_size-1);
+    }
+    return -1;
+}
+
+pdag_t *init_pdag( ptree_t *var_list, DdManager *manager )
+{
+    pdag_t *dag;
+    unsigned int k;
+    int i;
+
+    if (manager == NULL)
+        return NULL;
+
+    dag = malloc( sizeof(pdag_t) );
+    if (dag == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    dag->manager = manager;
+    dag->num_vars = tree_size( var_list );
+    dag->cluster_size = PDAG_CLUSTER_SIZE;
+
+    dag->var_tab_size = 16;
+    while (dag->var_tab_size < 2*dag->num_vars)
+        dag->var_tab_size *= 2;
+    dag->var_names = calloc( dag->var_tab_size, sizeof(char *) );
+    dag->var_indices = malloc( dag->var_tab_size*sizeof(int) );
+    if (dag->var_names == NULL || dag->var_indices == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; var_list != NULL; i++, var_list = var_list->left) {
+        if (var_list->name == NULL)
+            continue;
+        k = pdag_strhash( var_list->name ) & (dag->var_tab_size-1);
+        while (*(dag->var_names+k) != NULL) {
+            /* Keep the first match, as find_list_item() would. */
+            if (!strcmp( *(dag->var_names+k), var_list->name ))
+                break;
+            k = (k+1) & (dag->var_tab_size-1);
+        }
+        if (*(dag->var_names+k) != NULL)
+            continue;
+        *(dag->var_names+k) = strdup( var_list->name );
+        if (*(dag->var_names+k) == NULL) {
+            perror( __FILE__ ",  strdup" );
+            exit(-1);
+        }
+        *(dag->var_indices+k) = i;
+    }
+
+    dag->len = 0;
+    dag->cap = 64;
+    dag->keys = malloc( 3*dag->cap*sizeof(int) );
+    dag->bdds = malloc( dag->cap*sizeof(DdNode *) );
+    dag->uses = malloc( dag->cap*sizeof(int) );
+    dag->flags = malloc( dag->cap );
+    dag->tab_size = 2*dag->cap;
+    dag->tab = malloc( dag->tab_size*sizeof(int) );
+    dag->work_len = 0;
+    dag->work_cap = 64;
+    dag->work = malloc( dag->work_cap*sizeof(int) );
+    if (dag->keys == NULL || dag->bdds == NULL || dag->uses == NULL
+        || dag->flags == NULL || dag->tab == NULL || dag->work == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < dag->tab_size; i++)
+        *(dag->tab+i) = -1;
+
+    return dag;
+}
+
+void delete_pdag( pdag_t *dag )
+{
+    int i;
+    if (dag == NULL)
+        return;
+    for (i = 0; i < dag->len; i++) {
+        if (*(dag->bdds+i) != NULL)
+            Cudd_RecursiveDeref( dag->manager, *(dag->bdds+i) );
+    }
+    for (i = 0; i < dag->var_tab_size; i++)
+        free( *(dag->var_names+i) );
+    free( dag->var_names );
+    free( dag->var_indices );
+    free( dag->keys );
+    free( dag->bdds );
+    free( dag->uses );
+    free( dag->flags );
+    free( dag->tab );
+    free( dag->work );
+    free( dag );
+}
+
+/* Return the index of the entry with key (type, a, b), or -1 if there
+   is none. */
+static int pdag_find( pdag_t *dag, int type, int a, int b )
+{
+    unsigned int k;
+    int i, *key;
+
+    k = pdag_keyhash( type, a, b ) & (dag->tab_size-1);
+    while ((i = *(dag->tab+k)) >= 0) {
+        key = dag->keys+3*i;
+        if (*key == type && *(key+1) == a && *(key+2) == b)
+            return i;
+        k = (k+1) & (dag->tab_size-1);
+    }
+    return -1;
+}
+
+/* Add entry with key (type, a, b), which is assumed to not already be
+   present, and without a BDD.  Return its index. */
+static int pdag_insert( pdag_t *dag, int type, int a, int b )
+{
+    unsigned int k;
+    int i, *key;
+
+    if (dag->len == dag->cap) {
+        dag->cap *= 2;
+        dag->keys = realloc( dag->keys, 3*dag->cap*sizeof(int) );
+        dag->bdds = realloc( dag->bdds, dag->cap*sizeof(DdNode *) );
+        dag->uses = realloc( dag->uses, dag->cap*sizeof(int) );
+        dag->flags = realloc( dag->flags, dag->cap );
+        if (dag->keys == NULL || dag->bdds == NULL || dag->uses == NULL
+            || dag->flags == NULL) {
+            perror( __FILE__ ",  realloc" );
+            exit(-1);
+        }
+    }
+    i = dag->len++;
+    *(dag->keys+3*i) = type;
+    *(dag->keys+3*i+1) = a;
+    *(dag->keys+3*i+2) = b;
+    *(dag->bdds+i) = NULL;
+    *(dag->uses+i) = 0;
+    *(dag->flags+i) = 0;
+
+    if (2*dag->len > dag->tab_size) {
+        /* Rehash, keeping the load factor at most 1/2. */
+        free( dag->tab );
+        dag->tab_size *= 2;
+        dag->tab = malloc( dag->tab_size*sizeof(int) );
+        if (dag->tab == NULL) {
+            perror( __FILE__ ",  malloc" );
+            exit(-1);
+        }
+        for (i = 0; i < dag->tab_size; i++)
+            *(dag->tab+i) = -1;
+        for (i = 0; i < dag->len; i++) {
+            key = dag->keys+3*i;
+            k = pdag_keyhash( *key, *(key+1), *(key+2) ) & (dag->tab_size-1);
+            while (*(dag->tab+k) >= 0)
+                k = (k+1) & (dag->tab_size-1);
+            *(dag->tab+k) = i;
+        }
+    } else {
+        k = pdag_keyhash( type, a, b ) & (dag->tab_size-1);
+        while (*(dag->tab+k) >= 0)
+            k = (k+1) & (dag->tab_size-1);
+        *(dag->tab+k) = i;
+    }
+
+    return dag->len-1;
+}
+
+/* Mark entry i to be built in the current call of pdag_build_all(). */
+static void pdag_schedule( pdag_t *dag, int i )
+{
+    if (dag->work_len == dag->work_cap) {
+        dag->work_cap *= 2;
+        dag->work = realloc( dag->work, dag->work_cap*sizeof(int) );
+        if (dag->work == NULL) {
+            perror( __FILE__ ",  realloc" );
+            exit(-1);
+        }
+    }
+    *(dag->work+dag->work_len) = i;
+    dag->work_len++;
+    *(dag->flags+i) |= PDAG_PENDING;
+}
+
+/* Return the index of the entry with key (type, a, b), creating it
+   without a BDD if it is not already present.  For operator types, a
+   and b are indices of the operand entries, which must already
+   exist. */
+static int pdag_key( pdag_t *dag, int type, int a, int b )
+{
+    int i;
+
+    if ((type == PT_AND || type == PT_OR || type == PT_EQUIV) && a > b) {
+        /* Canonical operand order for commutative operators */
+        i = a;
+        a = b;
+        b = i;
+    }
+    if ((i = pdag_find( dag, type, a, b )) >= 0)
+        return i;
+    return pdag_insert( dag, type, a, b );
+}
+
+static int int_cmp( const void *a, const void *b )
+{
+    return (*(int *)a > *(int *)b) - (*(int *)a < *(int *)b);
+}
+
+/* Return the index of the entry for the conjunction of the entries
+   ids[0..len-1], which are sorted and otherwise overwritten.
+   Conjunctions of three or more distinct operands are keyed by a
+   chain of PDAG_CONJ_LINK entries listing the operands in order, so
+   that the same set of operands is recognized however it was
+   written. */
+static int pdag_conj_key( pdag_t *dag, int *ids, int len )
+{
+    int i, n, link;
+
+    if (len <= 0)
+        return pdag_key( dag, PT_CONSTANT, 1, 0 );
+    qsort( ids, len, sizeof(int), int_cmp );
+    for (i = 1, n = 1; i < len; i++) {
+        if (*(ids+i) != *(ids+n-1))
+            *(ids+(n++)) = *(ids+i);
+    }
+    if (n == 1)
+        return *ids;
+    if (n == 2)
+        return pdag_key( dag, PT_AND, *ids, *(ids+1) );
+    link = pdag_key( dag, PDAG_CONJ_LINK, *ids, *(ids+1) );
+    for (i = 2; i < n-1; i++)
+        link = pdag_key( dag, PDAG_CONJ_LINK, link, *(ids+i) );
+    return pdag_key( dag, PDAG_CONJ, link, *(ids+n-1) );
+}
+
+/* Place the indices of the operands of entry i in (*buf)[0..n-1],
+   enlarging *buf (of capacity *cap) as needed, and return n. */
+static int pdag_operands( pdag_t *dag, int i, int **buf, int *cap )
+{
+    int n = 0, *key = dag->keys+3*i;
+
+    switch (*key) {
+    case PT_NEG:
+        **buf = *(key+1);
+        return 1;
     case PT_AND:
     case PT_OR:
     case PT_IMPLIES:
     case PT_EQUIV:
-        lsub = ptree_BDD( head->left, var_list, manager );
-        rsub = ptree_BDD( head->right, var_list, manager );
-        break;
-    case PT_NEG:
-        rsub = ptree_BDD( head->right, var_list, manager );
-        break;
-    case PT_VARIABLE:
-        index = find_list_item( var_list, head->type, head->name, 0 );
-        if (index < 0) {
-            fprintf( stderr,
-                     "Error: ptree_BDD requested variable \"%s\","
-                     " but it is not in given list.\n",
-                     head->name );
-            exit(-1);
+        **buf = *(key+1);
+        *(*buf+1) = *(key+2);
+        return 2;
+    case PDAG_CONJ:
+        while (True) {
+            if (n+2 > *cap) {
+                *cap *= 2;
+                *buf = realloc( *buf, (*cap)*sizeof(int) );
+                if (*buf == NULL) {
+                    perror( __FILE__ ",  realloc" );
+                    exit(-1);
+                }
+            }
+            *(*buf+(n++)) = *(key+2);
+            if (*(dag->keys+3*(*(key+1))) != PDAG_CONJ_LINK) {
+                *(*buf+(n++)) = *(key+1);
+                return n;
+            }
+            key = dag->keys+3*(*(key+1));
         }
-        lsub = Cudd_ReadOne( manager );
-        Cudd_Ref( lsub );
-        fn = Cudd_bddAnd( manager, lsub,
-                          Cudd_bddIthVar( manager, index ) );
-        Cudd_Ref( fn );
-        Cudd_RecursiveDeref( manager, lsub );
-        break;
+    default:
+        return 0;
+    }
+}
 
-    case PT_NEXT_VARIABLE:
-        index = find_list_item( var_list, PT_VARIABLE, head->name, 0 );
-        if (index < 0) {
-            fprintf( stderr,
-                     "Error: ptree_BDD requested primed variable \"%s\","
-                     " but it is not in given list.\n",
-                     head->name );
-            exit(-1);
+static int popcount64( unsigned long long x )
+{
+    int c = 0;
+    while (x) {
+        x &= x-1;
+        c++;
+    }
+    return c;
+}
+
+/* Conjoin the referenced BDDs fns[0..len-1], which are permuted and
+   otherwise overwritten.  Conjuncts are gathered into clusters
+   greedily: a cluster is extended by the remaining conjunct whose
+   support has the largest overlap (relative to the union) with the
+   support of the cluster, until the conjunction would have more than
+   dag->cluster_size nodes.  The clusters are written, referenced, to
+   fns[0..n-1], where n is returned.  On error, all of the BDDs are
+   dereferenced and -1 is returned. */
+static int pdag_cluster( pdag_t *dag, DdNode **fns, int len )
+{
+    DdManager *manager = dag->manager;
+    unsigned long long *supp, *cur_supp;
+    int num_words, *indices, num_indices;
+    int num_clusters = 0, remaining, best;
+    int i, j, inter, uni;
+    double affinity, best_affinity;
+    DdNode *cur, *fn;
+
+    /* Drop repeated conjuncts */
+    for (i = 0; i < len; i++) {
+        for (j = 0; j < i; j++) {
+            if (*(fns+j) == *(fns+i))
+                break;
         }
-        lsub = Cudd_ReadOne( manager );
-        Cudd_Ref( lsub );
-        fn = Cudd_bddAnd( manager, lsub,
-                          Cudd_bddIthVar( manager,
-                                          tree_size(var_list)+index ) );
-        Cudd_Ref( fn );
-        Cudd_RecursiveDeref( manager, lsub );
-        break;
+        if (j < i) {
+            Cudd_RecursiveDeref( manager, *(fns+i) );
+            *(fns+i) = *(fns+len-1);
+            len--;
+            i--;
+        }
+    }
+    if (len <= 1)
+        return len;
+
+    num_words = (Cudd_ReadSize( manager )+63)/64;
+    if (num_words == 0)
+        num_words = 1;
+    supp = calloc( (len+1)*num_words, sizeof(unsigned long long) );
+    if (supp == NULL) {
+        perror( __FILE__ ",  calloc" );
+        exit(-1);
+    }
+    cur_supp = supp+len*num_words;
+    for (i = 0; i < len; i++) {
+        num_indices = Cudd_SupportIndices( manager, *(fns+i), &indices );
+        if (num_indices == CUDD_OUT_OF_MEM) {
+            for (i = 0; i < len; i++)
+                Cudd_RecursiveDeref( manager, *(fns+i) );
+            free( supp );
+            return -1;
+        }
+        for (j = 0; j < num_indices; j++)
+            *(supp+i*num_words+(*(indices+j))/64)
+                |= 1ULL << ((*(indices+j))%64);
+        if (num_indices > 0)
+            free( indices );
+    }
 
-    case PT_CONSTANT:
-        if (head->value == 0) {
-            fn = Cudd_Not( Cudd_ReadOne( manager ) );
-        } else {
-            fn = Cudd_ReadOne( manager );
+    /* fns[0..num_clusters-1] are finished clusters, and
+       fns[num_clusters..len-1] the remaining conjuncts, with their
+       supports kept in the same positions of supp. */
+    remaining = len;
+    while (remaining > 0) {
+        cur = *(fns+num_clusters);
+        for (j = 0; j < num_words; j++)
+            *(cur_supp+j) = *(supp+num_clusters*num_words+j);
+        remaining--;
+
+        while (remaining > 0) {
+            best = -1;
+            best_affinity = -1.;
+            for (i = num_clusters+1; i < len; i++) {
+                inter = uni = 0;
+                for (j = 0; j < num_words; j++) {
+                    inter += popcount64( *(cur_supp+j) & *(supp+i*num_words+j) );
+                    uni += popcount64( *(cur_supp+j) | *(supp+i*num_words+j) );
+                }
+                affinity = (uni > 0) ? (double)inter/uni : 1.;
+                if (affinity > best_affinity) {
+                    best_affinity = affinity;
+                    best = i;
+                }
+            }
+
+            fn = Cudd_bddAnd( manager, cur, *(fns+best) );
+            if (fn == NULL) {
+                if (cur != *(fns+num_clusters))
+                    Cudd_RecursiveDeref( manager, cur );
+                for (i = 0; i < len; i++)
+                    Cudd_RecursiveDeref( manager, *(fns+i) );
+                free( supp );
+                return -1;
+            }
+            Cudd_Ref( fn );
+            if (dag->cluster_size >= 0
+                && Cudd_DagSize( fn ) > dag->cluster_size) {
+                Cudd_RecursiveDeref( manager, fn );
+                break;  /* Close this cluster */
+            }
+            if (cur != *(fns+num_clusters))
+                Cudd_RecursiveDeref( manager, cur );
+            Cudd_RecursiveDeref( manager, *(fns+best) );
+            cur = fn;
+            for (j = 0; j < num_words; j++)
+                *(cur_supp+j) |= *(supp+best*num_words+j);
+
+            /* Move the last remaining conjunct into the vacated slot. */
+            *(fns+best) = *(fns+len-1);
+            for (j = 0; j < num_words; j++)
+                *(supp+best*num_words+j) = *(supp+(len-1)*num_words+j);
+            len--;
+            remaining--;
         }
+
+        if (cur != *(fns+num_clusters))
+            Cudd_RecursiveDeref( manager, *(fns+num_clusters) );
+        *(fns+num_clusters) = cur;
+        num_clusters++;
+    }
+
+    free( supp );
+    return num_clusters;
+}
+
+/* Conjoin the referenced clusters fns[0..len-1] pairwise, in a
+   balanced manner, dereferencing them.  Return the referenced result,
+   or NULL on error. */
+static DdNode *pdag_conj_balanced( pdag_t *dag, DdNode **fns, int len )
+{
+    DdManager *manager = dag->manager;
+    DdNode *fn;
+    int i, j;
+
+    if (len <= 0) {
+        fn = Cudd_ReadOne( manager );
         Cudd_Ref( fn );
-        break;
+        return fn;
     }
+    while (len > 1) {
+        for (i = 0; i < len/2; i++) {
+            fn = Cudd_bddAnd( manager, *(fns+2*i), *(fns+2*i+1) );
+            if (fn == NULL) {
+                for (j = 0; j < i; j++)
+                    Cudd_RecursiveDeref( manager, *(fns+j) );
+                for (j = 2*i; j < len; j++)
+                    Cudd_RecursiveDeref( manager, *(fns+j) );
+                return NULL;
+            }
+            Cudd_Ref( fn );
+            Cudd_RecursiveDeref( manager, *(fns+2*i) );
+            Cudd_RecursiveDeref( manager, *(fns+2*i+1) );
+            *(fns+i) = fn;
+        }
+        if (len % 2) {
+            *(fns+i) = *(fns+len-1);
+            len = len/2 + 1;
+        } else {
+            len = len/2;
+        }
+    }
+    return *fns;
+}
 
-    switch (head->type) {
+/* Build the BDD of entry i, whose operands have BDDs, and release
+   the BDDs of operands that no other pending entry still needs.  The
+   operands of i are in ops[0..num_ops-1].  Return 0 on success, -1
+   on error. */
+static int pdag_build( pdag_t *dag, int i, int *ops, int num_ops )
+{
+    DdManager *manager = dag->manager;
+    DdNode *fn = NULL, **fns;
+    int *key = dag->keys+3*i;
+    int j;
+
+    switch (*key) {
+    case PT_VARIABLE:  /* a is the BDD variable index */
+        fn = Cudd_bddIthVar( manager, *(key+1) );
+        break;
+    case PT_CONSTANT:
+        fn = *(key+1) ? Cudd_ReadOne( manager )
+            : Cudd_Not( Cudd_ReadOne( manager ) );
+        break;
+    case PT_NEG:
+        fn = Cudd_Not( *(dag->bdds+*(key+1)) );
+        break;
     case PT_AND:
-        fn = Cudd_bddAnd( manager, lsub, rsub );
-        Cudd_Ref( fn );
-        Cudd_RecursiveDeref( manager, lsub );
-        Cudd_RecursiveDeref( manager, rsub );
+        fn = Cudd_bddAnd( manager, *(dag->bdds+*(key+1)),
+                          *(dag->bdds+*(key+2)) );
         break;
-
     case PT_OR:
-        fn = Cudd_bddOr( manager, lsub, rsub );
-        Cudd_Ref( fn );
-        Cudd_RecursiveDeref( manager, lsub );
-        Cudd_RecursiveDeref( manager, rsub );
+        fn = Cudd_bddOr( manager, *(dag->bdds+*(key+1)),
+                         *(dag->bdds+*(key+2)) );
         break;
-
     case PT_IMPLIES:
-        tmp = Cudd_Not( lsub );
-        Cudd_Ref( tmp );
-        Cudd_RecursiveDeref( manager, lsub );
-        fn = Cudd_bddOr( manager, tmp, rsub );
-        Cudd_Ref( fn );
-        Cudd_RecursiveDeref( manager, tmp );
-        Cudd_RecursiveDeref( manager, rsub );
+        fn = Cudd_bddOr( manager, Cudd_Not( *(dag->bdds+*(key+1)) ),
+                         *(dag->bdds+*(key+2)) );
         break;
-
     case PT_EQUIV:
-        /* -> */
-        tmp = Cudd_Not( lsub );
-        Cudd_Ref( tmp );
-        fn = Cudd_bddOr( manager, tmp, rsub );
-        Cudd_Ref( fn );
-        Cudd_RecursiveDeref( manager, tmp );
-
-        /* <- */
-        tmp = Cudd_Not( rsub );
-        Cudd_Ref( tmp );
-        Cudd_RecursiveDeref( manager, rsub );
-        fn2 = Cudd_bddOr( manager, tmp, lsub );
-        Cudd_Ref( fn2 );
-        Cudd_RecursiveDeref( manager, tmp );
-        Cudd_RecursiveDeref( manager, lsub );
-
-        /* & */
-        tmp = fn;
-        fn = Cudd_bddAnd( manager, fn, fn2 );
-        Cudd_Ref( fn );
-        Cudd_RecursiveDeref( manager, tmp );
-        Cudd_RecursiveDeref( manager, fn2 );
+        fn = Cudd_bddXnor( manager, *(dag->bdds+*(key+1)),
+                           *(dag->bdds+*(key+2)) );
         break;
-
-    case PT_NEG:
-        fn = Cudd_Not( rsub );
-        Cudd_Ref( fn );
-        Cudd_RecursiveDeref( manager, rsub );
+    case PDAG_CONJ:
+        fns = malloc( num_ops*sizeof(DdNode *) );
+        if (fns == NULL) {
+            perror( __FILE__ ",  malloc" );
+            exit(-1);
+        }
+        for (j = 0; j < num_ops; j++) {
+            *(fns+j) = *(dag->bdds+*(ops+j));
+            Cudd_Ref( *(fns+j) );
+        }
+        j = pdag_cluster( dag, fns, num_ops );
+        if (j >= 0)
+            fn = pdag_conj_balanced( dag, fns, j );
+        free( fns );
         break;
     }
+    if (fn == NULL)
+        return -1;
+    if (*key != PDAG_CONJ)
+        Cudd_Ref( fn );
+    *(dag->bdds+i) = fn;
+
+    for (j = 0; j < num_ops; j++) {
+        (*(dag->uses+*(ops+j)))--;
+        if (*(dag->uses+*(ops+j)) == 0) {
+            Cudd_RecursiveDeref( manager, *(dag->bdds+*(ops+j)) );
+            *(dag->bdds+*(ops+j)) = NULL;
+        }
+    }
+    return 0;
+}
+
+/* Build the BDDs of entry root and of all entries that it depends on.
+   Each entry is built once, after its operands, and the BDD of an
+   operand is released as soon as the last entry using it is built, so
+   that only the BDD of root remains.  Return root, or -1 on error. */
+static int pdag_build_all( pdag_t *dag, int root )
+{
+    int *ops, ops_cap, num_ops;
+    int i, j, result = root;
+
+    ops_cap = 64;
+    ops = malloc( ops_cap*sizeof(int) );
+    if (ops == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+
+    /* Gather entries reachable from root, counting for each the
+       number of entries that use it. */
+    dag->work_len = 0;
+    pdag_schedule( dag, root );
+    for (i = 0; i < dag->work_len; i++) {
+        num_ops = pdag_operands( dag, *(dag->work+i), &ops, &ops_cap );
+        for (j = 0; j < num_ops; j++) {
+            (*(dag->uses+*(ops+j)))++;
+            if (!(*(dag->flags+*(ops+j)) & PDAG_PENDING))
+                pdag_schedule( dag, *(ops+j) );
+        }
+    }
+
+    /* Operands are always interned before the entries using them. */
+    qsort( dag->work, dag->work_len, sizeof(int), int_cmp );
+    for (i = 0; i < dag->work_len; i++) {
+        num_ops = pdag_operands( dag, *(dag->work+i), &ops, &ops_cap );
+        if (pdag_build( dag, *(dag->work+i), ops, num_ops )) {
+            result = -1;
+            break;
+        }
+    }
+
+    for (i = 0; i < dag->work_len; i++) {
+        j = *(dag->work+i);
+        if (result < 0 && *(dag->bdds+j) != NULL) {
+            Cudd_RecursiveDeref( dag->manager, *(dag->bdds+j) );
+            *(dag->bdds+j) = NULL;
+        }
+        *(dag->uses+j) = 0;
+        *(dag->flags+j) = 0;
+    }
+    dag->work_len = 0;
+    free( ops );
+    return result;
+}
+
+/* Return index of the entry for given parse tree, creating entries as
+   needed, and build its BDD.  Return -1 on error. */
+static int pdag_id( pdag_t *dag, ptree_t *head )
+{
+    ptree_t **stack;
+    int *kids;  /* -1 if the node has not been expanded; else number of
+                   operands that were pushed for it. */
+    int stack_len, stack_cap;
+    int *ids, ids_len, ids_cap;  /* Entry indices of finished subformulas */
+    ptree_t **conj, **work;  /* For gathering operands */
+    int conj_len, conj_cap, work_len, work_cap;
+    ptree_t *node;
+    int a, b, index;
+
+    /* Explicit post-order traversal; a node is popped for the second
+       time once the entries for its operands are on the ids stack. */
+    stack_cap = ids_cap = conj_cap = work_cap = 64;
+    stack = malloc( stack_cap*sizeof(ptree_t *) );
+    kids = malloc( stack_cap*sizeof(int) );
+    ids = malloc( ids_cap*sizeof(int) );
+    conj = malloc( conj_cap*sizeof(ptree_t *) );
+    work = malloc( work_cap*sizeof(ptree_t *) );
+    if (stack == NULL || kids == NULL || ids == NULL
+        || conj == NULL || work == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    *stack = head;
+    *kids = -1;
+    stack_len = 1;
+    ids_len = 0;
+
+    while (stack_len > 0) {
+        stack_len--;
+        node = *(stack+stack_len);
+
+        if (*(kids+stack_len) < 0) {
+            /* Gather operands to be pushed into conj. */
+            conj_len = 0;
+            if (node->type == PT_AND) {
+                /* Flatten maximal conjunction, collecting operands in
+                   left-to-right order. */
+                *work = node;
+                work_len = 1;
+                while (work_len > 0) {
+                    if (work_len+2 > work_cap || conj_len+1 > conj_cap) {
+                        work_cap *= 2;
+                        conj_cap *= 2;
+                        work = realloc( work, work_cap*sizeof(ptree_t *) );
+                        conj = realloc( conj, conj_cap*sizeof(ptree_t *) );
+                        if (work == NULL || conj == NULL) {
+                            perror( __FILE__ ",  realloc" );
+                            exit(-1);
+                        }
+                    }
+                    work_len--;
+                    if ((*(work+work_len))->type == PT_AND) {
+                        *(work+work_len+1) = (*(work+work_len))->left;
+                        *(work+work_len) = (*(work+work_len))->right;
+                        work_len += 2;
+                    } else {
+                        *(conj+conj_len) = *(work+work_len);
+                        conj_len++;
+                    }
+                }
+            } else if (node->type == PT_OR || node->type == PT_IMPLIES
+                       || node->type == PT_EQUIV) {
+                *conj = node->left;
+                *(conj+1) = node->right;
+                conj_len = 2;
+            } else if (node->type == PT_NEG) {
+                *conj = node->right;
+                conj_len = 1;
+            }
+
+            if (conj_len > 0) {
+                if (stack_len+conj_len+1 > stack_cap) {
+                    while (stack_len+conj_len+1 > stack_cap)
+                        stack_cap *= 2;
+                    stack = realloc( stack, stack_cap*sizeof(ptree_t *) );
+                    kids = realloc( kids, stack_cap*sizeof(int) );
+                    if (stack == NULL || kids == NULL) {
+                        perror( __FILE__ ",  realloc" );
+                        exit(-1);
+                    }
+                }
+                *(kids+stack_len) = conj_len;
+                stack_len++;
+                /* Push in reverse, so that the leftmost operand is
+                   finished first. */
+                for (index = conj_len-1; index >= 0; index--) {
+                    *(stack+stack_len) = *(conj+index);
+                    *(kids+stack_len) = -1;
+                    stack_len++;
+                }
+                continue;
+            }
+        }
+
+        switch (node->type) {
+        case PT_VARIABLE:
+        case PT_NEXT_VARIABLE:
+            index = pdag_var_index( dag, node->name );
+            if (index < 0) {
+                fprintf( stderr,
+                         "Error: ptree_BDD requested %svariable \"%s\","
+                         " but it is not in given list.\n",
+                         node->type == PT_NEXT_VARIABLE ? "primed " : "",
+                         node->name );
+                exit(-1);
+            }
+            if (node->type == PT_NEXT_VARIABLE)
+                index += dag->num_vars;
+            a = pdag_key( dag, PT_VARIABLE, index, 0 );
+            break;
 
+        case PT_CONSTANT:
+            a = pdag_key( dag, PT_CONSTANT, node->value != 0, 0 );
+            break;
+
+        case PT_NEG:
+            a = pdag_key( dag, PT_NEG, *(ids+ids_len-1), 0 );
+            ids_len--;
+            break;
+
+        case PT_AND:
+            b = *(kids+stack_len);
+            ids_len -= b;
+            a = pdag_conj_key( dag, ids+ids_len, b );
+            break;
+
+        case PT_OR:
+        case PT_IMPLIES:
+        case PT_EQUIV:
+            a = *(ids+ids_len-2);  /* left */
+            b = *(ids+ids_len-1);  /* right */
+            ids_len -= 2;
+            a = pdag_key( dag, node->type, a, b );
+            break;
+
+        default:
+            fprintf( stderr,
+                     "Error: ptree_BDD given unsupported node type %d.\n",
+                     node->type );
+            a = -1;
+        }
+
+        if (a < 0) {
+            ids_len = -1;
+            break;
+        }
+        if (ids_len == ids_cap) {
+            ids_cap *= 2;
+            ids = realloc( ids, ids_cap*sizeof(int) );
+            if (ids == NULL) {
+                perror( __FILE__ ",  realloc" );
+                exit(-1);
+            }
+        }
+        *(ids+ids_len) = a;
+        ids_len++;
+    }
+
+    a = (ids_len == 1) ? pdag_build_all( dag, *ids ) : -1;
+    free( conj );
+    free( work );
+    free( stack );
+    free( kids );
+    free( ids );
+    return a;
+}
+
+DdNode *pdag_BDD( pdag_t *dag, ptree_t *head )
+{
+    int id;
+    DdNode *fn;
+
+    if (dag == NULL || head == NULL)
+        return NULL;
+    id = pdag_id( dag, head );
+    if (id < 0)
+        return NULL;
+    /* The reference held by dag is passed to the caller. */
+    fn = *(dag->bdds+id);
+    *(dag->bdds+id) = NULL;
     return fn;
 }
 
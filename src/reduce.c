@@ -0,0 +1,1227 @@
+/* reduce.c -- Elimination of defined and irrelevant variables.
+ *             Also consult reduce.h
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+#include "logging.h"
+#include "ptree.h"
+#include "solve.h"
+#include "automaton.h"
+#include "reduce.h"
+
+
+extern specification_t spc;
+
+
+/* Kinds of conjuncts, indicating the component of the specification
+   whence they come. */
+#define CONJ_ENV_INIT 0
+#define CONJ_SYS_INIT 1
+#define CONJ_ENV_TRANS 2
+#define CONJ_SYS_TRANS 3
+
+
+/* Open-addressing table from variable names to indices in the
+   variable list (evar_list followed by svar_list). */
+typedef struct {
+    char **names;
+    int *indices;
+    int size;
+} name_tab_t;
+
+/* djb2 string hash */
+static unsigned int reduce_strhash( char *s )
+{
+    unsigned int h = 5381;
+    while (*s != '\0')
+        h = h*33 + (unsigned char)*(s++);
+    return h;
+}
+
+static void tab_init( name_tab_t *tab, ptree_t **vars, int num_vars )
+{
+    unsigned int h;
+    int i;
+
+    tab->size = 16;
+    while (tab->size < 2*num_vars)
+        tab->size *= 2;
+    tab->names = malloc( tab->size*sizeof(char *) );
+    tab->indices = malloc( tab->size*sizeof(int) );
+    if (tab->names == NULL || tab->indices == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < tab->size; i++)
+        *(tab->names+i) = NULL;
+
+    for (i = 0; i < num_vars; i++) {
+        h = reduce_strhash( (*(vars+i))->name ) & (tab->size-1);
+        while (*(tab->names+h) != NULL)
+            h = (h+1) & (tab->size-1);
+        *(tab->names+h) = (*(vars+i))->name;
+        *(tab->indices+h) = i;
+    }
+}
+
+/* Return index of variable with given name, or -1 if not found. */
+static int tab_find( name_tab_t *tab, char *name )
+{
+    unsigned int h = reduce_strhash( name ) & (tab->size-1);
+    while (*(tab->names+h) != NULL) {
+        if (!strcmp( *(tab->names+h), name ))
+            return *(tab->indices+h);
+        h = (h+1) & (tab->size-1);
+    }
+    return -1;
+}
+
+
+/* Append the top-level conjuncts of head to conj, with kind recorded
+   in the corresponding entry of kinds. */
+static void flatten_conj( ptree_t *head, int kind,
+                          ptree_t ***conj, int **kinds, int *len, int *cap )
+{
+    ptree_t **stack;
+    int top, stack_cap;
+
+    if (head == NULL)
+        return;
+
+    stack_cap = 16;
+    stack = malloc( stack_cap*sizeof(ptree_t *) );
+    if (stack == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    *stack = head;
+    top = 1;
+    while (top > 0) {
+        head = *(stack+(--top));
+        if (head->type == PT_AND) {
+            if (top+2 > stack_cap) {
+                stack_cap *= 2;
+                stack = realloc( stack, stack_cap*sizeof(ptree_t *) );
+                if (stack == NULL) {
+                    perror( __FILE__ ",  realloc" );
+                    exit(-1);
+                }
+            }
+            *(stack+(top++)) = head->right;
+            *(stack+(top++)) = head->left;
+            continue;
+        }
+
+        if (*len == *cap) {
+            *cap = (*cap == 0) ? 64 : 2*(*cap);
+            *conj = realloc( *conj, (*cap)*sizeof(ptree_t *) );
+            *kinds = realloc( *kinds, (*cap)*sizeof(int) );
+            if (*conj == NULL || *kinds == NULL) {
+                perror( __FILE__ ",  realloc" );
+                exit(-1);
+            }
+        }
+        *(*conj+*len) = head;
+        *(*kinds+*len) = kind;
+        (*len)++;
+    }
+    free( stack );
+}
+
+/* Gather conjuncts of all initial conditions and transition rules of
+   the global specification.  Return the number of conjuncts. */
+static int spec_conjuncts( ptree_t ***conj, int **kinds )
+{
+    int len = 0, cap = 0;
+    int i;
+
+    *conj = NULL;
+    *kinds = NULL;
+    flatten_conj( spc.env_init, CONJ_ENV_INIT, conj, kinds, &len, &cap );
+    flatten_conj( spc.sys_init, CONJ_SYS_INIT, conj, kinds, &len, &cap );
+    for (i = 0; i < spc.et_array_len; i++)
+        flatten_conj( *(spc.env_trans_array+i), CONJ_ENV_TRANS,
+                      conj, kinds, &len, &cap );
+    for (i = 0; i < spc.st_array_len; i++)
+        flatten_conj( *(spc.sys_trans_array+i), CONJ_SYS_TRANS,
+                      conj, kinds, &len, &cap );
+    return len;
+}
+
+
+/* Replace the subtree at head, in-place, by the constant True. */
+static void set_true( ptree_t *head )
+{
+    delete_tree( head->left );
+    delete_tree( head->right );
+    free( head->name );
+    head->left = head->right = NULL;
+    head->name = NULL;
+    head->type = PT_CONSTANT;
+    head->value = 1;
+}
+
+/* Replace, in-place, every variable node of given type (PT_VARIABLE or
+   PT_NEXT_VARIABLE) and name by a copy of f. */
+static void subst_var( ptree_t *head, char *name, int type, ptree_t *f )
+{
+    ptree_t *g;
+    if (head == NULL)
+        return;
+    if (head->type == type && !strcmp( head->name, name )) {
+        g = copy_ptree( f );
+        if (g == NULL) {
+            fprintf( stderr, "Error: subst_var failed to copy tree.\n" );
+            exit(-1);
+        }
+        free( head->name );
+        *head = *g;
+        free( g );
+        return;
+    }
+    subst_var( head->left, name, type, f );
+    subst_var( head->right, name, type, f );
+}
+
+static void subst_spec( char *name, ptree_t *f, ptree_t *fnext )
+{
+    int i;
+    subst_var( spc.env_init, name, PT_VARIABLE, f );
+    subst_var( spc.sys_init, name, PT_VARIABLE, f );
+    for (i = 0; i < spc.et_array_len; i++) {
+        subst_var( *(spc.env_trans_array+i), name, PT_VARIABLE, f );
+        subst_var( *(spc.env_trans_array+i), name, PT_NEXT_VARIABLE, fnext );
+    }
+    for (i = 0; i < spc.st_array_len; i++) {
+        subst_var( *(spc.sys_trans_array+i), name, PT_VARIABLE, f );
+        subst_var( *(spc.sys_trans_array+i), name, PT_NEXT_VARIABLE, fnext );
+    }
+    for (i = 0; i < spc.num_egoals; i++)
+        subst_var( *(spc.env_goals+i), name, PT_VARIABLE, f );
+    for (i = 0; i < spc.num_sgoals; i++)
+        subst_var( *(spc.sys_goals+i), name, PT_VARIABLE, f );
+}
+
+
+/* Return True if the tree only involves Boolean connectives,
+   constants, and variables of the given type other than name. */
+static bool def_ok( ptree_t *head, char *name, int type )
+{
+    if (head == NULL)
+        return True;
+    switch (head->type) {
+    case PT_VARIABLE:
+    case PT_NEXT_VARIABLE:
+        return head->type == type && strcmp( head->name, name );
+    case PT_CONSTANT:
+        return True;
+    case PT_NEG:
+    case PT_AND:
+    case PT_OR:
+    case PT_IMPLIES:
+    case PT_EQUIV:
+        return def_ok( head->left, name, type )
+            && def_ok( head->right, name, type );
+    default:
+        return False;
+    }
+}
+
+/* If head is v <-> f or f <-> v, where v is a variable of given type
+   named name, and f is acceptable as described for def_ok(), then
+   return f.  Else, return NULL. */
+static ptree_t *def_rhs( ptree_t *head, char *name, int type )
+{
+    ptree_t *f;
+    if (head->type != PT_EQUIV)
+        return NULL;
+    if (head->left->type == type && !strcmp( head->left->name, name )) {
+        f = head->right;
+    } else if (head->right->type == type
+               && !strcmp( head->right->name, name )) {
+        f = head->left;
+    } else {
+        return NULL;
+    }
+    if (!def_ok( f, name, type ))
+        return NULL;
+    return f;
+}
+
+/* Return True if fnext is identical to f after priming all variables. */
+static bool same_primed( ptree_t *f, ptree_t *fnext )
+{
+    if (f == NULL || fnext == NULL)
+        return f == fnext;
+    if (f->type == PT_VARIABLE) {
+        return fnext->type == PT_NEXT_VARIABLE
+            && !strcmp( f->name, fnext->name );
+    } else if (f->type == PT_CONSTANT) {
+        return fnext->type == PT_CONSTANT && f->value == fnext->value;
+    }
+    return f->type == fnext->type
+        && same_primed( f->left, fnext->left )
+        && same_primed( f->right, fnext->right );
+}
+
+
+static int find_root( int *parent, int i )
+{
+    while (*(parent+i) != i) {
+        *(parent+i) = *(parent+*(parent+i));
+        i = *(parent+i);
+    }
+    return i;
+}
+
+/* Merge the components of all variables in head.  *first is the
+   index of the first variable encountered, or -1 if none yet. */
+static void union_vars( ptree_t *head, name_tab_t *tab, int *parent,
+                        int *first )
+{
+    int i;
+    if (head == NULL)
+        return;
+    if (head->type == PT_VARIABLE || head->type == PT_NEXT_VARIABLE) {
+        i = tab_find( tab, head->name );
+        if (i < 0)
+            return;
+        if (*first < 0) {
+            *first = i;
+        } else {
+            *(parent+find_root( parent, i )) = find_root( parent, *first );
+        }
+        return;
+    }
+    union_vars( head->left, tab, parent, first );
+    union_vars( head->right, tab, parent, first );
+}
+
+
+/* Append a step for removing the variables with given (increasing)
+   indices, with positions relative to the variables not yet gone. */
+static reduce_step_t *add_step( reduction_t *red, int type,
+                                int *idx, int n, ptree_t **vars, int num_env,
+                                bool *gone, int num_vars )
+{
+    reduce_step_t *step;
+    int i, k, live;
+
+    red->steps = realloc( red->steps,
+                          (red->num_steps+1)*sizeof(reduce_step_t) );
+    if (red->steps == NULL) {
+        perror( __FILE__ ",  realloc" );
+        exit(-1);
+    }
+    step = red->steps + red->num_steps;
+    red->num_steps++;
+
+    step->type = type;
+    step->vars = NULL;
+    step->num_env = 0;
+    step->def = NULL;
+    step->env_init = step->sys_init = NULL;
+    step->env_trans = step->sys_trans = NULL;
+    step->positions = malloc( n*sizeof(int) );
+    if (step->positions == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+
+    live = 0;
+    k = 0;
+    for (i = 0; i < num_vars && k < n; i++) {
+        if (i == *(idx+k)) {
+            *(step->positions+k) = live;
+            if (step->vars == NULL) {
+                step->vars = init_ptree( PT_VARIABLE, (*(vars+i))->name,
+                                         (*(vars+i))->value );
+            } else {
+                append_list_item( step->vars, PT_VARIABLE,
+                                  (*(vars+i))->name, (*(vars+i))->value );
+            }
+            if (i < num_env)
+                (step->num_env)++;
+            k++;
+        }
+        if (!(*(gone+i)))
+            live++;
+    }
+
+    return step;
+}
+
+
+/* Return True if removing the given component cannot change
+   realizability, as described in reduce.h. */
+static bool component_ok( reduce_step_t *step )
+{
+    DdManager *manager;
+    DdNode *etrans, *strans, *einit, *sinit;
+    DdNode *ecube, *scube, *tmp, *tmp2;
+    int *cube_indices;
+    int len, i;
+    bool result = True;
+
+    len = tree_size( step->vars );
+    cube_indices = malloc( len*sizeof(int) );
+    if (cube_indices == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+
+    manager = Cudd_Init( 2*len, 0, CUDD_UNIQUE_SLOTS, CUDD_CACHE_SLOTS, 0 );
+    einit = ptree_BDD( step->env_init, step->vars, manager );
+    sinit = ptree_BDD( step->sys_init, step->vars, manager );
+    etrans = ptree_BDD( step->env_trans, step->vars, manager );
+    strans = ptree_BDD( step->sys_trans, step->vars, manager );
+    if (einit == NULL || sinit == NULL || etrans == NULL || strans == NULL) {
+        fprintf( stderr,
+                 "Error component_ok: failed to construct BDDs of"
+                 " component.\n" );
+        exit(-1);
+    }
+
+    for (i = 0; i < step->num_env; i++)
+        *(cube_indices+i) = len+i;
+    ecube = Cudd_IndicesToCube( manager, cube_indices, step->num_env );
+    Cudd_Ref( ecube );
+    for (i = step->num_env; i < len; i++)
+        *(cube_indices+i-step->num_env) = len+i;
+    scube = Cudd_IndicesToCube( manager, cube_indices, len-step->num_env );
+    Cudd_Ref( scube );
+
+    /* The environment can always move, ... */
+    tmp = Cudd_bddExistAbstract( manager, etrans, ecube );
+    Cudd_Ref( tmp );
+    if (tmp != Cudd_ReadOne( manager ))
+        result = False;
+    Cudd_RecursiveDeref( manager, tmp );
+
+    /* ...the system can always respond, ... */
+    if (result) {
+        tmp = Cudd_bddExistAbstract( manager, strans, scube );
+        Cudd_Ref( tmp );
+        tmp2 = Cudd_bddOr( manager, Cudd_Not( etrans ), tmp );
+        Cudd_Ref( tmp2 );
+        Cudd_RecursiveDeref( manager, tmp );
+        if (tmp2 != Cudd_ReadOne( manager ))
+            result = False;
+        Cudd_RecursiveDeref( manager, tmp2 );
+    }
+
+    /* ...and initial conditions are not vacuous. */
+    if (result) {
+        tmp = Cudd_bddAnd( manager, einit, sinit );
+        Cudd_Ref( tmp );
+        if (tmp == Cudd_Not( Cudd_ReadOne( manager ) ))
+            result = False;
+        Cudd_RecursiveDeref( manager, tmp );
+    }
+
+    Cudd_RecursiveDeref( manager, ecube );
+    Cudd_RecursiveDeref( manager, scube );
+    Cudd_RecursiveDeref( manager, einit );
+    Cudd_RecursiveDeref( manager, sinit );
+    Cudd_RecursiveDeref( manager, etrans );
+    Cudd_RecursiveDeref( manager, strans );
+    Cudd_Quit( manager );
+    free( cube_indices );
+    return result;
+}
+
+
+/* Return the conjunction of copies of the given conjuncts; True if
+   there are none. */
+static ptree_t *merge_copies( ptree_t **conj, int len )
+{
+    ptree_t **heads, *head;
+    int i;
+
+    if (len == 0)
+        return init_ptree( PT_CONSTANT, NULL, 1 );
+
+    heads = malloc( len*sizeof(ptree_t *) );
+    if (heads == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < len; i++)
+        *(heads+i) = copy_ptree( *(conj+i) );
+    head = merge_ptrees( heads, len, PT_AND );
+    free( heads );
+    return head;
+}
+
+
+reduction_t *reduce_GR1( unsigned char init_flags, int max_component,
+                         unsigned char verbose )
+{
+    reduction_t *red;
+    reduce_step_t *step;
+    ptree_t **vars, *var;
+    name_tab_t tab;
+    bool *gone, *relevant;
+    ptree_t **conj = NULL, **comp_conj[4];
+    int *kinds = NULL, *conj_var, comp_len[4];
+    int num_conj;
+    int *parent, *members, num_members, num_comp_sys;
+    int num_env, num_sys, num_vars, live_sys;
+    int num_defined = 0, num_removed = 0, num_components = 0;
+    ptree_t *f, *fnext;
+    int i, j, k, m, r, trans_kind, init_kind;
+
+    red = malloc( sizeof(reduction_t) );
+    if (red == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    red->init_flags = init_flags;
+    red->one_side_sys = (init_flags == ONE_SIDE_INIT && spc.env_init == NULL
+                         && spc.sys_init != NULL);
+    red->steps = NULL;
+    red->num_steps = 0;
+
+    num_env = tree_size( spc.evar_list );
+    num_sys = tree_size( spc.svar_list );
+    num_vars = num_env+num_sys;
+    if (num_sys == 0)
+        return red;
+
+    vars = malloc( num_vars*sizeof(ptree_t *) );
+    gone = malloc( num_vars*sizeof(bool) );
+    parent = malloc( num_vars*sizeof(int) );
+    members = malloc( num_vars*sizeof(int) );
+    relevant = malloc( num_vars*sizeof(bool) );
+    if (vars == NULL || gone == NULL || parent == NULL || members == NULL
+        || relevant == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    i = 0;
+    for (var = spc.evar_list; var; var = var->left)
+        *(vars+(i++)) = var;
+    for (var = spc.svar_list; var; var = var->left)
+        *(vars+(i++)) = var;
+    for (i = 0; i < num_vars; i++)
+        *(gone+i) = False;
+    live_sys = num_sys;
+    tab_init( &tab, vars, num_vars );
+
+
+    /* Substitute variables that are defined by equivalences */
+    num_conj = spec_conjuncts( &conj, &kinds );
+    for (i = 0; i < num_vars; i++) {
+        if (i >= num_env && live_sys == 1)
+            break;
+        if (i < num_env) {
+            init_kind = CONJ_ENV_INIT;
+            trans_kind = CONJ_ENV_TRANS;
+        } else {
+            init_kind = CONJ_SYS_INIT;
+            trans_kind = CONJ_SYS_TRANS;
+        }
+
+        f = fnext = NULL;
+        for (k = 0; k < num_conj; k++) {
+            if (*(kinds+k) != trans_kind)
+                continue;
+            fnext = def_rhs( *(conj+k), (*(vars+i))->name, PT_NEXT_VARIABLE );
+            if (fnext != NULL)
+                break;
+        }
+        if (fnext == NULL)
+            continue;
+        for (m = 0; m < num_conj; m++) {
+            if (*(kinds+m) != init_kind)
+                continue;
+            f = def_rhs( *(conj+m), (*(vars+i))->name, PT_VARIABLE );
+            if (f != NULL && same_primed( f, fnext ))
+                break;
+            f = NULL;
+        }
+        if (f == NULL)
+            continue;
+
+        step = add_step( red, REDUCE_DEFINED, &i, 1, vars, num_env,
+                         gone, num_vars );
+        step->def = copy_ptree( f );
+        fnext = copy_ptree( fnext );
+        set_true( *(conj+k) );
+        set_true( *(conj+m) );
+        subst_spec( (*(vars+i))->name, step->def, fnext );
+        delete_tree( fnext );
+
+        *(gone+i) = True;
+        if (i >= num_env)
+            live_sys--;
+        num_defined++;
+    }
+    free( conj );
+    free( kinds );
+
+
+    /* Components of the variable dependency graph */
+    num_conj = spec_conjuncts( &conj, &kinds );
+    conj_var = malloc( num_conj*sizeof(int) );
+    for (k = 0; k < 4; k++)
+        comp_conj[k] = malloc( num_conj*sizeof(ptree_t *) );
+    if ((num_conj > 0 && conj_var == NULL)
+        || (num_conj > 0 && (comp_conj[0] == NULL || comp_conj[1] == NULL
+                             || comp_conj[2] == NULL
+                             || comp_conj[3] == NULL))) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < num_vars; i++) {
+        *(parent+i) = i;
+        *(relevant+i) = False;
+    }
+    for (k = 0; k < num_conj; k++) {
+        *(conj_var+k) = -1;
+        union_vars( *(conj+k), &tab, parent, conj_var+k );
+    }
+    for (j = 0; j < spc.num_egoals; j++) {
+        r = -1;
+        union_vars( *(spc.env_goals+j), &tab, parent, &r );
+        if (r >= 0)
+            *(relevant+find_root( parent, r )) = True;
+    }
+    for (j = 0; j < spc.num_sgoals; j++) {
+        r = -1;
+        union_vars( *(spc.sys_goals+j), &tab, parent, &r );
+        if (r >= 0)
+            *(relevant+find_root( parent, r )) = True;
+    }
+    /* Goals may have merged components after relevance was marked */
+    for (i = 0; i < num_vars; i++) {
+        if (*(relevant+i))
+            *(relevant+find_root( parent, i )) = True;
+    }
+
+    for (r = 0; r < num_vars; r++) {
+        if (*(gone+r) || find_root( parent, r ) != r || *(relevant+r))
+            continue;
+
+        num_members = num_comp_sys = 0;
+        for (i = r; i < num_vars; i++) {
+            if (!(*(gone+i)) && find_root( parent, i ) == r) {
+                *(members+(num_members++)) = i;
+                if (i >= num_env)
+                    num_comp_sys++;
+            }
+        }
+        if ((max_component >= 0 && num_members > max_component)
+            || live_sys - num_comp_sys < 1)
+            continue;
+
+        for (k = 0; k < 4; k++)
+            comp_len[k] = 0;
+        for (k = 0; k < num_conj; k++) {
+            if (*(conj_var+k) >= 0
+                && find_root( parent, *(conj_var+k) ) == r) {
+                *(comp_conj[*(kinds+k)]+comp_len[*(kinds+k)]) = *(conj+k);
+                comp_len[*(kinds+k)]++;
+            }
+        }
+
+        step = add_step( red, REDUCE_COMPONENT, members, num_members,
+                         vars, num_env, gone, num_vars );
+        step->env_init = merge_copies( comp_conj[CONJ_ENV_INIT],
+                                       comp_len[CONJ_ENV_INIT] );
+        step->sys_init = merge_copies( comp_conj[CONJ_SYS_INIT],
+                                       comp_len[CONJ_SYS_INIT] );
+        step->env_trans = merge_copies( comp_conj[CONJ_ENV_TRANS],
+                                        comp_len[CONJ_ENV_TRANS] );
+        step->sys_trans = merge_copies( comp_conj[CONJ_SYS_TRANS],
+                                        comp_len[CONJ_SYS_TRANS] );
+        if (!component_ok( step )) {
+            red->num_steps--;
+            delete_tree( step->vars );
+            free( step->positions );
+            delete_tree( step->env_init );
+            delete_tree( step->sys_init );
+            delete_tree( step->env_trans );
+            delete_tree( step->sys_trans );
+            continue;
+        }
+
+        for (k = 0; k < 4; k++) {
+            for (j = 0; j < comp_len[k]; j++)
+                set_true( *(comp_conj[k]+j) );
+        }
+        for (j = 0; j < num_members; j++)
+            *(gone+*(members+j)) = True;
+        live_sys -= num_comp_sys;
+        num_removed += num_members;
+        num_components++;
+    }
+    free( conj );
+    free( kinds );
+    free( conj_var );
+    for (k = 0; k < 4; k++)
+        free( comp_conj[k] );
+
+
+    /* Unlink removed variables */
+    spc.evar_list = spc.svar_list = NULL;
+    for (i = num_vars-1; i >= 0; i--) {
+        if (*(gone+i)) {
+            (*(vars+i))->left = NULL;
+            delete_tree( *(vars+i) );
+        } else if (i < num_env) {
+            (*(vars+i))->left = spc.evar_list;
+            spc.evar_list = *(vars+i);
+        } else {
+            (*(vars+i))->left = spc.svar_list;
+            spc.svar_list = *(vars+i);
+        }
+    }
+
+    if (verbose)
+        logprint( "Eliminated %d variables by substitution and %d in %d"
+                  " independent components; %d variables remain.",
+                  num_defined, num_removed, num_components,
+                  num_vars - num_defined - num_removed );
+
+    free( tab.names );
+    free( tab.indices );
+    free( vars );
+    free( gone );
+    free( parent );
+    free( members );
+    free( relevant );
+    return red;
+}
+
+
+/* Return index of variable in evar_list followed by svar_list of the
+   global specification, or -1 if not found. */
+static int var_position( char *name )
+{
+    ptree_t *var;
+    int i = 0;
+    for (var = spc.evar_list; var; var = var->left, i++) {
+        if (!strcmp( var->name, name ))
+            return i;
+    }
+    for (var = spc.svar_list; var; var = var->left, i++) {
+        if (!strcmp( var->name, name ))
+            return i;
+    }
+    return -1;
+}
+
+/* Set the value field of each variable node to its index in the
+   variable list.  Return -1 if a variable is not found, else 0. */
+static int resolve_vars( ptree_t *head )
+{
+    if (head == NULL)
+        return 0;
+    if (head->type == PT_VARIABLE) {
+        head->value = var_position( head->name );
+        return (head->value < 0) ? -1 : 0;
+    }
+    if (resolve_vars( head->left ) < 0)
+        return -1;
+    return resolve_vars( head->right );
+}
+
+/* Evaluate formula with variables resolved by resolve_vars(). */
+static vartype eval_def( ptree_t *head, vartype *state )
+{
+    switch (head->type) {
+    case PT_VARIABLE:
+        return *(state+head->value) ? 1 : 0;
+    case PT_CONSTANT:
+        return head->value ? 1 : 0;
+    case PT_NEG:
+        return !eval_def( head->right, state );
+    case PT_AND:
+        return eval_def( head->left, state ) && eval_def( head->right, state );
+    case PT_OR:
+        return eval_def( head->left, state ) || eval_def( head->right, state );
+    case PT_IMPLIES:
+        return !eval_def( head->left, state ) || eval_def( head->right, state );
+    default:  /* PT_EQUIV */
+        return eval_def( head->left, state ) == eval_def( head->right, state );
+    }
+}
+
+/* Return new state vector obtained by inserting values at the given
+   (increasing) positions of state. */
+static vartype *insert_values( vartype *state, int state_len,
+                               int *positions, vartype *values, int n )
+{
+    vartype *new_state;
+    int i, j, k;
+
+    new_state = malloc( (state_len+n)*sizeof(vartype) );
+    if (new_state == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    j = k = 0;
+    for (i = 0; i < state_len+n; i++) {
+        if (k < n && *(positions+k) == i) {
+            *(new_state+i) = *(values+(k++));
+        } else {
+            *(new_state+i) = *(state+(j++));
+        }
+    }
+    return new_state;
+}
+
+static ptree_t *insert_list_item( ptree_t *head, int index, ptree_t *item )
+{
+    ptree_t *node;
+    if (index == 0) {
+        item->left = head;
+        return item;
+    }
+    node = get_list_item( head, index-1 );
+    item->left = node->left;
+    node->left = item;
+    return head;
+}
+
+/* Put the variables of step back into the global variable lists. */
+static void restore_vars( reduce_step_t *step )
+{
+    ptree_t *var;
+    int k = 0;
+    for (var = step->vars; var; var = var->left, k++) {
+        if (k < step->num_env) {
+            spc.evar_list = insert_list_item( spc.evar_list,
+                                              *(step->positions+k),
+                                              init_ptree( PT_VARIABLE,
+                                                          var->name,
+                                                          var->value ) );
+        } else {
+            spc.svar_list = insert_list_item( spc.svar_list,
+                                              *(step->positions+k)
+                                              - tree_size( spc.evar_list ),
+                                              init_ptree( PT_VARIABLE,
+                                                          var->name,
+                                                          var->value ) );
+        }
+    }
+}
+
+
+static int restore_defined( reduce_step_t *step, anode_t *head,
+                            int state_len )
+{
+    ptree_t *def;
+    vartype value, *new_state;
+
+    def = copy_ptree( step->def );
+    if (resolve_vars( def ) < 0) {
+        fprintf( stderr,
+                 "Error restore_defined: definition refers to unknown"
+                 " variable.\n" );
+        delete_tree( def );
+        return -1;
+    }
+    while (head) {
+        value = eval_def( def, head->state );
+        new_state = insert_values( head->state, state_len,
+                                   step->positions, &value, 1 );
+        free( head->state );
+        head->state = new_state;
+        head = head->next;
+    }
+    delete_tree( def );
+    return 0;
+}
+
+
+/* Compare nodes of the reduced automaton by address, for bsearch. */
+typedef struct {
+    anode_t *node;
+    int index;
+} node_ref_t;
+
+static int node_ref_cmp( const void *a, const void *b )
+{
+    const anode_t *x = ((const node_ref_t *)a)->node;
+    const anode_t *y = ((const node_ref_t *)b)->node;
+    if (x < y)
+        return -1;
+    return (x > y) ? 1 : 0;
+}
+
+/* Product of the reduced automaton with the valuations of a
+   component, the latter encoded as integers with bit i being the
+   value of the i-th variable of the component. */
+typedef struct {
+    anode_t **nodes;  /* Reduced automaton, in list order */
+    node_ref_t *refs;  /* Sorted by address */
+    int num_nodes;
+
+    vartype *values;  /* Scratch space for one valuation */
+    int *positions;
+    int len;  /* Number of variables in the component */
+    int state_len;  /* Of the reduced automaton */
+
+    /* Product nodes, in order of creation */
+    anode_t **pnodes;
+    int *pnode_index;
+    int *pcomp;
+    int num_pnodes;
+    int pcap;
+
+    int *tab;  /* Open-addressing table of indices into pnodes */
+    int tab_size;
+} product_t;
+
+static int product_node_index( product_t *prod, anode_t *node )
+{
+    node_ref_t key, *found;
+    key.node = node;
+    found = bsearch( &key, prod->refs, prod->num_nodes, sizeof(node_ref_t),
+                     node_ref_cmp );
+    return (found == NULL) ? -1 : found->index;
+}
+
+static unsigned int product_hash( int node_index, int comp )
+{
+    return (unsigned int)node_index*2654435761u ^ (unsigned int)comp*40503u;
+}
+
+/* Return product node for reduced node with given index and component
+   valuation comp, creating it if needed. */
+static anode_t *product_get( product_t *prod, int node_index, int comp,
+                             bool initial )
+{
+    anode_t *node;
+    vartype *state;
+    unsigned int h;
+    int i, p;
+
+    h = product_hash( node_index, comp ) & (prod->tab_size-1);
+    while ((p = *(prod->tab+h)) >= 0) {
+        if (*(prod->pnode_index+p) == node_index && *(prod->pcomp+p) == comp)
+            return *(prod->pnodes+p);
+        h = (h+1) & (prod->tab_size-1);
+    }
+
+    if (prod->num_pnodes == prod->pcap) {
+        prod->pcap *= 2;
+        prod->pnodes = realloc( prod->pnodes, prod->pcap*sizeof(anode_t *) );
+        prod->pnode_index = realloc( prod->pnode_index,
+                                     prod->pcap*sizeof(int) );
+        prod->pcomp = realloc( prod->pcomp, prod->pcap*sizeof(int) );
+        if (prod->pnodes == NULL || prod->pnode_index == NULL
+            || prod->pcomp == NULL) {
+            perror( __FILE__ ",  realloc" );
+            exit(-1);
+        }
+    }
+    p = prod->num_pnodes++;
+    *(prod->tab+h) = p;
+    for (i = 0; i < prod->len; i++)
+        *(prod->values+i) = (comp >> i)&1;
+    node = *(prod->nodes+node_index);
+    state = insert_values( node->state, prod->state_len,
+                           prod->positions, prod->values, prod->len );
+    *(prod->pnodes+p) = insert_anode( NULL, node->mode, node->rgrad, initial,
+                                      state, prod->state_len+prod->len );
+    free( state );
+    *(prod->pnode_index+p) = node_index;
+    *(prod->pcomp+p) = comp;
+
+    if (2*prod->num_pnodes > prod->tab_size) {  /* Rehash */
+        free( prod->tab );
+        prod->tab_size *= 2;
+        prod->tab = malloc( prod->tab_size*sizeof(int) );
+        if (prod->tab == NULL) {
+            perror( __FILE__ ",  malloc" );
+            exit(-1);
+        }
+        for (i = 0; i < prod->tab_size; i++)
+            *(prod->tab+i) = -1;
+        for (i = 0; i < prod->num_pnodes; i++) {
+            h = product_hash( *(prod->pnode_index+i), *(prod->pcomp+i) )
+                & (prod->tab_size-1);
+            while (*(prod->tab+h) >= 0)
+                h = (h+1) & (prod->tab_size-1);
+            *(prod->tab+h) = i;
+        }
+    }
+
+    return *(prod->pnodes+p);
+}
+
+
+/* Find successor valuations of the component from comp: one for each
+   environment move permitted by etrans, with the system response
+   chosen from strans.  Return the number of successors, which are
+   written into succ (of length at least 2^num_env), or -1 on error. */
+static int component_successors( DdManager *manager,
+                                 DdNode *etrans, DdNode *strans,
+                                 int len, int num_env, int comp, int *succ )
+{
+    int *inputs;
+    char *cube_str;
+    DdNode *cube, *tmp, *lit;
+    int e, i, n = 0, s;
+
+    inputs = malloc( 2*len*sizeof(int) );
+    cube_str = malloc( 2*len*sizeof(char) );
+    if (inputs == NULL || cube_str == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < len; i++)
+        *(inputs+i) = (comp >> i)&1;
+    for (i = len; i < 2*len; i++)
+        *(inputs+i) = 0;
+
+    for (e = 0; e < (1 << num_env); e++) {
+        for (i = 0; i < num_env; i++)
+            *(inputs+len+i) = (e >> i)&1;
+        if (Cudd_IsComplement( Cudd_Eval( manager, etrans, inputs ) ))
+            continue;
+
+        /* Restrict strans to this move and pick a system response. */
+        cube = strans;
+        Cudd_Ref( cube );
+        for (i = 0; i < len+num_env; i++) {
+            lit = Cudd_bddIthVar( manager, i );
+            if (!(*(inputs+i)))
+                lit = Cudd_Not( lit );
+            tmp = Cudd_bddAnd( manager, cube, lit );
+            Cudd_Ref( tmp );
+            Cudd_RecursiveDeref( manager, cube );
+            cube = tmp;
+        }
+        if (cube == Cudd_Not( Cudd_ReadOne( manager ) )
+            || !Cudd_bddPickOneCube( manager, cube, cube_str )) {
+            Cudd_RecursiveDeref( manager, cube );
+            free( inputs );
+            free( cube_str );
+            return -1;
+        }
+        Cudd_RecursiveDeref( manager, cube );
+
+        s = e;
+        for (i = num_env; i < len; i++) {
+            if (*(cube_str+len+i) == 1)
+                s |= 1 << i;
+        }
+        *(succ+(n++)) = s;
+    }
+
+    free( inputs );
+    free( cube_str );
+    return n;
+}
+
+static anode_t *restore_component( reduction_t *red, reduce_step_t *step,
+                                   anode_t *head, int state_len )
+{
+    DdManager *manager;
+    DdNode *einit, *sinit, *init, *etrans, *strans;
+    product_t prod;
+    anode_t *node, *pnode;
+    int **succ, *succ_len;
+    int *inputs;
+    int len, num_env, num_comp;
+    int c, e, i, j, k, p, t;
+    bool found;
+
+    len = tree_size( step->vars );
+    num_env = step->num_env;
+    num_comp = 1 << len;
+
+    manager = Cudd_Init( 2*len, 0, CUDD_UNIQUE_SLOTS, CUDD_CACHE_SLOTS, 0 );
+    einit = ptree_BDD( step->env_init, step->vars, manager );
+    sinit = ptree_BDD( step->sys_init, step->vars, manager );
+    etrans = ptree_BDD( step->env_trans, step->vars, manager );
+    strans = ptree_BDD( step->sys_trans, step->vars, manager );
+    if (einit == NULL || sinit == NULL || etrans == NULL || strans == NULL) {
+        fprintf( stderr,
+                 "Error restore_component: failed to construct BDDs of"
+                 " component.\n" );
+        return NULL;
+    }
+    init = Cudd_bddAnd( manager, einit, sinit );
+    Cudd_Ref( init );
+    Cudd_RecursiveDeref( manager, einit );
+    Cudd_RecursiveDeref( manager, sinit );
+
+    prod.num_nodes = aut_size( head );
+    prod.nodes = malloc( prod.num_nodes*sizeof(anode_t *) );
+    prod.refs = malloc( prod.num_nodes*sizeof(node_ref_t) );
+    prod.values = malloc( len*sizeof(vartype) );
+    prod.pcap = (prod.num_nodes < 8) ? 16 : 2*prod.num_nodes;
+    prod.pnodes = malloc( prod.pcap*sizeof(anode_t *) );
+    prod.pnode_index = malloc( prod.pcap*sizeof(int) );
+    prod.pcomp = malloc( prod.pcap*sizeof(int) );
+    prod.tab_size = 16;
+    while (prod.tab_size < 2*prod.pcap)
+        prod.tab_size *= 2;
+    prod.tab = malloc( prod.tab_size*sizeof(int) );
+    succ = malloc( num_comp*sizeof(int *) );
+    succ_len = malloc( num_comp*sizeof(int) );
+    inputs = malloc( 2*len*sizeof(int) );
+    if (prod.nodes == NULL || prod.refs == NULL || prod.values == NULL
+        || prod.pnodes == NULL || prod.pnode_index == NULL
+        || prod.pcomp == NULL || prod.tab == NULL
+        || succ == NULL || succ_len == NULL || inputs == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    prod.positions = step->positions;
+    prod.len = len;
+    prod.state_len = state_len;
+    prod.num_pnodes = 0;
+    for (i = 0; i < prod.tab_size; i++)
+        *(prod.tab+i) = -1;
+    for (c = 0; c < num_comp; c++)
+        *(succ+c) = NULL;
+    for (i = 0, node = head; node; node = node->next, i++) {
+        *(prod.nodes+i) = node;
+        (prod.refs+i)->node = node;
+        (prod.refs+i)->index = i;
+    }
+    qsort( prod.refs, prod.num_nodes, sizeof(node_ref_t), node_ref_cmp );
+    for (i = len; i < 2*len; i++)
+        *(inputs+i) = 0;
+
+    /* Initial nodes, paired with initial valuations of the component
+       as required by the interpretation of initial conditions. */
+    for (e = 0; e < (1 << num_env); e++) {
+        found = False;
+        for (c = e; c < num_comp; c += 1 << num_env) {
+            for (i = 0; i < len; i++)
+                *(inputs+i) = (c >> i)&1;
+            if (Cudd_IsComplement( Cudd_Eval( manager, init, inputs ) ))
+                continue;
+            for (k = 0; k < prod.num_nodes; k++) {
+                if ((*(prod.nodes+k))->initial)
+                    product_get( &prod, k, c, True );
+            }
+            found = True;
+            if (red->init_flags == ALL_ENV_EXIST_SYS_INIT || red->one_side_sys)
+                break;
+        }
+        if (found && red->one_side_sys)
+            break;
+    }
+
+    /* Breadth-first construction of the reachable product */
+    for (p = 0; p < prod.num_pnodes; p++) {
+        pnode = *(prod.pnodes+p);
+        node = *(prod.nodes+*(prod.pnode_index+p));
+        c = *(prod.pcomp+p);
+        if (*(succ+c) == NULL) {
+            *(succ+c) = malloc( (1 << num_env)*sizeof(int) );
+            if (*(succ+c) == NULL) {
+                perror( __FILE__ ",  malloc" );
+                exit(-1);
+            }
+            *(succ_len+c) = component_successors( manager, etrans, strans,
+                                                  len, num_env, c,
+                                                  *(succ+c) );
+            if (*(succ_len+c) < 0) {
+                fprintf( stderr,
+                         "Error restore_component: component has no"
+                         " response to an environment move.\n" );
+                return NULL;
+            }
+        }
+
+        pnode->trans_len = node->trans_len * *(succ_len+c);
+        if (pnode->trans_len > 0) {
+            pnode->trans = malloc( pnode->trans_len*sizeof(anode_t *) );
+            if (pnode->trans == NULL) {
+                perror( __FILE__ ",  malloc" );
+                exit(-1);
+            }
+        }
+        t = 0;
+        for (j = 0; j < node->trans_len; j++) {
+            k = product_node_index( &prod, *(node->trans+j) );
+            for (i = 0; i < *(succ_len+c); i++)
+                *(pnode->trans+(t++)) = product_get( &prod, k,
+                                                     *(*(succ+c)+i), False );
+        }
+    }
+
+    if (prod.num_pnodes == 0) {
+        fprintf( stderr,
+                 "Error restore_component: no initial nodes in product.\n" );
+        return NULL;
+    }
+    for (p = 0; p < prod.num_pnodes-1; p++)
+        (*(prod.pnodes+p))->next = *(prod.pnodes+p+1);
+    delete_aut( head );
+    head = *prod.pnodes;
+
+    for (c = 0; c < num_comp; c++)
+        free( *(succ+c) );
+    free( succ );
+    free( succ_len );
+    free( inputs );
+    free( prod.nodes );
+    free( prod.refs );
+    free( prod.values );
+    free( prod.pnodes );
+    free( prod.pnode_index );
+    free( prod.pcomp );
+    free( prod.tab );
+    Cudd_RecursiveDeref( manager, init );
+    Cudd_RecursiveDeref( manager, etrans );
+    Cudd_RecursiveDeref( manager, strans );
+    Cudd_Quit( manager );
+    return head;
+}
+
+
+anode_t *reduce_restore_aut( reduction_t *red, anode_t *head )
+{
+    reduce_step_t *step;
+    int state_len, k;
+
+    for (k = red->num_steps-1; k >= 0; k--) {
+        step = red->steps+k;
+        state_len = tree_size( spc.evar_list ) + tree_size( spc.svar_list );
+        if (step->type == REDUCE_DEFINED) {
+            if (restore_defined( step, head, state_len ) < 0)
+                return NULL;
+        } else {
+            head = restore_component( red, step, head, state_len );
+            if (head == NULL)
+                return NULL;
+        }
+        restore_vars( step );
+    }
+
+    return head;
+}
+
+
+void delete_reduction( reduction_t *red )
+{
+    int k;
+    if (red == NULL)
+        return;
+    for (k = 0; k < red->num_steps; k++) {
+        delete_tree( (red->steps+k)->vars );
+        free( (red->steps+k)->positions );
+        delete_tree( (red->steps+k)->def );
+        delete_tree( (red->steps+k)->env_init );
+        delete_tree( (red->steps+k)->sys_init );
+        delete_tree( (red->steps+k)->env_trans );
+        delete_tree( (red->steps+k)->sys_trans );
+    }
+    free( red->steps );
+    free( red );
+}
@@ -18,6 +18,7 @@
 #include "solve.h"
 #include "patching.h"
 #include "gr1c_util.h"
+#include "spc_cache.h"
 extern int yyparse( void );
 
 
@@ -67,6 +68,10 @@ int main( int argc, char **argv )
     bool reading_options = True;  /* For disabling option parsing using "--" */
     int input_index = -1;
     int output_file_index = -1;  /* For command-line flag "-o". */
+    int compile_file_index = -1;  /* For command-line flag "--compile". */
+    FILE *compile_fp = NULL;
+    specification_t compiled;  /* Expanded part of compiled specification */
+    int cache_status = 0;
     char dumpfilename[64];
 
     int i, j, var_index;
@@ -170,6 +175,13 @@ int main( int argc, char **argv )
             } else if (!strncmp( argv[i]+2, "version", strlen( "version" ) )) {
                 PRINT_VERSION();
                 return 0;
+            } else if (!strncmp( argv[i]+2, "compile", strlen( "compile" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                compile_file_index = i+1;
+                i++;
             } else {
                 fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
                 return 1;
@@ -183,7 +195,7 @@ int main( int argc, char **argv )
 
     if (help_flag) {
         /* Split among printf() calls to conform with ISO C90 string length */
-        printf( "Usage: %s [-hVvls] [-t TYPE] [-o FILE] [[--] FILE]\n\n"
+        printf( "Usage: %s [-hVvls] [-t TYPE] [-o FILE] [--compile FILE] [[--] FILE]\n\n"
                 "  -h        this help message\n"
                 "  -V        print version and exit\n"
                 "  -v        be verbose\n"
@@ -196,7 +208,10 @@ int main( int argc, char **argv )
                 "  -s        only check specification syntax (return 2 on error)\n"
 /*                "  -r        only check realizability; do not synthesize strategy\n"
                 "            (return 0 if realizable, 3 if not)\n" */
-                "  -o FILE   output strategy to FILE, rather than stdout (default)\n" );
+                "  -o FILE   output strategy to FILE, rather than stdout (default)\n"
+                "  --compile FILE  write compiled specification to FILE and exit;\n"
+                "            it can be given in place of the specification to skip\n"
+                "            parsing and expansion of nonboolean variables\n" );
         return 0;
     }
 
@@ -218,12 +233,22 @@ int main( int argc, char **argv )
         }
     }
 
-    /* Parse the specification. */
-    if (verbose)
-        logprint( "Parsing input..." );
+    /* Parse the specification, or load it if compiled. */
     SPC_INIT( spc );
-    if (yyparse())
-        return 2;
+    if (spc_cache_detect( stdin )) {
+        if (verbose)
+            logprint( "Loading compiled specification..." );
+        SPC_INIT( compiled );
+        cache_status = spc_cache_load( stdin, SPC_CACHE_RG, &spc, &compiled,
+                                       init_flags, verbose );
+        if (cache_status < 0)
+            return 2;
+    } else {
+        if (verbose)
+            logprint( "Parsing input..." );
+        if (yyparse())
+            return 2;
+    }
     if (verbose)
         logprint( "Done." );
 
@@ -268,6 +293,17 @@ int main( int argc, char **argv )
         *spc.sys_trans_array = init_ptree( PT_CONSTANT, NULL, 1 );
     }
 
+    if (compile_file_index >= 0) {
+        compile_fp = fopen( argv[compile_file_index], "wb" );
+        if (compile_fp == NULL) {
+            perror( __FILE__ ",  fopen" );
+            return -1;
+        }
+        if (spc_cache_dump_source( &spc, SPC_CACHE_RG, compile_fp )) {
+            fprintf( stderr, "Error while writing compiled specification.\n" );
+            return -1;
+        }
+    }
 
     if (ptdump_flag) {
         tree_dot_dump( spc.env_init, "env_init_ptree.dot" );
@@ -388,14 +424,37 @@ int main( int argc, char **argv )
         printf( "\n" );
     }
 
-    if (expand_nonbool_GR1( spc.evar_list, spc.svar_list, &spc.env_init, &spc.sys_init,
-                            &spc.env_trans_array, &spc.et_array_len,
-                            &spc.sys_trans_array, &spc.st_array_len,
-                            &spc.env_goals, spc.num_egoals, &spc.sys_goals, spc.num_sgoals,
-                            init_flags, verbose ) < 0)
-        return -1;
-    spc.nonbool_var_list = expand_nonbool_variables( &spc.evar_list, &spc.svar_list,
-                                                     verbose );
+    if (cache_status == 1) {
+        if (verbose)
+            logprint( "Using expansion of nonboolean variables from compiled"
+                      " specification." );
+        spc_free( &spc );
+        spc = compiled;
+    } else {
+        if (expand_nonbool_GR1( spc.evar_list, spc.svar_list,
+                                &spc.env_init, &spc.sys_init,
+                                &spc.env_trans_array, &spc.et_array_len,
+                                &spc.sys_trans_array, &spc.st_array_len,
+                                &spc.env_goals, spc.num_egoals,
+                                &spc.sys_goals, spc.num_sgoals,
+                                init_flags, verbose ) < 0)
+            return -1;
+        spc.nonbool_var_list = expand_nonbool_variables( &spc.evar_list,
+                                                         &spc.svar_list,
+                                                         verbose );
+    }
+
+    if (compile_fp != NULL) {
+        if (spc_cache_dump_expanded( &spc, init_flags, compile_fp )
+            || fclose( compile_fp )) {
+            fprintf( stderr, "Error while writing compiled specification.\n" );
+            return -1;
+        }
+        if (verbose)
+            logprint( "Wrote compiled specification to \"%s\".",
+                      argv[compile_file_index] );
+        return 0;
+    }
 
     /* Merge component safety (transition) formulas */
     if (spc.et_array_len > 1) {
@@ -19,6 +19,16 @@
 
 extern specification_t spc;
 
+static uint64_t rng_state;
+static bool rng_seeded = False;
+
+
+void sim_set_seed( uint64_t seed )
+{
+    rng_state = seed;
+    rng_seeded = True;
+}
+
 
 anode_t *sim_rhc( DdManager *manager, DdNode *W,
                   DdNode *etrans, DdNode *strans, DdNode **sgoals,
@@ -31,7 +41,7 @@ anode_t *sim_rhc( DdManager *manager, DdNode *W,
     vartype *candidate_state, *next_state;
     int current_goal = 0;
     int current_it = 0, i, j;
-    vartype **env_moves;
+    vartype **env_moves, *env_move;
     int emoves_len, emove_index;
     DdNode *strans_into_W;
     double Max, Min, next_min;
@@ -61,7 +71,8 @@ anode_t *sim_rhc( DdManager *manager, DdNode *W,
     if (offw == NULL)
         return NULL;
 
-    srand( time(NULL) );
+    if (!rng_seeded)
+        sim_set_seed( time(NULL) );
     num_env = tree_size( spc.evar_list );
     num_sys = tree_size( spc.svar_list );
 
@@ -91,8 +102,9 @@ anode_t *sim_rhc( DdManager *manager, DdNode *W,
     candidate_state = malloc( (num_env+num_sys)*sizeof(vartype) );
     finit_state = malloc( (num_env+num_sys)*sizeof(vartype) );
     fnext_state = malloc( (num_env+num_sys)*sizeof(vartype) );
+    env_move = malloc( (num_env+1)*sizeof(vartype) );
     if (next_state == NULL || candidate_state == NULL || finit_state == NULL
-        || fnext_state == NULL) {
+        || fnext_state == NULL || env_move == NULL) {
         perror( __FILE__ ",  malloc" );
         exit(-1);
     }
@@ -127,6 +139,8 @@ anode_t *sim_rhc( DdManager *manager, DdNode *W,
         ddval = Cudd_Eval( manager, *(sgoals+current_goal), cube );
         if (!Cudd_IsComplement( ddval )) {
             current_goal = (current_goal+1) % spc.num_sgoals;
+            for (i = 0; i < MEM_len; i++)
+                delete_aut( *(MEM+i) );
             free( MEM );
             MEM = NULL;
             MEM_len = 0;
@@ -145,16 +159,21 @@ anode_t *sim_rhc( DdManager *manager, DdNode *W,
                                              init_state, num_env+num_sys );
         }
 
-        env_moves = get_env_moves( manager, cube,
-                                   init_state, etrans,
-                                   num_env, num_sys,
-                                   &emoves_len );
-        emove_index = rand() % emoves_len;
+        /* The environment moves at random, so only the chosen move is
+           needed. */
+        if (sample_env_move( manager, cube, init_state, etrans,
+                             num_env, num_sys, env_move, &rng_state )) {
+            fprintf( stderr,
+                     "ERROR: no environment move in sim_rhc().\n" );
+            delete_aut( play );
+            play = NULL;
+            goto gc;
+        }
 
         tmp = state_to_cof( manager, cube, 2*(num_env+num_sys), init_state,
                          strans_into_W, 0, num_env+num_sys );
         tmp2 = state_to_cof( manager, cube, 2*(num_env+num_sys),
-                          *(env_moves+emove_index), tmp,
+                          env_move, tmp,
                           num_env+num_sys, num_env );
         Cudd_RecursiveDeref( manager, tmp );
 
@@ -165,7 +184,7 @@ anode_t *sim_rhc( DdManager *manager, DdNode *W,
         Cudd_AutodynDisable( manager );
         Cudd_ForeachCube( manager, tmp2, gen, gcube, gvalue ) {
             for (i = 0; i < num_env; i++)
-                *(candidate_state+i) = *(*(env_moves+emove_index)+i);
+                *(candidate_state+i) = *(env_move+i);
             initialize_cube( candidate_state+num_env,
                              gcube+num_sys+2*num_env, num_sys );
             while (!saturated_cube( candidate_state+num_env,
@@ -227,10 +246,6 @@ anode_t *sim_rhc( DdManager *manager, DdNode *W,
             logprint( "\t%d possible states at horizon 1.",
                       aut_size( *hstacks ) );
 
-        for (i = 0; i < emoves_len; i++)
-            free( *(env_moves+i) );
-        free( env_moves );
-
         for (hdepth = 1; hdepth < horizon; hdepth++) {
 
             node = *(hstacks+hdepth-1);
@@ -362,7 +377,9 @@ anode_t *sim_rhc( DdManager *manager, DdNode *W,
             }
             if (j >= horizon) {
                 fprintf( stderr, "ERROR: failed to backtrack in sim_rhc().\n" );
-                return NULL;
+                delete_aut( play );
+                play = NULL;
+                goto gc;
             }
 
             tmp = Cudd_bddAnd( manager, etrans, strans );
@@ -387,7 +404,10 @@ anode_t *sim_rhc( DdManager *manager, DdNode *W,
                 if (prev_node == NULL) {
                     fprintf( stderr,
                              "ERROR: failed to backtrack in sim_rhc().\n" );
-                    return NULL;
+                    Cudd_RecursiveDeref( manager, tmp );
+                    delete_aut( play );
+                    play = NULL;
+                    goto gc;
                 }
             }
             for (i = 0; i < num_env+num_sys; i++)
@@ -404,12 +424,19 @@ anode_t *sim_rhc( DdManager *manager, DdNode *W,
             *(init_state+i) = *(next_state+i);
     }
 
-
+    /* The "gc" label abbreviates "garbage collection". */
+  gc:
     Cudd_RecursiveDeref( manager, strans_into_W );
+    for (i = 0; i < MEM_len; i++)
+        delete_aut( *(MEM+i) );
+    free( MEM );
+    for (i = 0; i < horizon; i++)
+        delete_aut( *(hstacks+i) );
     free( next_state );
     free( candidate_state );
     free( finit_state );
     free( fnext_state );
+    free( env_move );
     free( hstacks );
     free( cube );
     free( offw );
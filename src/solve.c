@@ -12,6 +12,7 @@
 #include <assert.h>
 
 #include "logging.h"
+#include "perfstat.h"
 #include "solve.h"
 #include "solve_support.h"
 #include "automaton.h"
@@ -52,6 +53,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
     int emoves_len;
 
     ptree_t *var_separator;
+    pdag_t *dag;
     DdNode *W;
     DdNode *strans_into_W;
 
@@ -124,27 +126,30 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
         var_separator->left = spc.svar_list;
     }
 
-    /* Generate BDDs for the various parse trees from the problem spec. */
+    /* Generate BDDs for the various parse trees from the problem spec.
+       Subformulas common to several of them are built only once. */
+    perfstat_begin( "bdd_build", -1 );
+    dag = init_pdag( spc.evar_list, manager );
     if (spc.env_init != NULL) {
-        einit = ptree_BDD( spc.env_init, spc.evar_list, manager );
+        einit = pdag_BDD( dag, spc.env_init );
     } else {
         einit = Cudd_ReadOne( manager );
         Cudd_Ref( einit );
     }
     if (spc.sys_init != NULL) {
-        sinit = ptree_BDD( spc.sys_init, spc.evar_list, manager );
+        sinit = pdag_BDD( dag, spc.sys_init );
     } else {
         sinit = Cudd_ReadOne( manager );
         Cudd_Ref( sinit );
     }
     if (verbose > 1)
         logprint( "Building environment transition BDD..." );
-    etrans = ptree_BDD( spc.env_trans, spc.evar_list, manager );
+    etrans = pdag_BDD( dag, spc.env_trans );
     if (verbose > 1) {
         logprint( "Done." );
         logprint( "Building system transition BDD..." );
     }
-    strans = ptree_BDD( spc.sys_trans, spc.evar_list, manager );
+    strans = pdag_BDD( dag, spc.sys_trans );
     if (verbose > 1)
         logprint( "Done." );
 
@@ -152,18 +157,21 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
     if (spc.num_egoals > 0) {
         egoals = malloc( spc.num_egoals*sizeof(DdNode *) );
         for (i = 0; i < spc.num_egoals; i++)
-            *(egoals+i) = ptree_BDD( *(spc.env_goals+i), spc.evar_list, manager );
+            *(egoals+i) = pdag_BDD( dag, *(spc.env_goals+i) );
     } else {
         egoals = NULL;
     }
     if (spc.num_sgoals > 0) {
         sgoals = malloc( spc.num_sgoals*sizeof(DdNode *) );
         for (i = 0; i < spc.num_sgoals; i++)
-            *(sgoals+i) = ptree_BDD( *(spc.sys_goals+i), spc.evar_list, manager );
+            *(sgoals+i) = pdag_BDD( dag, *(spc.sys_goals+i) );
     } else {
         sgoals = NULL;
     }
 
+    delete_pdag( dag );
+    perfstat_end();
+
     if (var_separator == NULL) {
         spc.evar_list = NULL;
     } else {
@@ -190,6 +198,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
         free( cube );
         return NULL;
     }
+    perfstat_begin( "enumerate", -1 );
 
     /* The sublevel sets are exactly as resulting from the vanilla
        fixed point formula.  Thus for each system goal i, Y_0 = \emptyset,
@@ -237,6 +246,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                  " forms.\n" );
         free( state );
         free( cube );
+        perfstat_end();
         return NULL;
     }
     Cudd_Ref( tmp );
@@ -274,6 +284,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                     fprintf( stderr,
                              "Error synthesize: building list of initial"
                              " states.\n" );
+                    perfstat_end();
                     return NULL;
                 }
                 increment_cube( state, gcube, num_env+num_sys );
@@ -284,6 +295,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                 fprintf( stderr,
                          "Error synthesize: building list of initial"
                          " states.\n" );
+                perfstat_end();
                 return NULL;
             }
         }
@@ -303,12 +315,14 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
         tmp2 = Cudd_CubeArrayToBdd( manager, cube );
         if (tmp2 == NULL) {
             fprintf( stderr, "Error in generating cube for quantification.\n" );
+            perfstat_end();
             return NULL;
         }
         Cudd_Ref( tmp2 );
         tmp = Cudd_bddExistAbstract( manager, einit, tmp2 );
         if (tmp == NULL) {
             fprintf( stderr, "Error in performing quantification.\n" );
+            perfstat_end();
             return NULL;
         }
         Cudd_Ref( tmp );
@@ -324,6 +338,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                     fprintf( stderr,
                              "Error synthesize: building list of initial"
                              " states.\n" );
+                    perfstat_end();
                     return NULL;
                 }
                 increment_cube( state, gcube, num_env );
@@ -334,6 +349,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                 fprintf( stderr,
                          "Error synthesize: building list of initial"
                          " states.\n" );
+                perfstat_end();
                 return NULL;
             }
         }
@@ -352,6 +368,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
             tmp2 = Cudd_CubeArrayToBdd( manager, cube );
             if (tmp2 == NULL) {
                 fprintf( stderr, "Error in generating cube for cofactor.\n" );
+                perfstat_end();
                 return NULL;
             }
             Cudd_Ref( tmp2 );
@@ -359,6 +376,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
             tmp = Cudd_Cofactor( manager, W, tmp2 );
             if (tmp == NULL) {
                 fprintf( stderr, "Error in computing cofactor.\n" );
+                perfstat_end();
                 return NULL;
             }
             Cudd_Ref( tmp );
@@ -372,12 +390,14 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
             gen = Cudd_FirstCube( manager, tmp2, &gcube, &gvalue );
             if (gen == NULL) {
                 fprintf( stderr, "Error synthesize: failed to find cube.\n" );
+                perfstat_end();
                 return NULL;
             }
             if (Cudd_IsGenEmpty( gen )) {
                 fprintf( stderr,
                          "Error synthesize: unexpected losing initial"
                          " environment state found.\n" );
+                perfstat_end();
                 return NULL;
             }
             initialize_cube( state, gcube, num_env+num_sys );
@@ -402,11 +422,13 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
         gen = Cudd_FirstCube( manager, tmp, &gcube, &gvalue );
         if (gen == NULL) {
             fprintf( stderr, "Error synthesize: failed to find cube.\n" );
+            perfstat_end();
             return NULL;
         }
         if (Cudd_IsGenEmpty( gen )) {
             fprintf( stderr,
                      "Error synthesize: no winning initial state found.\n" );
+            perfstat_end();
             return NULL;
         }
         initialize_cube( state, gcube, num_env+num_sys );
@@ -415,6 +437,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
         if (this_node_stack == NULL) {
             fprintf( stderr,
                      "Error synthesize: building list of initial states.\n" );
+            perfstat_end();
             return NULL;
         }
         Cudd_GenFree( gen );
@@ -422,6 +445,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
         Cudd_RecursiveDeref( manager, tmp );
     } else {
         fprintf( stderr, "Error: Unrecognized init_flags %d", init_flags );
+        perfstat_end();
         return NULL;
     }
 
@@ -439,6 +463,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
             fprintf( stderr,
                      "Error synthesize: inserting state node into"
                      " strategy.\n" );
+            perfstat_end();
             return NULL;
         }
         node = node->next;
@@ -519,6 +544,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                         fprintf( stderr,
                                  "Error synthesize: inserting state node into"
                                  " strategy.\n" );
+                        perfstat_end();
                         return NULL;
                     }
                     new_node = find_anode( strategy, this_node_stack->mode,
@@ -558,6 +584,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                 fprintf( stderr,
                          "Error synthesize: Error in swapping variables with"
                          " primed forms.\n" );
+                perfstat_end();
                 return NULL;
             }
             Cudd_Ref( Y_i_primed );
@@ -581,6 +608,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
             gen = Cudd_FirstCube( manager, tmp, &gcube, &gvalue );
             if (gen == NULL) {
                 fprintf( stderr, "Error synthesize: failed to find cube.\n" );
+                perfstat_end();
                 return NULL;
             }
             if (Cudd_IsGenEmpty( gen )) {
@@ -600,6 +628,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                             fprintf( stderr,
                                      "Error synthesize: Error in swapping"
                                      " variables with primed forms.\n" );
+                            perfstat_end();
                             return NULL;
                         }
                         Cudd_Ref( Y_i_primed );
@@ -632,6 +661,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                         fprintf( stderr,
                                  "Error synthesize: unexpected losing"
                                  " state.\n" );
+                        perfstat_end();
                         return NULL;
                     }
                 } else {
@@ -660,12 +690,14 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                 if (gen == NULL) {
                     fprintf( stderr,
                              "Error synthesize: failed to find cube.\n" );
+                    perfstat_end();
                     return NULL;
                 }
                 if (Cudd_IsGenEmpty( gen )) {
                     Cudd_GenFree( gen );
                     fprintf( stderr,
                              "Error synthesize: unexpected losing state.\n" );
+                    perfstat_end();
                     return NULL;
                 }
                 for (i = 0; i < 2*(num_env+num_sys); i++)
@@ -711,6 +743,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                     fprintf( stderr,
                              "Error synthesize: inserting new node into"
                              " strategy.\n" );
+                    perfstat_end();
                     return NULL;
                 }
                 this_node_stack = insert_anode( this_node_stack, next_mode, -1,
@@ -720,6 +753,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                     fprintf( stderr,
                              "Error synthesize: pushing node onto stack"
                              " failed.\n" );
+                    perfstat_end();
                     return NULL;
                 }
             }
@@ -732,6 +766,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                 fprintf( stderr,
                          "Error synthesize: inserting new transition into"
                          " strategy.\n" );
+                perfstat_end();
                 return NULL;
             }
 
@@ -786,7 +821,7 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
         delete_tree( *spc.env_goals );
         free( spc.env_goals );
     }
-
+    perfstat_end();
 
     return strategy;
 }
@@ -22,6 +22,14 @@
 
 extern specification_t spc;
 
+static int num_threads = 1;  /* Threads of compute_minmax() */
+
+
+void metric_set_threads( int n )
+{
+    num_threads = (n < 1) ? 1 : n;
+}
+
 
 int *get_offsets( char *metric_vars, int *num_vars )
 {
@@ -94,201 +102,278 @@ int *get_offsets( char *metric_vars, int *num_vars )
 }
 
 
-int bounds_state( DdManager *manager, DdNode *T, vartype *ref_state,
-                  int *offw, int num_metric_vars,
-                  double *Min, double *Max, unsigned char verbose )
+/* Return referenced ADD of the value (as given by bitvec_to_int()) of
+   the i-th metric variable, in the copy of variables that begins at
+   index base, i.e., 0 for unprimed and num_env+num_sys for primed. */
+static DdNode *metric_var_ADD( DdManager *manager, int *offw, int i, int base )
 {
-    vartype *state;
-    double dist;
+    DdNode *value, *var, *weight, *term, *tmp;
+    int b;
+
+    value = Cudd_ReadZero( manager );
+    Cudd_Ref( value );
+    for (b = 0; b < *(offw+2*i+1); b++) {
+        var = Cudd_addIthVar( manager, base+*(offw+2*i)+b );
+        Cudd_Ref( var );
+        weight = Cudd_addConst( manager, (1 << b) );
+        Cudd_Ref( weight );
+        term = Cudd_addApply( manager, Cudd_addTimes, var, weight );
+        Cudd_Ref( term );
+        Cudd_RecursiveDeref( manager, var );
+        Cudd_RecursiveDeref( manager, weight );
+        tmp = Cudd_addApply( manager, Cudd_addPlus, value, term );
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, value );
+        Cudd_RecursiveDeref( manager, term );
+        value = tmp;
+    }
+    return value;
+}
+
+/* Return referenced ADD of the 1-norm distance over the metric
+   variables between unprimed variables and the reference ref_mapped
+   (values of metric variables), or if ref_mapped is NULL, between
+   unprimed and primed variables. */
+static DdNode *distance_ADD( DdManager *manager, int *offw, int num_metric_vars,
+                             int *ref_mapped )
+{
+    DdNode *dist, *this_value, *ref_value, *diff, *tmp;
     int num_env, num_sys;
     int i;
-    int *ref_mapped, *this_mapped;
-
-    /* Variables used during CUDD generation (state enumeration). */
-    DdGen *gen;
-    CUDD_VALUE_TYPE gvalue;
-    int *gcube;
 
     num_env = tree_size( spc.evar_list );
     num_sys = tree_size( spc.svar_list );
 
-    /* State vector (i.e., valuation of the variables) */
-    state = malloc( sizeof(vartype)*(num_env+num_sys) );
-    if (state == NULL) {
-        perror( __FILE__ ",  malloc" );
-        exit(-1);
+    dist = Cudd_ReadZero( manager );
+    Cudd_Ref( dist );
+    for (i = 0; i < num_metric_vars; i++) {
+        this_value = metric_var_ADD( manager, offw, i, 0 );
+        if (ref_mapped != NULL) {
+            ref_value = Cudd_addConst( manager, *(ref_mapped+i) );
+            Cudd_Ref( ref_value );
+        } else {
+            ref_value = metric_var_ADD( manager, offw, i, num_env+num_sys );
+        }
+        diff = Cudd_addApply( manager, Cudd_addMinus, this_value, ref_value );
+        Cudd_Ref( diff );
+        Cudd_RecursiveDeref( manager, this_value );
+        Cudd_RecursiveDeref( manager, ref_value );
+
+        /* |diff| = max(diff, -diff) */
+        tmp = Cudd_addNegate( manager, diff );
+        Cudd_Ref( tmp );
+        this_value = Cudd_addApply( manager, Cudd_addMaximum, diff, tmp );
+        Cudd_Ref( this_value );
+        Cudd_RecursiveDeref( manager, diff );
+        Cudd_RecursiveDeref( manager, tmp );
+
+        tmp = Cudd_addApply( manager, Cudd_addPlus, dist, this_value );
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, dist );
+        Cudd_RecursiveDeref( manager, this_value );
+        dist = tmp;
     }
+    return dist;
+}
 
-    /* Reference and particular integral vectors */
-    ref_mapped = malloc( num_metric_vars*sizeof(int) );
-    this_mapped = malloc( num_metric_vars*sizeof(int) );
-    if (ref_mapped == NULL || this_mapped == NULL) {
+/* Return referenced ADD of the 1-norm distance over the metric
+   variables from each state to the set G.  States are over unprimed
+   variables.  The distance is infinite if G is empty. */
+static DdNode *distance_to_set_ADD( DdManager *manager, DdNode *G,
+                                    int *offw, int num_metric_vars )
+{
+    DdNode *dist, *G_add, *cube, *tmp, *lit, *f0, *f1;
+    DdNode **vars, **pvars;
+    int *indices;
+    bool *is_metric;
+    int num_env, num_sys;
+    int i, b, k, num_indices;
+
+    num_env = tree_size( spc.evar_list );
+    num_sys = tree_size( spc.svar_list );
+
+    vars = malloc( 2*(num_env+num_sys)*sizeof(DdNode *) );
+    indices = malloc( 2*(num_env+num_sys)*sizeof(int) );
+    is_metric = malloc( (num_env+num_sys)*sizeof(bool) );
+    if (vars == NULL || indices == NULL || is_metric == NULL) {
         perror( __FILE__ ",  malloc" );
         exit(-1);
     }
-
-    for (i = 0; i < num_metric_vars; i++)
-        *(ref_mapped+i) = bitvec_to_int( ref_state+(*(offw+2*i)),
-                                         *(offw+2*i+1) );
-    *Min = *Max = -1.;  /* Distance is non-negative; thus use -1 as "unset". */
-
-    Cudd_AutodynDisable( manager );
-    Cudd_ForeachCube( manager, T, gen, gcube, gvalue ) {
-        initialize_cube( state, gcube, num_env+num_sys );
-        while (!saturated_cube( state, gcube, num_env+num_sys )) {
-
-            for (i = 0; i < num_metric_vars; i++)
-                *(this_mapped+i) = bitvec_to_int( state+(*(offw+2*i)),
-                                                  *(offw+2*i+1) );
-
-            /* 2-norm derived metric */
-            /* dist = 0.; */
-            /* for (i = 0; i < num_metric_vars; i++) */
-            /*     dist += pow(*(this_mapped+i) - *(ref_mapped+i), 2); */
-            /* dist = sqrt( dist ); */
-
-            /* 1-norm derived metric */
-            dist = 0.;
-            for (i = 0; i < num_metric_vars; i++)
-                dist += abs(*(this_mapped+i) - *(ref_mapped+i));
-            if (*Min == -1. || dist < *Min)
-                *Min = dist;
-            if (*Max == -1. || dist > *Max)
-                *Max = dist;
-
-            increment_cube( state, gcube, num_env+num_sys );
+    pvars = vars+num_env+num_sys;
+    for (i = 0; i < num_env+num_sys; i++)
+        *(is_metric+i) = False;
+
+    /* Project G onto the metric variables, and move it to the primed
+       copy of them. */
+    k = 0;
+    for (i = 0; i < num_metric_vars; i++) {
+        for (b = 0; b < *(offw+2*i+1); b++) {
+            *(vars+k) = Cudd_bddIthVar( manager, *(offw+2*i)+b );
+            *(pvars+k) = Cudd_bddIthVar( manager,
+                                         num_env+num_sys+*(offw+2*i)+b );
+            *(is_metric+*(offw+2*i)+b) = True;
+            k++;
         }
+    }
+    num_indices = 0;
+    for (i = 0; i < 2*(num_env+num_sys); i++) {
+        if (i >= num_env+num_sys || !*(is_metric+i))
+            *(indices+(num_indices++)) = i;
+    }
+    cube = Cudd_IndicesToCube( manager, indices, num_indices );
+    Cudd_Ref( cube );
+    tmp = Cudd_bddExistAbstract( manager, G, cube );
+    Cudd_Ref( tmp );
+    Cudd_RecursiveDeref( manager, cube );
+    G_add = Cudd_bddSwapVariables( manager, tmp, vars, pvars, k );
+    Cudd_Ref( G_add );
+    Cudd_RecursiveDeref( manager, tmp );
+    tmp = Cudd_BddToAdd( manager, G_add );
+    Cudd_Ref( tmp );
+    Cudd_RecursiveDeref( manager, G_add );
+    G_add = tmp;
+
+    /* Distance to each state of G, and infinity elsewhere */
+    tmp = distance_ADD( manager, offw, num_metric_vars, NULL );
+    dist = Cudd_addIte( manager, G_add, tmp, Cudd_ReadPlusInfinity( manager ) );
+    Cudd_Ref( dist );
+    Cudd_RecursiveDeref( manager, tmp );
+    Cudd_RecursiveDeref( manager, G_add );
+
+    /* Minimize over the primed variables. */
+    for (b = 0; b < k; b++) {
+        lit = Cudd_addIthVar( manager, Cudd_NodeReadIndex( *(pvars+b) ) );
+        Cudd_Ref( lit );
+        f1 = Cudd_Cofactor( manager, dist, lit );
+        Cudd_Ref( f1 );
+        tmp = Cudd_addCmpl( manager, lit );
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, lit );
+        f0 = Cudd_Cofactor( manager, dist, tmp );
+        Cudd_Ref( f0 );
+        Cudd_RecursiveDeref( manager, tmp );
+        tmp = Cudd_addApply( manager, Cudd_addMinimum, f0, f1 );
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, f0 );
+        Cudd_RecursiveDeref( manager, f1 );
+        Cudd_RecursiveDeref( manager, dist );
+        dist = tmp;
+    }
 
-        for (i = 0; i < num_metric_vars; i++)
-            *(this_mapped+i) = bitvec_to_int( state+(*(offw+2*i)),
-                                              *(offw+2*i+1) );
-
-        /* 2-norm derived metric */
-        /* dist = 0.; */
-        /* for (i = 0; i < num_metric_vars; i++) */
-        /*     dist += pow(*(this_mapped+i) - *(ref_mapped+i), 2); */
-        /* dist = sqrt( dist ); */
+    free( vars );
+    free( indices );
+    free( is_metric );
+    return dist;
+}
 
-        /* 1-norm derived metric */
-        dist = 0.;
-        for (i = 0; i < num_metric_vars; i++)
-            dist += abs(*(this_mapped+i) - *(ref_mapped+i));
-        if (*Min == -1. || dist < *Min)
-            *Min = dist;
-        if (*Max == -1. || dist > *Max)
-            *Max = dist;
+/* Find the minimum and maximum of the ADD dist over the states in T.
+   Both are -1 if T is empty or the distance is infinite. */
+static void ADD_bounds( DdManager *manager, DdNode *dist, DdNode *T,
+                        double *Min, double *Max )
+{
+    DdNode *T_add, *tmp, *bound;
 
+    *Min = *Max = -1.;  /* Distance is non-negative; thus use -1 as "unset". */
+    if (T == Cudd_Not( Cudd_ReadOne( manager ) ))
+        return;
+    T_add = Cudd_BddToAdd( manager, T );
+    Cudd_Ref( T_add );
+
+    tmp = Cudd_addIte( manager, T_add, dist, Cudd_ReadPlusInfinity( manager ) );
+    Cudd_Ref( tmp );
+    bound = Cudd_addFindMin( manager, tmp );
+    if (bound != Cudd_ReadPlusInfinity( manager )) {
+        *Min = Cudd_V( bound );
+        Cudd_RecursiveDeref( manager, tmp );
+        tmp = Cudd_addIte( manager, T_add, dist,
+                           Cudd_ReadMinusInfinity( manager ) );
+        Cudd_Ref( tmp );
+        *Max = Cudd_V( Cudd_addFindMax( manager, tmp ) );
     }
-    Cudd_AutodynEnable( manager, CUDD_REORDER_SAME );
-
-    free( state );
-    free( ref_mapped );
-    free( this_mapped );
-    return 0;
+    Cudd_RecursiveDeref( manager, tmp );
+    Cudd_RecursiveDeref( manager, T_add );
 }
 
 
-int bounds_DDset( DdManager *manager, DdNode *T, DdNode *G,
+int bounds_state( DdManager *manager, DdNode *T, vartype *ref_state,
                   int *offw, int num_metric_vars,
                   double *Min, double *Max, unsigned char verbose )
 {
-    vartype **states = NULL;
-    int num_states = 0;
-    vartype *state;
-    double tMin, tMax;  /* Particular distance to goal set */
-    int num_env, num_sys;
-    int i, k;
-    int *mapped_state;
-
-    /* Variables used during CUDD generation (state enumeration). */
-    DdGen *gen;
-    CUDD_VALUE_TYPE gvalue;
-    int *gcube;
-
-    num_env = tree_size( spc.evar_list );
-    num_sys = tree_size( spc.svar_list );
+    DdNode *dist;
+    int i;
+    int *ref_mapped;
 
-    state = malloc( (num_env+num_sys)*sizeof(vartype) );
-    if (state == NULL) {
+    ref_mapped = malloc( num_metric_vars*sizeof(int) );
+    if (ref_mapped == NULL) {
         perror( __FILE__ ",  malloc" );
         exit(-1);
     }
+    for (i = 0; i < num_metric_vars; i++)
+        *(ref_mapped+i) = bitvec_to_int( ref_state+(*(offw+2*i)),
+                                         *(offw+2*i+1) );
 
-    *Min = *Max = -1.;  /* Distance is non-negative; thus use -1 as "unset". */
-
-    Cudd_AutodynDisable( manager );
-    Cudd_ForeachCube( manager, T, gen, gcube, gvalue ) {
-        initialize_cube( state, gcube, num_env+num_sys );
-        while (!saturated_cube( state, gcube, num_env+num_sys )) {
+    /* 1-norm derived metric */
+    dist = distance_ADD( manager, offw, num_metric_vars, ref_mapped );
+    ADD_bounds( manager, dist, T, Min, Max );
+    Cudd_RecursiveDeref( manager, dist );
 
-            num_states++;
-            states = realloc( states, num_states*sizeof(vartype *) );
-            if (states == NULL) {
-                perror( __FILE__ ",  realloc" );
-                exit(-1);
-            }
-            *(states+num_states-1) = malloc( (num_env+num_sys)
-                                             *sizeof(vartype) );
-            if (*(states+num_states-1) == NULL) {
-                perror( __FILE__ ",  malloc" );
-                exit(-1);
-            }
-            for (i = 0; i < num_env+num_sys; i++)
-                *(*(states+num_states-1)+i) = *(state+i);
+    free( ref_mapped );
+    return 0;
+}
 
-            increment_cube( state, gcube, num_env+num_sys );
-        }
 
-        num_states++;
-        states = realloc( states, num_states*sizeof(vartype *) );
-        if (states == NULL) {
-            perror( __FILE__ ",  realloc" );
-            exit(-1);
-        }
+int bounds_DDset( DdManager *manager, DdNode *T, DdNode *G,
+                  int *offw, int num_metric_vars,
+                  double *Min, double *Max, unsigned char verbose )
+{
+    DdNode *dist;
 
-        *(states+num_states-1) = malloc( (num_env+num_sys)*sizeof(vartype) );
-        if (*(states+num_states-1) == NULL) {
-            perror( __FILE__ ",  malloc" );
-            exit(-1);
-        }
-        for (i = 0; i < num_env+num_sys; i++)
-            *(*(states+num_states-1)+i) = *(state+i);
+    dist = distance_to_set_ADD( manager, G, offw, num_metric_vars );
+    ADD_bounds( manager, dist, T, Min, Max );
+    Cudd_RecursiveDeref( manager, dist );
+    if (verbose > 1)
+        logprint( "Distances to goal set: min %f, max %f", *Min, *Max );
+    return 0;
+}
 
-    }
-    Cudd_AutodynEnable( manager, CUDD_REORDER_SAME );
 
-    mapped_state = malloc( num_metric_vars*sizeof(int) );
-    if (mapped_state == NULL) {
-        perror( __FILE__ ",  malloc" );
-        exit(-1);
-    }
-    for (k = 0; k < num_states; k++) {
-        bounds_state( manager, G, *(states+k), offw, num_metric_vars,
-                      &tMin, &tMax, verbose );
-        if (*Min == -1. || tMin < *Min)
-            *Min = tMin;
-        if (*Max == -1. || tMin > *Max)
-            *Max = tMin;
-
-        if (verbose > 1) {
-            for (i = 0; i < num_metric_vars; i++)
-                *(mapped_state+i) = bitvec_to_int( *(states+k)+(*(offw+2*i)),
-                                                   *(offw+2*i+1) );
-            logprint_startline();
-            logprint_raw( "\t" );
-            for (i = 0; i < num_metric_vars; i++)
-                logprint_raw( "%d, ", *(mapped_state+i) );
-            logprint_raw( "mi = %f", tMin );
-            logprint_endline();
+/* Distance bounds of sublevel sets that are found in one thread,
+   using a manager of its own */
+typedef struct {
+    DdManager *manager;
+    DdNode **G;  /* Goal set of each system goal, or NULL if not used */
+    DdNode **T;  /* Sublevel set of each pair */
+    int *goals;  /* System goal of each pair */
+    double **Min, **Max;  /* Where results of each pair are written */
+    int len;
+    int *offw;
+    int num_metric_vars;
+} minmax_worker_t;
+
+static void *minmax_worker( void *arg )
+{
+    minmax_worker_t *worker = (minmax_worker_t *)arg;
+    DdNode *dist = NULL;
+    int goal = -1;
+    int k;
+
+    /* Pairs of the same goal are consecutive, so the distance to the
+       goal is computed once for each of them. */
+    for (k = 0; k < worker->len; k++) {
+        if (*(worker->goals+k) != goal) {
+            if (dist != NULL)
+                Cudd_RecursiveDeref( worker->manager, dist );
+            goal = *(worker->goals+k);
+            dist = distance_to_set_ADD( worker->manager, *(worker->G+goal),
+                                        worker->offw,
+                                        worker->num_metric_vars );
         }
+        ADD_bounds( worker->manager, dist, *(worker->T+k),
+                    *(worker->Min+k), *(worker->Max+k) );
     }
-
-    free( mapped_state );
-    for (i = 0; i < num_states; i++)
-        free( *(states+i) );
-    free( states );
-    free( state );
-    return 0;
+    if (dist != NULL)
+        Cudd_RecursiveDeref( worker->manager, dist );
+    return NULL;
 }
 
 
@@ -303,6 +388,7 @@ DdNode *compute_winning_set_saveBDDs( DdManager *manager,
 {
     int i;
     ptree_t *var_separator;
+    pdag_t *dag;
     DdNode *W;
 
     if (spc.num_egoals == 0) {
@@ -326,14 +412,15 @@ DdNode *compute_winning_set_saveBDDs( DdManager *manager,
         var_separator->left = spc.svar_list;
     }
 
+    dag = init_pdag( spc.evar_list, manager );
     if (verbose > 1)
         logprint( "Building environment transition BDD..." );
-    (*etrans) = ptree_BDD( spc.env_trans, spc.evar_list, manager );
+    (*etrans) = pdag_BDD( dag, spc.env_trans );
     if (verbose > 1) {
         logprint( "Done." );
         logprint( "Building system transition BDD..." );
     }
-    (*strans) = ptree_BDD( spc.sys_trans, spc.evar_list, manager );
+    (*strans) = pdag_BDD( dag, spc.sys_trans );
     if (verbose > 1)
         logprint( "Done." );
 
@@ -341,18 +428,20 @@ DdNode *compute_winning_set_saveBDDs( DdManager *manager,
     if (spc.num_egoals > 0) {
         (*egoals) = malloc( spc.num_egoals*sizeof(DdNode *) );
         for (i = 0; i < spc.num_egoals; i++)
-            *((*egoals)+i) = ptree_BDD( *(spc.env_goals+i), spc.evar_list, manager );
+            *((*egoals)+i) = pdag_BDD( dag, *(spc.env_goals+i) );
     } else {
         (*egoals) = NULL;
     }
     if (spc.num_sgoals > 0) {
         (*sgoals) = malloc( spc.num_sgoals*sizeof(DdNode *) );
         for (i = 0; i < spc.num_sgoals; i++)
-            *((*sgoals)+i) = ptree_BDD( *(spc.sys_goals+i), spc.evar_list, manager );
+            *((*sgoals)+i) = pdag_BDD( dag, *(spc.sys_goals+i) );
     } else {
         (*sgoals) = NULL;
     }
 
+    delete_pdag( dag );
+
     if (var_separator == NULL) {
         spc.evar_list = NULL;
     } else {
@@ -373,7 +462,7 @@ DdNode *compute_winning_set_saveBDDs( DdManager *manager,
 }
 
 
-int compute_minmax( DdManager *manager,DdNode **W,
+int compute_minmax( DdManager *manager, DdNode **W,
                     DdNode **etrans, DdNode **strans, DdNode ***sgoals,
                     int **num_sublevels, double ***Min, double ***Max,
                     int *offw, int num_metric_vars,
@@ -384,7 +473,12 @@ int compute_minmax( DdManager *manager,DdNode **W,
     DdNode ****X_ijr = NULL;
     bool env_nogoal_flag = False;
     int i, j, r;
-    DdNode *tmp, *tmp2;
+    DdNode **G, **T;
+    int *goals;
+    double **Min_p, **Max_p;
+    int num_pairs, num_workers, num_vars;
+    minmax_worker_t *workers;
+    int k;
 
     if (spc.num_egoals == 0)
         env_nogoal_flag = True;
@@ -417,22 +511,130 @@ int compute_minmax( DdManager *manager,DdNode **W,
         }
 
         *(*(*Min+i)) = *(*(*Max+i)) = 0;
+    }
+
+    /* Each pair of system goal and sublevel is independent of the
+       others.  Pairs are listed in order of goal. */
+    num_pairs = 0;
+    for (i = 0; i < spc.num_sgoals; i++) {
+        if (*(*num_sublevels+i) > 2)
+            num_pairs += *(*num_sublevels+i)-2;
+    }
+    G = malloc( (spc.num_sgoals+1)*sizeof(DdNode *) );
+    T = malloc( (num_pairs+1)*sizeof(DdNode *) );
+    goals = malloc( (num_pairs+1)*sizeof(int) );
+    Min_p = malloc( (num_pairs+1)*sizeof(double *) );
+    Max_p = malloc( (num_pairs+1)*sizeof(double *) );
+    if (G == NULL || T == NULL || goals == NULL
+        || Min_p == NULL || Max_p == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    k = 0;
+    for (i = 0; i < spc.num_sgoals; i++) {
+        *(G+i) = Cudd_bddAnd( manager, *((*sgoals)+i), *W );
+        Cudd_Ref( *(G+i) );
         for (j = 1; j < *(*num_sublevels+i)-1; j++) {
             if (verbose > 1)
                 logprint( "goal %d, level %d...", i, j );
-            tmp = Cudd_bddAnd( manager,
-                               *(*(Y+i)+j+1), Cudd_Not( *(*(Y+i)+j) ) );
-            Cudd_Ref( tmp );
-            tmp2 = Cudd_bddAnd( manager, *((*sgoals)+i), *W );
-            Cudd_Ref( tmp2 );
-            if (bounds_DDset( manager, tmp, tmp2, offw, num_metric_vars,
-                              *(*Min+i)+j, *(*Max+i)+j, verbose )) {
-                *(*(*Min+i)+j) = *(*(*Max+i)+j) = -1.;
+            *(T+k) = Cudd_bddAnd( manager,
+                                  *(*(Y+i)+j+1), Cudd_Not( *(*(Y+i)+j) ) );
+            Cudd_Ref( *(T+k) );
+            *(goals+k) = i;
+            *(Min_p+k) = *(*Min+i)+j;
+            *(Max_p+k) = *(*Max+i)+j;
+            k++;
+        }
+    }
+
+    num_workers = (num_threads < num_pairs) ? num_threads : num_pairs;
+    if (num_workers < 1)
+        num_workers = 1;
+    workers = malloc( num_workers*sizeof(minmax_worker_t) );
+    if (workers == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+
+    /* Workers get contiguous ranges of pairs, so that few goals are
+       shared among them. */
+    for (i = 0; i < num_workers; i++) {
+        k = num_pairs*i/num_workers;
+        (workers+i)->len = num_pairs*(i+1)/num_workers - k;
+        (workers+i)->goals = goals+k;
+        (workers+i)->Min = Min_p+k;
+        (workers+i)->Max = Max_p+k;
+        (workers+i)->offw = offw;
+        (workers+i)->num_metric_vars = num_metric_vars;
+        if (num_workers == 1) {
+            (workers+i)->manager = manager;
+            (workers+i)->G = G;
+            (workers+i)->T = T+k;
+        }
+    }
+
+    if (num_workers == 1) {
+        minmax_worker( workers );
+    } else {
+        if (verbose)
+            logprint( "Computing distance bounds of %d sublevel sets in %d"
+                      " threads...", num_pairs, num_workers );
+
+        /* Each worker gets a copy of its sublevel and goal sets. */
+        num_vars = Cudd_ReadSize( manager );
+        for (i = 0; i < num_workers; i++) {
+            (workers+i)->manager = worker_manager( manager, num_vars );
+            (workers+i)->G = malloc( (spc.num_sgoals+1)*sizeof(DdNode *) );
+            (workers+i)->T = malloc( ((workers+i)->len+1)*sizeof(DdNode *) );
+            if ((workers+i)->G == NULL || (workers+i)->T == NULL) {
+                perror( __FILE__ ",  malloc" );
+                exit(-1);
+            }
+            for (j = 0; j < spc.num_sgoals; j++)
+                *((workers+i)->G+j) = NULL;
+            k = (workers+i)->goals - goals;
+            for (j = 0; j < (workers+i)->len; j++) {
+                *((workers+i)->T+j) = Cudd_bddTransfer( manager,
+                                                        (workers+i)->manager,
+                                                        *(T+k+j) );
+                Cudd_Ref( *((workers+i)->T+j) );
+                if (*((workers+i)->G + *(goals+k+j)) == NULL) {
+                    *((workers+i)->G + *(goals+k+j))
+                        = Cudd_bddTransfer( manager, (workers+i)->manager,
+                                            *(G + *(goals+k+j)) );
+                    Cudd_Ref( *((workers+i)->G + *(goals+k+j)) );
+                }
+            }
+        }
+
+        run_workers( minmax_worker, workers, sizeof(minmax_worker_t),
+                     num_workers );
+
+        for (i = 0; i < num_workers; i++) {
+            for (j = 0; j < (workers+i)->len; j++)
+                Cudd_RecursiveDeref( (workers+i)->manager,
+                                     *((workers+i)->T+j) );
+            for (j = 0; j < spc.num_sgoals; j++) {
+                if (*((workers+i)->G+j) != NULL)
+                    Cudd_RecursiveDeref( (workers+i)->manager,
+                                         *((workers+i)->G+j) );
             }
-            Cudd_RecursiveDeref( manager, tmp );
-            Cudd_RecursiveDeref( manager, tmp2 );
+            free( (workers+i)->G );
+            free( (workers+i)->T );
+            Cudd_Quit( (workers+i)->manager );
         }
     }
+    free( workers );
+
+    for (k = 0; k < num_pairs; k++)
+        Cudd_RecursiveDeref( manager, *(T+k) );
+    for (i = 0; i < spc.num_sgoals; i++)
+        Cudd_RecursiveDeref( manager, *(G+i) );
+    free( G );
+    free( T );
+    free( goals );
+    free( Min_p );
+    free( Max_p );
 
 
     /* Pre-exit clean-up */
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 
 #include "logging.h"
+#include "perfstat.h"
 #include "solve.h"
 #include "solve_support.h"
 
@@ -22,6 +23,7 @@ DdNode *compute_winning_set( DdManager *manager, unsigned char verbose )
 {
     int i;
     ptree_t *var_separator;
+    pdag_t *dag;
     DdNode *W;  /* Characteristic function of winning set */
     DdNode *etrans, *strans, **egoals, **sgoals;
     bool env_nogoal_flag = False;  /* Indicate environment has no goals */
@@ -52,15 +54,18 @@ DdNode *compute_winning_set( DdManager *manager, unsigned char verbose )
         var_separator->left = spc.svar_list;
     }
 
-    /* Generate BDDs for the various parse trees from the problem spec. */
+    /* Generate BDDs for the various parse trees from the problem spec.
+       Subformulas common to several of them are built only once. */
+    perfstat_begin( "bdd_build", -1 );
+    dag = init_pdag( spc.evar_list, manager );
     if (verbose > 1)
         logprint( "Building environment transition BDD..." );
-    etrans = ptree_BDD( spc.env_trans, spc.evar_list, manager );
+    etrans = pdag_BDD( dag, spc.env_trans );
     if (verbose > 1) {
         logprint( "Done." );
         logprint( "Building system transition BDD..." );
     }
-    strans = ptree_BDD( spc.sys_trans, spc.evar_list, manager );
+    strans = pdag_BDD( dag, spc.sys_trans );
     if (verbose > 1)
         logprint( "Done." );
 
@@ -68,18 +73,21 @@ DdNode *compute_winning_set( DdManager *manager, unsigned char verbose )
     if (spc.num_egoals > 0) {
         egoals = malloc( spc.num_egoals*sizeof(DdNode *) );
         for (i = 0; i < spc.num_egoals; i++)
-            *(egoals+i) = ptree_BDD( *(spc.env_goals+i), spc.evar_list, manager );
+            *(egoals+i) = pdag_BDD( dag, *(spc.env_goals+i) );
     } else {
         egoals = NULL;
     }
     if (spc.num_sgoals > 0) {
         sgoals = malloc( spc.num_sgoals*sizeof(DdNode *) );
         for (i = 0; i < spc.num_sgoals; i++)
-            *(sgoals+i) = ptree_BDD( *(spc.sys_goals+i), spc.evar_list, manager );
+            *(sgoals+i) = pdag_BDD( dag, *(spc.sys_goals+i) );
     } else {
         sgoals = NULL;
     }
 
+    delete_pdag( dag );
+    perfstat_end();
+
     /* Break the link that appended the system variables list to the
        environment variables list. */
     if (var_separator == NULL) {
@@ -111,10 +119,23 @@ DdNode *compute_winning_set( DdManager *manager, unsigned char verbose )
 }
 
 
-DdNode *compute_winning_set_BDD( DdManager *manager,
-                                 DdNode *etrans, DdNode *strans,
-                                 DdNode **egoals, DdNode **sgoals,
-                                 unsigned char verbose )
+/* Compute the fixpoint Z_i for each system goal i, of which Z_0 is
+   the winning set.  If Z_init is not NULL, then iteration of Z begins
+   there instead of at True, which is correct if Z_init contains the
+   result, e.g., if it is the result for a game in which the system
+   has more moves or the environment fewer.  Similarly, if Y_init is
+   not NULL, then each least fixpoint Y_i begins there instead of at
+   False, which is correct if Y_init is Y_last from a game in which
+   the system has fewer moves or the environment more.  If Y_last is
+   not NULL, then Y_i from the last iteration of Z is stored there,
+   after dereferencing any previous element.  Return array of Z_i,
+   which the caller should dereference and free, or NULL if error. */
+static DdNode **winning_set_fixpoint( DdManager *manager,
+                                      DdNode *etrans, DdNode *strans,
+                                      DdNode **egoals, DdNode **sgoals,
+                                      DdNode **Z_init, DdNode **Y_init,
+                                      DdNode **Y_last,
+                                      unsigned char verbose )
 {
     DdNode *X = NULL, *X_prev = NULL;
     DdNode *Y = NULL, *Y_exmod = NULL, *Y_prev = NULL;
@@ -170,13 +191,14 @@ DdNode *compute_winning_set_BDD( DdManager *manager,
 
     /* Initialize */
     for (i = 0; i < spc.num_sgoals; i++) {
-        *(Z+i) = Cudd_ReadOne( manager );
+        *(Z+i) = (Z_init != NULL) ? *(Z_init+i) : Cudd_ReadOne( manager );
         Cudd_Ref( *(Z+i) );
     }
 
     num_it_Z = 0;
     do {
         num_it_Z++;
+        perfstat_begin( "fixpoint_Z", num_it_Z );
         if (verbose > 1) {
             logprint( "Z iteration %d", num_it_Z );
             logprint( "Cudd_ReadMemoryInUse (bytes): %d",
@@ -200,18 +222,24 @@ DdNode *compute_winning_set_BDD( DdManager *manager,
             }
             if (*(Z+i) == NULL) {
                 /* fatal error */
+                perfstat_end();
                 return NULL;
             }
 
             /* (Re)initialize Y */
             if (Y != NULL)
                 Cudd_RecursiveDeref( manager, Y );
-            Y = Cudd_Not( Cudd_ReadOne( manager ) );
+            if (Y_init != NULL) {
+                Y = *(Y_init+i);
+            } else {
+                Y = Cudd_Not( Cudd_ReadOne( manager ) );
+            }
             Cudd_Ref( Y );
 
             num_it_Y = 0;
             do {
                 num_it_Y++;
+                perfstat_begin( "fixpoint_Y", num_it_Y );
                 if (verbose > 1) {
                     logprint( "\tY iteration %d", num_it_Y );
                     logprint( "\tCudd_ReadMemoryInUse (bytes): %d",
@@ -227,6 +255,8 @@ DdNode *compute_winning_set_BDD( DdManager *manager,
                                                num_env, num_sys, cube );
                 if (Y_exmod == NULL) {
                     /* fatal error */
+                    perfstat_end();
+                    perfstat_end();
                     return NULL;
                 }
 
@@ -244,6 +274,7 @@ DdNode *compute_winning_set_BDD( DdManager *manager,
                     num_it_X = 0;
                     do {
                         num_it_X++;
+                        perfstat_begin( "fixpoint_X", num_it_X );
                         if (verbose > 1) {
                             logprint( "\t\tX iteration %d", num_it_X );
                             logprint( "\t\tCudd_ReadMemoryInUse (bytes): %d",
@@ -258,6 +289,9 @@ DdNode *compute_winning_set_BDD( DdManager *manager,
                                                  num_env, num_sys, cube );
                         if (X == NULL) {
                             /* fatal error */
+                            perfstat_end();
+                            perfstat_end();
+                            perfstat_end();
                             return NULL;
                         }
 
@@ -281,6 +315,7 @@ DdNode *compute_winning_set_BDD( DdManager *manager,
                         X = Cudd_bddAnd( manager, X, X_prev );
                         Cudd_Ref( X );
                         Cudd_RecursiveDeref( manager, tmp );
+                        perfstat_end();
 
                     } while (!Cudd_bddLeq( manager, X, X_prev )
                              || !Cudd_bddLeq( manager, X_prev, X ));
@@ -300,6 +335,7 @@ DdNode *compute_winning_set_BDD( DdManager *manager,
                 Y = Cudd_bddOr( manager, Y, Y_prev );
                 Cudd_Ref( Y );
                 Cudd_RecursiveDeref( manager, tmp2 );
+                perfstat_end();
 
             } while (!Cudd_bddLeq( manager, Y, Y_prev )
                      || !Cudd_bddLeq( manager, Y_prev, Y ));
@@ -308,7 +344,13 @@ DdNode *compute_winning_set_BDD( DdManager *manager,
             *(Z+i) = Cudd_bddAnd( manager, Y, *(Z_prev+i) );
             Cudd_Ref( *(Z+i) );
 
-            Cudd_RecursiveDeref( manager, Y );
+            if (Y_last != NULL) {
+                if (*(Y_last+i) != NULL)
+                    Cudd_RecursiveDeref( manager, *(Y_last+i) );
+                *(Y_last+i) = Y;
+            } else {
+                Cudd_RecursiveDeref( manager, Y );
+            }
             Y = NULL;
             Cudd_RecursiveDeref( manager, Y_prev );
             Y_prev = NULL;
@@ -325,20 +367,126 @@ DdNode *compute_winning_set_BDD( DdManager *manager,
                 break;
             }
         }
+        perfstat_end();
     } while (Z_changed);
 
     /* Pre-exit clean-up */
-    tmp = *Z;
-    Cudd_RecursiveDeref( manager, *Z_prev );
-    for (i = 1; i < spc.num_sgoals; i++) {
-        Cudd_RecursiveDeref( manager, *(Z+i) );
+    for (i = 0; i < spc.num_sgoals; i++)
         Cudd_RecursiveDeref( manager, *(Z_prev+i) );
-    }
-    free( Z );
     free( Z_prev );
     free( cube );
 
-    return tmp;
+    return Z;
+}
+
+
+DdNode *compute_winning_set_BDD( DdManager *manager,
+                                 DdNode *etrans, DdNode *strans,
+                                 DdNode **egoals, DdNode **sgoals,
+                                 unsigned char verbose )
+{
+    DdNode **Z, *W;
+    int i;
+
+    Z = winning_set_fixpoint( manager, etrans, strans, egoals, sgoals,
+                              NULL, NULL, NULL, verbose );
+    if (Z == NULL)
+        return NULL;
+    W = *Z;
+    for (i = 1; i < spc.num_sgoals; i++)
+        Cudd_RecursiveDeref( manager, *(Z+i) );
+    free( Z );
+    return W;
+}
+
+
+void winning_incr_clear( DdManager *manager, winning_incr_t *incr )
+{
+    int i;
+    if (incr->Z != NULL) {
+        for (i = 0; i < incr->num_sgoals; i++) {
+            Cudd_RecursiveDeref( manager, *(incr->Z+i) );
+            Cudd_RecursiveDeref( manager, *(incr->Y+i) );
+        }
+        free( incr->Z );
+        free( incr->Y );
+        Cudd_RecursiveDeref( manager, incr->etrans );
+        Cudd_RecursiveDeref( manager, incr->strans );
+    }
+    WINNING_INCR_INIT( *incr );
+}
+
+
+DdNode *compute_winning_set_incr( DdManager *manager, winning_incr_t *incr,
+                                  DdNode *etrans, DdNode *strans,
+                                  DdNode **egoals, DdNode **sgoals,
+                                  unsigned char verbose )
+{
+    DdNode **Z, **Y_last;
+    bool shrink = False, grow = False;
+    int i;
+
+    if (incr->Z != NULL && incr->num_sgoals == spc.num_sgoals) {
+        /* Removing moves of the system or adding moves of the
+           environment cannot enlarge the winning set, and conversely. */
+        shrink = Cudd_bddLeq( manager, strans, incr->strans )
+            && Cudd_bddLeq( manager, incr->etrans, etrans );
+        grow = Cudd_bddLeq( manager, incr->strans, strans )
+            && Cudd_bddLeq( manager, etrans, incr->etrans );
+    } else {
+        winning_incr_clear( manager, incr );
+    }
+
+    if (shrink && grow) {
+        if (verbose)
+            logprint( "Transition rules unchanged; reusing winning set." );
+        Cudd_Ref( *incr->Z );
+        return *incr->Z;
+    }
+
+    Y_last = malloc( (spc.num_sgoals+1)*sizeof(DdNode *) );
+    if (Y_last == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < spc.num_sgoals; i++)
+        *(Y_last+i) = NULL;
+
+    if (shrink) {
+        if (verbose)
+            logprint( "Continuing greatest fixpoint from previous winning"
+                      " set..." );
+        Z = winning_set_fixpoint( manager, etrans, strans, egoals, sgoals,
+                                  incr->Z, NULL, Y_last, verbose );
+    } else if (grow) {
+        if (verbose)
+            logprint( "Beginning least fixpoints from those of previous"
+                      " winning set..." );
+        Z = winning_set_fixpoint( manager, etrans, strans, egoals, sgoals,
+                                  NULL, incr->Y, Y_last, verbose );
+    } else {
+        if (verbose && incr->Z != NULL)
+            logprint( "Transition rules changed in both directions;"
+                      " solving from scratch..." );
+        Z = winning_set_fixpoint( manager, etrans, strans, egoals, sgoals,
+                                  NULL, NULL, Y_last, verbose );
+    }
+    winning_incr_clear( manager, incr );
+    if (Z == NULL) {
+        free( Y_last );
+        return NULL;
+    }
+
+    incr->Z = Z;
+    incr->Y = Y_last;
+    incr->num_sgoals = spc.num_sgoals;
+    incr->etrans = etrans;
+    Cudd_Ref( incr->etrans );
+    incr->strans = strans;
+    Cudd_Ref( incr->strans );
+
+    Cudd_Ref( *Z );
+    return *Z;
 }
 
 
@@ -434,6 +582,7 @@ DdNode ***compute_sublevel_sets( DdManager *manager,
     for (i = 0; i < num_sys_goals; i++) {
         while (True) {
             (*(*num_sublevels+i))++;
+            perfstat_begin( "sublevel_sets", *(*num_sublevels+i)-1 );
             *(Y+i) = realloc( *(Y+i), *(*num_sublevels+i)*sizeof(DdNode *) );
             *(*X_ijr+i) = realloc( *(*X_ijr+i),
                                    *(*num_sublevels+i)*sizeof(DdNode **) );
@@ -473,6 +622,7 @@ DdNode ***compute_sublevel_sets( DdManager *manager,
                                              num_env, num_sys, cube );
                     if (X == NULL) {
                         /* fatal error */
+                        perfstat_end();
                         return NULL;
                     }
 
@@ -520,6 +670,7 @@ DdNode ***compute_sublevel_sets( DdManager *manager,
                               *(*(Y+i)+*(*num_sublevels+i)-2) );
             Cudd_Ref( *(*(Y+i)+*(*num_sublevels+i)-1) );
             Cudd_RecursiveDeref( manager, tmp );
+            perfstat_end();
 
             if (Cudd_bddLeq( manager, *(*(Y+i)+*(*num_sublevels+i)-1),
                              *(*(Y+i)+*(*num_sublevels+i)-2))
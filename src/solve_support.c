@@ -8,8 +8,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
 
 #include "solve_support.h"
+#include "gr1c_util.h"
 
 
 int read_state_str( char *input, vartype **state, int max_len )
@@ -293,6 +295,89 @@ vartype **get_env_moves( DdManager *manager, int *cube,
 }
 
 
+int sample_minterm( DdManager *manager, DdNode *f, int *vars, int num_vars,
+                    vartype *assignment, uint64_t *rng )
+{
+    DdNode *g, *g0, *g1, *var;
+    double count0, count1;
+    int i;
+
+    if (f == Cudd_Not( Cudd_ReadOne( manager ) ))
+        return -1;
+
+    /* Choose values one variable at a time, with probability of each
+       value proportional to the number of satisfying assignments of
+       the remaining variables. */
+    g = f;
+    Cudd_Ref( g );
+    for (i = 0; i < num_vars; i++) {
+        var = Cudd_bddIthVar( manager, *(vars+i) );
+        g1 = Cudd_Cofactor( manager, g, var );
+        Cudd_Ref( g1 );
+        g0 = Cudd_Cofactor( manager, g, Cudd_Not( var ) );
+        Cudd_Ref( g0 );
+        count1 = Cudd_CountMinterm( manager, g1, num_vars-i-1 );
+        count0 = Cudd_CountMinterm( manager, g0, num_vars-i-1 );
+        Cudd_RecursiveDeref( manager, g );
+        if (rng_uniform( rng )*(count0+count1) < count1) {
+            *(assignment+i) = 1;
+            g = g1;
+            Cudd_RecursiveDeref( manager, g0 );
+        } else {
+            *(assignment+i) = 0;
+            g = g0;
+            Cudd_RecursiveDeref( manager, g1 );
+        }
+    }
+    Cudd_RecursiveDeref( manager, g );
+    return 0;
+}
+
+
+int sample_env_move( DdManager *manager, int *cube,
+                     vartype *state, DdNode *etrans,
+                     int num_env, int num_sys, vartype *env_move,
+                     uint64_t *rng )
+{
+    DdNode *tmp, *tmp2, *ddcube;
+    int *vars;
+    int i, result;
+
+    tmp = state_to_cof( manager, cube, 2*(num_env+num_sys),
+                        state, etrans, 0, num_env+num_sys );
+    cube_prime_sys( cube, num_env, num_sys );
+    ddcube = Cudd_CubeArrayToBdd( manager, cube );
+    if (ddcube == NULL) {
+        fprintf( stderr, "Error in generating cube for quantification." );
+        Cudd_RecursiveDeref( manager, tmp );
+        return -1;
+    }
+    Cudd_Ref( ddcube );
+    tmp2 = Cudd_bddExistAbstract( manager, tmp, ddcube );
+    if (tmp2 == NULL) {
+        fprintf( stderr, "Error in performing quantification." );
+        Cudd_RecursiveDeref( manager, tmp );
+        Cudd_RecursiveDeref( manager, ddcube );
+        return -1;
+    }
+    Cudd_Ref( tmp2 );
+    Cudd_RecursiveDeref( manager, tmp );
+    Cudd_RecursiveDeref( manager, ddcube );
+
+    vars = malloc( (num_env+1)*sizeof(int) );
+    if (vars == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < num_env; i++)
+        *(vars+i) = num_env+num_sys+i;
+    result = sample_minterm( manager, tmp2, vars, num_env, env_move, rng );
+    free( vars );
+    Cudd_RecursiveDeref( manager, tmp2 );
+    return result;
+}
+
+
 /* Compute exists modal operator applied to set C. */
 DdNode *compute_existsmodal( DdManager *manager, DdNode *C,
                              DdNode *etrans, DdNode *strans,
@@ -355,3 +440,53 @@ DdNode *compute_existsmodal( DdManager *manager, DdNode *C,
     Cudd_RecursiveDeref( manager, tmp );
     return tmp2;
 }
+
+
+DdManager *worker_manager( DdManager *manager, int num_vars )
+{
+    DdManager *wmanager;
+    Cudd_ReorderingType method;
+
+    wmanager = Cudd_Init( num_vars, 0, CUDD_UNIQUE_SLOTS, CUDD_CACHE_SLOTS, 0 );
+    if (wmanager == NULL) {
+        fprintf( stderr, "Error: failed to create CUDD manager.\n" );
+        exit(-1);
+    }
+    Cudd_SetMaxCacheHard( wmanager, (unsigned int)-1 );
+    if (Cudd_ReorderingStatus( manager, &method ))
+        Cudd_AutodynEnable( wmanager, method );
+    return wmanager;
+}
+
+
+void run_workers( void *(*worker)( void * ), void *args, size_t size,
+                  int num_workers )
+{
+    pthread_t *threads;
+    bool *started;
+    int i;
+
+    if (num_workers == 1) {
+        worker( args );
+        return;
+    }
+
+    threads = malloc( num_workers*sizeof(pthread_t) );
+    started = malloc( num_workers*sizeof(bool) );
+    if (threads == NULL || started == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < num_workers; i++) {
+        *(started+i) = !pthread_create( threads+i, NULL, worker,
+                                        (char *)args + i*size );
+        if (!*(started+i))
+            worker( (char *)args + i*size );
+    }
+    for (i = 0; i < num_workers; i++) {
+        if (*(started+i))
+            pthread_join( *(threads+i), NULL );
+    }
+    free( threads );
+    free( started );
+}
@@ -0,0 +1,441 @@
+/* spc_cache.c -- Reading and writing of compiled specifications.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "ptree.h"
+#include "logging.h"
+#include "gr1c_util.h"
+#include "spc_cache.h"
+
+
+#define SPC_CACHE_BYTE_ORDER 0x01020304
+
+/* Tag of the optional part following the source part */
+#define SPC_SECTION_EXPANDED 1
+
+/* Flags of each parse tree node in the file */
+#define SPC_NODE_LEFT 1
+#define SPC_NODE_RIGHT 2
+#define SPC_NODE_NAME 4
+
+/* Bound on the length of variable names, to catch corrupt files */
+#define SPC_MAX_NAME_LEN (1 << 20)
+
+
+static int write_u32( uint32_t x, FILE *fp )
+{
+    return fwrite( &x, sizeof(x), 1, fp ) != 1;
+}
+
+static int write_i32( int32_t x, FILE *fp )
+{
+    return fwrite( &x, sizeof(x), 1, fp ) != 1;
+}
+
+static int read_u32( uint32_t *x, FILE *fp )
+{
+    return fread( x, sizeof(*x), 1, fp ) != 1;
+}
+
+static int read_i32( int32_t *x, FILE *fp )
+{
+    return fread( x, sizeof(*x), 1, fp ) != 1;
+}
+
+
+/* Write the tree in prefix order, left before right.  An explicit
+   stack is used because formulas may be very deep, e.g., long chains
+   of conjunctions. */
+static int write_tree( ptree_t *head, FILE *fp )
+{
+    ptree_t **stack = NULL, **tmp;
+    int stack_len = 0, stack_cap = 0;
+    ptree_t *node;
+    unsigned char flags;
+    size_t name_len;
+
+    flags = (head != NULL);
+    if (fwrite( &flags, 1, 1, fp ) != 1)
+        return -1;
+    if (head == NULL)
+        return 0;
+
+    node = head;
+    while (node != NULL) {
+        flags = 0;
+        if (node->left != NULL)
+            flags |= SPC_NODE_LEFT;
+        if (node->right != NULL)
+            flags |= SPC_NODE_RIGHT;
+        if (node->name != NULL)
+            flags |= SPC_NODE_NAME;
+        if (write_i32( node->type, fp ) || write_i32( node->value, fp )
+            || fwrite( &flags, 1, 1, fp ) != 1) {
+            free( stack );
+            return -1;
+        }
+        if (node->name != NULL) {
+            name_len = strlen( node->name );
+            if (write_u32( name_len, fp )
+                || fwrite( node->name, 1, name_len, fp ) != name_len) {
+                free( stack );
+                return -1;
+            }
+        }
+
+        if (node->right != NULL) {
+            if (stack_len == stack_cap) {
+                stack_cap = (stack_cap == 0) ? 64 : 2*stack_cap;
+                tmp = realloc( stack, stack_cap*sizeof(ptree_t *) );
+                if (tmp == NULL) {
+                    perror( __FILE__ ",  realloc" );
+                    exit(-1);
+                }
+                stack = tmp;
+            }
+            *(stack+stack_len) = node->right;
+            stack_len++;
+        }
+        if (node->left != NULL) {
+            node = node->left;
+        } else if (stack_len > 0) {
+            stack_len--;
+            node = *(stack+stack_len);
+        } else {
+            node = NULL;
+        }
+    }
+
+    free( stack );
+    return 0;
+}
+
+
+/* Read a tree written by write_tree() into *head.  Return nonzero on
+   error, in which case *head is NULL. */
+static int read_tree( ptree_t **head, FILE *fp )
+{
+    ptree_t ***stack = NULL, ***tmp;  /* Slots to be filled */
+    int stack_len = 0, stack_cap = 0;
+    ptree_t **slot;
+    ptree_t *node;
+    int32_t type, value;
+    uint32_t name_len;
+    unsigned char flags;
+
+    *head = NULL;
+    if (fread( &flags, 1, 1, fp ) != 1)
+        return -1;
+    if (flags == 0)
+        return 0;
+
+    slot = head;
+    while (slot != NULL) {
+        if (read_i32( &type, fp ) || read_i32( &value, fp )
+            || fread( &flags, 1, 1, fp ) != 1
+            || type < PT_EMPTY || type > PT_NOTEQ)
+            goto error;
+
+        node = malloc( sizeof(ptree_t) );
+        if (node == NULL) {
+            perror( __FILE__ ",  malloc" );
+            exit(-1);
+        }
+        node->type = type;
+        node->value = value;
+        node->name = NULL;
+        node->left = node->right = NULL;
+        *slot = node;
+
+        if (flags & SPC_NODE_NAME) {
+            if (read_u32( &name_len, fp ) || name_len > SPC_MAX_NAME_LEN)
+                goto error;
+            node->name = malloc( name_len+1 );
+            if (node->name == NULL) {
+                perror( __FILE__ ",  malloc" );
+                exit(-1);
+            }
+            if (fread( node->name, 1, name_len, fp ) != name_len)
+                goto error;
+            *(node->name+name_len) = '\0';
+        }
+
+        if (flags & SPC_NODE_RIGHT) {
+            if (stack_len == stack_cap) {
+                stack_cap = (stack_cap == 0) ? 64 : 2*stack_cap;
+                tmp = realloc( stack, stack_cap*sizeof(ptree_t **) );
+                if (tmp == NULL) {
+                    perror( __FILE__ ",  realloc" );
+                    exit(-1);
+                }
+                stack = tmp;
+            }
+            *(stack+stack_len) = &(node->right);
+            stack_len++;
+        }
+        if (flags & SPC_NODE_LEFT) {
+            slot = &(node->left);
+        } else if (stack_len > 0) {
+            stack_len--;
+            slot = *(stack+stack_len);
+        } else {
+            slot = NULL;
+        }
+    }
+
+    free( stack );
+    return 0;
+
+  error:
+    free( stack );
+    delete_tree( *head );
+    *head = NULL;
+    return -1;
+}
+
+
+static int write_tree_array( ptree_t **array, int len, FILE *fp )
+{
+    int i;
+    if (write_i32( len, fp ))
+        return -1;
+    for (i = 0; i < len; i++) {
+        if (write_tree( *(array+i), fp ))
+            return -1;
+    }
+    return 0;
+}
+
+
+static int read_tree_array( ptree_t ***array, int *len, FILE *fp )
+{
+    int32_t n;
+    int i;
+
+    *array = NULL;
+    *len = 0;
+    if (read_i32( &n, fp ) || n < 0)
+        return -1;
+    if (n == 0)
+        return 0;
+    *array = malloc( n*sizeof(ptree_t *) );
+    if (*array == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < n; i++)
+        *(*array+i) = NULL;
+    *len = n;
+    for (i = 0; i < n; i++) {
+        if (read_tree( *array+i, fp ))
+            return -1;
+    }
+    return 0;
+}
+
+
+static int write_spec( specification_t *spec, bool with_nonbool, FILE *fp )
+{
+    if (write_tree( spec->evar_list, fp )
+        || write_tree( spec->svar_list, fp )
+        || (with_nonbool && write_tree( spec->nonbool_var_list, fp ))
+        || write_tree( spec->env_init, fp )
+        || write_tree( spec->sys_init, fp )
+        || write_tree_array( spec->env_trans_array, spec->et_array_len, fp )
+        || write_tree_array( spec->sys_trans_array, spec->st_array_len, fp )
+        || write_tree_array( spec->env_goals, spec->num_egoals, fp )
+        || write_tree_array( spec->sys_goals, spec->num_sgoals, fp ))
+        return -1;
+    return 0;
+}
+
+
+/* On error, the partially read specification is freed. */
+static int read_spec( specification_t *spec, bool with_nonbool, FILE *fp )
+{
+    if (read_tree( &(spec->evar_list), fp )
+        || read_tree( &(spec->svar_list), fp )
+        || (with_nonbool && read_tree( &(spec->nonbool_var_list), fp ))
+        || read_tree( &(spec->env_init), fp )
+        || read_tree( &(spec->sys_init), fp )
+        || read_tree_array( &(spec->env_trans_array), &(spec->et_array_len), fp )
+        || read_tree_array( &(spec->sys_trans_array), &(spec->st_array_len), fp )
+        || read_tree_array( &(spec->env_goals), &(spec->num_egoals), fp )
+        || read_tree_array( &(spec->sys_goals), &(spec->num_sgoals), fp )) {
+        spc_free( spec );
+        return -1;
+    }
+    return 0;
+}
+
+
+bool spc_cache_detect( FILE *fp )
+{
+    int c = getc( fp );
+    if (c == EOF)
+        return False;
+    ungetc( c, fp );
+    return c == (unsigned char)*SPC_CACHE_MAGIC;
+}
+
+
+int spc_cache_dump_source( specification_t *spec, int kind, FILE *fp )
+{
+    if (fwrite( SPC_CACHE_MAGIC, 1, SPC_CACHE_MAGIC_LEN, fp )
+        != SPC_CACHE_MAGIC_LEN
+        || write_u32( SPC_CACHE_VERSION, fp )
+        || write_u32( SPC_CACHE_BYTE_ORDER, fp )
+        || write_i32( kind, fp )
+        || write_spec( spec, False, fp ))
+        return -1;
+    return 0;
+}
+
+
+int spc_cache_dump_expanded( specification_t *spec, unsigned char init_flags,
+                             FILE *fp )
+{
+    ptree_t *var;
+
+    if (write_u32( SPC_SECTION_EXPANDED, fp )
+        || write_u32( init_flags, fp )
+        || write_i32( tree_size( spec->nonbool_var_list ), fp ))
+        return -1;
+    for (var = spec->nonbool_var_list; var != NULL; var = var->left) {
+        if (write_i32( get_nonbool_encoding( var->name ), fp ))
+            return -1;
+    }
+    if (write_spec( spec, True, fp ))
+        return -1;
+    return 0;
+}
+
+
+int spc_cache_load( FILE *fp, int kind,
+                    specification_t *source, specification_t *expanded,
+                    unsigned char init_flags, unsigned char verbose )
+{
+    char magic[SPC_CACHE_MAGIC_LEN];
+    uint32_t version, byte_order, tag, file_init_flags;
+    int32_t file_kind, num_nonbool, enc;
+    int *encodings;
+    ptree_t *var;
+    bool matches;
+    int i;
+
+    if (fread( magic, 1, SPC_CACHE_MAGIC_LEN, fp ) != SPC_CACHE_MAGIC_LEN
+        || memcmp( magic, SPC_CACHE_MAGIC, SPC_CACHE_MAGIC_LEN )
+        || read_u32( &version, fp ) || read_u32( &byte_order, fp )
+        || read_i32( &file_kind, fp )) {
+        fprintf( stderr, "Error: not a compiled specification.\n" );
+        return -1;
+    }
+    if (byte_order != SPC_CACHE_BYTE_ORDER) {
+        fprintf( stderr,
+                 "Error: compiled specification was written with different"
+                 " byte order.\n" );
+        return -1;
+    }
+    if (version != SPC_CACHE_VERSION) {
+        fprintf( stderr,
+                 "Error: unsupported compiled specification version %d.\n",
+                 (int)version );
+        return -1;
+    }
+    if (kind != SPC_CACHE_ANY && file_kind != kind) {
+        fprintf( stderr,
+                 "Error: compiled specification is for a different kind"
+                 " of game.\n" );
+        return -1;
+    }
+
+    if (read_spec( source, False, fp )) {
+        fprintf( stderr, "Error: compiled specification is corrupt.\n" );
+        return -1;
+    }
+    if (verbose > 1)
+        logprint( "Loaded source part of compiled specification." );
+
+    if (expanded == NULL || read_u32( &tag, fp ))
+        return 0;
+    if (tag != SPC_SECTION_EXPANDED || read_u32( &file_init_flags, fp )
+        || read_i32( &num_nonbool, fp ) || num_nonbool < 0) {
+        fprintf( stderr, "Error: compiled specification is corrupt.\n" );
+        spc_free( source );
+        return -1;
+    }
+    encodings = malloc( (num_nonbool+1)*sizeof(int) );
+    if (encodings == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < num_nonbool; i++) {
+        if (read_i32( &enc, fp )) {
+            fprintf( stderr, "Error: compiled specification is corrupt.\n" );
+            free( encodings );
+            spc_free( source );
+            return -1;
+        }
+        *(encodings+i) = enc;
+    }
+
+    if (read_spec( expanded, True, fp )) {
+        fprintf( stderr, "Error: compiled specification is corrupt.\n" );
+        free( encodings );
+        spc_free( source );
+        return -1;
+    }
+
+    /* The expansion is only usable if it would be the same as that
+       obtained now from the source part. */
+    matches = (file_init_flags == init_flags
+               && tree_size( expanded->nonbool_var_list ) == num_nonbool);
+    for (var = expanded->nonbool_var_list, i = 0; matches && var != NULL;
+         var = var->left, i++) {
+        if (get_nonbool_encoding( var->name ) != *(encodings+i))
+            matches = False;
+    }
+    free( encodings );
+    if (!matches) {
+        if (verbose)
+            logprint( "Expanded part of compiled specification was made with"
+                      " other options; ignoring it." );
+        spc_free( expanded );
+        return 0;
+    }
+    if (verbose > 1)
+        logprint( "Loaded expanded part of compiled specification." );
+    return 1;
+}
+
+
+void spc_free( specification_t *spec )
+{
+    int i;
+
+    delete_tree( spec->nonbool_var_list );
+    delete_tree( spec->evar_list );
+    delete_tree( spec->svar_list );
+    delete_tree( spec->env_init );
+    delete_tree( spec->sys_init );
+    for (i = 0; i < spec->et_array_len; i++)
+        delete_tree( *(spec->env_trans_array+i) );
+    free( spec->env_trans_array );
+    for (i = 0; i < spec->st_array_len; i++)
+        delete_tree( *(spec->sys_trans_array+i) );
+    free( spec->sys_trans_array );
+    for (i = 0; i < spec->num_egoals; i++)
+        delete_tree( *(spec->env_goals+i) );
+    free( spec->env_goals );
+    for (i = 0; i < spec->num_sgoals; i++)
+        delete_tree( *(spec->sys_goals+i) );
+    free( spec->sys_goals );
+    free( spec->offw );
+    SPC_INIT( (*spec) );
+}
@@ -5,8 +5,10 @@
  */
 
 
+#define _POSIX_C_SOURCE 200809L
 #define _ISOC99_SOURCE
 #include <math.h>
+#include <ctype.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -53,6 +55,217 @@ vartype *int_to_bitvec( int x, int vec_len )
 }
 
 
+int nonbool_to_int( vartype *vec, int vec_len, int encoding )
+{
+    int i, result;
+    switch (encoding) {
+    case NONBOOL_ENC_BINARY:
+        return bitvec_to_int( vec, vec_len );
+
+    case NONBOOL_ENC_GRAY:
+        result = bitvec_to_int( vec, vec_len );
+        for (i = result >> 1; i > 0; i >>= 1)
+            result ^= i;
+        return result;
+
+    case NONBOOL_ENC_ONEHOT:
+        result = -1;
+        for (i = 0; i < vec_len; i++) {
+            if (*(vec+i)) {
+                if (result >= 0)
+                    return -1;
+                result = i;
+            }
+        }
+        return result;
+
+    default:
+        return -1;
+    }
+}
+
+
+vartype *int_to_nonbool( int x, int vec_len, int encoding )
+{
+    int i;
+    vartype *vec;
+    switch (encoding) {
+    case NONBOOL_ENC_BINARY:
+        return int_to_bitvec( x, vec_len );
+
+    case NONBOOL_ENC_GRAY:
+        return int_to_bitvec( x ^ (x >> 1), vec_len );
+
+    case NONBOOL_ENC_ONEHOT:
+        if (vec_len < 1)
+            return NULL;
+        vec = malloc( vec_len*sizeof(vartype) );
+        if (vec == NULL) {
+            perror( __FILE__ ",  malloc" );
+            exit(-1);
+        }
+        for (i = 0; i < vec_len; i++)
+            *(vec+i) = (i == x);
+        return vec;
+
+    default:
+        return NULL;
+    }
+}
+
+
+/* splitmix64, as described by Steele, Lea, and Flood (2014), "Fast
+   splittable pseudorandom number generators". */
+uint64_t rng_next( uint64_t *state )
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+
+double rng_uniform( uint64_t *state )
+{
+    return (rng_next( state ) >> 11) * (1.0/9007199254740992.0);  /* 2^-53 */
+}
+
+
+/* Encodings chosen for particular variables; others use the default. */
+static int default_encoding = NONBOOL_ENC_BINARY;
+static char **encoding_names = NULL;
+static int *encodings = NULL;
+static int num_encodings = 0;
+
+int set_nonbool_encoding( char *name, int encoding )
+{
+    int i;
+    if (nonbool_num_bits( 1, encoding ) < 0)
+        return -1;
+    if (name == NULL) {
+        default_encoding = encoding;
+        return 0;
+    }
+
+    for (i = 0; i < num_encodings; i++) {
+        if (!strcmp( *(encoding_names+i), name )) {
+            *(encodings+i) = encoding;
+            return 0;
+        }
+    }
+    num_encodings++;
+    encoding_names = realloc( encoding_names, num_encodings*sizeof(char *) );
+    encodings = realloc( encodings, num_encodings*sizeof(int) );
+    if (encoding_names == NULL || encodings == NULL) {
+        perror( __FILE__ ",  realloc" );
+        exit(-1);
+    }
+    *(encoding_names+num_encodings-1) = strdup( name );
+    if (*(encoding_names+num_encodings-1) == NULL) {
+        perror( __FILE__ ",  strdup" );
+        exit(-1);
+    }
+    *(encodings+num_encodings-1) = encoding;
+    return 0;
+}
+
+
+int get_nonbool_encoding( char *name )
+{
+    int i;
+    if (name != NULL) {
+        for (i = 0; i < num_encodings; i++) {
+            if (!strcmp( *(encoding_names+i), name ))
+                return *(encodings+i);
+        }
+    }
+    return default_encoding;
+}
+
+
+int parse_nonbool_encodings( char *spec )
+{
+    char *item, *end, *sep;
+    char name[256];
+    int len, encoding;
+
+    item = spec;
+    while (item != NULL && *item != '\0') {
+        end = strchr( item, ',' );
+        if (end == NULL)
+            end = item+strlen( item );
+        sep = memchr( item, '=', end-item );
+        if (sep == NULL)
+            sep = item-1;
+
+        len = end-sep-1;
+        if (len == strlen( "binary" ) && !strncmp( sep+1, "binary", len )) {
+            encoding = NONBOOL_ENC_BINARY;
+        } else if (len == strlen( "gray" ) && !strncmp( sep+1, "gray", len )) {
+            encoding = NONBOOL_ENC_GRAY;
+        } else if (len == strlen( "onehot" )
+                   && !strncmp( sep+1, "onehot", len )) {
+            encoding = NONBOOL_ENC_ONEHOT;
+        } else {
+            fprintf( stderr, "Unrecognized encoding \"%.*s\".\n",
+                     len, sep+1 );
+            return -1;
+        }
+
+        if (sep < item) {
+            set_nonbool_encoding( NULL, encoding );
+        } else {
+            len = sep-item;
+            if (len < 1 || len >= sizeof(name)) {
+                fprintf( stderr,
+                         "Invalid variable name in encoding \"%.*s\".\n",
+                         (int)(end-item), item );
+                return -1;
+            }
+            strncpy( name, item, len );
+            name[len] = '\0';
+            set_nonbool_encoding( name, encoding );
+        }
+
+        item = (*end == ',') ? end+1 : end;
+    }
+    return 0;
+}
+
+
+void clear_nonbool_encodings(void)
+{
+    int i;
+    for (i = 0; i < num_encodings; i++)
+        free( *(encoding_names+i) );
+    free( encoding_names );
+    free( encodings );
+    encoding_names = NULL;
+    encodings = NULL;
+    num_encodings = 0;
+    default_encoding = NONBOOL_ENC_BINARY;
+}
+
+
+int *get_encodings_list( ptree_t *nonbool_var_list )
+{
+    int *enc;
+    int i;
+    if (nonbool_var_list == NULL)
+        return NULL;
+    enc = malloc( tree_size( nonbool_var_list )*sizeof(int) );
+    if (enc == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; nonbool_var_list; i++) {
+        *(enc+i) = get_nonbool_encoding( nonbool_var_list->name );
+        nonbool_var_list = nonbool_var_list->left;
+    }
+    return enc;
+}
+
+
 ptree_t *expand_nonbool_variables( ptree_t **evar_list, ptree_t **svar_list,
                                    unsigned char verbose )
 {
@@ -99,7 +312,8 @@ ptree_t *expand_nonbool_variables( ptree_t **evar_list, ptree_t **svar_list,
     if ((*evar_list) != NULL) {
         tmppt = (*evar_list);
         if (tmppt->value >= 0) {  /* Handle special case of head node */
-            expt = var_to_bool( tmppt->name, tmppt->value );
+            expt = var_to_bool( tmppt->name, tmppt->value,
+                                get_nonbool_encoding( tmppt->name ) );
             (*evar_list) = expt;
             prevpt = get_list_item( expt, -1 );
             prevpt->left = tmppt->left;
@@ -112,7 +326,8 @@ ptree_t *expand_nonbool_variables( ptree_t **evar_list, ptree_t **svar_list,
         tmppt = tmppt->left;
         while (tmppt) {
             if (tmppt->value >= 0) {
-                expt = var_to_bool( tmppt->name, tmppt->value );
+                expt = var_to_bool( tmppt->name, tmppt->value,
+                                    get_nonbool_encoding( tmppt->name ) );
                 prevpt->left = expt;
                 prevpt = get_list_item( expt, -1 );
                 prevpt->left = tmppt->left;
@@ -129,7 +344,8 @@ ptree_t *expand_nonbool_variables( ptree_t **evar_list, ptree_t **svar_list,
     if ((*svar_list) != NULL) {
         tmppt = (*svar_list);
         if (tmppt->value >= 0) {  /* Handle special case of head node */
-            expt = var_to_bool( tmppt->name, tmppt->value );
+            expt = var_to_bool( tmppt->name, tmppt->value,
+                                get_nonbool_encoding( tmppt->name ) );
             (*svar_list) = expt;
             prevpt = get_list_item( expt, -1 );
             prevpt->left = tmppt->left;
@@ -142,7 +358,8 @@ ptree_t *expand_nonbool_variables( ptree_t **evar_list, ptree_t **svar_list,
         tmppt = tmppt->left;
         while (tmppt) {
             if (tmppt->value >= 0) {
-                expt = var_to_bool( tmppt->name, tmppt->value );
+                expt = var_to_bool( tmppt->name, tmppt->value,
+                                    get_nonbool_encoding( tmppt->name ) );
                 prevpt->left = expt;
                 prevpt = get_list_item( expt, -1 );
                 prevpt->left = tmppt->left;
@@ -160,8 +377,8 @@ ptree_t *expand_nonbool_variables( ptree_t **evar_list, ptree_t **svar_list,
 }
 
 
-vartype *expand_nonbool_state( vartype *state, int *offw, int num_nonbool,
-                               int mapped_len )
+vartype *expand_nonbool_state( vartype *state, int *offw, int *enc,
+                               int num_nonbool, int mapped_len )
 {
     int i, j, k;
     vartype *mapped_state, *state_frag;
@@ -182,7 +399,12 @@ vartype *expand_nonbool_state( vartype *state, int *offw, int num_nonbool,
 
             j++;
         } else {
-            state_frag = int_to_bitvec( *(state+k), *(offw+2*i+1) );
+            if (enc == NULL) {
+                state_frag = int_to_bitvec( *(state+k), *(offw+2*i+1) );
+            } else {
+                state_frag = int_to_nonbool( *(state+k), *(offw+2*i+1),
+                                             *(enc+i) );
+            }
             for (j = *(offw+2*i); j < *(offw+2*i)+*(offw+2*i+1); j++)
                 *(mapped_state+j) = *(state_frag+j-*(offw+2*i));
             free( state_frag );
@@ -196,6 +418,30 @@ vartype *expand_nonbool_state( vartype *state, int *offw, int num_nonbool,
 }
 
 
+/* Constraint on the bits of the nonboolean variable var that excludes
+   patterns not representing any value in its domain, or NULL if every
+   pattern is a value. */
+static ptree_t *nonbool_domain_bool( ptree_t *var, int type,
+                                     unsigned char verbose )
+{
+    int maxbitval;
+    if (get_nonbool_encoding( var->name ) == NONBOOL_ENC_ONEHOT) {
+        if (verbose > 1)
+            logprint( "In mapping %s to one-hot bits, requiring exactly one"
+                      " of %d bits", var->name, var->value+1 );
+        return onehot_domain_bool( var->name, var->value, type );
+    }
+
+    maxbitval = 1 << nonbool_num_bits( var->value, NONBOOL_ENC_BINARY );
+    if (maxbitval-1 <= var->value)
+        return NULL;
+    if (verbose > 1)
+        logprint( "In mapping %s to a bitvector, blocking values %d-%d",
+                  var->name, var->value+1, maxbitval-1 );
+    return unreach_expanded_bool( var->name, var->value+1, maxbitval-1, type );
+}
+
+
 int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
                         ptree_t **env_init, ptree_t **sys_init,
                         ptree_t ***env_trans_array, int *et_array_len,
@@ -207,7 +453,8 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
 {
     int i;
     ptree_t *tmppt, *prevpt, *var_separator;
-    int maxbitval;
+    ptree_t *domain;
+    int encoding;
 
     /* Make nonzero settings of "don't care" bits unreachable */
     tmppt = evar_list;
@@ -217,29 +464,21 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
             continue;
         }
 
-        maxbitval = (int)(pow( 2, ceil(log2( tmppt->value > 0 ?
-                                             tmppt->value+1 : 2 )) ));
-        if (maxbitval-1 > tmppt->value) {
-            if (verbose > 1)
-                logprint( "In mapping %s to a bitvector, blocking values %d-%d",
-                          tmppt->name, tmppt->value+1, maxbitval-1 );
+        domain = nonbool_domain_bool( tmppt, PT_VARIABLE, verbose );
+        if (domain != NULL) {
 
             /* Initial conditions */
             if (init_flags == ONE_SIDE_INIT && *sys_init != NULL) {
                 prevpt = *sys_init;
                 *sys_init = init_ptree( PT_AND, NULL, 0 );
-                (*sys_init)->right
-                    = unreach_expanded_bool( tmppt->name, tmppt->value+1,
-                                             maxbitval-1, PT_VARIABLE );
+                (*sys_init)->right = domain;
                 (*sys_init)->left = prevpt;
             } else {
                 if (*env_init == NULL)
                     *env_init = init_ptree( PT_CONSTANT, NULL, 1 );
                 prevpt = *env_init;
                 *env_init = init_ptree( PT_AND, NULL, 0 );
-                (*env_init)->right
-                    = unreach_expanded_bool( tmppt->name, tmppt->value+1,
-                                             maxbitval-1, PT_VARIABLE );
+                (*env_init)->right = domain;
                 (*env_init)->left = prevpt;
             }
 
@@ -252,11 +491,9 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
                 exit(-1);
             }
             *((*env_trans_array)+(*et_array_len)-2)
-                = unreach_expanded_bool( tmppt->name, tmppt->value+1,
-                                         maxbitval-1, PT_VARIABLE );
+                = nonbool_domain_bool( tmppt, PT_VARIABLE, 0 );
             *((*env_trans_array)+(*et_array_len)-1)
-                = unreach_expanded_bool( tmppt->name, tmppt->value+1,
-                                         maxbitval-1, PT_NEXT_VARIABLE );
+                = nonbool_domain_bool( tmppt, PT_NEXT_VARIABLE, 0 );
         }
         tmppt = tmppt->left;
     }
@@ -268,12 +505,8 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
             continue;
         }
 
-        maxbitval = (int)(pow( 2, ceil(log2( tmppt->value > 0 ?
-                                             tmppt->value+1 : 2 )) ));
-        if (maxbitval-1 > tmppt->value) {
-            if (verbose > 1)
-                logprint( "In mapping %s to a bitvector, blocking values %d-%d",
-                          tmppt->name, tmppt->value+1, maxbitval-1 );
+        domain = nonbool_domain_bool( tmppt, PT_VARIABLE, verbose );
+        if (domain != NULL) {
 
             /* Initial conditions */
             if (init_flags == ONE_SIDE_INIT && *sys_init == NULL) {
@@ -281,18 +514,14 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
                     *env_init = init_ptree( PT_CONSTANT, NULL, 1 );
                 prevpt = *env_init;
                 *env_init = init_ptree( PT_AND, NULL, 0 );
-                (*env_init)->right
-                    = unreach_expanded_bool( tmppt->name, tmppt->value+1,
-                                             maxbitval-1, PT_VARIABLE );
+                (*env_init)->right = domain;
                 (*env_init)->left = prevpt;
             } else {
                 if (*sys_init == NULL)
                     *sys_init = init_ptree( PT_CONSTANT, NULL, 1 );
                 prevpt = *sys_init;
                 *sys_init = init_ptree( PT_AND, NULL, 0 );
-                (*sys_init)->right
-                    = unreach_expanded_bool( tmppt->name, tmppt->value+1,
-                                             maxbitval-1, PT_VARIABLE );
+                (*sys_init)->right = domain;
                 (*sys_init)->left = prevpt;
             }
 
@@ -305,11 +534,9 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
                 exit(-1);
             }
             *((*sys_trans_array)+(*st_array_len)-2)
-                = unreach_expanded_bool( tmppt->name, tmppt->value+1,
-                                         maxbitval-1, PT_VARIABLE );
+                = nonbool_domain_bool( tmppt, PT_VARIABLE, 0 );
             *((*sys_trans_array)+(*st_array_len)-1)
-                = unreach_expanded_bool( tmppt->name, tmppt->value+1,
-                                         maxbitval-1, PT_NEXT_VARIABLE );
+                = nonbool_domain_bool( tmppt, PT_NEXT_VARIABLE, 0 );
         }
         tmppt = tmppt->left;
     }
@@ -331,12 +558,14 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
     tmppt = evar_list;
     while (tmppt) {
         if (tmppt->value >= 0) {
+            encoding = get_nonbool_encoding( tmppt->name );
             if (*sys_init != NULL) {
                 if (verbose > 1)
                     logprint( "Expanding nonbool variable %s in SYSINIT...",
                               tmppt->name );
                 (*sys_init) = expand_to_bool( (*sys_init),
-                                              tmppt->name, tmppt->value );
+                                              tmppt->name, tmppt->value,
+                                              encoding );
                 if ((*sys_init) == NULL) {
                     fprintf( stderr,
                              "Error expand_nonbool_GR1: Failed to convert"
@@ -351,7 +580,8 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
                     logprint( "Expanding nonbool variable %s in ENVINIT...",
                               tmppt->name );
                 (*env_init) = expand_to_bool( (*env_init),
-                                              tmppt->name, tmppt->value );
+                                              tmppt->name, tmppt->value,
+                                              encoding );
                 if ((*env_init) == NULL) {
                     fprintf( stderr,
                              "Error expand_nonbool_GR1: Failed to convert"
@@ -367,7 +597,7 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
                               tmppt->name, i );
                 *((*env_trans_array)+i)
                     = expand_to_bool( *((*env_trans_array)+i),
-                                      tmppt->name, tmppt->value );
+                                      tmppt->name, tmppt->value, encoding );
                 if (*((*env_trans_array)+i) == NULL) {
                     fprintf( stderr,
                              "Error expand_nonbool_GR1: Failed to convert"
@@ -383,7 +613,7 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
                               tmppt->name, i );
                 *((*sys_trans_array)+i)
                     = expand_to_bool( *((*sys_trans_array)+i),
-                                      tmppt->name, tmppt->value );
+                                      tmppt->name, tmppt->value, encoding );
                 if (*((*sys_trans_array)+i) == NULL) {
                     fprintf( stderr,
                              "Error expand_nonbool_GR1: Failed to convert"
@@ -399,7 +629,7 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
                               tmppt->name, i );
                 *((*env_goals)+i)
                     = expand_to_bool( *((*env_goals)+i),
-                                      tmppt->name, tmppt->value );
+                                      tmppt->name, tmppt->value, encoding );
                 if (*((*env_goals)+i) == NULL) {
                     fprintf( stderr,
                              "Error expand_nonbool_GR1: Failed to convert"
@@ -415,7 +645,7 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
                               tmppt->name, i );
                 *((*sys_goals)+i)
                     = expand_to_bool( *((*sys_goals)+i),
-                                      tmppt->name, tmppt->value );
+                                      tmppt->name, tmppt->value, encoding );
                 if (*((*sys_goals)+i) == NULL) {
                     fprintf( stderr,
                              "Error expand_nonbool_GR1: Failed to convert"
@@ -796,3 +1026,393 @@ void print_support( DdManager *manager, int state_len, DdNode *X, FILE *outf )
         setlogopt( prev_logoptions );
     }
 }
+
+
+/* Variable names paired with indices, sorted by name for bsearch() */
+typedef struct {
+    char *name;
+    int index;
+} var_ref_t;
+
+static int var_ref_cmp( const void *a, const void *b )
+{
+    return strcmp( ((const var_ref_t *)a)->name,
+                   ((const var_ref_t *)b)->name );
+}
+
+static var_ref_t *sorted_var_refs( ptree_t *evar_list, ptree_t *svar_list,
+                                   int num_vars )
+{
+    var_ref_t *refs;
+    ptree_t *var;
+    int i = 0;
+
+    refs = malloc( (num_vars+1)*sizeof(var_ref_t) );
+    if (refs == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (var = evar_list; var; var = var->left, i++) {
+        (refs+i)->name = var->name;
+        (refs+i)->index = i;
+    }
+    for (var = svar_list; var; var = var->left, i++) {
+        (refs+i)->name = var->name;
+        (refs+i)->index = i;
+    }
+    qsort( refs, num_vars, sizeof(var_ref_t), var_ref_cmp );
+    return refs;
+}
+
+static int find_var_ref( var_ref_t *refs, int num_vars, char *name )
+{
+    var_ref_t key, *found;
+    key.name = name;
+    found = bsearch( &key, refs, num_vars, sizeof(var_ref_t), var_ref_cmp );
+    return (found == NULL) ? -1 : found->index;
+}
+
+
+#define FORCE_MAX_ITER 50
+
+/* Hyperedges over variables, stored compactly: edge k comprises
+   vars[start[k]], ..., vars[start[k+1]-1]. */
+typedef struct {
+    int *start;
+    int *vars;
+    int num_edges;
+    int len;
+    int start_cap;
+    int vars_cap;
+    int *mark;  /* Last edge id in which each variable was added */
+    int edge_id;
+} force_edges_t;
+
+static void force_add_vars( force_edges_t *E, ptree_t *head,
+                            var_ref_t *refs, int num_vars )
+{
+    int i;
+    if (head == NULL)
+        return;
+    if (head->type == PT_VARIABLE || head->type == PT_NEXT_VARIABLE) {
+        i = find_var_ref( refs, num_vars, head->name );
+        if (i < 0 || *(E->mark+i) == E->edge_id)
+            return;
+        *(E->mark+i) = E->edge_id;
+        if (E->len == E->vars_cap) {
+            E->vars_cap *= 2;
+            E->vars = realloc( E->vars, E->vars_cap*sizeof(int) );
+            if (E->vars == NULL) {
+                perror( __FILE__ ",  realloc" );
+                exit(-1);
+            }
+        }
+        *(E->vars+(E->len++)) = i;
+        return;
+    }
+    force_add_vars( E, head->left, refs, num_vars );
+    force_add_vars( E, head->right, refs, num_vars );
+}
+
+/* Add hyperedge comprising the variables of head.  Hyperedges with
+   fewer than two variables do not affect the order and are
+   discarded. */
+static void force_add_edge( force_edges_t *E, ptree_t *head,
+                            var_ref_t *refs, int num_vars )
+{
+    E->edge_id++;
+    force_add_vars( E, head, refs, num_vars );
+    if (E->len - *(E->start+E->num_edges) < 2) {
+        E->len = *(E->start+E->num_edges);
+        return;
+    }
+    if (E->num_edges+2 > E->start_cap) {
+        E->start_cap *= 2;
+        E->start = realloc( E->start, E->start_cap*sizeof(int) );
+        if (E->start == NULL) {
+            perror( __FILE__ ",  realloc" );
+            exit(-1);
+        }
+    }
+    E->num_edges++;
+    *(E->start+E->num_edges) = E->len;
+}
+
+/* Add one hyperedge for each top-level conjunct of head. */
+static void force_add_conjuncts( force_edges_t *E, ptree_t *head,
+                                 var_ref_t *refs, int num_vars )
+{
+    if (head == NULL)
+        return;
+    if (head->type == PT_AND) {
+        force_add_conjuncts( E, head->left, refs, num_vars );
+        force_add_conjuncts( E, head->right, refs, num_vars );
+    } else {
+        force_add_edge( E, head, refs, num_vars );
+    }
+}
+
+typedef struct {
+    double key;
+    int var;
+} force_key_t;
+
+static int force_key_cmp( const void *a, const void *b )
+{
+    const force_key_t *x = a, *y = b;
+    if (x->key < y->key)
+        return -1;
+    if (x->key > y->key)
+        return 1;
+    return x->var - y->var;
+}
+
+/* Sum over hyperedges of the distance between the extreme positions
+   of its variables */
+static long force_span( force_edges_t *E, int *pos )
+{
+    long span = 0;
+    int k, j, lo, hi;
+    for (k = 0; k < E->num_edges; k++) {
+        lo = hi = *(pos+*(E->vars+*(E->start+k)));
+        for (j = *(E->start+k)+1; j < *(E->start+k+1); j++) {
+            if (*(pos+*(E->vars+j)) < lo)
+                lo = *(pos+*(E->vars+j));
+            if (*(pos+*(E->vars+j)) > hi)
+                hi = *(pos+*(E->vars+j));
+        }
+        span += hi - lo;
+    }
+    return span;
+}
+
+int *force_var_order( ptree_t *evar_list, ptree_t *svar_list,
+                      ptree_t *env_init, ptree_t *sys_init,
+                      ptree_t **env_trans_array, int et_array_len,
+                      ptree_t **sys_trans_array, int st_array_len,
+                      ptree_t **env_goals, int num_env_goals,
+                      ptree_t **sys_goals, int num_sys_goals,
+                      unsigned char verbose )
+{
+    var_ref_t *refs;
+    force_edges_t E;
+    force_key_t *keys;
+    double *cog, *sum;
+    int *count, *pos, *best, *perm;
+    long span, best_span, initial_span;
+    int num_vars, iter, i, j, k;
+
+    num_vars = tree_size( evar_list ) + tree_size( svar_list );
+    if (num_vars == 0)
+        return NULL;
+    refs = sorted_var_refs( evar_list, svar_list, num_vars );
+
+    E.start_cap = 64;
+    E.vars_cap = 256;
+    E.start = malloc( E.start_cap*sizeof(int) );
+    E.vars = malloc( E.vars_cap*sizeof(int) );
+    E.mark = malloc( num_vars*sizeof(int) );
+    if (E.start == NULL || E.vars == NULL || E.mark == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    *E.start = 0;
+    E.num_edges = E.len = 0;
+    E.edge_id = 0;
+    for (i = 0; i < num_vars; i++)
+        *(E.mark+i) = 0;
+
+    force_add_conjuncts( &E, env_init, refs, num_vars );
+    force_add_conjuncts( &E, sys_init, refs, num_vars );
+    for (i = 0; i < et_array_len; i++)
+        force_add_conjuncts( &E, *(env_trans_array+i), refs, num_vars );
+    for (i = 0; i < st_array_len; i++)
+        force_add_conjuncts( &E, *(sys_trans_array+i), refs, num_vars );
+    for (i = 0; i < num_env_goals; i++)
+        force_add_edge( &E, *(env_goals+i), refs, num_vars );
+    for (i = 0; i < num_sys_goals; i++)
+        force_add_edge( &E, *(sys_goals+i), refs, num_vars );
+    free( refs );
+
+    keys = malloc( num_vars*sizeof(force_key_t) );
+    cog = malloc( (E.num_edges+1)*sizeof(double) );
+    sum = malloc( num_vars*sizeof(double) );
+    count = malloc( num_vars*sizeof(int) );
+    pos = malloc( num_vars*sizeof(int) );
+    best = malloc( num_vars*sizeof(int) );
+    perm = malloc( 2*num_vars*sizeof(int) );
+    if (keys == NULL || cog == NULL || sum == NULL || count == NULL
+        || pos == NULL || best == NULL || perm == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+
+    /* Start from declaration order. */
+    for (i = 0; i < num_vars; i++) {
+        *(pos+i) = i;
+        *(best+i) = i;
+    }
+    best_span = initial_span = force_span( &E, pos );
+
+    for (iter = 0; iter < FORCE_MAX_ITER; iter++) {
+        for (i = 0; i < num_vars; i++) {
+            *(sum+i) = 0.;
+            *(count+i) = 0;
+        }
+        for (k = 0; k < E.num_edges; k++) {
+            *(cog+k) = 0.;
+            for (j = *(E.start+k); j < *(E.start+k+1); j++)
+                *(cog+k) += *(pos+*(E.vars+j));
+            *(cog+k) /= *(E.start+k+1) - *(E.start+k);
+            for (j = *(E.start+k); j < *(E.start+k+1); j++) {
+                *(sum+*(E.vars+j)) += *(cog+k);
+                (*(count+*(E.vars+j)))++;
+            }
+        }
+        for (i = 0; i < num_vars; i++) {
+            (keys+i)->var = i;
+            if (*(count+i) > 0) {
+                (keys+i)->key = *(sum+i) / *(count+i);
+            } else {
+                (keys+i)->key = *(pos+i);
+            }
+        }
+        qsort( keys, num_vars, sizeof(force_key_t), force_key_cmp );
+        for (i = 0; i < num_vars; i++)
+            *(pos+(keys+i)->var) = i;
+
+        span = force_span( &E, pos );
+        if (span >= best_span)
+            break;
+        best_span = span;
+        for (i = 0; i < num_vars; i++)
+            *(best+i) = (keys+i)->var;
+    }
+
+    if (verbose > 1)
+        logprint( "FORCE variable order: total span of %d hyperedges"
+                  " reduced from %d to %d in %d iterations.",
+                  E.num_edges, (int)initial_span, (int)best_span, iter );
+
+    /* Keep each variable adjacent to its primed copy. */
+    for (i = 0; i < num_vars; i++) {
+        *(perm+2*i) = *(best+i);
+        *(perm+2*i+1) = *(best+i) + num_vars;
+    }
+
+    free( E.start );
+    free( E.vars );
+    free( E.mark );
+    free( keys );
+    free( cog );
+    free( sum );
+    free( count );
+    free( pos );
+    free( best );
+    return perm;
+}
+
+
+int dump_var_order( DdManager *manager,
+                    ptree_t *evar_list, ptree_t *svar_list, FILE *fp )
+{
+    ptree_t *var;
+    int num_env, num_vars, level, index;
+
+    num_env = tree_size( evar_list );
+    num_vars = num_env + tree_size( svar_list );
+    if (Cudd_ReadSize( manager ) != 2*num_vars) {
+        fprintf( stderr,
+                 "Error dump_var_order: manager has %d variables but"
+                 " expected %d.\n", Cudd_ReadSize( manager ), 2*num_vars );
+        return -1;
+    }
+
+    for (level = 0; level < 2*num_vars; level++) {
+        index = Cudd_ReadInvPerm( manager, level );
+        if (index % num_vars < num_env) {
+            var = get_list_item( evar_list, index % num_vars );
+        } else {
+            var = get_list_item( svar_list, index % num_vars - num_env );
+        }
+        if (var == NULL)
+            return -1;
+        fprintf( fp, "%s%s\n", var->name, (index >= num_vars) ? "'" : "" );
+    }
+
+    return 0;
+}
+
+
+int *load_var_order( FILE *fp, ptree_t *evar_list, ptree_t *svar_list )
+{
+    var_ref_t *refs;
+    bool *used;
+    int *perm;
+    char line[2048];
+    char *name, *end;
+    int num_vars, len = 0, i;
+    bool primed;
+
+    num_vars = tree_size( evar_list ) + tree_size( svar_list );
+    refs = sorted_var_refs( evar_list, svar_list, num_vars );
+    used = malloc( (2*num_vars+1)*sizeof(bool) );
+    perm = malloc( (2*num_vars+1)*sizeof(int) );
+    if (used == NULL || perm == NULL) {
+        perror( __FILE__ ",  malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < 2*num_vars; i++)
+        *(used+i) = False;
+
+    while (fgets( line, sizeof(line), fp )) {
+        name = line;
+        while (isspace( (unsigned char)*name ))
+            name++;
+        end = name + strlen( name );
+        while (end > name && isspace( (unsigned char)*(end-1) ))
+            end--;
+        *end = '\0';
+        if (*name == '\0' || *name == '#')
+            continue;
+
+        primed = False;
+        if (*(end-1) == '\'') {
+            primed = True;
+            *(end-1) = '\0';
+        }
+        i = find_var_ref( refs, num_vars, name );
+        if (i < 0) {
+            fprintf( stderr,
+                     "Warning: unknown variable \"%s\" in order file.\n",
+                     name );
+            continue;
+        }
+        if (primed)
+            i += num_vars;
+        if (*(used+i)) {
+            fprintf( stderr,
+                     "Warning: variable \"%s%s\" repeated in order file.\n",
+                     name, primed ? "'" : "" );
+            continue;
+        }
+        *(used+i) = True;
+        *(perm+(len++)) = i;
+    }
+    if (ferror( fp )) {
+        perror( __FILE__ ",  fgets" );
+        free( refs );
+        free( used );
+        free( perm );
+        return NULL;
+    }
+
+    for (i = 0; i < 2*num_vars; i++) {
+        if (!(*(used+i)))
+            *(perm+(len++)) = i;
+    }
+
+    free( refs );
+    free( used );
+    return perm;
+}
@@ -120,3 +120,20 @@ if ! (gr1c -h | diff $TMPFILE -); then
     echo
     exit 1
 fi
+
+if test $VERBOSE -eq 1; then
+    echo '\nComparing outputs of `gr1c -t aut:FILE -t txt:FILE` with those of separate runs...'
+fi
+AUTFILE=$($MKTEMP)
+TXTFILE=$($MKTEMP)
+if (gr1c -t aut:$AUTFILE -t txt:$TXTFILE ${BUILD_ROOT}/examples/trivial.spc | grep . > /dev/null); then
+    echo $PREFACE 'Output written to stdout despite only -t TYPE:FILE outputs'
+    echo
+    exit 1
+fi
+if ! (gr1c -t aut ${BUILD_ROOT}/examples/trivial.spc | diff $AUTFILE -) || ! (gr1c -t txt ${BUILD_ROOT}/examples/trivial.spc | diff $TXTFILE -); then
+    echo $PREFACE 'Outputs of `gr1c -t aut:FILE -t txt:FILE` differ from those of separate runs'
+    echo
+    exit 1
+fi
+rm $AUTFILE $TXTFILE
@@ -21,7 +21,7 @@ fi
 ################################################################
 # Test realizability
 
-REFSPECS="gridworld_bool.spc gridworld_env.spc arbiter4.spc trivial_2var.spc free_counter.spc empty.spc trivial_mustblock.spc"
+REFSPECS="gridworld_bool.spc gridworld_env.spc arbiter4.spc trivial_2var.spc free_counter.spc empty.spc trivial_mustblock.spc reducible.spc"
 UNREALIZABLE_REFSPECS="trivial_un.spc"
 
 if test $VERBOSE -eq 1; then
@@ -51,6 +51,30 @@ for k in $(echo $UNREALIZABLE_REFSPECS); do
 done
 
 
+# Variable elimination should not affect realizability
+if test $VERBOSE -eq 1; then
+    echo "\nChecking realizability after eliminating variables..."
+fi
+for k in $(echo $REFSPECS); do
+    if test $VERBOSE -eq 1; then
+        echo "\t gr1c -r -e $TESTDIR/specs/$k"
+    fi
+    if ! $BUILD_ROOT/gr1c -r -e specs/$k > /dev/null; then
+        echo $PREFACE "realizable specs/${k} detected as unrealizable with -e\n"
+        exit 1
+    fi
+done
+for k in $(echo $UNREALIZABLE_REFSPECS); do
+    if test $VERBOSE -eq 1; then
+        echo "\t gr1c -r -e $TESTDIR/specs/$k"
+    fi
+    if $BUILD_ROOT/gr1c -r -e specs/$k > /dev/null; then
+        echo $PREFACE "unrealizable specs/${k} detected as realizable with -e\n"
+        exit 1
+    fi
+done
+
+
 # Testing init_flags besides ALL_ENV_EXIST_SYS_INIT
 if test $VERBOSE -eq 1; then
     echo "\t gr1c -r -n ALL_INIT $TESTDIR/specs/trivial_partwin.spc"
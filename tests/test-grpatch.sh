@@ -37,4 +37,115 @@ for k in $(echo $REFSPECS); do
         echo $PREFACE "gr1c-patch, patch_localfixpoint() regression test failed for specs/${k}\n"
         exit 1
     fi
+    if test $VERBOSE -eq 1; then
+        echo "\tComparing  gr1c-patch -j 2 -t aut -a $TESTDIR/expected_outputs/patching/${k}.spc.autdump.out -e $TESTDIR/specs/patching/${k}.edc $TESTDIR/specs/patching/${k}.spc \n\t\tagainst $TESTDIR/expected_outputs/patching/${k}.edc.autdump.out"
+    fi
+    if ! ($BUILD_ROOT/gr1c-patch -j 2 -t aut -a expected_outputs/patching/${k}.spc.autdump.out -e specs/patching/${k}.edc specs/patching/${k}.spc | cmp -s expected_outputs/patching/${k}.edc.autdump.out -); then
+        echo $PREFACE "gr1c-patch -j 2, patch_localfixpoint() regression test failed for specs/${k}\n"
+        exit 1
+    fi
+done
+
+if test $VERBOSE -eq 1; then
+    echo "\nPerforming regression tests for gr1c-patch -s..."
+fi
+for k in $(echo $REFSPECS); do
+    if test $VERBOSE -eq 1; then
+        echo "\tComparing  strategy dumped by gr1c-patch -s -a $TESTDIR/expected_outputs/patching/${k}.spc.autdump.out $TESTDIR/specs/patching/${k}.spc\n\t\tafter $TESTDIR/specs/patching/${k}.edc against $TESTDIR/expected_outputs/patching/${k}.edc.autdump.out"
+    fi
+    if ! ( (cat specs/patching/${k}.edc; printf '.\ndump\nquit\n') | $BUILD_ROOT/gr1c-patch -s -a expected_outputs/patching/${k}.spc.autdump.out specs/patching/${k}.spc | sed -n '/^ok 0 /,$p' | sed '1s/.*/1/;$d' | cmp -s expected_outputs/patching/${k}.edc.autdump.out -); then
+        echo $PREFACE "gr1c-patch -s regression test failed for specs/${k}\n"
+        exit 1
+    fi
+done
+
+# Replies to several batches: block (0,9), then block (0,8), then
+# block (0,12), which affects states outside of N and thus must be
+# rejected without changing the strategy.  Node IDs are tracked from
+# the strategy given with -a: deleted IDs must be of current nodes,
+# and each node line either changes a current node or adds one with
+# an ID that was not used before.
+check_serve_replies () {
+    awk '
+NR == FNR { if (FNR > 1) { live[$1] = 1; used[$1] = 1; num_live++ }; next }
+in_reply == 0 && $1 == "ok" {
+    in_reply = 1; reply++; n = $3; d = $4; count = 0
+    if (reply == 3)
+        bad = 1
+    next
+}
+in_reply == 0 && $1 == "error" { in_reply = 2; reply++; if (reply != 3) bad = 1; next }
+$0 == "." {
+    if (in_reply == 1 && (n != num_live || (reply <= 2 && count != d)))
+        bad = 1
+    in_reply = 0
+    next
+}
+in_reply == 1 && reply <= 2 {
+    count++
+    if ($1 == "-") {
+        if (!($2 in live))
+            bad = 1
+        delete live[$2]
+        num_live--
+    } else if (!($1 in live)) {
+        if ($1 in used)
+            bad = 1
+        live[$1] = 1; used[$1] = 1; num_live++
+    }
+}
+END { if (bad || reply != 4) exit 1 }' $1 -
+}
+
+SERVE_INPUT=$(mktemp)
+for k in $(echo $REFSPECS); do
+    (grep -v '^blocksys' specs/patching/${k}.edc; printf 'blocksys 0 9\n.\n';
+     cat specs/patching/${k}.edc; printf '.\n';
+     grep -v '^blocksys' specs/patching/${k}.edc; printf 'blocksys 0 12\n.\ndump\nquit\n') > $SERVE_INPUT
+    if test $VERBOSE -eq 1; then
+        echo "\tChecking replies of gr1c-patch -s -a $TESTDIR/expected_outputs/patching/${k}.spc.autdump.out $TESTDIR/specs/patching/${k}.spc\n\t\tto several batches"
+    fi
+    if ! ($BUILD_ROOT/gr1c-patch -s -a expected_outputs/patching/${k}.spc.autdump.out specs/patching/${k}.spc < $SERVE_INPUT | check_serve_replies expected_outputs/patching/${k}.spc.autdump.out); then
+        echo $PREFACE "gr1c-patch -s replies to several batches are wrong for specs/${k}\n"
+        exit 1
+    fi
+done
+
+if ! (python -V > /dev/null 2>&1); then
+    PYTHON=python3
+else
+    PYTHON=python
+fi
+SOCKET_PATH=$(mktemp -u)
+for k in $(echo $REFSPECS); do
+    if test $VERBOSE -eq 1; then
+        echo "\tChecking replies of gr1c-patch --socket ... $TESTDIR/specs/patching/${k}.spc\n\t\tto several batches"
+    fi
+    $BUILD_ROOT/gr1c-patch --socket $SOCKET_PATH -a expected_outputs/patching/${k}.spc.autdump.out specs/patching/${k}.spc &
+    i=0
+    while ! test -S $SOCKET_PATH; do
+        i=$((i+1))
+        if test $i -gt 30; then
+            echo $PREFACE "gr1c-patch --socket did not create socket for specs/${k}\n"
+            exit 1
+        fi
+        sleep 1
+    done
+    if ! ($PYTHON -c '
+import socket, sys
+s = socket.socket( socket.AF_UNIX, socket.SOCK_STREAM )
+s.connect( sys.argv[1] )
+s.sendall( getattr( sys.stdin, "buffer", sys.stdin ).read() )
+out = getattr( sys.stdout, "buffer", sys.stdout )
+while True:
+    data = s.recv( 4096 )
+    if not data:
+        break
+    out.write( data )
+' $SOCKET_PATH < $SERVE_INPUT | check_serve_replies expected_outputs/patching/${k}.spc.autdump.out); then
+        echo $PREFACE "gr1c-patch --socket replies to several batches are wrong for specs/${k}\n"
+        exit 1
+    fi
+    wait
 done
+rm -f $SERVE_INPUT
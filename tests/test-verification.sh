@@ -49,3 +49,61 @@ for REFSPC in $(echo $REFSPECS); do
         exit 1
     fi
 done
+
+REFSPECS="count_onestep.spc free_counter.spc gridworld_env.spc reducible.spc"
+for REFSPC in $(echo $REFSPECS); do
+    if test $VERBOSE -eq 1; then
+        echo "\nConstructing strategy for ${TESTDIR}/specs/${REFSPC} after eliminating variables"
+        echo "\tgr1c -e -t aut ${TESTDIR}/specs/${REFSPC} > ${REFSPC}.e.aut"
+    fi
+    $BUILD_ROOT/gr1c -e -t aut specs/${REFSPC} > ${REFSPC}.e.aut
+    if test $VERBOSE -eq 1; then
+        echo "\nVerifying it using Spin..."
+        echo "\tgr1c-autman -i specs/${REFSPC} ${REFSPC}.e.aut -P -o ${REFSPC}.e.aut.pml"
+    fi
+    FORMULA=$($BUILD_ROOT/gr1c-autman -i specs/${REFSPC} ${REFSPC}.e.aut -P -o ${REFSPC}.e.aut.pml)
+    if test $VERBOSE -eq 1; then
+        echo "\tspin -f \"!(${FORMULA})\" >> ${REFSPC}.e.aut.pml"
+    fi
+    ${SPINEXE} -f "!(${FORMULA})" >> ${REFSPC}.e.aut.pml
+    if test $VERBOSE -eq 1; then
+        echo "\tspin -a ${REFSPC}.e.aut.pml"
+        echo "\tcc -o pan pan.c && ./pan -a"
+    fi
+    ${SPINEXE} -a ${REFSPC}.e.aut.pml
+    cc -o pan pan.c
+    if test $(./pan -a | grep errors| cut -d: -f2) -ne 0; then
+        echo $PREFACE "Strategy obtained with -e does not satisfy specification ${TESTDIR}/specs/${REFSPC}\n"
+        exit 1
+    fi
+done
+
+REFSPECS="count_onestep.spc free_counter.spc reducible.spc"
+for ENC in gray onehot; do
+    for REFSPC in $(echo $REFSPECS); do
+        if test $VERBOSE -eq 1; then
+            echo "\nConstructing strategy for ${TESTDIR}/specs/${REFSPC} with ${ENC} encoding"
+            echo "\tgr1c --encoding ${ENC} -t aut ${TESTDIR}/specs/${REFSPC} > ${REFSPC}.${ENC}.aut"
+        fi
+        $BUILD_ROOT/gr1c --encoding ${ENC} -t aut specs/${REFSPC} > ${REFSPC}.${ENC}.aut
+        if test $VERBOSE -eq 1; then
+            echo "\nVerifying it using Spin..."
+            echo "\tgr1c-autman -i specs/${REFSPC} ${REFSPC}.${ENC}.aut -P -o ${REFSPC}.${ENC}.aut.pml"
+        fi
+        FORMULA=$($BUILD_ROOT/gr1c-autman -i specs/${REFSPC} ${REFSPC}.${ENC}.aut -P -o ${REFSPC}.${ENC}.aut.pml)
+        if test $VERBOSE -eq 1; then
+            echo "\tspin -f \"!(${FORMULA})\" >> ${REFSPC}.${ENC}.aut.pml"
+        fi
+        ${SPINEXE} -f "!(${FORMULA})" >> ${REFSPC}.${ENC}.aut.pml
+        if test $VERBOSE -eq 1; then
+            echo "\tspin -a ${REFSPC}.${ENC}.aut.pml"
+            echo "\tcc -o pan pan.c && ./pan -a"
+        fi
+        ${SPINEXE} -a ${REFSPC}.${ENC}.aut.pml
+        cc -o pan pan.c
+        if test $(./pan -a | grep errors| cut -d: -f2) -ne 0; then
+            echo $PREFACE "Strategy obtained with ${ENC} encoding does not satisfy specification ${TESTDIR}/specs/${REFSPC}\n"
+            exit 1
+        fi
+    done
+done
@@ -1,4 +1,4 @@
-/* Unit tests for aut_aut_dump()
+/* Unit tests for aut_aut_dump() and aut_aut_dumpver()
  *
  * SCL; 2017
  */
@@ -34,6 +34,21 @@
 "1 1 0 0 1 0 -1 2\n" \
 "2 0 0 0 1 0 -1 2\n"
 
+#define REF_GR1CAUT_SINGLE_LOOP_AND_2SUCC_V2 \
+"2\n" \
+"1:1 1 0 -1 0 2\n" \
+"0:1,1:0 1 0 -1 1\n" \
+"0:0 1 0 -1 0\n"
+
+/* With SOURCE_DATE_EPOCH=0, ENV of a and SYS of b, c in [0,2] */
+#define REF_JSONL_SINGLE_LOOP_AND_2SUCC \
+"{\"version\":1,\"gr1c\":\"" GR1C_VERSION "\",\"date\":\"1970-01-01 00:00:00\"," \
+"\"extra\":\"\",\"ENV\":[{\"a\":\"boolean\"}]," \
+"\"SYS\":[{\"b\":\"boolean\"},{\"c\":[0,2]}]}\n" \
+"{\"id\":0,\"state\":[0,1,0],\"mode\":0,\"rgrad\":-1,\"initial\":true,\"trans\":[0,2]}\n" \
+"{\"id\":1,\"state\":[1,0,0],\"mode\":0,\"rgrad\":-1,\"initial\":true,\"trans\":[2]}\n" \
+"{\"id\":2,\"state\":[0,0,0],\"mode\":0,\"rgrad\":-1,\"initial\":true,\"trans\":[2]}\n"
+
 
 #define STRING_MAXLEN 2048
 int main(void)
@@ -46,6 +61,7 @@ int main(void)
     anode_t *this_node, *that_node;
     const int state_len = 3;
     vartype state[] = {0, 0, 0};
+    ptree_t *evar_list, *svar_list;
 
     head = insert_anode( NULL, 0, -1, True, state, state_len );
     head->trans = malloc( sizeof(anode_t *) );
@@ -205,6 +221,63 @@ int main(void)
         abort();
     }
 
+    if (fseek( fp, 0, SEEK_SET )) {
+        perror( __FILE__ ", fseek" );
+        abort();
+    }
+    if (ftruncate( fd, 0 )) {
+        perror( __FILE__ ", ftruncate" );
+        abort();
+    }
+    assert( aut_aut_dumpver( head, state_len, fp, 3 ) == -1 );
+    assert( !aut_aut_dumpver( head, state_len, fp, 2 ) );
+    if (fseek( fp, 0, SEEK_SET )) {
+        perror( __FILE__ ", fseek" );
+        abort();
+    }
+    memset( instr, '\0', STRING_MAXLEN );
+    if (fread( instr, sizeof(char), STRING_MAXLEN-1, fp )
+        != strlen(REF_GR1CAUT_SINGLE_LOOP_AND_2SUCC_V2)
+        || strcmp( instr, REF_GR1CAUT_SINGLE_LOOP_AND_2SUCC_V2 )) {
+        ERRPRINT( "output of aut_aut_dumpver does not match expectation" );
+        ERRPRINT1( "%s", instr  );
+        ERRPRINT1( "%s", REF_GR1CAUT_SINGLE_LOOP_AND_2SUCC_V2 );
+        abort();
+    }
+
+    evar_list = init_ptree( PT_VARIABLE, "a", -1 );
+    svar_list = init_ptree( PT_VARIABLE, "b", -1 );
+    append_list_item( svar_list, PT_VARIABLE, "c", 2 );
+    if (setenv( "SOURCE_DATE_EPOCH", "0", 1 )) {
+        perror( __FILE__ ", setenv" );
+        abort();
+    }
+    if (fseek( fp, 0, SEEK_SET )) {
+        perror( __FILE__ ", fseek" );
+        abort();
+    }
+    if (ftruncate( fd, 0 )) {
+        perror( __FILE__ ", ftruncate" );
+        abort();
+    }
+    assert( !json_aut_dumpopt( head, evar_list, svar_list,
+                               JSON_AUT_LINES, fp ) );
+    if (fseek( fp, 0, SEEK_SET )) {
+        perror( __FILE__ ", fseek" );
+        abort();
+    }
+    memset( instr, '\0', STRING_MAXLEN );
+    if (fread( instr, sizeof(char), STRING_MAXLEN-1, fp )
+        != strlen(REF_JSONL_SINGLE_LOOP_AND_2SUCC)
+        || strcmp( instr, REF_JSONL_SINGLE_LOOP_AND_2SUCC )) {
+        ERRPRINT( "output of json_aut_dumpopt does not match expectation" );
+        ERRPRINT1( "%s", instr  );
+        ERRPRINT1( "%s", REF_JSONL_SINGLE_LOOP_AND_2SUCC );
+        abort();
+    }
+    delete_tree( evar_list );
+    delete_tree( svar_list );
+
     fclose( fp );
     if (remove( filename )) {
         perror( __FILE__ ", remove" );
@@ -1,4 +1,5 @@
-/* Unit tests for aut_aut_load()
+/* Unit tests for aut_aut_load(), including of format version 2 and of
+ * gzip-compressed input
  *
  * SCL; 2012-2015
  */
@@ -30,6 +31,29 @@
 "2 0 0 1 0 1 2 3\n" \
 "3 1 1 1 1 1 2 1\n"
 
+/* REF_GR1CAUT_TRIVIAL_MOD in gr1caut v2 format, with a comment */
+#define REF_GR1CAUT_TRIVIAL_MOD_V2 \
+"2\n" \
+"1:1 0 0 -1 1\n"  \
+"0:1,1:0 1 0 2 1 -1\n" \
+"\n# State changes of one variable\n" \
+"0:0 1 0 1 0 1\n" \
+"0:1,1:1 1 1 1 -1 -1\n"
+
+/* Three nodes, the last having the state of the first; state length
+   of 2. */
+#define REF_GR1CAUT_DICT_V2 \
+"2\n" \
+". 1 0 -1 1 1\n" \
+"0:1 0 1 -1 -1\n" \
+"@0 0 0 -1 -1\n"
+
+/* Errors in version 2: position outside the state vector, reference to
+   a state not yet given, target not among the nodes */
+#define BAD_GR1CAUT_V2_POS "2\n2:1 0 0 -1 0\n"
+#define BAD_GR1CAUT_V2_REF "2\n. 0 0 -1 0\n@1 0 0 -1 0\n"
+#define BAD_GR1CAUT_V2_TRANS "2\n. 0 0 -1 0\n0:1 0 0 -1 1\n"
+
 /* Trivial reference in gr1caut v0 format; state length of 2. */
 #define REF_GR1CAUT_TRIVIAL_V0 \
 "0 1 0 0 2 1 2\n" \
@@ -37,8 +61,14 @@
 "2 1 1 1 1 1 0\n"
 
 
+/* Long lines: state vector length and out-degree of LONG_LEN, with
+   node 0 having all ones and node 1 all zeros. */
+#define LONG_LEN 3000
+
+
 #define STRING_MAXLEN 2048
-anode_t *aut_aut_loads( char *autstr, int state_len )
+/* Load automaton from the string autstr, or return NULL if error. */
+anode_t *aut_aut_loads_try( char *autstr, int state_len )
 {
     int fd;
     FILE *fp;
@@ -67,11 +97,6 @@ anode_t *aut_aut_loads( char *autstr, int state_len )
 
     /* Load in "gr1c automaton" format */
     head = aut_aut_load( state_len, fp );
-    if (head == NULL) {
-        ERRPRINT( "Failed to read automaton "
-                  "in \"gr1c automaton\" format." );
-        abort();
-    }
 
     fclose( fp );
     if (remove( filename )) {
@@ -82,6 +107,17 @@ anode_t *aut_aut_loads( char *autstr, int state_len )
     return head;
 }
 
+anode_t *aut_aut_loads( char *autstr, int state_len )
+{
+    anode_t *head = aut_aut_loads_try( autstr, state_len );
+    if (head == NULL) {
+        ERRPRINT( "Failed to read automaton "
+                  "in \"gr1c automaton\" format." );
+        abort();
+    }
+    return head;
+}
+
 
 int main( int argc, char **argv )
 {
@@ -91,6 +127,12 @@ int main( int argc, char **argv )
     char instr[STRING_MAXLEN];
     anode_t *head, *node, *out_node;
     vartype state[2], next_state[2];
+    char *longstr, *s;
+    int i;
+#ifdef USE_ZLIB
+    anode_t *loaded;
+    long size;
+#endif
 
     head = aut_aut_loads( REF_GR1CAUT_TRIVIAL, 2 );
 
@@ -220,10 +262,142 @@ int main( int argc, char **argv )
     delete_aut( head );
     head = NULL;
 
+    /* Version 2, which should be the same when dumped in version 1 */
+    head = aut_aut_loads( REF_GR1CAUT_TRIVIAL_MOD_V2, 2 );
+    strcpy( filename, "dumpXXXXXX" );
+    fd = mkstemp( filename );
+    if (fd == -1) {
+        perror( __FILE__ ", mkstemp" );
+        abort();
+    }
+    fp = fdopen( fd, "w+" );
+    if (fp == NULL) {
+        perror( __FILE__ ", fdopen" );
+        abort();
+    }
+    aut_aut_dumpver( head, 2, fp, 1 );
+    if (fseek( fp, 0, SEEK_SET )) {
+        perror( __FILE__ ", fseek" );
+        abort();
+    }
+    memset( instr, '\0', STRING_MAXLEN );
+    if (fread( instr, sizeof(char), STRING_MAXLEN-1, fp )
+        != strlen(REF_GR1CAUT_TRIVIAL_MOD)
+        || strcmp( instr, REF_GR1CAUT_TRIVIAL_MOD )) {
+        ERRPRINT( "version 2 input does not match expectation." );
+        ERRPRINT1( "%s", instr  );
+        ERRPRINT1( "%s", REF_GR1CAUT_TRIVIAL_MOD );
+        abort();
+    }
+    fclose( fp );
+    if (remove( filename )) {
+        perror( __FILE__ ", remove" );
+        abort();
+    }
+    delete_aut( head );
+
+    head = aut_aut_loads( REF_GR1CAUT_DICT_V2, 2 );
+    assert( aut_size( head ) == 3 );
+    node = head->next->next;
+    assert( *(node->state) == 0 && *(node->state+1) == 0 );
+    assert( *(head->next->state) == 1 && *(head->next->state+1) == 0 );
+    assert( head->initial && !node->initial );
+    assert( head->trans_len == 2 && *(head->trans) == head->next
+            && *(head->trans+1) == node );
+    assert( node->trans_len == 1 && *(node->trans) == head->next );
+    delete_aut( head );
+
+    assert( aut_aut_loads_try( BAD_GR1CAUT_V2_POS, 2 ) == NULL );
+    assert( aut_aut_loads_try( BAD_GR1CAUT_V2_REF, 2 ) == NULL );
+    assert( aut_aut_loads_try( BAD_GR1CAUT_V2_TRANS, 2 ) == NULL );
+
     head = aut_aut_loads( REF_GR1CAUT_TRIVIAL_V0, 2 );
     assert( aut_size( head ) == 3 );
     delete_aut( head );
     head = NULL;
 
+    /* Lines much longer than any read buffer of a previous
+       implementation; ID 1 is given first. */
+    longstr = malloc( 8*(2*LONG_LEN+10) );
+    assert( longstr != NULL );
+    s = longstr;
+    s += sprintf( s, "1\n1" );
+    for (i = 0; i < LONG_LEN; i++)
+        s += sprintf( s, " 0" );
+    s += sprintf( s, " 0 0 -1 0\n0" );
+    for (i = 0; i < LONG_LEN; i++)
+        s += sprintf( s, " 1" );
+    s += sprintf( s, " 1 0 -1" );
+    for (i = 0; i < LONG_LEN; i++)
+        s += sprintf( s, " %d", i%2 );
+    sprintf( s, "\n" );
+    head = aut_aut_loads( longstr, LONG_LEN );
+    free( longstr );
+    assert( aut_size( head ) == 2 );
+    assert( head->initial && !head->next->initial );
+    assert( *(head->state) == 1 && *(head->state+LONG_LEN-1) == 1 );
+    assert( *(head->next->state+LONG_LEN-1) == 0 );
+    if (head->trans_len != LONG_LEN) {
+        ERRPRINT1( "node should have %d outgoing transitions", LONG_LEN );
+        ERRPRINT1( "but actually has %d.", head->trans_len );
+        abort();
+    }
+    assert( *(head->trans) == head && *(head->trans+LONG_LEN-1) == head->next );
+    assert( head->next->trans_len == 1 && *(head->next->trans) == head );
+
+#ifdef USE_ZLIB
+    /* Round trip through gzip-compressed file */
+    strcpy( filename, "dumpXXXXXX" );
+    fd = mkstemp( filename );
+    if (fd == -1) {
+        perror( __FILE__ ", mkstemp" );
+        abort();
+    }
+    fp = fdopen( fd, "w+b" );
+    if (fp == NULL) {
+        perror( __FILE__ ", fdopen" );
+        abort();
+    }
+    assert( aut_dump_set_compression( 10 ) );
+    assert( !aut_dump_set_compression( 6 ) );
+    assert( !aut_aut_dumpver( head, LONG_LEN, fp, 1 ) );
+    assert( !aut_dump_set_compression( 0 ) );
+    fflush( fp );
+    size = ftell( fp );
+    assert( size == aut_last_dump_bytes() );
+    assert( size < 4*LONG_LEN );  /* Text is more than 8*LONG_LEN */
+    rewind( fp );
+    assert( getc( fp ) == 0x1f && getc( fp ) == 0x8b );
+    rewind( fp );
+    loaded = aut_aut_load( LONG_LEN, fp );
+    if (loaded == NULL) {
+        ERRPRINT( "Failed to read compressed automaton." );
+        abort();
+    }
+    assert( aut_size( loaded ) == 2 );
+    assert( loaded->initial && !loaded->next->initial );
+    assert( *(loaded->state) == 1 && *(loaded->next->state+LONG_LEN-1) == 0 );
+    assert( loaded->trans_len == LONG_LEN
+            && *(loaded->trans+LONG_LEN-1) == loaded->next );
+    delete_aut( loaded );
+
+    /* Truncated compressed file */
+    if (ftruncate( fd, size/2 )) {
+        perror( __FILE__ ", ftruncate" );
+        abort();
+    }
+    rewind( fp );
+    assert( aut_aut_load( LONG_LEN, fp ) == NULL );
+
+    fclose( fp );
+    if (remove( filename )) {
+        perror( __FILE__ ", remove" );
+        abort();
+    }
+#endif
+
+    delete_aut( head );
+    head = NULL;
+
     return 0;
 }
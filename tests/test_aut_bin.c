@@ -0,0 +1,213 @@
+/* Unit tests for the gr1c binary strategy format: bin_aut_dump(),
+ * aut_bin_open(), aut_bin_find(), and bin_aut_loadver().
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "common.h"
+#include "tests_common.h"
+#include "ptree.h"
+#include "automaton.h"
+
+
+/* Wide enough that packed states straddle 64-bit words. */
+#define STATE_LEN 7
+#define NUM_NODES 3
+
+vartype states[NUM_NODES][STATE_LEN] = {{0, 1, 40000, 3, 99999, 1, -1},
+                                        {1, 0, 0, 2, 123456, 0, 7},
+                                        {1, 1, 65535, 0, 0, 1, 0}};
+
+
+/* Compare the given automaton with that built from states, in which
+   node i has mode i, rgrad -i, is initial iff i is even, and has
+   transitions to itself and to node (i+1)%NUM_NODES. */
+void check_aut( anode_t *head )
+{
+    anode_t *node = head;
+    int i, j;
+
+    for (i = 0; i < NUM_NODES; i++) {
+        assert( node != NULL );
+        for (j = 0; j < STATE_LEN; j++) {
+            if (*(node->state+j) != states[i][j]) {
+                ERRPRINT2( "loaded state of node %d differs at element %d.",
+                           i, j );
+                abort();
+            }
+        }
+        assert( node->mode == i && node->rgrad == -i );
+        assert( node->initial == (i%2 == 0) );
+        assert( node->trans_len == 2 );
+        assert( anode_index( head, *(node->trans) ) == i );
+        assert( anode_index( head, *(node->trans+1) ) == (i+1)%NUM_NODES );
+        node = node->next;
+    }
+    assert( node == NULL );
+}
+
+
+int main(void)
+{
+    int fd;
+    FILE *fp;
+    char filename[32];
+    anode_t *head = NULL, *loaded;
+    anode_t *nodes[NUM_NODES];
+    aut_bin_t *bin;
+    ptree_t *evar_list, *svar_list;
+    vartype state[STATE_LEN];
+    int version;
+    int i, j;
+
+    for (i = NUM_NODES-1; i >= 0; i--) {
+        head = insert_anode( head, i, -i, (i%2 == 0), states[i], STATE_LEN );
+        nodes[i] = head;
+    }
+    for (i = 0; i < NUM_NODES; i++) {
+        nodes[i]->trans = malloc( 2*sizeof(anode_t *) );
+        assert( nodes[i]->trans );
+        nodes[i]->trans_len = 2;
+        *(nodes[i]->trans) = nodes[i];
+        *(nodes[i]->trans+1) = nodes[(i+1)%NUM_NODES];
+    }
+
+    evar_list = init_ptree( PT_VARIABLE, "x", -1 );
+    append_list_item( evar_list, PT_VARIABLE, "y", -1 );
+    svar_list = init_ptree( PT_VARIABLE, "z", 65535 );
+    for (i = 3; i < STATE_LEN; i++) {
+        sprintf( filename, "v%d", i );
+        append_list_item( svar_list, PT_VARIABLE, filename, -1 );
+    }
+
+    strcpy( filename, "dumpXXXXXX" );
+    fd = mkstemp( filename );
+    if (fd == -1) {
+        perror( __FILE__ ", mkstemp" );
+        abort();
+    }
+    fp = fdopen( fd, "w+" );
+    if (fp == NULL) {
+        perror( __FILE__ ", fdopen" );
+        abort();
+    }
+
+
+    /* Mismatched variable lists are rejected. */
+    assert( bin_aut_dump( head, evar_list, svar_list, STATE_LEN-1, fp ) );
+
+
+    /************************************************
+     * View of mapped file, with variable names
+     ************************************************/
+    if (bin_aut_dump( head, evar_list, svar_list, STATE_LEN, fp )) {
+        ERRPRINT( "bin_aut_dump failed." );
+        abort();
+    }
+    assert( aut_last_dump_bytes() % 8 == 0 );
+    fflush( fp );
+    rewind( fp );
+    bin = aut_bin_open( fp );
+    if (bin == NULL) {
+        ERRPRINT( "failed to open view of binary strategy." );
+        abort();
+    }
+    assert( bin->version == BIN_AUT_VERSION );
+    assert( bin->state_len == STATE_LEN && bin->num_env == 2 );
+    assert( bin->num_nodes == NUM_NODES && bin->num_edges == 2*NUM_NODES );
+    assert( !strcmp( *(bin->names), "x" ) && !strcmp( *(bin->names+2), "z" )
+            && !strcmp( *(bin->names+STATE_LEN-1), "v6" ) );
+    assert( *(bin->widths+2) == 16 && *(bin->widths+STATE_LEN-1) == 32 );
+    assert( bin->row_words == 2 );
+    for (i = 0; i < NUM_NODES; i++) {
+        aut_bin_state( bin, i, state );
+        for (j = 0; j < STATE_LEN; j++)
+            assert( state[j] == states[i][j] );
+        assert( *(bin->modes+i) == i && *(bin->rgrads+i) == -i );
+        assert( *(bin->initial+i) == (i%2 == 0) );
+        assert( *(bin->offsets+i+1) - *(bin->offsets+i) == 2 );
+        assert( *(bin->targets + *(bin->offsets+i)+1) == (i+1)%NUM_NODES );
+    }
+
+    /* Lookup of nodes by state and mode */
+    for (i = 0; i < NUM_NODES; i++) {
+        assert( aut_bin_find( bin, states[i], -1, -1 ) == i );
+        assert( aut_bin_find( bin, states[i], i, -1 ) == i );
+        assert( aut_bin_find( bin, states[i], i+1, -1 ) == -1 );
+        assert( aut_bin_find( bin, states[i], -1, i ) == -1 );
+    }
+    memcpy( state, states[0], STATE_LEN*sizeof(vartype) );
+    state[2] = 65536;  /* Wider than recorded for this variable */
+    assert( aut_bin_find( bin, state, -1, -1 ) == -1 );
+    state[2] = 40000;
+    state[0] = 1;
+    assert( aut_bin_find( bin, state, -1, -1 ) == -1 );
+    aut_bin_close( bin );
+
+    rewind( fp );
+    loaded = bin_aut_loadver( STATE_LEN, fp, &version );
+    if (loaded == NULL) {
+        ERRPRINT( "failed to load binary strategy." );
+        abort();
+    }
+    assert( version == BIN_AUT_VERSION );
+    check_aut( loaded );
+    delete_aut( loaded );
+
+    /* Wrong state vector length */
+    rewind( fp );
+    assert( bin_aut_loadver( STATE_LEN+1, fp, NULL ) == NULL );
+
+
+    /************************************************
+     * Buffered read, without variable names
+     ************************************************/
+    rewind( fp );
+    if (ftruncate( fd, 0 )) {
+        perror( __FILE__ ", ftruncate" );
+        abort();
+    }
+    fputc( '#', fp );
+    if (bin_aut_dump( head, NULL, NULL, STATE_LEN, fp )) {
+        ERRPRINT( "bin_aut_dump failed." );
+        abort();
+    }
+    fflush( fp );
+    if (fseek( fp, 1, SEEK_SET )) {
+        perror( __FILE__ ", fseek" );
+        abort();
+    }
+    loaded = bin_aut_loadver( -1, fp, NULL );
+    if (loaded == NULL) {
+        ERRPRINT( "failed to load binary strategy not at start of file." );
+        abort();
+    }
+    check_aut( loaded );
+    delete_aut( loaded );
+
+    /* Truncated file */
+    if (ftruncate( fd, 1+aut_last_dump_bytes()-8 )) {
+        perror( __FILE__ ", ftruncate" );
+        abort();
+    }
+    if (fseek( fp, 1, SEEK_SET )) {
+        perror( __FILE__ ", fseek" );
+        abort();
+    }
+    assert( aut_bin_open( fp ) == NULL );
+
+    fclose( fp );
+    if (remove( filename )) {
+        perror( __FILE__ ", remove" );
+        abort();
+    }
+    delete_aut( head );
+    delete_tree( evar_list );
+    delete_tree( svar_list );
+    return 0;
+}
@@ -0,0 +1,198 @@
+/* Unit tests for Monte Carlo simulation of strategies: aut_sim_run().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common.h"
+#include "tests_common.h"
+#include "automaton.h"
+#include "aut_sim.h"
+
+
+#define NUM_PLAYS 4000
+
+
+/* Return a view of the automaton in which node i has state i, the
+   given mode and reach annotation value (-1 if rgrads is NULL), and
+   transitions to the nodes listed in succ[i], ending with -1.  Only
+   node 0 is initial. */
+aut_bin_t *build_view( int num_nodes, int *modes, int *rgrads,
+                       int succ[][3] )
+{
+    anode_t *head = NULL, *nodes[4];
+    aut_bin_t *bin;
+    FILE *fp;
+    vartype state;
+    int i, j;
+
+    for (i = num_nodes-1; i >= 0; i--) {
+        state = i;
+        head = insert_anode( head, modes[i],
+                             (rgrads == NULL) ? -1 : rgrads[i], (i == 0),
+                             &state, 1 );
+        nodes[i] = head;
+    }
+    for (i = 0; i < num_nodes; i++) {
+        for (j = 0; succ[i][j] >= 0; j++) ;
+        nodes[i]->trans_len = j;
+        nodes[i]->trans = malloc( (j+1)*sizeof(anode_t *) );
+        if (nodes[i]->trans == NULL) {
+            perror( __FILE__ ",  malloc" );
+            abort();
+        }
+        for (j = 0; j < nodes[i]->trans_len; j++)
+            *(nodes[i]->trans+j) = nodes[succ[i][j]];
+    }
+
+    fp = tmpfile();
+    if (fp == NULL) {
+        perror( __FILE__ ",  tmpfile" );
+        abort();
+    }
+    if (bin_aut_dump( head, NULL, NULL, 1, fp )) {
+        ERRPRINT( "bin_aut_dump failed." );
+        abort();
+    }
+    fflush( fp );
+    rewind( fp );
+    bin = aut_bin_open( fp );
+    fclose( fp );
+    if (bin == NULL) {
+        ERRPRINT( "failed to open view of binary strategy." );
+        abort();
+    }
+    delete_aut( head );
+    return bin;
+}
+
+void check_same_stats( aut_sim_stats_t *s1, aut_sim_stats_t *s2 )
+{
+    int i;
+    if (s1->num_plays != s2->num_plays || s1->num_steps != s2->num_steps
+        || s1->num_blocked != s2->num_blocked
+        || s1->num_goals != s2->num_goals
+        || s1->num_cycles != s2->num_cycles
+        || s1->cycle_min != s2->cycle_min || s1->cycle_max != s2->cycle_max
+        || s1->cycle_sum != s2->cycle_sum) {
+        ERRPRINT( "statistics depend on the number of threads." );
+        abort();
+    }
+    for (i = 0; i < s1->num_goals; i++) {
+        if (*(s1->goal_visits+i) != *(s2->goal_visits+i)) {
+            ERRPRINT1( "visits of goal mode %d depend on the number of"
+                       " threads.", i );
+            abort();
+        }
+    }
+}
+
+
+/* Check the counts of a run, where goal_visits is that of each goal. */
+void check_stats( aut_sim_stats_t *stats, int num_plays, uint64_t num_steps,
+                  int num_blocked, int num_goals, uint64_t goal_visits,
+                  uint64_t num_cycles, int cycle_len )
+{
+    int i;
+    if (stats->num_plays != num_plays || stats->num_steps != num_steps
+        || stats->num_blocked != num_blocked) {
+        ERRPRINT2( "unexpected %d plays or %d blocked plays.",
+                   stats->num_plays, stats->num_blocked );
+        fprintf( stderr, "%llu steps; expected %d, %llu, %d\n",
+                 (unsigned long long)stats->num_steps, num_plays,
+                 (unsigned long long)num_steps, num_blocked );
+        abort();
+    }
+    if (stats->num_goals != num_goals) {
+        ERRPRINT2( "%d goal modes detected; expected %d.",
+                   stats->num_goals, num_goals );
+        abort();
+    }
+    for (i = 0; i < num_goals; i++) {
+        if (*(stats->goal_visits+i) != goal_visits) {
+            ERRPRINT2( "goal mode %d has %llu visits.", i,
+                       (unsigned long long)*(stats->goal_visits+i) );
+            abort();
+        }
+    }
+    if (stats->num_cycles != num_cycles
+        || stats->cycle_sum != num_cycles*cycle_len
+        || stats->cycle_min != cycle_len || stats->cycle_max != cycle_len) {
+        ERRPRINT1( "unexpected %llu mode cycles or their lengths.",
+                   (unsigned long long)stats->num_cycles );
+        abort();
+    }
+}
+
+
+int main(void)
+{
+    /* Cycle 0 -> 1 -> 2 -> 0, with modes 0, 1, 1 */
+    int cycle_modes[3] = {0, 1, 1};
+    int cycle_succ[3][3] = {{1, -1}, {2, -1}, {0, -1}};
+    /* The same cycle for a single goal, which holds at node 2 */
+    int single_modes[3] = {0, 0, 0};
+    int single_rgrads[3] = {2, 1, 0};
+    /* Node 0 has mode 0 and moves to 1 (mode 1), which returns to 0,
+       or to the dead end 2 (mode 0). */
+    int branch_modes[3] = {0, 1, 0};
+    int branch_succ[3][3] = {{1, 2, -1}, {0, -1}, {-1}};
+    aut_bin_t *bin;
+    aut_sim_stats_t stats, stats_threaded;
+
+    bin = build_view( 3, cycle_modes, NULL, cycle_succ );
+    if (aut_sim_run( bin, 10, 9, 0, 1, &stats )) {
+        ERRPRINT( "aut_sim_run failed on cycle of two goal modes." );
+        abort();
+    }
+    check_stats( &stats, 10, 90, 0, 2, 30, 30, 3 );
+    aut_sim_free( &stats );
+    aut_bin_close( bin );
+
+    /* Each play arrives at node 2 after steps 2, 5, and 8, and does
+       not begin at the goal, so it completes two cycles. */
+    bin = build_view( 3, single_modes, single_rgrads, cycle_succ );
+    if (aut_sim_run( bin, 10, 9, 0, 1, &stats )) {
+        ERRPRINT( "aut_sim_run failed on cycle of a single goal." );
+        abort();
+    }
+    check_stats( &stats, 10, 90, 0, 1, 30, 20, 3 );
+    aut_sim_free( &stats );
+    aut_bin_close( bin );
+
+    /* Each visit of node 0 ends the play with probability 1/2, so a
+       play has 2K+1 steps, where K is the number of cycles 0 -> 1 -> 0
+       and has mean 1. */
+    bin = build_view( 3, branch_modes, NULL, branch_succ );
+    if (aut_sim_run( bin, NUM_PLAYS, 1000, 42, 1, &stats )) {
+        ERRPRINT( "aut_sim_run failed on branching strategy." );
+        abort();
+    }
+    check_stats( &stats, NUM_PLAYS, 2*stats.num_cycles + NUM_PLAYS,
+                 NUM_PLAYS, 2, stats.num_cycles, stats.num_cycles, 2 );
+    if (stats.num_cycles < 0.9*NUM_PLAYS || stats.num_cycles > 1.1*NUM_PLAYS) {
+        ERRPRINT1( "%d cycles is far from the expected number.",
+                   (int)stats.num_cycles );
+        abort();
+    }
+
+    if (aut_sim_run( bin, NUM_PLAYS, 1000, 42, 4, &stats_threaded )) {
+        ERRPRINT( "aut_sim_run failed using 4 threads." );
+        abort();
+    }
+    check_same_stats( &stats, &stats_threaded );
+    aut_sim_free( &stats_threaded );
+    if (aut_sim_run( bin, NUM_PLAYS, 1000, 43, 4, &stats_threaded )) {
+        ERRPRINT( "aut_sim_run failed using 4 threads." );
+        abort();
+    }
+    if (stats_threaded.num_steps == stats.num_steps) {
+        ERRPRINT( "plays from different seeds have the same length." );
+        abort();
+    }
+    aut_sim_free( &stats_threaded );
+    aut_sim_free( &stats );
+    aut_bin_close( bin );
+
+    return 0;
+}
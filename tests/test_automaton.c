@@ -17,6 +17,7 @@ int main( int argc, char **argv )
     int i, j;  /* Generic counters */
     anode_t *head, *backup_head;
     anode_t *node;  /* Generic node, used for multiple purposes */
+    aut_numbering_t *numbering;
     vartype **nodes_states = NULL;
     int state_len = 10;
     int *modes = NULL;
@@ -134,6 +135,20 @@ int main( int argc, char **argv )
         abort();
     }
 
+    numbering = aut_number_nodes( head );
+    for (node = head; node; node = node->next) {
+        if (aut_numbering_index( numbering, node )
+            != anode_index( head, node )) {
+            ERRPRINT( "numbering of nodes disagrees with anode_index()." );
+            abort();
+        }
+    }
+    if (aut_numbering_index( numbering, NULL ) != -1) {
+        ERRPRINT( "numbering found node when none should match." );
+        abort();
+    }
+    delete_aut_numbering( numbering );
+
     /* Test removal of edges to first successor node of `head`.
        Before removing it, ensure that there is at least one such
        transition.  */
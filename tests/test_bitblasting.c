@@ -15,7 +15,7 @@ int main( int argc, char **argv )
 {
     ptree_t *head = NULL;
 
-    head = var_to_bool( "x", 2 );
+    head = var_to_bool( "x", 2, NONBOOL_ENC_BINARY );
     if (head == NULL) {
         ERRPRINT( "var_to_bool() unexpectedly returned NULL (error)." );
         abort();
@@ -35,5 +35,41 @@ int main( int argc, char **argv )
     delete_tree( head );
     head = NULL;
 
+    head = var_to_bool( "x", 2, NONBOOL_ENC_ONEHOT );
+    if (tree_size( head ) != 3) {
+        ERRPRINT1( "var_to_bool() returned list of %d one-hot variables, "
+                   "rather than list of length 3.",
+                   tree_size( head ) );
+        abort();
+    }
+    delete_tree( head );
+
+    /* x = 2 in Gray code is 11, i.e., x0 & x1 */
+    head = init_ptree( PT_EQUALS, NULL, 0 );
+    head->left = init_ptree( PT_VARIABLE, "x", 0 );
+    head->right = init_ptree( PT_CONSTANT, NULL, 2 );
+    head = expand_to_bool( head, "x", 2, NONBOOL_ENC_GRAY );
+    if (head == NULL || head->type != PT_AND
+        || head->left->type != PT_VARIABLE || head->right->type != PT_VARIABLE
+        || strcmp( "x0", head->left->name )
+        || strcmp( "x1", head->right->name )) {
+        ERRPRINT( "unexpected expansion of \"x = 2\" in Gray code" );
+        abort();
+    }
+    delete_tree( head );
+
+    /* x' = 1 in one-hot encoding is x1' */
+    head = init_ptree( PT_EQUALS, NULL, 0 );
+    head->left = init_ptree( PT_NEXT_VARIABLE, "x", 0 );
+    head->right = init_ptree( PT_CONSTANT, NULL, 1 );
+    head = expand_to_bool( head, "x", 2, NONBOOL_ENC_ONEHOT );
+    if (head == NULL || head->type != PT_NEXT_VARIABLE
+        || strcmp( "x1", head->name )) {
+        ERRPRINT( "unexpected expansion of \"x' = 1\" in one-hot encoding" );
+        abort();
+    }
+    delete_tree( head );
+    head = NULL;
+
     return 0;
 }
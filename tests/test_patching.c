@@ -16,6 +16,32 @@
 specification_t spc;
 
 
+/* Strategy for the second test fixture below, in gr1c automaton
+   format, and changes that block the cells 2 and 5 of its path. */
+#define PATCH_STRATEGY \
+    "1\n" \
+    "0 0 0 0 1 1 3 1\n" "1 1 0 0 0 1 2 2\n" \
+    "2 0 1 0 0 1 1 3\n" "3 1 1 0 0 1 0 4\n" \
+    "4 1 1 1 0 0 4 5\n" "5 0 0 1 0 0 3 6\n" \
+    "6 1 0 1 0 0 2 7\n" "7 0 1 1 0 0 1 8\n" \
+    "8 0 0 0 0 0 0 0\n"
+#define PATCH_CHANGES \
+    "1 0 0\n" "0 1 0\n" "1 1 0\n" "0 0 1\n" "1 0 1\n" "0 1 1\n" \
+    "blocksys 0 1 0\n" "blocksys 1 0 1\n"
+
+/* Return a temporary stream containing str, positioned at the start. */
+FILE *tmpfile_str( char *str )
+{
+    FILE *fp = tmpfile();
+    if (fp == NULL) {
+        perror( __FILE__ ",  tmpfile" );
+        abort();
+    }
+    fputs( str, fp );
+    rewind( fp );
+    return fp;
+}
+
 #define STRING_MAXLEN 60
 int main( int argc, char **argv )
 {
@@ -34,6 +60,10 @@ int main( int argc, char **argv )
     DdNode **vars, **pvars;
     anode_t *start_node, *stop_node;
 
+    int num_threads, cell;
+    FILE *strategy_fp, *change_fp, *dump_fp[2];
+    int c;
+
     SPC_INIT( spc );
 
     /*************************************************************
@@ -221,5 +251,118 @@ int main( int argc, char **argv )
     for (i = 0; i < Exit_len; i++)
         delete_aut( *(Exit+i) );
     free( Exit );
+
+
+    /*************************************************************
+       # **Test fixture**
+
+       ENV:;
+       SYS: y0 y1 y2;
+
+       ENVINIT:;
+       ENVTRANS:;
+       ENVGOAL:;
+
+       SYSINIT:;
+       SYSTRANS:;
+       SYSGOAL: []<>(!y0 & !y1 & !y2) & []<>(y0 & y1 & !y2);
+
+       Read y0 y1 y2 as the binary numeral of a cell.  The strategy
+       PATCH_STRATEGY visits the cells 0, 1, 2, 3, 7, 4, 5, 6 in turn,
+       and PATCH_CHANGES blocks the cells 2 and 5, so local games must
+       be solved for both goal modes.  The patched strategy must not
+       depend on the number of threads used to solve them.
+    *************************************************************/
+
+    SPC_INIT( spc );
+    spc.svar_list = append_list_item( NULL, PT_VARIABLE, "y0", -1 );
+    append_list_item( spc.svar_list, PT_VARIABLE, "y1", -1 );
+    append_list_item( spc.svar_list, PT_VARIABLE, "y2", -1 );
+
+    spc.num_sgoals = 2;
+    spc.sys_goals = malloc( spc.num_sgoals*sizeof(ptree_t *) );
+    if (spc.sys_goals == NULL) {
+        perror( __FILE__ ",  malloc" );
+        abort();
+    }
+    node = init_ptree( PT_AND, NULL, 0 );
+    node->left = init_ptree( PT_AND, NULL, 0 );
+    node->left->left = init_ptree( PT_NEG, NULL, 0 );
+    node->left->left->right = init_ptree( PT_VARIABLE, "y0", 0 );
+    node->left->right = init_ptree( PT_NEG, NULL, 0 );
+    node->left->right->right = init_ptree( PT_VARIABLE, "y1", 0 );
+    node->right = init_ptree( PT_NEG, NULL, 0 );
+    node->right->right = init_ptree( PT_VARIABLE, "y2", 0 );
+    *spc.sys_goals = node;
+    node = init_ptree( PT_AND, NULL, 0 );
+    node->left = init_ptree( PT_AND, NULL, 0 );
+    node->left->left = init_ptree( PT_VARIABLE, "y0", 0 );
+    node->left->right = init_ptree( PT_VARIABLE, "y1", 0 );
+    node->right = init_ptree( PT_NEG, NULL, 0 );
+    node->right->right = init_ptree( PT_VARIABLE, "y2", 0 );
+    *(spc.sys_goals+1) = node;
+
+    for (num_threads = 1; num_threads <= 2; num_threads++) {
+        manager = Cudd_Init( 6, 0, CUDD_UNIQUE_SLOTS, CUDD_CACHE_SLOTS, 0 );
+        Cudd_SetMaxCacheHard( manager, (unsigned int)-1 );
+        Cudd_AutodynEnable( manager, CUDD_REORDER_SAME );
+
+        patch_set_threads( num_threads );
+        strategy_fp = tmpfile_str( PATCH_STRATEGY );
+        change_fp = tmpfile_str( PATCH_CHANGES );
+        strategy = patch_localfixpoint( manager, strategy_fp, change_fp,
+                                        0, 3, NULL, NULL, 0 );
+        fclose( strategy_fp );
+        fclose( change_fp );
+        if (strategy == NULL) {
+            ERRPRINT1( "failed to patch small strategy using %d threads.",
+                       num_threads );
+            abort();
+        }
+        for (start_node = strategy; start_node != NULL;
+             start_node = start_node->next) {
+            cell = *(start_node->state) + 2*(*(start_node->state+1))
+                + 4*(*(start_node->state+2));
+            if (cell == 2 || cell == 5) {
+                ERRPRINT2( "strategy patched using %d threads visits"
+                           " blocked cell %d.", num_threads, cell );
+                abort();
+            }
+        }
+
+        *(dump_fp+num_threads-1) = tmpfile();
+        if (*(dump_fp+num_threads-1) == NULL) {
+            perror( __FILE__ ",  tmpfile" );
+            abort();
+        }
+        aut_aut_dump( strategy, 3, *(dump_fp+num_threads-1) );
+        rewind( *(dump_fp+num_threads-1) );
+        delete_aut( strategy );
+
+        patch_cache_clear();
+        if (Cudd_CheckZeroRef( manager ) != 0) {
+            ERRPRINT1( "Leaked BDD references; Cudd_CheckZeroRef -> %d.",
+                       Cudd_CheckZeroRef( manager ) );
+            abort();
+        }
+        Cudd_Quit( manager );
+    }
+    patch_set_threads( 1 );
+
+    do {
+        c = fgetc( *dump_fp );
+        if (c != fgetc( *(dump_fp+1) )) {
+            ERRPRINT( "strategies patched using 1 and 2 threads differ." );
+            abort();
+        }
+    } while (c != EOF);
+    fclose( *dump_fp );
+    fclose( *(dump_fp+1) );
+
+    delete_tree( spc.svar_list );
+    for (i = 0; i < spc.num_sgoals; i++)
+        delete_tree( *(spc.sys_goals+i) );
+    free( spc.sys_goals );
+
     return 0;
 }
@@ -0,0 +1,78 @@
+/* Unit tests for counting of solver phases: perfstat_begin(),
+ * perfstat_end(), and perfstat_dump_json().
+ *
+ * Whether counters are available depends on how gr1c was built and on
+ * the host, so only the recording of phases is checked if they are.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "common.h"
+#include "tests_common.h"
+#include "perfstat.h"
+
+
+#define STRING_MAXLEN 4096
+int main(void)
+{
+    FILE *fp;
+    char data[STRING_MAXLEN];
+    size_t len;
+    int i;
+
+    /* Nothing is recorded before counting is enabled. */
+    perfstat_begin( "outer", -1 );
+    perfstat_end();
+    perfstat_end();  /* Unbalanced ends are ignored. */
+    fp = tmpfile();
+    assert( fp != NULL );
+    assert( !perfstat_dump_json( fp ) );
+    rewind( fp );
+    len = fread( data, 1, STRING_MAXLEN-1, fp );
+    *(data+len) = '\0';
+    assert( strstr( data, "\"phases\": [\n]" ) != NULL );
+    fclose( fp );
+
+    if (perfstat_enable()) {
+        printf( "Performance counters are not available; skipping.\n" );
+        return 0;
+    }
+
+    perfstat_begin( "outer", -1 );
+    for (i = 1; i <= 3; i++) {
+        perfstat_begin( "inner", i%2 );
+        perfstat_end();
+    }
+    /* Deeper than PERFSTAT_MAX_DEPTH */
+    for (i = 0; i < PERFSTAT_MAX_DEPTH+2; i++)
+        perfstat_begin( "deep", i );
+    for (i = 0; i < PERFSTAT_MAX_DEPTH+2; i++)
+        perfstat_end();
+    perfstat_end();
+
+    fp = tmpfile();
+    assert( fp != NULL );
+    assert( !perfstat_dump_json( fp ) );
+    rewind( fp );
+    len = fread( data, 1, STRING_MAXLEN-1, fp );
+    *(data+len) = '\0';
+    fclose( fp );
+    if (strstr( data, "{\"phase\": \"outer\", \"level\": -1, \"depth\": 0,"
+                " \"calls\": 1," ) == NULL
+        || strstr( data, "{\"phase\": \"inner\", \"level\": 1, \"depth\": 1,"
+                   " \"calls\": 2," ) == NULL
+        || strstr( data, "{\"phase\": \"inner\", \"level\": 0, \"depth\": 1,"
+                   " \"calls\": 1," ) == NULL
+        || strstr( data, "\"level\": 14, \"depth\": 15," ) == NULL
+        || strstr( data, "\"level\": 15," ) != NULL) {
+        ERRPRINT( "unexpected records of phases." );
+        ERRPRINT1( "%s", data );
+        abort();
+    }
+
+    perfstat_disable();
+    return 0;
+}
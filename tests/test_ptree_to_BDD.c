@@ -14,7 +14,10 @@
 int main( int argc, char **argv )
 {
     DdManager *manager;
-    DdNode *f;  /* Boolean formula (BDD) */
+    DdNode *f, *g;  /* Boolean formulas (BDDs) */
+    pdag_t *dag;
+    ptree_t **heads;  /* For merging */
+    int dag_len;
     DdNode *ddval;  /* Store result of evaluating a BDD */
     int *cube;
     char manual_eval;
@@ -70,6 +73,109 @@ int main( int argc, char **argv )
     Cudd_RecursiveDeref( manager, f );
 
 
+    /************************************************
+     * Shared subformulas are built only once.
+     ************************************************/
+    dag = init_pdag( var_list, manager );
+    f = pdag_BDD( dag, head );
+    dag_len = dag->len;
+    delete_tree( head );
+    head = NULL;
+    head = pusht_terminal( head, PT_VARIABLE, "c", -1 );
+    head = pusht_operator( head, PT_NEG );
+    head = pusht_terminal( head, PT_VARIABLE, "b", -1 );
+    head = pusht_terminal( head, PT_VARIABLE, "a", -1 );
+    head = pusht_operator( head, PT_AND );
+    head = pusht_operator( head, PT_OR );  /* !c | (a & b) */
+    g = pdag_BDD( dag, head );
+    if (f != g || dag->len != dag_len) {
+        ERRPRINT( "Commuted copy of \"(a & b) | !c\" was not recognized"
+                  " as an existing subformula." );
+        abort();
+    }
+    Cudd_RecursiveDeref( manager, f );
+    Cudd_RecursiveDeref( manager, g );
+    delete_pdag( dag );
+    delete_tree( head );
+
+
+    /************************************************
+     * Long left-deep conjunction chain, ((a & a) & a) & ...
+     ************************************************/
+#define CHAIN_LEN 50000
+    head = init_ptree( PT_VARIABLE, "a", -1 );
+    for (i = 1; i < CHAIN_LEN; i++) {
+        head = pusht_terminal( head, PT_VARIABLE, "a", -1 );
+        head = pusht_operator( head, PT_AND );
+    }
+    f = ptree_BDD( head, var_list, manager );
+    delete_tree( head );
+    head = init_ptree( PT_VARIABLE, "a", -1 );
+    g = ptree_BDD( head, var_list, manager );
+    if (f != g) {
+        ERRPRINT( "BDD of long conjunction chain of \"a\" differs from"
+                  " that of \"a\"." );
+        abort();
+    }
+    Cudd_RecursiveDeref( manager, f );
+    Cudd_RecursiveDeref( manager, g );
+    delete_tree( head );
+
+
+    /************************************************
+     * Conjunction of a, !b, c, a | b, b -> c, in small clusters
+     ************************************************/
+    heads = malloc( 5*sizeof(ptree_t *) );
+    if (heads == NULL) {
+        perror( __FILE__ ",  malloc" );
+        abort();
+    }
+    *heads = init_ptree( PT_VARIABLE, "a", -1 );
+    *(heads+1) = pusht_operator( init_ptree( PT_VARIABLE, "b", -1 ),
+                                 PT_NEG );
+    *(heads+2) = init_ptree( PT_VARIABLE, "c", -1 );
+    *(heads+3) = pusht_terminal( NULL, PT_VARIABLE, "a", -1 );
+    *(heads+3) = pusht_terminal( *(heads+3), PT_VARIABLE, "b", -1 );
+    *(heads+3) = pusht_operator( *(heads+3), PT_OR );
+    *(heads+4) = pusht_terminal( NULL, PT_VARIABLE, "b", -1 );
+    *(heads+4) = pusht_terminal( *(heads+4), PT_VARIABLE, "c", -1 );
+    *(heads+4) = pusht_operator( *(heads+4), PT_IMPLIES );
+    head = merge_ptrees( heads, 5, PT_AND );
+    free( heads );
+    dag = init_pdag( var_list, manager );
+    dag->cluster_size = 2;
+    f = pdag_BDD( dag, head );
+    delete_pdag( dag );
+    g = ptree_BDD( head, var_list, manager );
+    if (f != g) {
+        ERRPRINT( "BDD of merged parse trees built in clusters differs"
+                  " from that built with default cluster size." );
+        abort();
+    }
+    cube = malloc( 3*sizeof(int) );
+    if (cube == NULL) {
+        perror( __FILE__ ",  malloc" );
+        abort();
+    }
+    for (i = 0; i < 8; i++) {
+        *cube = i&1;
+        *(cube+1) = (i >> 1)&1;
+        *(cube+2) = (i >> 2)&1;
+        manual_eval = (*cube && !(*(cube+1)) && *(cube+2));
+        ddval = Cudd_Eval( manager, f, cube );
+        if ((Cudd_IsComplement( ddval ) && manual_eval)
+            || (!Cudd_IsComplement( ddval ) && !manual_eval)) {
+            ERRPRINT( "Conjunction of \"a\", \"!b\", \"c\","
+                      " \"a | b\", \"b -> c\" gave incorrect output." );
+            abort();
+        }
+    }
+    free( cube );
+    Cudd_RecursiveDeref( manager, f );
+    Cudd_RecursiveDeref( manager, g );
+    delete_tree( head );
+
+
     if (Cudd_CheckZeroRef( manager ) != 0) {
         ERRPRINT1( "Leaked BDD references; Cudd_CheckZeroRef -> %d.",
                    Cudd_CheckZeroRef( manager ) );
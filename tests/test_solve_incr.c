@@ -0,0 +1,166 @@
+/* Unit tests for incremental computation of winning sets:
+ * compute_winning_set_incr() against compute_winning_set_BDD().
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "common.h"
+#include "tests_common.h"
+#include "ptree.h"
+#include "solve.h"
+
+specification_t spc;
+
+
+/* Variables are x (env), y and z (sys), and their primed forms. */
+#define NUM_VARS 3
+#define NUM_GAMES 200
+#define NUM_EDITS 8
+
+
+/* Return referenced BDD of the cube given by the bits of k over
+   variables first, ..., first+len-1, and the remaining variables
+   unconstrained. */
+static DdNode *minterm_BDD( DdManager *manager, int k, int first, int len )
+{
+    int cube[2*NUM_VARS];
+    DdNode *f;
+    int i;
+    for (i = 0; i < 2*NUM_VARS; i++)
+        cube[i] = 2;
+    for (i = 0; i < len; i++)
+        cube[first+i] = (k >> i) & 1;
+    f = Cudd_CubeArrayToBdd( manager, cube );
+    Cudd_Ref( f );
+    return f;
+}
+
+/* Return referenced disjunction of about percent of the minterms over
+   the first len variables. */
+static DdNode *random_BDD( DdManager *manager, int len, int percent )
+{
+    DdNode *f, *m, *tmp;
+    int k;
+    f = Cudd_Not( Cudd_ReadOne( manager ) );
+    Cudd_Ref( f );
+    for (k = 0; k < (1 << len); k++) {
+        if (rand() % 100 >= percent)
+            continue;
+        m = minterm_BDD( manager, k, 0, len );
+        tmp = Cudd_bddOr( manager, f, m );
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, f );
+        Cudd_RecursiveDeref( manager, m );
+        f = tmp;
+    }
+    return f;
+}
+
+/* Remove (if remove is True) or add a random edge of the environment (if
+   len is NUM_VARS+1) or of the system (if len is 2*NUM_VARS). */
+static void edit( DdManager *manager, DdNode **trans, int len,
+                  bool remove )
+{
+    DdNode *m, *tmp;
+    m = minterm_BDD( manager, rand() % (1 << len), 0, len );
+    if (remove) {
+        tmp = Cudd_bddAnd( manager, *trans, Cudd_Not( m ) );
+    } else {
+        tmp = Cudd_bddOr( manager, *trans, m );
+    }
+    Cudd_Ref( tmp );
+    Cudd_RecursiveDeref( manager, m );
+    Cudd_RecursiveDeref( manager, *trans );
+    *trans = tmp;
+}
+
+
+int main(void)
+{
+    DdManager *manager;
+    DdNode *etrans, *strans, *egoals[2], *sgoals[2];
+    DdNode *W, *W_ref;
+    winning_incr_t incr;
+    int game, k, i;
+
+    srand( 0 );
+
+    SPC_INIT( spc );
+    spc.evar_list = init_ptree( PT_VARIABLE, "x", 0 );
+    spc.svar_list = init_ptree( PT_VARIABLE, "y", 0 );
+    append_list_item( spc.svar_list, PT_VARIABLE, "z", 0 );
+
+    manager = Cudd_Init( 2*NUM_VARS, 0, CUDD_UNIQUE_SLOTS, CUDD_CACHE_SLOTS, 0 );
+
+    for (game = 0; game < NUM_GAMES; game++) {
+        spc.num_egoals = 1 + rand() % 2;
+        spc.num_sgoals = 1 + rand() % 2;
+        for (i = 0; i < spc.num_egoals; i++)
+            egoals[i] = random_BDD( manager, NUM_VARS, 50 );
+        for (i = 0; i < spc.num_sgoals; i++)
+            sgoals[i] = random_BDD( manager, NUM_VARS, 30 );
+        etrans = random_BDD( manager, NUM_VARS+1, 70 );
+        strans = random_BDD( manager, 2*NUM_VARS, 40 );
+
+        WINNING_INCR_INIT( incr );
+        for (k = 0; k <= NUM_EDITS; k++) {
+            if (k > 0) {
+                /* Mostly edits in one direction, so that both kinds of
+                   reuse occur, and sometimes edits of both rules. */
+                switch (rand() % 5) {
+                case 0:
+                    edit( manager, &strans, 2*NUM_VARS, True );
+                    break;
+                case 1:
+                    edit( manager, &strans, 2*NUM_VARS, False );
+                    break;
+                case 2:
+                    edit( manager, &etrans, NUM_VARS+1, True );
+                    break;
+                case 3:
+                    edit( manager, &etrans, NUM_VARS+1, False );
+                    break;
+                default:
+                    edit( manager, &strans, 2*NUM_VARS, True );
+                    edit( manager, &etrans, NUM_VARS+1, True );
+                    break;
+                }
+            }
+
+            W = compute_winning_set_incr( manager, &incr, etrans, strans,
+                                          egoals, sgoals, 0 );
+            W_ref = compute_winning_set_BDD( manager, etrans, strans,
+                                             egoals, sgoals, 0 );
+            if (W == NULL || W_ref == NULL) {
+                ERRPRINT( "failed to compute winning set." );
+                abort();
+            }
+            if (!Cudd_bddLeq( manager, W, W_ref )
+                || !Cudd_bddLeq( manager, W_ref, W )) {
+                ERRPRINT2( "incremental winning set differs in game %d"
+                           " after %d edits.", game, k );
+                abort();
+            }
+            Cudd_RecursiveDeref( manager, W );
+            Cudd_RecursiveDeref( manager, W_ref );
+        }
+        winning_incr_clear( manager, &incr );
+
+        Cudd_RecursiveDeref( manager, etrans );
+        Cudd_RecursiveDeref( manager, strans );
+        for (i = 0; i < spc.num_egoals; i++)
+            Cudd_RecursiveDeref( manager, egoals[i] );
+        for (i = 0; i < spc.num_sgoals; i++)
+            Cudd_RecursiveDeref( manager, sgoals[i] );
+    }
+
+    if (Cudd_CheckZeroRef( manager ) != 0) {
+        ERRPRINT( "unexpected references remain in the BDD manager." );
+        abort();
+    }
+    Cudd_Quit( manager );
+    delete_tree( spc.evar_list );
+    delete_tree( spc.svar_list );
+    return 0;
+}
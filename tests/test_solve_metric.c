@@ -0,0 +1,260 @@
+/* Unit tests for distances between states: bounds_state() and
+ * bounds_DDset() against enumeration of states, and compute_minmax()
+ * using one thread against using several.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "common.h"
+#include "tests_common.h"
+#include "ptree.h"
+#include "solve_metric.h"
+
+specification_t spc;
+
+
+/* Variables are x (env), y0 and y1 (sys), and their primed forms. */
+#define NUM_VARS 3
+#define NUM_SETS 300
+
+
+/* Return referenced disjunction of about percent of the states. */
+static DdNode *random_BDD( DdManager *manager, int percent )
+{
+    int cube[2*NUM_VARS];
+    DdNode *f, *m, *tmp;
+    int k, i;
+    for (i = 0; i < 2*NUM_VARS; i++)
+        cube[i] = 2;
+    f = Cudd_Not( Cudd_ReadOne( manager ) );
+    Cudd_Ref( f );
+    for (k = 0; k < (1 << NUM_VARS); k++) {
+        if (rand() % 100 >= percent)
+            continue;
+        for (i = 0; i < NUM_VARS; i++)
+            cube[i] = (k >> i) & 1;
+        m = Cudd_CubeArrayToBdd( manager, cube );
+        Cudd_Ref( m );
+        tmp = Cudd_bddOr( manager, f, m );
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, f );
+        Cudd_RecursiveDeref( manager, m );
+        f = tmp;
+    }
+    return f;
+}
+
+static bool is_member( DdManager *manager, DdNode *f, int k )
+{
+    int assignment[2*NUM_VARS];
+    int i;
+    for (i = 0; i < 2*NUM_VARS; i++)
+        assignment[i] = (i < NUM_VARS) ? (k >> i) & 1 : 0;
+    return Cudd_Eval( manager, f, assignment ) == Cudd_ReadOne( manager );
+}
+
+/* 1-norm distance between states given by the bits of k and l */
+static double distance( int k, int l, int *offw, int num_metric_vars )
+{
+    int i, mask;
+    double dist = 0.;
+    for (i = 0; i < num_metric_vars; i++) {
+        mask = (1 << *(offw+2*i+1)) - 1;
+        dist += abs( ((k >> *(offw+2*i)) & mask)
+                     - ((l >> *(offw+2*i)) & mask) );
+    }
+    return dist;
+}
+
+/* Compare with bounds found by enumeration, where -1 means unset. */
+static void check_bounds( double Min, double Max,
+                          double ref_Min, double ref_Max,
+                          char *name, int trial )
+{
+    if (Min != ref_Min || Max != ref_Max) {
+        ERRPRINT2( "%s gave unexpected bounds in trial %d.", name, trial );
+        fprintf( stderr, "%f, %f; expected %f, %f\n",
+                 Min, Max, ref_Min, ref_Max );
+        abort();
+    }
+}
+
+
+int main(void)
+{
+    DdManager *manager;
+    DdNode *T, *G;
+    char *metric_vars[2] = {"y", "x y"};
+    int *offw, num_metric_vars;
+    vartype ref_state[NUM_VARS];
+    int ref;
+    double Min, Max, ref_Min, ref_Max, d, dmin;
+    int trial, k, l, i;
+    DdNode *W, *etrans, *strans, **sgoals;
+    int *num_sublevels[2];
+    double **Min_t[2], **Max_t[2];  /* Bounds using 1 and 3 threads */
+
+    srand( 0 );
+
+    SPC_INIT( spc );
+    spc.evar_list = init_ptree( PT_VARIABLE, "x", 0 );
+    spc.svar_list = init_ptree( PT_VARIABLE, "y0", 0 );
+    append_list_item( spc.svar_list, PT_VARIABLE, "y1", 0 );
+
+    manager = Cudd_Init( 2*NUM_VARS, 0, CUDD_UNIQUE_SLOTS, CUDD_CACHE_SLOTS, 0 );
+
+    for (trial = 0; trial < NUM_SETS; trial++) {
+        offw = get_offsets( metric_vars[trial%2], &num_metric_vars );
+        if (offw == NULL) {
+            ERRPRINT1( "get_offsets failed on \"%s\".", metric_vars[trial%2] );
+            abort();
+        }
+
+        /* Distances from a state */
+        T = random_BDD( manager, 10+rand()%80 );
+        ref = rand() % (1 << NUM_VARS);
+        for (i = 0; i < NUM_VARS; i++)
+            ref_state[i] = (ref >> i) & 1;
+        ref_Min = ref_Max = -1.;
+        for (k = 0; k < (1 << NUM_VARS); k++) {
+            if (!is_member( manager, T, k ))
+                continue;
+            d = distance( k, ref, offw, num_metric_vars );
+            if (ref_Min == -1. || d < ref_Min)
+                ref_Min = d;
+            if (ref_Max == -1. || d > ref_Max)
+                ref_Max = d;
+        }
+        if (bounds_state( manager, T, ref_state, offw, num_metric_vars,
+                          &Min, &Max, 0 )) {
+            ERRPRINT( "bounds_state failed." );
+            abort();
+        }
+        check_bounds( Min, Max, ref_Min, ref_Max, "bounds_state", trial );
+
+        /* Distances to a set, which is sometimes empty */
+        G = random_BDD( manager, (trial%10 == 0) ? 0 : 10+rand()%60 );
+        ref_Min = ref_Max = -1.;
+        for (k = 0; k < (1 << NUM_VARS); k++) {
+            if (!is_member( manager, T, k ))
+                continue;
+            dmin = -1.;
+            for (l = 0; l < (1 << NUM_VARS); l++) {
+                if (!is_member( manager, G, l ))
+                    continue;
+                d = distance( k, l, offw, num_metric_vars );
+                if (dmin == -1. || d < dmin)
+                    dmin = d;
+            }
+            if (dmin == -1.)
+                continue;
+            if (ref_Min == -1. || dmin < ref_Min)
+                ref_Min = dmin;
+            if (ref_Max == -1. || dmin > ref_Max)
+                ref_Max = dmin;
+        }
+        if (bounds_DDset( manager, T, G, offw, num_metric_vars,
+                          &Min, &Max, 0 )) {
+            ERRPRINT( "bounds_DDset failed." );
+            abort();
+        }
+        check_bounds( Min, Max, ref_Min, ref_Max, "bounds_DDset", trial );
+
+        Cudd_RecursiveDeref( manager, T );
+        Cudd_RecursiveDeref( manager, G );
+        free( offw );
+    }
+
+    /* Distance bounds of sublevel sets must not depend on the number
+       of threads.  The system moves y by flipping at most one bit, and
+       has goals y = 0 and y = 3. */
+    spc.env_trans = init_ptree( PT_CONSTANT, NULL, 1 );
+    spc.sys_trans = init_ptree( PT_OR, NULL, 0 );
+    spc.sys_trans->left = init_ptree( PT_EQUIV, NULL, 0 );
+    spc.sys_trans->left->left = init_ptree( PT_NEXT_VARIABLE, "y0", 0 );
+    spc.sys_trans->left->right = init_ptree( PT_VARIABLE, "y0", 0 );
+    spc.sys_trans->right = init_ptree( PT_EQUIV, NULL, 0 );
+    spc.sys_trans->right->left = init_ptree( PT_NEXT_VARIABLE, "y1", 0 );
+    spc.sys_trans->right->right = init_ptree( PT_VARIABLE, "y1", 0 );
+    spc.num_sgoals = 2;
+    spc.sys_goals = malloc( spc.num_sgoals*sizeof(ptree_t *) );
+    if (spc.sys_goals == NULL) {
+        perror( __FILE__ ",  malloc" );
+        abort();
+    }
+    *spc.sys_goals = init_ptree( PT_AND, NULL, 0 );
+    (*spc.sys_goals)->left = init_ptree( PT_NEG, NULL, 0 );
+    (*spc.sys_goals)->left->right = init_ptree( PT_VARIABLE, "y0", 0 );
+    (*spc.sys_goals)->right = init_ptree( PT_NEG, NULL, 0 );
+    (*spc.sys_goals)->right->right = init_ptree( PT_VARIABLE, "y1", 0 );
+    *(spc.sys_goals+1) = init_ptree( PT_AND, NULL, 0 );
+    (*(spc.sys_goals+1))->left = init_ptree( PT_VARIABLE, "y0", 0 );
+    (*(spc.sys_goals+1))->right = init_ptree( PT_VARIABLE, "y1", 0 );
+
+    offw = get_offsets( "y", &num_metric_vars );
+    if (offw == NULL) {
+        ERRPRINT( "get_offsets failed on \"y\"." );
+        abort();
+    }
+    for (trial = 0; trial < 2; trial++) {
+        metric_set_threads( (trial == 0) ? 1 : 3 );
+        if (compute_minmax( manager, &W, &etrans, &strans, &sgoals,
+                            num_sublevels+trial, Min_t+trial, Max_t+trial,
+                            offw, num_metric_vars, 0 )) {
+            ERRPRINT1( "compute_minmax failed in trial %d.", trial );
+            abort();
+        }
+        Cudd_RecursiveDeref( manager, W );
+        Cudd_RecursiveDeref( manager, etrans );
+        Cudd_RecursiveDeref( manager, strans );
+        for (i = 0; i < spc.num_sgoals; i++)
+            Cudd_RecursiveDeref( manager, *(sgoals+i) );
+        free( sgoals );
+    }
+    metric_set_threads( 1 );
+    for (i = 0; i < spc.num_sgoals; i++) {
+        if (*(*num_sublevels+i) != *(*(num_sublevels+1)+i)) {
+            ERRPRINT1( "number of sublevels of goal %d depends on the"
+                       " number of threads.", i );
+            abort();
+        }
+        if (*(*num_sublevels+i) < 3) {
+            ERRPRINT1( "goal %d has too few sublevels to be split among"
+                       " threads.", i );
+            abort();
+        }
+        for (k = 0; k < *(*num_sublevels+i)-1; k++) {
+            if (*(*(*Min_t+i)+k) != *(*(*(Min_t+1)+i)+k)
+                || *(*(*Max_t+i)+k) != *(*(*(Max_t+1)+i)+k)) {
+                ERRPRINT2( "compute_minmax gave different bounds with 1 and"
+                           " 3 threads for goal %d, sublevel %d.", i, k+1 );
+                abort();
+            }
+        }
+    }
+    for (trial = 0; trial < 2; trial++) {
+        for (i = 0; i < spc.num_sgoals; i++) {
+            free( *(*(Min_t+trial)+i) );
+            free( *(*(Max_t+trial)+i) );
+        }
+        free( *(Min_t+trial) );
+        free( *(Max_t+trial) );
+        free( *(num_sublevels+trial) );
+    }
+    free( offw );
+    delete_tree( spc.env_trans );
+    delete_tree( spc.sys_trans );
+    for (i = 0; i < spc.num_sgoals; i++)
+        delete_tree( *(spc.sys_goals+i) );
+    free( spc.sys_goals );
+
+    if (Cudd_CheckZeroRef( manager ) != 0) {
+        ERRPRINT( "unexpected references remain in the BDD manager." );
+        abort();
+    }
+    Cudd_Quit( manager );
+    delete_tree( spc.evar_list );
+    delete_tree( spc.svar_list );
+    return 0;
+}
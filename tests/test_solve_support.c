@@ -5,6 +5,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 
 #include "common.h"
 #include "ptree.h"
@@ -42,6 +43,9 @@ int main( int argc, char **argv )
     int move_counter;
     vartype **env_moves;
     int emoves_len;
+    vartype env_move[3], first_moves[16];
+    int counts[8];
+    uint64_t rng;
 
     /* Repeatable random seed */
     srand( 0 );
@@ -237,6 +241,46 @@ int main( int argc, char **argv )
         compare_bcubes( state, *(env_moves+i), num_env );
     }
 
+
+    /************************************************
+     * Sampling of environment moves
+     ************************************************/
+
+    /* From the second state, each of the 4 moves has x1' = 0 and should
+       be drawn about equally often. */
+    for (i = 0; i < 8; i++)
+        counts[i] = 0;
+    rng = 0;
+    for (i = 0; i < 4000; i++) {
+        if (sample_env_move( manager, cube, state, etrans,
+                             num_env, num_sys, env_move, &rng )) {
+            ERRPRINT( "Failed to sample an environment move." );
+            abort();
+        }
+        if (i < 16)
+            first_moves[i] = 4*env_move[0] + 2*env_move[1] + env_move[2];
+        counts[4*env_move[0] + 2*env_move[1] + env_move[2]]++;
+    }
+    for (i = 0; i < 8; i++) {
+        if ((i < 4 && (counts[i] < 800 || counts[i] > 1200))
+            || (i >= 4 && counts[i] > 0)) {
+            ERRPRINT2( "Environment move %d was sampled %d times of 4000.",
+                       i, counts[i] );
+            abort();
+        }
+    }
+
+    /* The same seed gives the same moves. */
+    rng = 0;
+    for (i = 0; i < 16; i++) {
+        sample_env_move( manager, cube, state, etrans,
+                         num_env, num_sys, env_move, &rng );
+        if (first_moves[i] != 4*env_move[0] + 2*env_move[1] + env_move[2]) {
+            ERRPRINT1( "Sample %d differs after reseeding.", i );
+            abort();
+        }
+    }
+
     Cudd_RecursiveDeref( manager, etrans );
     if (Cudd_CheckZeroRef( manager ) != 0) {
         ERRPRINT1( "Leaked BDD references; Cudd_CheckZeroRef -> %d.",
@@ -0,0 +1,243 @@
+/* Unit tests for compiled specifications: spc_cache_dump_source(),
+ * spc_cache_dump_expanded(), and spc_cache_load().
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "common.h"
+#include "tests_common.h"
+#include "ptree.h"
+#include "solve.h"
+#include "gr1c_util.h"
+#include "spc_cache.h"
+
+
+/* Long enough that recursive traversal of the chain would be risky. */
+#define CHAIN_LEN 200000
+
+
+/* Return nonzero if the two trees differ.  Recursion is only used on
+   right children, which are leaves in the chains built below. */
+int tree_differs( ptree_t *a, ptree_t *b )
+{
+    while (a != NULL && b != NULL) {
+        if (a->type != b->type || a->value != b->value)
+            return 1;
+        if ((a->name == NULL) != (b->name == NULL)
+            || (a->name != NULL && strcmp( a->name, b->name )))
+            return 1;
+        if (tree_differs( a->right, b->right ))
+            return 1;
+        a = a->left;
+        b = b->left;
+    }
+    return a != b;
+}
+
+int array_differs( ptree_t **a, int a_len, ptree_t **b, int b_len )
+{
+    int i;
+    if (a_len != b_len)
+        return 1;
+    for (i = 0; i < a_len; i++) {
+        if (tree_differs( *(a+i), *(b+i) ))
+            return 1;
+    }
+    return 0;
+}
+
+void check_spec( specification_t *expected, specification_t *loaded,
+                 bool with_nonbool )
+{
+    if (tree_differs( expected->evar_list, loaded->evar_list )
+        || tree_differs( expected->svar_list, loaded->svar_list )
+        || (with_nonbool && tree_differs( expected->nonbool_var_list,
+                                          loaded->nonbool_var_list ))
+        || tree_differs( expected->env_init, loaded->env_init )
+        || tree_differs( expected->sys_init, loaded->sys_init )
+        || array_differs( expected->env_trans_array, expected->et_array_len,
+                          loaded->env_trans_array, loaded->et_array_len )
+        || array_differs( expected->sys_trans_array, expected->st_array_len,
+                          loaded->sys_trans_array, loaded->st_array_len )
+        || array_differs( expected->env_goals, expected->num_egoals,
+                          loaded->env_goals, loaded->num_egoals )
+        || array_differs( expected->sys_goals, expected->num_sgoals,
+                          loaded->sys_goals, loaded->num_sgoals )) {
+        ERRPRINT( "loaded specification differs from that dumped." );
+        abort();
+    }
+}
+
+
+/* Delete a chain built by build_chain() without deep recursion. */
+void delete_chain( ptree_t *head )
+{
+    ptree_t *next;
+    while (head != NULL) {
+        next = head->left;
+        head->left = NULL;
+        delete_tree( head );
+        head = next;
+    }
+}
+
+/* x & (y != 1) & x & (y != 1) & ... with len conjunctions */
+ptree_t *build_chain( int len )
+{
+    ptree_t *head = init_ptree( PT_VARIABLE, "x", 0 ), *node;
+    int i;
+    for (i = 0; i < len; i++) {
+        node = init_ptree( PT_AND, NULL, 0 );
+        node->left = head;
+        if (i % 2) {
+            node->right = init_ptree( PT_VARIABLE, "x", 0 );
+        } else {
+            node->right = init_ptree( PT_NOTEQ, NULL, 0 );
+            node->right->left = init_ptree( PT_NEXT_VARIABLE, "y", 0 );
+            node->right->right = init_ptree( PT_CONSTANT, NULL, 1 );
+        }
+        head = node;
+    }
+    return head;
+}
+
+
+int main(void)
+{
+    int fd;
+    FILE *fp;
+    char filename[32];
+    specification_t spec, loaded, loaded_expanded;
+
+    SPC_INIT( spec );
+    spec.evar_list = init_ptree( PT_VARIABLE, "x", -1 );
+    spec.svar_list = init_ptree( PT_VARIABLE, "y", 3 );
+    spec.sys_init = init_ptree( PT_EQUALS, NULL, 0 );
+    spec.sys_init->left = init_ptree( PT_VARIABLE, "y", 0 );
+    spec.sys_init->right = init_ptree( PT_CONSTANT, NULL, 2 );
+    spec.et_array_len = 1;
+    spec.env_trans_array = malloc( sizeof(ptree_t *) );
+    assert( spec.env_trans_array );
+    *spec.env_trans_array = init_ptree( PT_CONSTANT, NULL, 1 );
+    spec.st_array_len = 2;
+    spec.sys_trans_array = malloc( 2*sizeof(ptree_t *) );
+    assert( spec.sys_trans_array );
+    *spec.sys_trans_array = build_chain( CHAIN_LEN );
+    *(spec.sys_trans_array+1) = NULL;
+    spec.num_sgoals = 1;
+    spec.sys_goals = malloc( sizeof(ptree_t *) );
+    assert( spec.sys_goals );
+    *spec.sys_goals = init_ptree( PT_NEG, NULL, 0 );
+    (*spec.sys_goals)->right = init_ptree( PT_VARIABLE, "x", 0 );
+    spec.nonbool_var_list = init_ptree( PT_VARIABLE, "y", 3 );
+
+    strcpy( filename, "spcXXXXXX" );
+    fd = mkstemp( filename );
+    if (fd == -1) {
+        perror( __FILE__ ", mkstemp" );
+        abort();
+    }
+    fp = fdopen( fd, "w+b" );
+    if (fp == NULL) {
+        perror( __FILE__ ", fdopen" );
+        abort();
+    }
+
+    if (spc_cache_dump_source( &spec, SPC_CACHE_GR1, fp )
+        || spc_cache_dump_expanded( &spec, ALL_ENV_EXIST_SYS_INIT, fp )) {
+        ERRPRINT( "failed to dump compiled specification." );
+        abort();
+    }
+    fflush( fp );
+
+
+    /* Source part only */
+    rewind( fp );
+    assert( spc_cache_detect( fp ) );
+    SPC_INIT( loaded );
+    assert( spc_cache_load( fp, SPC_CACHE_ANY, &loaded, NULL, 0, 0 ) == 0 );
+    check_spec( &spec, &loaded, False );
+    assert( loaded.nonbool_var_list == NULL );
+    delete_chain( *loaded.sys_trans_array );
+    *loaded.sys_trans_array = NULL;
+    spc_free( &loaded );
+
+    /* Both parts */
+    rewind( fp );
+    SPC_INIT( loaded );
+    SPC_INIT( loaded_expanded );
+    assert( spc_cache_load( fp, SPC_CACHE_GR1, &loaded, &loaded_expanded,
+                            ALL_ENV_EXIST_SYS_INIT, 0 ) == 1 );
+    check_spec( &spec, &loaded, False );
+    check_spec( &spec, &loaded_expanded, True );
+    delete_chain( *loaded.sys_trans_array );
+    *loaded.sys_trans_array = NULL;
+    spc_free( &loaded );
+    delete_chain( *loaded_expanded.sys_trans_array );
+    *loaded_expanded.sys_trans_array = NULL;
+    spc_free( &loaded_expanded );
+
+    /* Expanded part is ignored if made with other init_flags... */
+    rewind( fp );
+    SPC_INIT( loaded );
+    SPC_INIT( loaded_expanded );
+    assert( spc_cache_load( fp, SPC_CACHE_GR1, &loaded, &loaded_expanded,
+                            ALL_INIT, 0 ) == 0 );
+    assert( loaded_expanded.nonbool_var_list == NULL );
+    delete_chain( *loaded.sys_trans_array );
+    *loaded.sys_trans_array = NULL;
+    spc_free( &loaded );
+
+    /* ...or with another encoding. */
+    assert( !set_nonbool_encoding( "y", NONBOOL_ENC_ONEHOT ) );
+    rewind( fp );
+    SPC_INIT( loaded );
+    SPC_INIT( loaded_expanded );
+    assert( spc_cache_load( fp, SPC_CACHE_GR1, &loaded, &loaded_expanded,
+                            ALL_ENV_EXIST_SYS_INIT, 0 ) == 0 );
+    delete_chain( *loaded.sys_trans_array );
+    *loaded.sys_trans_array = NULL;
+    spc_free( &loaded );
+
+    /* Wrong kind of game */
+    rewind( fp );
+    SPC_INIT( loaded );
+    assert( spc_cache_load( fp, SPC_CACHE_RG, &loaded, NULL, 0, 0 ) == -1 );
+
+    /* Truncated file */
+    if (ftruncate( fd, 100 )) {
+        perror( __FILE__ ", ftruncate" );
+        abort();
+    }
+    rewind( fp );
+    SPC_INIT( loaded );
+    assert( spc_cache_load( fp, SPC_CACHE_GR1, &loaded, NULL, 0, 0 ) == -1 );
+    assert( loaded.evar_list == NULL && loaded.sys_trans_array == NULL );
+
+    /* Text specifications are not detected as compiled. */
+    rewind( fp );
+    if (ftruncate( fd, 0 )) {
+        perror( __FILE__ ", ftruncate" );
+        abort();
+    }
+    fprintf( fp, "ENV: x;\n" );
+    fflush( fp );
+    rewind( fp );
+    assert( !spc_cache_detect( fp ) );
+    assert( getc( fp ) == 'E' );
+
+    fclose( fp );
+    if (remove( filename )) {
+        perror( __FILE__ ", remove" );
+        abort();
+    }
+    delete_chain( *spec.sys_trans_array );
+    *spec.sys_trans_array = NULL;
+    spc_free( &spec );
+    return 0;
+}
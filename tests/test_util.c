@@ -89,10 +89,174 @@ void test_int_to_bitvec(void)
 }
 
 
+void test_nonbool_encodings(void)
+{
+    vartype *bv;
+    int encoding, x;
+    for (encoding = NONBOOL_ENC_BINARY; encoding <= NONBOOL_ENC_ONEHOT;
+         encoding++) {
+        for (x = 0; x < 8; x++) {
+            bv = int_to_nonbool( x, nonbool_num_bits( 7, encoding ), encoding );
+            if (nonbool_to_int( bv, nonbool_num_bits( 7, encoding ),
+                                encoding ) != x) {
+                ERRPRINT2( "Value %d not recovered in encoding %d.",
+                           x, encoding );
+                abort();
+            }
+            free( bv );
+        }
+    }
+
+    /* Gray code of consecutive values differs in one bit */
+    bv = int_to_nonbool( 4, 3, NONBOOL_ENC_GRAY );
+    if (bitvec_to_int( bv, 3 ) != 6) {
+        ERRPRINT( "Unexpected Gray code of 4." );
+        abort();
+    }
+    free( bv );
+
+    set_nonbool_encoding( NULL, NONBOOL_ENC_GRAY );
+    if (parse_nonbool_encodings( "x=onehot,binary,y=gray" )
+        || get_nonbool_encoding( "x" ) != NONBOOL_ENC_ONEHOT
+        || get_nonbool_encoding( "y" ) != NONBOOL_ENC_GRAY
+        || get_nonbool_encoding( "z" ) != NONBOOL_ENC_BINARY) {
+        ERRPRINT( "Encodings were not parsed as expected." );
+        abort();
+    }
+    if (!parse_nonbool_encodings( "x=twohot" )) {
+        ERRPRINT( "Unrecognized encoding was accepted." );
+        abort();
+    }
+    clear_nonbool_encodings();
+    if (get_nonbool_encoding( "x" ) != NONBOOL_ENC_BINARY) {
+        ERRPRINT( "Encodings were not cleared." );
+        abort();
+    }
+}
+
+
+/* Variables a, b, c (env) and x, y, z (sys), with transition rules
+   that pair each env variable with one sys variable. */
+void test_var_order(void)
+{
+    ptree_t *evar_list, *svar_list;
+    ptree_t *sys_trans[3];
+    char *pairs[3][2] = {{"z", "a"}, {"y", "c"}, {"x", "b"}};
+    int *perm, *rank;
+    int i;
+    FILE *fp;
+
+    evar_list = init_ptree( PT_VARIABLE, "a", -1 );
+    append_list_item( evar_list, PT_VARIABLE, "b", -1 );
+    append_list_item( evar_list, PT_VARIABLE, "c", -1 );
+    svar_list = init_ptree( PT_VARIABLE, "x", -1 );
+    append_list_item( svar_list, PT_VARIABLE, "y", -1 );
+    append_list_item( svar_list, PT_VARIABLE, "z", -1 );
+    for (i = 0; i < 3; i++) {
+        sys_trans[i] = pusht_terminal( NULL, PT_NEXT_VARIABLE,
+                                       pairs[i][0], -1 );
+        sys_trans[i] = pusht_terminal( sys_trans[i], PT_VARIABLE,
+                                       pairs[i][1], -1 );
+        sys_trans[i] = pusht_operator( sys_trans[i], PT_EQUIV );
+    }
+
+    perm = force_var_order( evar_list, svar_list, NULL, NULL, NULL, 0,
+                            sys_trans, 3, NULL, 0, NULL, 0, 0 );
+    rank = malloc( 6*sizeof(int) );
+    if (perm == NULL || rank == NULL) {
+        ERRPRINT( "force_var_order failed." );
+        abort();
+    }
+    for (i = 0; i < 6; i++) {
+        if (*(perm+2*i+1) != *(perm+2*i) + 6) {
+            ERRPRINT( "force_var_order did not keep variables adjacent to"
+                      " their primed copies." );
+            abort();
+        }
+        *(rank+*(perm+2*i)) = i;
+    }
+    /* a with z, c with y, b with x */
+    if (abs( *rank - *(rank+5) ) != 1 || abs( *(rank+2) - *(rank+4) ) != 1
+        || abs( *(rank+1) - *(rank+3) ) != 1) {
+        ERRPRINT( "force_var_order did not place related variables"
+                  " together." );
+        abort();
+    }
+    free( perm );
+    free( rank );
+
+    /* Unknown and repeated names are skipped; others go to the bottom. */
+    fp = tmpfile();
+    if (fp == NULL) {
+        perror( __FILE__ ",  tmpfile" );
+        abort();
+    }
+    fprintf( fp, "# comment\n  z'\nq\nz'\n\nb\n" );
+    rewind( fp );
+    perm = load_var_order( fp, evar_list, svar_list );
+    fclose( fp );
+    if (perm == NULL || *perm != 11 || *(perm+1) != 1) {
+        ERRPRINT( "load_var_order gave wrong order at top levels." );
+        abort();
+    }
+    for (i = 2; i < 12; i++) {
+        if (*(perm+i) != (i == 2 ? 0 : i-1)) {
+            ERRPRINT1( "load_var_order gave wrong order at level %d.", i );
+            abort();
+        }
+    }
+    free( perm );
+
+    for (i = 0; i < 3; i++)
+        delete_tree( sys_trans[i] );
+    delete_tree( evar_list );
+    delete_tree( svar_list );
+}
+
+
+void test_rng(void)
+{
+    uint64_t state1 = 42, state2 = 42, state3 = 43;
+    double x, sum = 0.;
+    int i, num_diff = 0;
+
+    for (i = 0; i < 1000; i++) {
+        if (rng_next( &state1 ) != rng_next( &state2 )) {
+            ERRPRINT( "rng_next gave different sequences from one seed." );
+            abort();
+        }
+        if (rng_next( &state1 ) != rng_next( &state3 ))
+            num_diff++;
+        rng_next( &state2 );
+    }
+    if (num_diff < 990) {
+        ERRPRINT1( "Sequences from different seeds matched %d times.",
+                   1000-num_diff );
+        abort();
+    }
+
+    for (i = 0; i < 10000; i++) {
+        x = rng_uniform( &state1 );
+        if (x < 0. || x >= 1.) {
+            ERRPRINT1( "rng_uniform gave %f, outside of [0, 1).", x );
+            abort();
+        }
+        sum += x;
+    }
+    if (sum/10000 < 0.45 || sum/10000 > 0.55) {
+        ERRPRINT1( "Mean of rng_uniform is %f.", sum/10000 );
+        abort();
+    }
+}
+
+
 int main( int argc, char **argv )
 {
     test_bitvec_to_int();
     test_int_to_bitvec();
+    test_nonbool_encodings();
+    test_var_order();
+    test_rng();
 
     return 0;
 }